@@ -119,16 +119,22 @@ Sample usage:
 
 #include <algorithm>
 #include <atomic>
+#include <exception>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <type_traits>
+#include <vector>
 
 #include <glog/logging.h>
 
 #include <folly/ConcurrentSkipList-inl.h>
+#include <folly/Executor.h>
 #include <folly/Likely.h>
 #include <folly/Memory.h>
+#include <folly/ScopeGuard.h>
 #include <folly/detail/Iterators.h>
+#include <folly/synchronization/Latch.h>
 #include <folly/synchronization/MicroSpinLock.h>
 
 namespace folly {
@@ -190,6 +196,84 @@ class ConcurrentSkipList {
     return std::make_shared<ConcurrentSkipList>(height);
   }
 
+  // Create a skiplist holding the elements of the sorted range [first, last).
+  // Instead of searching for each insertion point, the towers are built
+  // bottom-up in a single pass, in time linear in the size of the range.
+  // Of a run of equivalent elements, only the first is kept.
+  template <typename Iter>
+  static std::shared_ptr<SkipListType> createInstanceFromSorted(
+      Iter first, Iter last, const NodeAlloc& alloc = NodeAlloc()) {
+    auto sl = createInstance(heightForSize(std::distance(first, last)), alloc);
+    SortedRun run;
+    // Link even a partially built run, so that sl owns all nodes and frees
+    // them if we throw.
+    SCOPE_EXIT {
+      sl->linkRuns(&run, 1);
+    };
+    sl->buildRun(first, last, run);
+    return sl;
+  }
+
+  // Same as above, but splits the range into `chunks` pieces which are built
+  // in parallel on `executor` and then linked together. Blocks until done,
+  // so `executor` must not be the one running the caller. NodeAlloc must be
+  // thread-safe.
+  template <typename Iter>
+  static std::shared_ptr<SkipListType> createInstanceFromSorted(
+      Executor& executor,
+      size_t chunks,
+      Iter first,
+      Iter last,
+      const NodeAlloc& alloc = NodeAlloc()) {
+    static_assert(
+        std::is_base_of_v<
+            std::random_access_iterator_tag,
+            typename std::iterator_traits<Iter>::iterator_category>,
+        "parallel build needs random access iterators");
+    size_t n = last - first;
+    auto sl = createInstance(heightForSize(n), alloc);
+    chunks = std::max<size_t>(1, std::min(chunks, n));
+    std::vector<SortedRun> runs(chunks);
+    std::vector<std::exception_ptr> errors(chunks);
+    Latch latch(static_cast<ptrdiff_t>(chunks));
+    size_t begin = 0;
+    for (size_t i = 0; i < chunks; ++i) {
+      size_t end = i + 1 == chunks ? n : std::max(begin, n * (i + 1) / chunks);
+      // Don't split a run of equivalent elements across chunks.
+      while (end > begin && end < n && !Comp()(first[end - 1], first[end])) {
+        ++end;
+      }
+      try {
+        executor.add([&, i, begin, end] {
+          try {
+            sl->buildRun(first + begin, first + end, runs[i]);
+          } catch (...) {
+            errors[i] = std::current_exception();
+          }
+          latch.count_down();
+        });
+      } catch (...) {
+        // The chunks already scheduled refer to our locals; wait for them,
+        // and own their nodes, before unwinding.
+        latch.count_down(static_cast<ptrdiff_t>(chunks - i));
+        latch.wait();
+        sl->linkRuns(runs.data(), runs.size());
+        throw;
+      }
+      begin = end;
+    }
+    latch.wait();
+    // Link even partially built runs, so that sl owns all nodes and frees
+    // them if we throw.
+    sl->linkRuns(runs.data(), runs.size());
+    for (auto& e : errors) {
+      if (e) {
+        std::rethrow_exception(e);
+      }
+    }
+    return sl;
+  }
+
   size_t size() const { return size_.load(std::memory_order_relaxed); }
   bool empty() const { return size() == 0; }
 
@@ -526,6 +610,70 @@ class ConcurrentSkipList {
     recycle(oldHead);
   }
 
+  // Head height that the list would have grown to by adding `size` nodes.
+  static int heightForSize(size_t size) {
+    int height = 1;
+    while (height < MAX_HEIGHT &&
+           size > detail::SkipListRandomHeight::instance()->getSizeLimit(
+                      height)) {
+      ++height;
+    }
+    return height;
+  }
+
+  // A sorted chain of fully linked nodes, not yet linked to the list.
+  struct SortedRun {
+    NodeType* firsts[MAX_HEIGHT] = {};
+    NodeType* lasts[MAX_HEIGHT] = {};
+    size_t size = 0;
+  };
+
+  template <typename Iter>
+  void buildRun(Iter first, Iter last, SortedRun& run) {
+    int maxHeight = height();
+    NodeType* prev = nullptr;
+    for (; first != last; ++first) {
+      if (prev && !Comp()(prev->data(), *first)) {
+        DCHECK(!Comp()(*first, prev->data())) << "input is not sorted";
+        continue;
+      }
+      int nodeHeight =
+          detail::SkipListRandomHeight::instance()->getHeight(maxHeight);
+      NodeType* node =
+          NodeType::create(recycler_.alloc(), nodeHeight, *first);
+      for (int k = 0; k < nodeHeight; ++k) {
+        if (run.lasts[k]) {
+          run.lasts[k]->setSkip(k, node);
+        } else {
+          run.firsts[k] = node;
+        }
+        run.lasts[k] = node;
+      }
+      node->setFullyLinked();
+      prev = node;
+      ++run.size;
+    }
+  }
+
+  // Appends the runs, in order, to the list. Only valid while the list is
+  // not shared yet.
+  void linkRuns(SortedRun* runs, size_t count) {
+    NodeType* head = head_.load(std::memory_order_relaxed);
+    NodeType* lasts[MAX_HEIGHT];
+    std::fill(lasts, lasts + head->height(), head);
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+      for (int k = 0; k < head->height(); ++k) {
+        if (runs[i].firsts[k]) {
+          lasts[k]->setSkip(k, runs[i].firsts[k]);
+          lasts[k] = runs[i].lasts[k];
+        }
+      }
+      total += runs[i].size;
+    }
+    size_.store(total, std::memory_order_relaxed);
+  }
+
   void recycle(NodeType* node) { recycler_.add(node); }
 
   detail::NodeRecycler<NodeType, NodeAlloc> recycler_;
@@ -24,6 +24,7 @@
 #include <folly/Optional.h>
 #include <folly/Range.h>
 #include <folly/Utility.h>
+#include <folly/container/span.h>
 #include <folly/lang/Exception.h>
 
 namespace folly {
@@ -194,6 +195,12 @@ class Executor {
   /// This is up to the implementation to enforce
   virtual void addWithPriority(Func, int8_t priority);
 
+  /// Enqueue every function in funcs, leaving them empty. Equivalent to
+  /// calling add() on each in order, which is what the default does;
+  /// executors override it to pay the per-task synchronization (queue
+  /// publish, worker wake-up) once per batch.
+  virtual void addBatch(span<Func> funcs);
+
   virtual uint8_t getNumPriorities() const { return 1; }
 
   static constexpr int8_t LO_PRI = SCHAR_MIN;
@@ -18,6 +18,8 @@
 
 #include <atomic>
 #include <mutex>
+#include <tuple>
+#include <vector>
 
 #include <folly/Optional.h>
 #include <folly/concurrency/detail/ConcurrentHashMap-detail.h>
@@ -324,6 +326,65 @@ class ConcurrentHashMap {
     return res;
   }
 
+  /*
+   * Inserts every pair in [first, last) whose key is not already present,
+   * and returns the number of pairs inserted. Wrap the range in
+   * std::make_move_iterator to move the keys and values out of it; pairs
+   * whose key is already present are left as they were, unless the key is
+   * inserted by another thread while the call is running.
+   *
+   * The range is hashed once and grouped by segment, and each segment is
+   * grown to fit its share of the input before any of it is inserted, so a
+   * segment is rehashed at most once per call instead of once per doubling.
+   * Safe to call concurrently with any other operation; since segments are
+   * locked independently, a large load can be split across threads.
+   */
+  template <typename ForwardIt>
+  size_type insertBulk(ForwardIt first, ForwardIt last) {
+    using Ref = decltype(*first);
+    std::vector<std::pair<size_t, ForwardIt>> hashed;
+    std::vector<size_t> counts(NumShards + 1, 0);
+    for (auto it = first; it != last; ++it) {
+      auto h = HashFn{}(std::get<0>(*it));
+      hashed.emplace_back(h, it);
+      ++counts[pickSegment(h) + 1];
+    }
+    for (uint64_t s = 0; s < NumShards; ++s) {
+      counts[s + 1] += counts[s];
+    }
+    // Counting sort by segment; counts[s] ends up as the end of segment s.
+    std::vector<std::pair<size_t, ForwardIt>> sorted(hashed.size());
+    for (auto& p : hashed) {
+      sorted[counts[pickSegment(p.first)]++] = p;
+    }
+    size_type inserted = 0;
+    size_t begin = 0;
+    for (uint64_t s = 0; s < NumShards; ++s) {
+      size_t end = counts[s];
+      if (begin == end) {
+        continue;
+      }
+      auto seg = ensureSegment(s);
+      seg->reserve(seg->size() + (end - begin));
+      ConstIterator pos(this, s);
+      for (; begin < end; ++begin) {
+        Ref kv = *sorted[begin].second;
+        // The node is built, moving from the pair, before the segment sees
+        // that the key is present; look first so that it is not.
+        if (std::is_rvalue_reference_v<Ref> &&
+            seg->find(pos.it_, sorted[begin].first, std::get<0>(kv))) {
+          continue;
+        }
+        inserted += seg->insert(
+            pos.it_,
+            sorted[begin].first,
+            std::get<0>(std::forward<Ref>(kv)),
+            std::get<1>(std::forward<Ref>(kv)));
+      }
+    }
+    return inserted;
+  }
+
   template <typename Key, typename... Args>
   std::pair<ConstIterator, bool> try_emplace(Key&& k, Args&&... args) {
     auto h = HashFn{}(k);
@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <folly/Optional.h>
+#include <folly/concurrency/ConcurrentHashMap.h>
+#include <folly/lang/Align.h>
+
+#include <glog/logging.h>
+
+namespace folly {
+
+/**
+ * A thread-safe, approximately-LRU evicting cache.
+ *
+ * This is the concurrent counterpart of folly::EvictingCacheMap, intended
+ * for use cases where a Synchronized<EvictingCacheMap> would make the lock
+ * the contention point.
+ *
+ * Readers are wait-free: lookups go through a ConcurrentHashMap and are
+ * protected by hazard pointers, and promotion only sets a per-entry
+ * "referenced" bit with a relaxed store. get() never takes a lock.
+ *
+ * Writers (set, insert, try_emplace, erase, clear) are sharded by hash into
+ * 2^ShardBits shards and take only the lock of their shard. Each shard
+ * maintains its own CLOCK ring (second-chance eviction): when a shard is
+ * full, the clock hand sweeps the ring, clearing referenced bits until it
+ * finds an entry that has not been read since the last sweep, and evicts it.
+ *
+ * The shards are aligned with the segments of the underlying
+ * ConcurrentHashMap, so all updates to a given map segment are serialized by
+ * the same shard lock.
+ *
+ * Differences from EvictingCacheMap:
+ *
+ * * Eviction order is approximate LRU (CLOCK), not exact LRU.
+ *
+ * * maxSize is split evenly across the shards, so each shard holds at most
+ *   ceil(maxSize / 2^ShardBits) entries. The total number of entries never
+ *   exceeds maxSize + 2^ShardBits - 1, and eviction may start before the
+ *   cache as a whole holds maxSize entries if the keys hash unevenly. Use
+ *   ShardBits = 0 for an exact bound.
+ *
+ * * Lookups return copies of the values, since references would not be
+ *   protected once the lookup returns. Use a shared_ptr value type for large
+ *   values.
+ *
+ * * The prune hook receives the evicted entry by const reference, because
+ *   concurrent readers may still be looking at it. It is invoked with the
+ *   shard lock held and must not call back into the cache.
+ *
+ * NOTE: maxSize == 0 disables automatic evictions.
+ */
+template <
+    typename TKey,
+    typename TValue,
+    typename THash = std::hash<TKey>,
+    typename TKeyEqual = std::equal_to<TKey>,
+    uint8_t ShardBits = 6,
+    class Mutex = std::mutex>
+class ConcurrentEvictingCacheMap {
+  struct Entry {
+    template <typename... Args>
+    explicit Entry(std::size_t s, bool ref, Args&&... args)
+        : value(std::forward<Args>(args)...), referenced(ref), slot(s) {}
+
+    // ConcurrentHashMap may copy entries while rehashing a segment. This only
+    // happens with the shard lock held, so slot is stable; a concurrent
+    // promotion of the old copy may be lost, which is harmless.
+    Entry(const Entry& other) noexcept(
+        std::is_nothrow_copy_constructible<TValue>::value)
+        : value(other.value),
+          referenced(other.referenced.load(std::memory_order_relaxed)),
+          slot(other.slot.load(std::memory_order_relaxed)) {}
+
+    Entry& operator=(const Entry&) = delete;
+
+    TValue value;
+    // Set by readers, cleared by the clock hand.
+    mutable std::atomic<bool> referenced;
+    // Index of this entry's key in the clock ring of its shard. Only accessed
+    // with the shard lock held.
+    mutable std::atomic<std::size_t> slot;
+  };
+
+  using Map = ConcurrentHashMap<
+      TKey,
+      Entry,
+      THash,
+      TKeyEqual,
+      std::allocator<uint8_t>,
+      ShardBits,
+      std::atomic,
+      Mutex>;
+
+  static constexpr std::size_t NumShards = std::size_t(1) << ShardBits;
+
+  struct alignas(hardware_destructive_interference_size) Shard {
+    Mutex mutex;
+    std::vector<TKey> ring;
+    std::size_t hand{0};
+  };
+
+ public:
+  using key_type = TKey;
+  using mapped_type = TValue;
+  using hasher = THash;
+  using PruneHookCall = std::function<void(const TKey&, const TValue&)>;
+
+  /**
+   * Construct a ConcurrentEvictingCacheMap
+   * @param maxSize maximum size of the cache map.  Once a shard exceeds its
+   *     share of maxSize, the shard will begin to evict.
+   * @param pruneHook callback invoked for each automatic eviction
+   */
+  explicit ConcurrentEvictingCacheMap(
+      std::size_t maxSize, PruneHookCall pruneHook = nullptr)
+      : map_(maxSize == 0 ? 8 : maxSize + NumShards),
+        maxSize_(maxSize),
+        maxShardSize_(
+            maxSize == 0 ? 0 : (maxSize + NumShards - 1) / NumShards),
+        pruneHook_(std::move(pruneHook)) {}
+
+  ConcurrentEvictingCacheMap(const ConcurrentEvictingCacheMap&) = delete;
+  ConcurrentEvictingCacheMap& operator=(const ConcurrentEvictingCacheMap&) =
+      delete;
+
+  std::size_t getMaxSize() const { return maxSize_; }
+
+  /**
+   * Check for existence of a specific key in the map.  This operation has
+   *     no effect on LRU order.
+   */
+  bool exists(const TKey& key) const { return map_.find(key) != map_.cend(); }
+
+  /**
+   * Get a copy of the value associated with a specific key, marking the
+   *     entry as recently used.  Never blocks.
+   * @return the value if it exists, none otherwise
+   */
+  Optional<TValue> get(const TKey& key) const {
+    auto it = map_.find(key);
+    if (it == map_.cend()) {
+      return none;
+    }
+    auto& entry = it->second;
+    // Avoid dirtying the cache line of hot entries that are already marked.
+    if (!entry.referenced.load(std::memory_order_relaxed)) {
+      entry.referenced.store(true, std::memory_order_relaxed);
+    }
+    return entry.value;
+  }
+
+  /**
+   * Get a copy of the value associated with a specific key without marking
+   *     the entry as recently used.
+   * @return the value if it exists, none otherwise
+   */
+  Optional<TValue> getWithoutPromotion(const TKey& key) const {
+    auto it = map_.find(key);
+    if (it == map_.cend()) {
+      return none;
+    }
+    return it->second.value;
+  }
+
+  /**
+   * Set a key-value pair in the cache, replacing any existing value.
+   * @param promote whether the entry is marked as recently used
+   */
+  void set(const TKey& key, const TValue& value, bool promote = true) {
+    setImpl(key, value, promote);
+  }
+
+  void set(const TKey& key, TValue&& value, bool promote = true) {
+    setImpl(key, std::move(value), promote);
+  }
+
+  /**
+   * Insert a new key-value pair if no element exists for key.
+   * @return true if the insertion took place
+   */
+  bool insert(const TKey& key, const TValue& value) {
+    return try_emplace(key, value);
+  }
+
+  bool insert(const TKey& key, TValue&& value) {
+    return try_emplace(key, std::move(value));
+  }
+
+  /**
+   * Emplace a new key-value pair if no element exists for key.
+   * @return true if the insertion took place
+   */
+  template <typename... Args>
+  bool try_emplace(const TKey& key, Args&&... args) {
+    auto& shard = shardFor(key);
+    std::lock_guard<Mutex> g(shard.mutex);
+    if (map_.find(key) != map_.cend()) {
+      return false;
+    }
+    insertNewLocked(shard, key, std::forward<Args>(args)...);
+    return true;
+  }
+
+  /**
+   * Erase the key-value pair associated with key if it exists.  The prune
+   *     hook is not invoked.
+   * @return true if the key existed and was erased
+   */
+  bool erase(const TKey& key) {
+    auto& shard = shardFor(key);
+    std::lock_guard<Mutex> g(shard.mutex);
+    auto it = map_.find(key);
+    if (it == map_.cend()) {
+      return false;
+    }
+    removeSlotLocked(shard, it->second.slot.load(std::memory_order_relaxed));
+    map_.erase(it);
+    return true;
+  }
+
+  /**
+   * Erase all entries.  The prune hook is not invoked.  Concurrent writers
+   *     to shards that have already been cleared are not affected.
+   */
+  void clear() {
+    for (auto& shard : shards_) {
+      std::lock_guard<Mutex> g(shard.mutex);
+      for (auto& key : shard.ring) {
+        map_.erase(key);
+      }
+      shard.ring.clear();
+      shard.hand = 0;
+    }
+  }
+
+  std::size_t size() const { return map_.size(); }
+
+  bool empty() const { return map_.empty(); }
+
+ private:
+  Shard& shardFor(const TKey& key) {
+    // Same shard selection as ConcurrentHashMap::pickSegment().
+    return shards_[THash{}(key) & (NumShards - 1)];
+  }
+
+  template <typename V>
+  void setImpl(const TKey& key, V&& value, bool promote) {
+    auto& shard = shardFor(key);
+    std::lock_guard<Mutex> g(shard.mutex);
+    auto it = map_.find(key);
+    if (it == map_.cend()) {
+      insertNewLocked(shard, key, std::forward<V>(value));
+      return;
+    }
+    auto slot = it->second.slot.load(std::memory_order_relaxed);
+    bool ref = promote || it->second.referenced.load(std::memory_order_relaxed);
+    map_.insert_or_assign(key, Entry(slot, ref, std::forward<V>(value)));
+  }
+
+  template <typename... Args>
+  void insertNewLocked(Shard& shard, const TKey& key, Args&&... args) {
+    if (maxShardSize_ != 0 && shard.ring.size() >= maxShardSize_) {
+      evictLocked(shard);
+    }
+    // New entries start unreferenced so that a scan of cold keys cannot push
+    // out entries that are actually being read.
+    map_.try_emplace(key, shard.ring.size(), false, std::forward<Args>(args)...);
+    shard.ring.push_back(key);
+  }
+
+  void evictLocked(Shard& shard) {
+    DCHECK(!shard.ring.empty());
+    // Give every entry a second chance, but bound the sweep in case readers
+    // keep setting referenced bits faster than the hand clears them.
+    for (std::size_t steps = 2 * shard.ring.size();; --steps) {
+      if (shard.hand >= shard.ring.size()) {
+        shard.hand = 0;
+      }
+      auto it = map_.find(shard.ring[shard.hand]);
+      DCHECK(it != map_.cend());
+      auto& entry = it->second;
+      if (steps > 0 && entry.referenced.load(std::memory_order_relaxed)) {
+        entry.referenced.store(false, std::memory_order_relaxed);
+        ++shard.hand;
+        continue;
+      }
+      if (pruneHook_) {
+        pruneHook_(it->first, entry.value);
+      }
+      removeSlotLocked(shard, shard.hand);
+      map_.erase(it);
+      return;
+    }
+  }
+
+  void removeSlotLocked(Shard& shard, std::size_t slot) {
+    DCHECK_LT(slot, shard.ring.size());
+    std::size_t last = shard.ring.size() - 1;
+    if (slot != last) {
+      shard.ring[slot] = std::move(shard.ring[last]);
+      auto moved = map_.find(shard.ring[slot]);
+      DCHECK(moved != map_.cend());
+      moved->second.slot.store(slot, std::memory_order_relaxed);
+    }
+    shard.ring.pop_back();
+  }
+
+  Map map_;
+  std::array<Shard, NumShards> shards_;
+  const std::size_t maxSize_;
+  const std::size_t maxShardSize_;
+  const PruneHookCall pruneHook_;
+};
+
+} // namespace folly
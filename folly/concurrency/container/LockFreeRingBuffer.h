@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cassert>
 #include <cstring>
 #include <memory>
 #include <type_traits>
@@ -26,6 +28,7 @@
 #include <folly/Portability.h>
 #include <folly/Traits.h>
 #include <folly/detail/TurnSequencer.h>
+#include <folly/lang/Align.h>
 #include <folly/portability/Unistd.h>
 #include <folly/synchronization/SanitizeThread.h>
 
@@ -62,6 +65,21 @@ class RingBufferBrokenStorage;
 /// Cursor that can point anywhere in this stream of writes. Reads from the
 /// "future" can optionally block but reads from the "past" will always fail.
 ///
+/// Consumer groups
+///
+/// A buffer can also be constructed with a fixed number of consumer groups,
+/// so that several independent sinks drain the same stream of writes. Each
+/// group has a committed cursor: the next write no consumer in the group has
+/// taken yet. Any number of threads can consume from a group; each write is
+/// delivered to exactly one of them, by a CAS on the group's cursor after the
+/// value has been read. A group that falls more than <capacity> writes behind
+/// skips ahead to the tail and counts what it missed in dropped().
+///
+/// write() ignores consumer groups, so writers still never block on readers.
+/// tryWriteBounded() is the backpressure alternative: it fails instead of
+/// overwriting a write the slowest group has not consumed yet. Groups only
+/// lose writes if plain write() is mixed in.
+///
 
 template <
     typename T,
@@ -111,9 +129,23 @@ class LockFreeRingBuffer {
     friend class LockFreeRingBuffer;
   };
 
+  class ConsumerGroup;
+
   explicit LockFreeRingBuffer(uint32_t capacity) noexcept
       : capacity_(capacity), slots_(new Slot[capacity]), ticket_(0) {}
 
+  /// Creates a buffer with `numGroups` consumer groups, numbered from 0.
+  LockFreeRingBuffer(uint32_t capacity, uint32_t numGroups)
+      : capacity_(capacity),
+        slots_(new Slot[capacity]),
+        ticket_(0),
+        numGroups_(numGroups),
+        groups_(numGroups ? new ConsumerGroup[numGroups] : nullptr) {
+    for (uint32_t i = 0; i < numGroups_; ++i) {
+      groups_[i].ring_ = this;
+    }
+  }
+
   LockFreeRingBuffer(const LockFreeRingBuffer&) = delete;
   LockFreeRingBuffer& operator=(const LockFreeRingBuffer&) = delete;
 
@@ -139,6 +171,21 @@ class LockFreeRingBuffer {
     return Cursor(ticket);
   }
 
+  /// Perform a single write unless it would overwrite a write that some
+  /// consumer group has not consumed yet, in which case nothing is written
+  /// and false is returned. Equivalent to write() without consumer groups.
+  template <typename V>
+  bool tryWriteBounded(const V& value) noexcept {
+    uint64_t ticket = ticket_.load();
+    do {
+      if (ticket - slowestCommitted(ticket) >= capacity_) {
+        return false;
+      }
+    } while (!ticket_.compare_exchange_weak(ticket, ticket + 1));
+    slots_[idx(ticket)].write(turn(ticket), value);
+    return true;
+  }
+
   /// Read the value at the cursor.
   /// Returns true if the read succeeded, false otherwise. If the return
   /// value is false, dest is to be considered partially read and in an
@@ -180,6 +227,13 @@ class LockFreeRingBuffer {
         static_cast<void const*>(slots_.get()), capacity_ * sizeof(Slot));
   }
 
+  uint32_t numConsumerGroups() const noexcept { return numGroups_; }
+
+  ConsumerGroup& consumerGroup(uint32_t i) noexcept {
+    assert(i < numGroups_);
+    return groups_[i];
+  }
+
  private:
   using Slot = detail::RingBufferSlot<T, Atom, Storage>;
 
@@ -189,6 +243,20 @@ class LockFreeRingBuffer {
 
   Atom<uint64_t> ticket_;
 
+  const uint32_t numGroups_{0};
+
+  const std::unique_ptr<ConsumerGroup[]> groups_;
+
+  /// The smallest committed cursor over all groups, or `head` if there are
+  /// none.
+  uint64_t slowestCommitted(uint64_t head) const noexcept {
+    uint64_t slowest = head;
+    for (uint32_t i = 0; i < numGroups_; ++i) {
+      slowest = std::min<uint64_t>(slowest, groups_[i].committed_.load());
+    }
+    return slowest;
+  }
+
   uint32_t idx(uint64_t ticket) const noexcept { return ticket % capacity_; }
 
   uint32_t turn(uint64_t ticket) const noexcept {
@@ -196,6 +264,87 @@ class LockFreeRingBuffer {
   }
 }; // LockFreeRingBuffer
 
+/// A consumer group's view of the stream of writes. All members are safe to
+/// call from any number of threads.
+template <
+    typename T,
+    template <typename> class Atom,
+    template <typename> class Storage>
+class LockFreeRingBuffer<T, Atom, Storage>::ConsumerGroup {
+ public:
+  ConsumerGroup(const ConsumerGroup&) = delete;
+  ConsumerGroup& operator=(const ConsumerGroup&) = delete;
+
+  /// Consume the next write into dest.
+  /// Returns false if the group has consumed every completed write. Never
+  /// blocks; a write that is still in progress reads as not there yet.
+  template <typename V>
+  bool tryReadNext(V& dest) noexcept {
+    return readN(&dest, 1) == 1;
+  }
+
+  /// Consume up to n consecutive writes into dest[0, n), with a single
+  /// update of the committed cursor. Returns the number consumed, which is
+  /// less than n when the group catches up with the writers.
+  template <typename V>
+  size_t readN(V* dest, size_t n) noexcept {
+    uint64_t ticket = committed_.load();
+    while (n > 0) {
+      uint64_t head = ring_->ticket_.load();
+      if (head - ticket > ring_->capacity_) {
+        // Lapped by the writers: everything before the tail is gone.
+        uint64_t tail = head - ring_->capacity_;
+        if (committed_.compare_exchange_weak(ticket, tail)) {
+          dropped_.fetch_add(tail - ticket);
+          ticket = tail;
+        }
+        continue;
+      }
+      size_t avail = std::min<uint64_t>(n, head - ticket);
+      size_t read = 0;
+      while (read < avail &&
+             ring_->tryRead(dest[read], Cursor(ticket + read))) {
+        ++read;
+      }
+      if (read == 0) {
+        if (avail == 0 ||
+            ring_->ticket_.load() - ticket <= ring_->capacity_) {
+          return 0;
+        }
+        // The slot was overwritten while we read it; skip ahead.
+        continue;
+      }
+      // Another consumer in the group may have taken these writes first, in
+      // which case ticket is reloaded and we try again from there.
+      if (committed_.compare_exchange_strong(ticket, ticket + read)) {
+        return read;
+      }
+    }
+    return 0;
+  }
+
+  /// Returns a Cursor pointing to the next write the group will consume.
+  Cursor committed() const noexcept { return Cursor(committed_.load()); }
+
+  /// Number of writes the group skipped because it was lapped.
+  uint64_t dropped() const noexcept { return dropped_.load(); }
+
+  /// Number of writes the group has yet to consume, dropped ones included.
+  uint64_t lag() const noexcept {
+    uint64_t committed = committed_.load();
+    return ring_->ticket_.load() - committed;
+  }
+
+ private:
+  friend class LockFreeRingBuffer;
+
+  ConsumerGroup() noexcept = default;
+
+  const LockFreeRingBuffer* ring_{nullptr};
+  alignas(hardware_destructive_interference_size) Atom<uint64_t> committed_{0};
+  Atom<uint64_t> dropped_{0};
+};
+
 namespace detail {
 template <
     typename T,
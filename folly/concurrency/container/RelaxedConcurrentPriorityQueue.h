@@ -23,10 +23,12 @@
 #include <iomanip>
 #include <iostream>
 #include <mutex>
+#include <vector>
 
 #include <folly/Random.h>
 #include <folly/SpinLock.h>
 #include <folly/ThreadLocal.h>
+#include <folly/concurrency/CacheLocality.h>
 #include <folly/detail/Futex.h>
 #include <folly/lang/Align.h>
 #include <folly/synchronization/Hazptr.h>
@@ -90,6 +92,21 @@
 // It also does not block the producer. For optimistic read, we use
 // hazard pointer to protect the node from been reclaimed. We optimize the
 // check-lock-check pattern by using test-test-and-set spin lock.
+//
+/// --- Batches ---
+// pushBatch sorts its values and inserts them as sorted runs of up to
+// ListTargetSize nodes. A run is merged into one tree element under the
+// same locks a single push takes, so a batch of n values takes about
+// n / ListTargetSize lock round trips instead of n. popBatch detaches
+// several nodes from the root list under one root lock (one node per lock
+// in the strict mode, PopBatch == 0, to keep pops strictly ordered).
+//
+/// --- Locality ---
+// The leaves of the bottom level are split into contiguous ranges, one per
+// AccessSpreader stripe, and a push starts probing for a leaf in the range
+// of the calling thread's stripe. Neighbouring leaves share their
+// ancestors, so threads that share a cache (or NUMA node) mostly lock and
+// read the same tree elements instead of bouncing lines across sockets.
 
 /// --- Template Parameters: ---
 // 1. PopBatch could be 0 or a positive integer.
@@ -110,6 +127,8 @@
 /// --- Interface ---
 //  void push(const T& val)
 //  void pop(T& val)
+//  void pushBatch(Iter first, Iter last)
+//  size_t popBatch(OutputIt out, size_t max)
 //  size_t size()
 //  bool empty()
 
@@ -133,6 +152,8 @@ class RelaxedConcurrentPriorityQueue {
   static constexpr size_t Align = 1u << 7;
   static constexpr int LevelForForceInsert = 3;
   static constexpr int LevelForTraverseParent = 7;
+  // Max number of leaf ranges pushes are spread across by cache locality
+  static constexpr uint32_t LocalityStripes = 16;
 
   static_assert(PopBatch <= 256, "PopBatch must be <= 256");
   static_assert(
@@ -257,6 +278,78 @@ class RelaxedConcurrentPriorityQueue {
     }
   }
 
+  /// Push all the values in [first, last).
+  template <typename Iter>
+  void pushBatch(Iter first, Iter last) {
+    std::vector<Node*> nodes;
+    for (; first != last; ++first) {
+      Node* newNode = new Node;
+      newNode->val = *first;
+      nodes.push_back(newNode);
+    }
+    if (nodes.empty()) {
+      return;
+    }
+    std::sort(nodes.begin(), nodes.end(), [](Node* a, Node* b) {
+      return a->val > b->val;
+    });
+    for (size_t i = 0; i < nodes.size(); i += ListTargetSize) {
+      size_t len = std::min(ListTargetSize, nodes.size() - i);
+      for (size_t j = i; j + 1 < i + len; j++) {
+        nodes[j]->next = nodes[j + 1];
+      }
+      nodes[i + len - 1]->next = nullptr;
+      moundPushList(nodes[i], len);
+    }
+    if (MayBlock) {
+      blockingPushImpl(static_cast<uint32_t>(nodes.size()));
+    }
+    if (SupportsSize) {
+      counter_p_.fetch_add(nodes.size(), std::memory_order_relaxed);
+    }
+  }
+
+  /// Pop up to max values into out, in the order pop() would return them.
+  /// Does not block: returns the number of values popped, which is 0 if
+  /// the queue is empty. If MayBlock, only values that no blocked pop() is
+  /// waiting for are taken.
+  template <typename OutputIt>
+  size_t popBatch(OutputIt out, size_t max) {
+    if (MayBlock) {
+      max = claimPopTickets(max);
+    }
+    size_t popped = 0;
+    while (popped < max) {
+      T val;
+      if (PopBatch > 0 && tryPopFromSharedBuffer(val)) {
+        *out++ = val;
+        popped++;
+        continue;
+      }
+      if (isMoundEmpty()) {
+        if (!MayBlock) {
+          break;
+        }
+        // The claimed values are in the queue, but may be in the middle of
+        // a move between the tree and the shared buffer.
+        tryWait(std::chrono::time_point<std::chrono::steady_clock>::max());
+        continue;
+      }
+      Position pos;
+      pos.level = pos.index = 0;
+      lockNode(pos);
+      size_t n = moundPopList(out, PopBatch > 0 ? max - popped : 1);
+      popped += n;
+      if (!MayBlock && n == 0 && isEmpty()) {
+        break;
+      }
+    }
+    if (SupportsSize) {
+      counter_c_.fetch_add(popped, std::memory_order_relaxed);
+    }
+    return popped;
+  }
+
   /// Note: size() and empty() are guaranteed to be accurate only if
   ///       the queue is not changed concurrently.
   /// Returns an estimate of the size of the queue
@@ -409,7 +502,7 @@ class RelaxedConcurrentPriorityQueue {
       int bound = 1 << b; // number of elements in this level
       int steps = 1 + b * b; // probe the length
       ++seed;
-      uint32_t index = seed % bound;
+      uint32_t index = localLeafIndex(b, seed);
 
       for (int i = 0; i < steps; i++) {
         int loc = (index + i) % bound;
@@ -441,6 +534,16 @@ class RelaxedConcurrentPriorityQueue {
     }
   }
 
+  /// Pick a leaf in the range of leaves of the calling thread's
+  /// AccessSpreader stripe
+  FOLLY_ALWAYS_INLINE uint32_t localLeafIndex(uint32_t level, uint32_t seed) {
+    uint32_t bound = 1u << level;
+    uint32_t stripes = std::min(bound, LocalityStripes);
+    uint32_t width = bound / stripes;
+    uint32_t stripe = AccessSpreader<Atom>::cachedCurrent(stripes);
+    return stripe * width + seed % width;
+  }
+
   /// Swap two Tree Elements (head, size)
   void swapList(const Position& a, const Position& b) {
     Node* tmp = getList(a);
@@ -860,6 +963,51 @@ class RelaxedConcurrentPriorityQueue {
     }
   }
 
+  // Merge the sorted list (head, len) into the element at pos. Like
+  // regularInsert, it only needs the parent's head to stay above the list.
+  bool mergeInsert(const Position& pos, const T& val, Node* head, size_t len) {
+    if (isRoot(pos)) {
+      lockNode(pos);
+    } else {
+      Position parent = parentOf(pos);
+      if (!trylockNode(parent)) {
+        return false;
+      }
+      if (!trylockNode(pos)) {
+        unlockNode(parent);
+        return false;
+      }
+      if (FOLLY_UNLIKELY(readValue(parent) <= val)) {
+        unlockNode(parent);
+        unlockNode(pos);
+        return false;
+      }
+      unlockNode(parent);
+    }
+    mergeListTo(pos, head, len);
+    if (getElementSize(pos) > PruningSize) {
+      startPruning(pos);
+    } else {
+      unlockNode(pos);
+    }
+    return true;
+  }
+
+  // Push a sorted list whose head holds the largest value
+  void moundPushList(Node* head, size_t len) {
+    folly::hazptr_holder<Atom> hptr = folly::make_hazard_pointer<Atom>();
+    uint32_t seed = folly::Random::rand32() % (1 << 21);
+    T val = head->val;
+    while (true) {
+      bool go_fast_path = false;
+      Position cur = selectPosition(val, go_fast_path, seed, hptr);
+      binarySearchPosition(cur, val, hptr);
+      if (FOLLY_LIKELY(mergeInsert(cur, val, head, len))) {
+        return;
+      }
+    }
+  }
+
   int popToSharedBuffer(const uint32_t rsize, Node* head) {
     Position pos;
     pos.level = pos.index = 0;
@@ -1020,8 +1168,61 @@ class RelaxedConcurrentPriorityQueue {
     return true;
   }
 
-  void blockingPushImpl() {
-    auto p = pticket_.fetch_add(1, std::memory_order_acq_rel);
+  // Pop up to max nodes from the root list, with the root locked. Returns
+  // the number popped, 0 if the root is empty or the shared buffer still
+  // holds nodes popped earlier.
+  template <typename OutputIt>
+  size_t moundPopList(OutputIt& out, size_t max) {
+    Position pos;
+    pos.level = pos.index = 0;
+    Node* head = getList(pos);
+    if (head == nullptr ||
+        (PopBatch > 0 && top_loc_.load(std::memory_order_acquire) >= 0)) {
+      unlockNode(pos);
+      return 0;
+    }
+
+    Node* popped = head;
+    size_t n = 0;
+    while (head != nullptr && n < max) {
+      head = head->next;
+      n++;
+    }
+    setTreeNode(pos, head);
+    uint32_t sz = getElementSize(pos) - n;
+
+    bool done = false;
+    if (sz == 0) {
+      done = deferSettingRootSize(pos);
+    } else {
+      setElementSize(pos, sz);
+    }
+    if (!done) {
+      mergeDown(pos);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      Node* next = popped->next;
+      *out++ = popped->val;
+      popped->retire();
+      popped = next;
+    }
+    return n;
+  }
+
+  // Issues the tickets of n pushed values at once.
+  void blockingPushImpl(uint32_t n = 1) {
+    auto first = pticket_.fetch_add(n, std::memory_order_acq_rel);
+    // Consecutive tickets map to distinct futexes, NumFutex at a time, and a
+    // futex only needs the highest ticket that maps to it, so only the last
+    // NumFutex tickets of a batch are published, each with at most one wake.
+    auto count = std::min<uint32_t>(n, NumFutex);
+    for (uint32_t p = first + n - count; p != first + n; ++p) {
+      publishPushTicket(p);
+    }
+  }
+
+  void publishPushTicket(uint32_t p) {
     auto loc = getFutexArrayLoc(p);
     uint32_t curfutex = futex_array_[loc].load(std::memory_order_acquire);
 
@@ -1046,6 +1247,28 @@ class RelaxedConcurrentPriorityQueue {
     }
   }
 
+  // Takes up to max consumer tickets, but only those of values whose push
+  // has completed, so that each of them is backed by a value in the queue
+  // and a pop() with a later ticket still waits for a push of its own.
+  // Returns the number of tickets taken.
+  size_t claimPopTickets(size_t max) {
+    auto c = cticket_.load(std::memory_order_acquire);
+    while (true) {
+      auto p = pticket_.load(std::memory_order_acquire);
+      // Negative while pop() calls wait for pushes.
+      auto unclaimed = static_cast<int32_t>(p - c);
+      if (unclaimed <= 0 || max == 0) {
+        return 0;
+      }
+      auto n = static_cast<uint32_t>(
+          std::min(max, static_cast<size_t>(unclaimed)));
+      if (cticket_.compare_exchange_weak(
+              c, c + n, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return n;
+      }
+    }
+  }
+
   // This could guarentee the Mound is empty
   FOLLY_ALWAYS_INLINE bool isMoundEmpty() {
     Position pos;
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+
+#include <folly/Optional.h>
+#include <folly/concurrency/container/SingleWriterFixedHashMap.h>
+#include <folly/lang/Bits.h>
+#include <folly/synchronization/Hazptr.h>
+
+#include <glog/logging.h>
+
+namespace folly {
+
+/// SingleWriterGrowableHashMap:
+///
+/// Single-writer hash map with wait-free concurrent reads whose capacity
+/// follows the number of live keys, built on SingleWriterFixedHashMap.
+///
+/// The writer inserts and erases in place in the current table. When the
+/// table would pass its maximum load (counting tombstones), or falls well
+/// below its minimum load after erasures, the writer builds a new table
+/// sized for the live keys, publishes it, and retires the old one to the
+/// hazard pointer library. Readers protect the table they use with a
+/// hazard pointer, so they never block and never see a table freed under
+/// them; a reader racing with a rebuild sees either the old or the new
+/// table, each of which is a consistent map.
+///
+/// Rebuilding also drops tombstones, so a long-running insert/erase churn
+/// does not degrade lookups.
+///
+/// Writer-only operations (not thread-safe with respect to each other):
+/// - insert()
+/// - erase()
+/// - capacity()
+///
+/// Reader operations (wait-free, safe concurrently with the writer):
+/// - contains()
+/// - get()
+/// - forEach()
+/// - size()
+/// - empty()
+///
+template <typename Key, typename Value>
+class SingleWriterGrowableHashMap {
+  using FixedMap = SingleWriterFixedHashMap<Key, Value>;
+
+  struct Table : hazptr_obj_base<Table> {
+    FixedMap map;
+
+    explicit Table(size_t capacity) : map(capacity) {}
+  };
+
+  // A table is rebuilt when inserting would use more than 3/4 of its slots
+  // (live keys plus tombstones), or when erasing leaves fewer than 1/8 of
+  // them live. A rebuilt table is sized so that the live keys fill between
+  // 1/4 and 1/2 of it.
+  static constexpr size_t kMinCapacity = 8;
+
+  hazptr_obj_cohort<> cohort_; // destroyed last; reclaims retired tables
+  std::atomic<Table*> table_;
+
+ public:
+  explicit SingleWriterGrowableHashMap(size_t capacity = kMinCapacity)
+      : table_(new Table(std::max(capacity, kMinCapacity))) {
+    table_.load(std::memory_order_relaxed)->set_cohort_tag(&cohort_);
+  }
+
+  SingleWriterGrowableHashMap(const SingleWriterGrowableHashMap&) = delete;
+  SingleWriterGrowableHashMap& operator=(const SingleWriterGrowableHashMap&) =
+      delete;
+
+  /* There must be no concurrent readers */
+  ~SingleWriterGrowableHashMap() {
+    delete table_.load(std::memory_order_relaxed);
+  }
+
+  /* not data-race-free, to be called only by the single writer */
+  size_t capacity() const { return writerTable()->map.capacity(); }
+
+  /* data-race-free, can be called by readers */
+  size_t size() const {
+    hazptr_local<1> h;
+    return h[0].protect(table_)->map.size();
+  }
+
+  bool empty() const { return size() == 0; }
+
+  bool contains(Key key) const {
+    hazptr_local<1> h;
+    return h[0].protect(table_)->map.contains(key);
+  }
+
+  Optional<Value> get(Key key) const {
+    hazptr_local<1> h;
+    auto& map = h[0].protect(table_)->map;
+    auto it = map.find(key);
+    if (it == map.end()) {
+      return none;
+    }
+    return it.value();
+  }
+
+  /// Calls f(key, value) for each entry of the table current at the time
+  /// of the call. Must not call other member functions of this map from f,
+  /// since the hazard pointer it uses is held for the whole iteration.
+  template <typename F>
+  void forEach(F&& f) const {
+    hazptr_local<1> h;
+    auto& map = h[0].protect(table_)->map;
+    for (auto it = map.begin(); it != map.end(); ++it) {
+      f(it.key(), it.value());
+    }
+  }
+
+  /* not data-race-free, to be called only by the single writer */
+  bool insert(Key key, Value value) {
+    auto t = writerTable();
+    if (t->map.contains(key)) {
+      return false;
+    }
+    if (4 * (t->map.used() + 1) > 3 * t->map.capacity()) {
+      t = rebuild(t, t->map.size() + 1);
+    }
+    bool inserted = t->map.insert(key, value);
+    DCHECK(inserted);
+    return inserted;
+  }
+
+  /* not data-race-free, to be called only by the single writer */
+  bool erase(Key key) {
+    auto t = writerTable();
+    if (!t->map.erase(key)) {
+      return false;
+    }
+    if (t->map.capacity() > kMinCapacity &&
+        8 * t->map.size() < t->map.capacity()) {
+      rebuild(t, t->map.size());
+    }
+    return true;
+  }
+
+ private:
+  Table* writerTable() const { return table_.load(std::memory_order_relaxed); }
+
+  Table* rebuild(Table* old, size_t count) {
+    auto t = new Table(std::max(2 * count, kMinCapacity));
+    t->set_cohort_tag(&cohort_);
+    auto& from = old->map;
+    for (auto it = from.begin(); it != from.end(); ++it) {
+      t->map.insert(it.key(), it.value());
+    }
+    table_.store(t, std::memory_order_release);
+    old->retire();
+    return t;
+  }
+}; // SingleWriterGrowableHashMap
+
+} // namespace folly
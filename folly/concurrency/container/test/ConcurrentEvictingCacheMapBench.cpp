@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/concurrency/container/ConcurrentEvictingCacheMap.h>
+
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include <folly/BenchmarkUtil.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <folly/portability/GFlags.h>
+#include <folly/synchronization/test/Barrier.h>
+
+DEFINE_int32(reps, 10, "number of reps");
+DEFINE_int32(ops, 1000 * 1000, "number of operations per thread per rep");
+DEFINE_int64(size, 100 * 1000, "maximum number of cached entries");
+DEFINE_int64(keys, 200 * 1000, "number of distinct keys accessed");
+DEFINE_int32(max_threads, 128, "maximum number of threads");
+
+template <typename Func>
+inline uint64_t run_once(int nthr, const Func& fn) {
+  folly::test::Barrier b(nthr + 1);
+  std::vector<std::thread> thr(nthr);
+  for (int tid = 0; tid < nthr; ++tid) {
+    thr[tid] = std::thread([&, tid] {
+      b.wait();
+      b.wait();
+      fn(tid);
+    });
+  }
+  b.wait();
+  // begin time measurement
+  auto tbegin = std::chrono::steady_clock::now();
+  b.wait();
+  /* wait for completion */
+  for (int i = 0; i < nthr; ++i) {
+    thr[i].join();
+  }
+  /* end time measurement */
+  auto tend = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(tend - tbegin)
+      .count();
+}
+
+template <typename RepFunc>
+uint64_t runBench(const std::string& name, int ops, const RepFunc& repFn) {
+  int reps = FLAGS_reps;
+  uint64_t min = UINTMAX_MAX;
+  uint64_t max = 0;
+  uint64_t sum = 0;
+
+  repFn(); // sometimes first run is outlier
+  for (int r = 0; r < reps; ++r) {
+    uint64_t dur = repFn();
+    sum += dur;
+    min = std::min(min, dur);
+    max = std::max(max, dur);
+    // if each rep takes too long run at least 3 reps
+    const uint64_t minute = 60000000000UL;
+    if (sum > minute && r >= 2) {
+      reps = r + 1;
+      break;
+    }
+  }
+
+  const std::string unit = " ns";
+  uint64_t avg = sum / reps;
+  uint64_t res = min;
+  std::cout << name;
+  std::cout << "   " << std::setw(4) << (max + ops / 2) / ops << unit;
+  std::cout << "   " << std::setw(4) << (avg + ops / 2) / ops << unit;
+  std::cout << "   " << std::setw(4) << (min + ops / 2) / ops << unit;
+  std::cout << std::endl;
+  return res;
+}
+
+// One in every `writeEvery` operations is a set(), the rest are get()s.
+// Keys are drawn from a cheap per-thread LCG so that the access pattern is
+// spread over the whole key space.
+template <typename GetFn, typename SetFn>
+uint64_t bench_mixed(
+    const int nthr,
+    const int writeEvery,
+    const GetFn& getFn,
+    const SetFn& setFn,
+    const std::string& name) {
+  int ops = FLAGS_ops;
+  uint64_t keys = FLAGS_keys;
+  auto repFn = [&] {
+    auto fn = [&](int tid) {
+      uint64_t x = tid * 0x9E3779B97F4A7C15ULL + 1;
+      for (int i = 0; i < ops; ++i) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        int key = int((x >> 33) % keys);
+        if (writeEvery != 0 && i % writeEvery == 0) {
+          setFn(key);
+        } else {
+          getFn(key);
+        }
+      }
+    };
+    return run_once(nthr, fn);
+  };
+  return runBench(name, ops * nthr, repFn);
+}
+
+uint64_t bench_sync_ecm(
+    const int nthr, const int writeEvery, const std::string& name) {
+  folly::Synchronized<folly::EvictingCacheMap<int, int>> m(
+      std::in_place, FLAGS_size);
+  for (int i = 0; i < FLAGS_size; ++i) {
+    m.wlock()->set(i, i);
+  }
+  return bench_mixed(
+      nthr,
+      writeEvery,
+      [&](int key) {
+        // get() promotes, so it needs the exclusive lock.
+        auto locked = m.wlock();
+        auto it = locked->find(key);
+        folly::doNotOptimizeAway(it == locked->end() ? 0 : it->second);
+      },
+      [&](int key) { m.wlock()->set(key, key); },
+      name);
+}
+
+uint64_t bench_cecm(
+    const int nthr, const int writeEvery, const std::string& name) {
+  folly::ConcurrentEvictingCacheMap<int, int> m(FLAGS_size);
+  for (int i = 0; i < FLAGS_size; ++i) {
+    m.set(i, i);
+  }
+  return bench_mixed(
+      nthr,
+      writeEvery,
+      [&](int key) { folly::doNotOptimizeAway(m.get(key)); },
+      [&](int key) { m.set(key, key); },
+      name);
+}
+
+void dottedLine() {
+  std::cout << ".............................................................."
+            << std::endl;
+}
+
+void benches() {
+  std::cout << "=============================================================="
+            << std::endl;
+  std::cout << "Test name                         Max time  Avg time  Min time"
+            << std::endl;
+  for (int nthr = 1; nthr <= FLAGS_max_threads; nthr *= 2) {
+    std::cout << "========================= " << std::setw(3) << nthr
+              << " threads" << " ========================" << std::endl;
+    bench_sync_ecm(nthr, 0, "Sync<ECM>  100% get            ");
+    bench_cecm(nthr, 0, "CECM       100% get            ");
+    dottedLine();
+    bench_sync_ecm(nthr, 10, "Sync<ECM>  90% get 10% set     ");
+    bench_cecm(nthr, 10, "CECM       90% get 10% set     ");
+    dottedLine();
+    bench_sync_ecm(nthr, 2, "Sync<ECM>  50% get 50% set     ");
+    bench_cecm(nthr, 2, "CECM       50% get 50% set     ");
+  }
+  std::cout << "=============================================================="
+            << std::endl;
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  benches();
+}
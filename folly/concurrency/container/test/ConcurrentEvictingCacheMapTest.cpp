@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/concurrency/container/ConcurrentEvictingCacheMap.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+template <typename K, typename V>
+using SingleShardCache = ConcurrentEvictingCacheMap<
+    K,
+    V,
+    std::hash<K>,
+    std::equal_to<K>,
+    /* ShardBits = */ 0>;
+
+TEST(ConcurrentEvictingCacheMap, Basic) {
+  SingleShardCache<int, std::string> map(10);
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.get(1).has_value());
+  EXPECT_FALSE(map.exists(1));
+
+  map.set(1, "one");
+  EXPECT_EQ(1, map.size());
+  EXPECT_TRUE(map.exists(1));
+  EXPECT_EQ("one", map.get(1).value());
+  EXPECT_EQ("one", map.getWithoutPromotion(1).value());
+
+  map.set(1, "uno");
+  EXPECT_EQ(1, map.size());
+  EXPECT_EQ("uno", map.get(1).value());
+
+  EXPECT_FALSE(map.insert(1, "eins"));
+  EXPECT_EQ("uno", map.get(1).value());
+  EXPECT_TRUE(map.insert(2, "two"));
+  EXPECT_TRUE(map.try_emplace(3, 5, 'x'));
+  EXPECT_EQ("xxxxx", map.get(3).value());
+  EXPECT_EQ(3, map.size());
+
+  EXPECT_TRUE(map.erase(2));
+  EXPECT_FALSE(map.erase(2));
+  EXPECT_FALSE(map.exists(2));
+  EXPECT_EQ(2, map.size());
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.exists(1));
+  EXPECT_FALSE(map.exists(3));
+}
+
+TEST(ConcurrentEvictingCacheMap, EvictsUnreferencedFirst) {
+  SingleShardCache<int, int> map(4);
+  for (int i = 0; i < 4; ++i) {
+    map.set(i, i, /* promote = */ false);
+  }
+  // Touch everything but 2; it must be the next victim.
+  EXPECT_TRUE(map.get(0).has_value());
+  EXPECT_TRUE(map.get(1).has_value());
+  EXPECT_TRUE(map.get(3).has_value());
+
+  map.set(4, 4);
+  EXPECT_EQ(4, map.size());
+  EXPECT_FALSE(map.exists(2));
+  for (int i : {0, 1, 3, 4}) {
+    EXPECT_TRUE(map.exists(i)) << i;
+  }
+}
+
+TEST(ConcurrentEvictingCacheMap, GetWithoutPromotionDoesNotProtect) {
+  SingleShardCache<int, int> map(2);
+  map.set(0, 0, /* promote = */ false);
+  map.set(1, 1, /* promote = */ false);
+  EXPECT_TRUE(map.getWithoutPromotion(0).has_value());
+  EXPECT_TRUE(map.get(1).has_value());
+  map.set(2, 2);
+  EXPECT_FALSE(map.exists(0));
+  EXPECT_TRUE(map.exists(1));
+  EXPECT_TRUE(map.exists(2));
+}
+
+TEST(ConcurrentEvictingCacheMap, AllReferenced) {
+  SingleShardCache<int, int> map(8);
+  for (int i = 0; i < 8; ++i) {
+    map.set(i, i);
+  }
+  for (int i = 8; i < 100; ++i) {
+    map.set(i, i);
+    EXPECT_EQ(8, map.size());
+    EXPECT_TRUE(map.exists(i));
+  }
+}
+
+TEST(ConcurrentEvictingCacheMap, EraseThenEvict) {
+  SingleShardCache<int, int> map(4);
+  for (int i = 0; i < 4; ++i) {
+    map.set(i, i, /* promote = */ false);
+  }
+  // Erasing from the middle of the ring must keep the remaining slots
+  // consistent for the clock hand.
+  EXPECT_TRUE(map.erase(1));
+  EXPECT_TRUE(map.erase(0));
+  for (int i = 4; i < 20; ++i) {
+    map.set(i, i, /* promote = */ false);
+    EXPECT_LE(map.size(), 4);
+    EXPECT_TRUE(map.exists(i));
+  }
+}
+
+TEST(ConcurrentEvictingCacheMap, PruneHook) {
+  std::vector<std::pair<int, int>> pruned;
+  SingleShardCache<int, int> map(
+      3, [&](const int& k, const int& v) { pruned.emplace_back(k, v); });
+  for (int i = 0; i < 3; ++i) {
+    map.set(i, i * 10, /* promote = */ false);
+  }
+  EXPECT_TRUE(pruned.empty());
+  map.set(3, 30);
+  ASSERT_EQ(1, pruned.size());
+  EXPECT_FALSE(map.exists(pruned[0].first));
+  EXPECT_EQ(pruned[0].first * 10, pruned[0].second);
+
+  // Explicit erase does not call the hook.
+  map.erase(3);
+  EXPECT_EQ(1, pruned.size());
+}
+
+TEST(ConcurrentEvictingCacheMap, UnlimitedSize) {
+  ConcurrentEvictingCacheMap<int, int> map(0);
+  for (int i = 0; i < 10000; ++i) {
+    map.set(i, i);
+  }
+  EXPECT_EQ(10000, map.size());
+}
+
+TEST(ConcurrentEvictingCacheMap, ShardedSizeBound) {
+  constexpr std::size_t kMaxSize = 1000;
+  ConcurrentEvictingCacheMap<int, int> map(kMaxSize);
+  for (int i = 0; i < 100000; ++i) {
+    map.set(i, i);
+    ASSERT_LE(map.size(), kMaxSize + 63);
+  }
+  EXPECT_GE(map.size(), kMaxSize / 2);
+}
+
+TEST(ConcurrentEvictingCacheMap, SharedPtrValue) {
+  SingleShardCache<int, std::shared_ptr<int>> map(2);
+  map.set(1, std::make_shared<int>(1));
+  map.set(2, std::make_shared<int>(2));
+  map.set(3, std::make_shared<int>(3));
+  EXPECT_EQ(2, map.size());
+  EXPECT_EQ(3, *map.get(3).value());
+}
+
+TEST(ConcurrentEvictingCacheMap, ConcurrentReadersAndWriters) {
+  constexpr int kKeys = 4096;
+  constexpr int kWriters = 4;
+  constexpr int kReaders = 8;
+  ConcurrentEvictingCacheMap<int, int> map(kKeys / 4);
+
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kWriters; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 50000; ++i) {
+        int key = (i * 7 + t) % kKeys;
+        if (i % 16 == 0) {
+          map.erase(key);
+        } else {
+          map.set(key, key);
+        }
+      }
+    });
+  }
+  for (int t = 0; t < kReaders; ++t) {
+    threads.emplace_back([&, t] {
+      int i = t;
+      while (!stop.load(std::memory_order_relaxed)) {
+        int key = i++ % kKeys;
+        if (auto v = map.get(key)) {
+          ASSERT_EQ(key, *v);
+        }
+      }
+    });
+  }
+  for (int t = 0; t < kWriters; ++t) {
+    threads[t].join();
+  }
+  stop = true;
+  for (int t = kWriters; t < kWriters + kReaders; ++t) {
+    threads[t].join();
+  }
+  EXPECT_LE(map.size(), kKeys / 4 + 63);
+}
@@ -16,6 +16,7 @@
 
 #include <iostream>
 #include <thread>
+#include <vector>
 
 #include <folly/concurrency/container/LockFreeRingBuffer.h>
 #include <folly/portability/GTest.h>
@@ -273,4 +274,155 @@ TEST(LockFreeRingBuffer, cursorComparison) {
   EXPECT_FALSE(rb.currentHead() < rb.currentTail());
 }
 
+TEST(LockFreeRingBuffer, consumerGroupsReadIndependently) {
+  LockFreeRingBuffer<int> rb(8, 2);
+  ASSERT_EQ(2, rb.numConsumerGroups());
+  auto& logging = rb.consumerGroup(0);
+  auto& metrics = rb.consumerGroup(1);
+
+  int val = -1;
+  EXPECT_FALSE(logging.tryReadNext(val));
+  for (int i = 0; i < 5; ++i) {
+    rb.write(i);
+  }
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(logging.tryReadNext(val));
+    EXPECT_EQ(i, val);
+  }
+  EXPECT_FALSE(logging.tryReadNext(val));
+  EXPECT_EQ(0, logging.lag());
+
+  // The other group still sees everything.
+  EXPECT_EQ(5, metrics.lag());
+  int batch[8];
+  EXPECT_EQ(3, metrics.readN(batch, 3));
+  EXPECT_EQ(0, batch[0]);
+  EXPECT_EQ(2, batch[2]);
+  EXPECT_EQ(2, metrics.readN(batch, 8));
+  EXPECT_EQ(3, batch[0]);
+  EXPECT_EQ(4, batch[1]);
+  EXPECT_EQ(0, metrics.readN(batch, 8));
+  EXPECT_TRUE(metrics.committed() == rb.currentHead());
+}
+
+TEST(LockFreeRingBuffer, consumerGroupSkipsWhenLapped) {
+  const int capacity = 4;
+  LockFreeRingBuffer<int> rb(capacity, 1);
+  auto& group = rb.consumerGroup(0);
+
+  for (int i = 0; i < 3 * capacity + 1; ++i) {
+    rb.write(i);
+  }
+  int batch[capacity];
+  ASSERT_EQ(capacity, group.readN(batch, capacity));
+  for (int i = 0; i < capacity; ++i) {
+    EXPECT_EQ(2 * capacity + 1 + i, batch[i]);
+  }
+  EXPECT_EQ(2 * capacity + 1, group.dropped());
+  EXPECT_EQ(0, group.lag());
+}
+
+TEST(LockFreeRingBuffer, boundedWritesWaitForSlowestGroup) {
+  const int capacity = 4;
+  LockFreeRingBuffer<int> rb(capacity, 2);
+  auto& fast = rb.consumerGroup(0);
+  auto& slow = rb.consumerGroup(1);
+
+  for (int i = 0; i < capacity; ++i) {
+    ASSERT_TRUE(rb.tryWriteBounded(i));
+  }
+  EXPECT_FALSE(rb.tryWriteBounded(capacity));
+
+  int batch[capacity];
+  ASSERT_EQ(capacity, fast.readN(batch, capacity));
+  EXPECT_FALSE(rb.tryWriteBounded(capacity));
+
+  ASSERT_EQ(1, slow.readN(batch, 1));
+  EXPECT_TRUE(rb.tryWriteBounded(capacity));
+  EXPECT_FALSE(rb.tryWriteBounded(capacity + 1));
+
+  ASSERT_EQ(capacity, slow.readN(batch, capacity));
+  for (int i = 0; i < capacity; ++i) {
+    EXPECT_EQ(i + 1, batch[i]);
+  }
+  EXPECT_EQ(0, slow.dropped());
+
+  // Without groups, bounded writes never fail.
+  LockFreeRingBuffer<int> plain(capacity);
+  for (int i = 0; i < 3 * capacity; ++i) {
+    EXPECT_TRUE(plain.tryWriteBounded(i));
+  }
+}
+
+template <template <typename> class Atom>
+void runConsumerGroups(
+    int capacity, int writers, int consumersPerGroup, int writesPerWriter) {
+  using folly::test::DeterministicSchedule;
+  const int groups = 2;
+
+  LockFreeRingBuffer<int, Atom> rb(capacity, groups);
+  std::atomic<int> writersDone{0};
+  std::vector<std::atomic<int64_t>> sums(groups);
+  std::vector<std::atomic<int64_t>> counts(groups);
+
+  std::vector<std::thread> threads;
+  for (int w = 0; w < writers; ++w) {
+    threads.push_back(DeterministicSchedule::thread([&, w] {
+      for (int i = 0; i < writesPerWriter;) {
+        if (rb.tryWriteBounded(w * writesPerWriter + i)) {
+          ++i;
+        }
+      }
+      ++writersDone;
+    }));
+  }
+  for (int g = 0; g < groups; ++g) {
+    for (int c = 0; c < consumersPerGroup; ++c) {
+      threads.push_back(DeterministicSchedule::thread([&, g, c] {
+        auto& group = rb.consumerGroup(g);
+        int batch[8];
+        // Alternate single and batched reads between consumers.
+        size_t want = c % 2 ? 8 : 1;
+        while (true) {
+          bool done = writersDone.load() == writers;
+          size_t n = group.readN(batch, want);
+          for (size_t i = 0; i < n; ++i) {
+            sums[g] += batch[i];
+          }
+          counts[g] += n;
+          if (n == 0 && done) {
+            break;
+          }
+        }
+      }));
+    }
+  }
+  for (auto& thread : threads) {
+    DeterministicSchedule::join(thread);
+  }
+
+  // Every write is consumed exactly once per group.
+  int64_t total = int64_t(writers) * writesPerWriter;
+  for (int g = 0; g < groups; ++g) {
+    EXPECT_EQ(total, counts[g].load());
+    EXPECT_EQ(total * (total - 1) / 2, sums[g].load());
+    EXPECT_EQ(0, rb.consumerGroup(g).dropped());
+  }
+}
+
+TEST(LockFreeRingBuffer, consumerGroupsDeliverExactlyOnce) {
+  using folly::test::DeterministicAtomic;
+  using folly::test::DeterministicSchedule;
+
+  {
+    DeterministicSchedule sched(DeterministicSchedule::uniform(0));
+    runConsumerGroups<DeterministicAtomic>(4, 2, 2, 100);
+  }
+  {
+    DeterministicSchedule sched(DeterministicSchedule::uniform(1));
+    runConsumerGroups<DeterministicAtomic>(16, 3, 3, 50);
+  }
+  runConsumerGroups<std::atomic>(64, 4, 3, 2000);
+}
+
 } // namespace folly
@@ -15,7 +15,10 @@
  */
 
 #include <iomanip>
+#include <iterator>
+#include <numeric>
 #include <thread>
+#include <vector>
 
 #include <boost/thread.hpp>
 
@@ -291,6 +294,219 @@ TEST(CPQ, ConcurrentPushRelaxedImplTest) {
   concurrentPush<RelaxedConcurrentPriorityQueue<int, false, false, 8, 8>>();
 }
 
+/// pushBatch and popBatch return the pushed values, in priority order
+/// when the queue is strict.
+template <class PriorityQueue, bool Strict>
+void batchOpsTest() {
+  for (int n : {0, 1, 100, 10000}) {
+    PriorityQueue pq;
+    folly::Random::DefaultGenerator rng;
+    rng.seed(n);
+    std::vector<int> vals;
+    for (int i = 0; i < n; i++) {
+      vals.push_back(folly::Random::rand32(rng) % (n + 1));
+    }
+    // mix batches with single pushes
+    size_t half = vals.size() / 2;
+    pq.pushBatch(vals.begin(), vals.begin() + half);
+    for (size_t i = half; i < vals.size(); i++) {
+      pq.push(vals[i]);
+    }
+    EXPECT_EQ(pq.size(), n);
+
+    std::vector<int> popped;
+    while (pq.popBatch(std::back_inserter(popped), 7) > 0) {
+    }
+    EXPECT_TRUE(pq.empty());
+    EXPECT_EQ(pq.size(), 0);
+    EXPECT_EQ(pq.popBatch(std::back_inserter(popped), 7), 0);
+    ASSERT_EQ(popped.size(), vals.size());
+    if (Strict) {
+      EXPECT_TRUE(std::is_sorted(popped.rbegin(), popped.rend()));
+    }
+    std::sort(popped.begin(), popped.end());
+    std::sort(vals.begin(), vals.end());
+    EXPECT_EQ(popped, vals);
+  }
+}
+
+TEST(CPQ, BatchOpsStrictImplTest) {
+  batchOpsTest<RelaxedConcurrentPriorityQueue<int, false, true, 0>, true>();
+  batchOpsTest<RelaxedConcurrentPriorityQueue<int, false, true, 0, 1>, true>();
+  batchOpsTest<RelaxedConcurrentPriorityQueue<int, false, true, 0, 8>, true>();
+  batchOpsTest<RelaxedConcurrentPriorityQueue<int, true, true, 0>, true>();
+}
+
+TEST(CPQ, BatchOpsRelaxedImplTest) {
+  batchOpsTest<RelaxedConcurrentPriorityQueue<int, false, true>, false>();
+  batchOpsTest<RelaxedConcurrentPriorityQueue<int, false, true, 1, 1>, false>();
+  batchOpsTest<RelaxedConcurrentPriorityQueue<int, false, true, 8, 2>, false>();
+  batchOpsTest<RelaxedConcurrentPriorityQueue<int, true, true>, false>();
+}
+
+/// threads push and pop in batches; all pushed values come out exactly once
+template <class PriorityQueue>
+void concurrentBatchOps() {
+  for (int t : nthr) {
+    PriorityQueue pq;
+    std::atomic<uint64_t> push_sum(0);
+    std::atomic<uint64_t> pop_sum(0);
+    std::atomic<uint64_t> pop_count(0);
+    nthreads = t;
+
+    auto fn = [&](uint32_t tid) {
+      folly::Random::DefaultGenerator rng;
+      rng.seed(tid);
+      std::vector<int> batch;
+      std::vector<int> out;
+      for (int rep = 0; rep < 200; rep++) {
+        batch.clear();
+        for (int i = 0; i < 50; i++) {
+          int val = folly::Random::rand32(rng) % 1000 + 1;
+          batch.push_back(val);
+          push_sum.fetch_add(val, std::memory_order_relaxed);
+        }
+        pq.pushBatch(batch.begin(), batch.end());
+        out.clear();
+        pop_count.fetch_add(
+            pq.popBatch(std::back_inserter(out), 40),
+            std::memory_order_relaxed);
+        for (int v : out) {
+          pop_sum.fetch_add(v, std::memory_order_relaxed);
+        }
+      }
+    };
+    run_once(fn);
+
+    uint64_t remaining = t * 200 * 50 - pop_count.load();
+    for (uint64_t i = 0; i < remaining; i++) {
+      int val;
+      pq.pop(val);
+      pop_sum += val;
+    }
+    EXPECT_TRUE(pq.empty());
+    EXPECT_EQ(pop_sum.load(), push_sum.load());
+  }
+}
+
+TEST(CPQ, ConcurrentBatchOpsTest) {
+  concurrentBatchOps<RelaxedConcurrentPriorityQueue<int, false, false, 0>>();
+  concurrentBatchOps<RelaxedConcurrentPriorityQueue<int, false, false>>();
+  concurrentBatchOps<RelaxedConcurrentPriorityQueue<int, false, false, 8, 2>>();
+  concurrentBatchOps<RelaxedConcurrentPriorityQueue<int, true, false>>();
+}
+
+/// blocked consumers are woken by the values of a batch push
+TEST(CPQ, PushBatchWakesBlockedPop) {
+  RelaxedConcurrentPriorityQueue<int, true, false> pq;
+  std::atomic<uint64_t> sum(0);
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < 4; i++) {
+    consumers.emplace_back([&] {
+      for (int j = 0; j < 100; j++) {
+        int val;
+        pq.pop(val);
+        sum += val;
+      }
+    });
+  }
+  std::vector<int> vals(400);
+  std::iota(vals.begin(), vals.end(), 1);
+  pq.pushBatch(vals.begin(), vals.begin() + 150);
+  pq.pushBatch(vals.begin() + 150, vals.end());
+  for (auto& t : consumers) {
+    t.join();
+  }
+  EXPECT_EQ(sum.load(), 400 * 401 / 2);
+  EXPECT_TRUE(pq.empty());
+}
+
+/// a value pushed for a blocked pop() is left to it by popBatch
+TEST(CPQ, PopBatchSkipsValueOfBlockedPop) {
+  RelaxedConcurrentPriorityQueue<int, true, false> pq;
+  std::thread consumer([&] {
+    int val;
+    pq.pop(val);
+    EXPECT_EQ(val, 1);
+  });
+  // Let the consumer take its ticket and block.
+  /* sleep override */ std::this_thread::sleep_for(std::chrono::seconds(1));
+  pq.push(1);
+  std::vector<int> out;
+  EXPECT_EQ(pq.popBatch(std::back_inserter(out), 10), 0);
+  consumer.join();
+  EXPECT_TRUE(pq.empty());
+}
+
+/// popBatch does not take the values that blocked pop() calls wait for
+TEST(CPQ, PopBatchWithBlockedPop) {
+  RelaxedConcurrentPriorityQueue<int, true, false> pq;
+  constexpr int kPoppers = 4;
+  constexpr int kPerPopper = 1000;
+  constexpr int kBatchPopped = 4000;
+  constexpr int kPushers = 2;
+  constexpr int kPerPusher = (kPoppers * kPerPopper + kBatchPopped) / kPushers;
+  std::atomic<uint64_t> pushSum(0);
+  std::atomic<uint64_t> popSum(0);
+  // Values still to be taken by popBatch.
+  std::atomic<int> budget(kBatchPopped);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kPoppers; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < kPerPopper; j++) {
+        int val;
+        pq.pop(val);
+        popSum += val;
+      }
+    });
+  }
+  for (int i = 0; i < 2; i++) {
+    threads.emplace_back([&] {
+      std::vector<int> out;
+      while (true) {
+        int left = budget.load();
+        if (left == 0) {
+          break;
+        }
+        int n = std::min(left, 16);
+        if (!budget.compare_exchange_weak(left, left - n)) {
+          continue;
+        }
+        out.clear();
+        int got = static_cast<int>(pq.popBatch(std::back_inserter(out), n));
+        budget += n - got;
+        for (int v : out) {
+          popSum += v;
+        }
+      }
+    });
+  }
+  for (int i = 0; i < kPushers; i++) {
+    threads.emplace_back([&, i] {
+      std::vector<int> batch;
+      for (int j = 0; j < kPerPusher; j++) {
+        int val = i * kPerPusher + j + 1;
+        pushSum += val;
+        if (j % 2) {
+          pq.push(val);
+        } else {
+          batch.push_back(val);
+          if (batch.size() == 10) {
+            pq.pushBatch(batch.begin(), batch.end());
+            batch.clear();
+          }
+        }
+      }
+      pq.pushBatch(batch.begin(), batch.end());
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(popSum.load(), pushSum.load());
+  EXPECT_TRUE(pq.empty());
+}
+
 template <class PriorityQueue>
 void concurrentOps(int ops) {
   for (int t : nthr) {
@@ -1156,6 +1372,76 @@ TEST(CPQ, ProducerConsumerBench) {
   }
 }
 
+template <class PriorityQueue>
+static uint64_t batch_test(std::string name, uint32_t batch) {
+  int ops = 1 << 18;
+  int reps = 15;
+  uint64_t min = UINTMAX_MAX;
+  uint64_t max = 0;
+  uint64_t sum = 0;
+
+  for (int r = 0; r < reps; ++r) {
+    PriorityQueue pq;
+    auto fn = [&](uint32_t tid) {
+      folly::Random::DefaultGenerator rng_tl;
+      rng_tl.seed(tid);
+      std::vector<int> vals(batch);
+      std::vector<int> out;
+      out.reserve(batch);
+      for (int i = tid * batch; i < ops; i += nthreads * batch) {
+        for (auto& v : vals) {
+          v = folly::Random::rand32(rng_tl) % (ops + 1);
+        }
+        if (batch == 1) {
+          pq.push(vals[0]);
+        } else {
+          pq.pushBatch(vals.begin(), vals.end());
+        }
+        for (size_t popped = 0; popped < batch;) {
+          out.clear();
+          popped += pq.popBatch(std::back_inserter(out), batch - popped);
+        }
+      }
+    };
+    uint64_t dur = run_once(fn);
+    sum += dur;
+    min = std::min(min, dur);
+    max = std::max(max, dur);
+  }
+
+  uint64_t avg = sum / reps;
+  std::cout << std::setw(12) << name;
+  std::cout << "   " << std::setw(8) << max / ops << " ns";
+  std::cout << "   " << std::setw(8) << avg / ops << " ns";
+  std::cout << "   " << std::setw(8) << min / ops << " ns";
+  std::cout << std::endl;
+  return min;
+}
+
+TEST(CPQ, BatchBench) {
+  if (!FLAGS_bench) {
+    return;
+  }
+  std::vector<int> batches = {1, 16, 256};
+  std::vector<int> nthrs = {1, 4, 8, 16, 28, 32, 56, 64, 96, 128};
+
+  std::cout
+      << "Each thread pushes a batch of random values, then pops as many.\n"
+      << "The bench caculates the avg execution time for\n"
+      << "one value pushed and popped.\n"
+      << "RCPQ b=N: the relaxed concurrent priority queue, batches of N\n"
+      << std::endl;
+  std::cout << "\nTest_name, Max time, Avg time, Min time" << std::endl;
+  for (int i : nthrs) {
+    nthreads = i;
+    std::cout << "Thread number: " << i << std::endl;
+    for (int b : batches) {
+      batch_test<RelaxedConcurrentPriorityQueue<int>>(
+          "RCPQ b=" + std::to_string(b), b);
+    }
+  }
+}
+
 TEST(CPQ, Accuracy) {
   if (!FLAGS_bench) {
     return;
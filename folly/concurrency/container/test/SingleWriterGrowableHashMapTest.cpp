@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/concurrency/container/SingleWriterGrowableHashMap.h>
+
+#include <folly/portability/GTest.h>
+#include <folly/synchronization/test/Barrier.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using SWGHM = folly::SingleWriterGrowableHashMap<int, int>;
+
+TEST(SingleWriterGrowableHashMap, basic) {
+  SWGHM m;
+  ASSERT_TRUE(m.empty());
+  ASSERT_FALSE(m.contains(1));
+  ASSERT_FALSE(m.get(1).has_value());
+  ASSERT_FALSE(m.erase(1));
+
+  ASSERT_TRUE(m.insert(1, 10));
+  ASSERT_FALSE(m.insert(1, 11));
+  ASSERT_EQ(m.size(), 1);
+  ASSERT_TRUE(m.contains(1));
+  ASSERT_EQ(*m.get(1), 10);
+
+  ASSERT_TRUE(m.erase(1));
+  ASSERT_FALSE(m.erase(1));
+  ASSERT_TRUE(m.empty());
+  ASSERT_FALSE(m.contains(1));
+}
+
+TEST(SingleWriterGrowableHashMap, growAndShrink) {
+  SWGHM m;
+  auto initial = m.capacity();
+  for (int i = 0; i < 10000; ++i) {
+    ASSERT_TRUE(m.insert(i, i));
+    ASSERT_LE(4 * m.size(), 3 * m.capacity());
+  }
+  ASSERT_EQ(m.size(), 10000);
+  ASSERT_LE(m.capacity(), 4 * 10000);
+  for (int i = 0; i < 10000; ++i) {
+    ASSERT_EQ(*m.get(i), i);
+  }
+  for (int i = 0; i < 9990; ++i) {
+    ASSERT_TRUE(m.erase(i));
+  }
+  ASSERT_EQ(m.size(), 10);
+  ASSERT_LE(m.capacity(), 8 * 10);
+  for (int i = 9990; i < 10000; ++i) {
+    ASSERT_EQ(*m.get(i), i);
+  }
+  for (int i = 9990; i < 10000; ++i) {
+    ASSERT_TRUE(m.erase(i));
+  }
+  ASSERT_EQ(m.capacity(), initial);
+}
+
+TEST(SingleWriterGrowableHashMap, tombstoneChurn) {
+  SWGHM m;
+  for (int i = 0; i < 10; ++i) {
+    m.insert(i, i);
+  }
+  // Each key inserted and erased leaves a tombstone, which must not cause
+  // unbounded growth.
+  for (int i = 10; i < 100000; ++i) {
+    ASSERT_TRUE(m.insert(i, i));
+    ASSERT_TRUE(m.erase(i));
+  }
+  ASSERT_EQ(m.size(), 10);
+  ASSERT_LE(m.capacity(), 64);
+}
+
+TEST(SingleWriterGrowableHashMap, forEach) {
+  SWGHM m;
+  for (int i = 0; i < 100; ++i) {
+    m.insert(i, i);
+  }
+  int sum = 0;
+  int count = 0;
+  m.forEach([&](int k, int v) {
+    ASSERT_EQ(k, v);
+    sum += v;
+    ++count;
+  });
+  ASSERT_EQ(count, 100);
+  ASSERT_EQ(sum, 4950);
+}
+
+TEST(SingleWriterGrowableHashMap, drf) {
+  SWGHM m;
+  int nthr = 5;
+  folly::test::Barrier b1(nthr);
+  std::atomic<bool> stop{false};
+
+  // Keys 0..9 stay in the map throughout, so readers must always find them
+  // even while the writer grows and shrinks the table.
+  for (int i = 0; i < 10; ++i) {
+    m.insert(i, i);
+  }
+  auto writer = std::thread([&] {
+    b1.wait();
+    for (int rep = 0; rep < 100; ++rep) {
+      for (int j = 10; j < 1000; ++j) {
+        m.insert(j, j);
+      }
+      for (int j = 10; j < 1000; ++j) {
+        m.erase(j);
+      }
+    }
+    stop.store(true);
+  });
+
+  std::vector<std::thread> readers(nthr - 1);
+  for (int i = 0; i < nthr - 1; ++i) {
+    readers[i] = std::thread([&] {
+      b1.wait();
+      while (!stop.load()) {
+        for (int j = 0; j < 10; ++j) {
+          auto v = m.get(j);
+          ASSERT_TRUE(v.has_value());
+          ASSERT_EQ(*v, j);
+        }
+        int sum = 0;
+        m.forEach([&](int k, int v) {
+          ASSERT_EQ(k, v);
+          sum += k < 10 ? v : 0;
+        });
+        ASSERT_EQ(sum, 45);
+      }
+    });
+  }
+
+  writer.join();
+  for (auto& t : readers) {
+    t.join();
+  }
+}
@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <new>
@@ -370,6 +371,10 @@ class alignas(64) BucketTable {
     auto count = bucket_count_.load(std::memory_order_relaxed);
     buckets->unlink_and_reclaim_nodes(count);
     buckets->destroy(count);
+    if (newbuckets_) {
+      newbuckets_->unlink_and_reclaim_nodes(newcount_);
+      newbuckets_->destroy(newcount_);
+    }
   }
 
   size_t size() { return size_.load(std::memory_order_acquire); }
@@ -416,62 +421,23 @@ class alignas(64) BucketTable {
 
   // Must hold lock.
   void rehash(size_t bucket_count, hazptr_obj_cohort<Atom>* cohort) {
+    finishRehash();
     auto oldcount = bucket_count_.load(std::memory_order_relaxed);
     // bucket_count must be a power of 2
     DCHECK_EQ(bucket_count & (bucket_count - 1), 0);
     if (bucket_count <= oldcount) {
       return; // Rehash only if expanding.
     }
-    auto buckets = buckets_.load(std::memory_order_relaxed);
-    DCHECK(buckets); // Use-after-destruction by user.
-    auto newbuckets = Buckets::create(bucket_count, cohort);
-    load_factor_nodes_ =
-        to_integral(static_cast<float>(bucket_count) * load_factor_);
-    for (size_t i = 0; i < oldcount; i++) {
-      auto bucket = &buckets->array()[i]();
-      auto node = bucket->load(std::memory_order_relaxed);
-      if (!node) {
-        continue;
-      }
-      auto h = HashFn()(node->getItem().first);
-      auto idx = getIdx(bucket_count, h);
-      // Reuse as long a chain as possible from the end.  Since the
-      // nodes don't have previous pointers, the longest last chain
-      // will be the same for both the previous hashmap and the new one,
-      // assuming all the nodes hash to the same bucket.
-      auto lastrun = node;
-      auto lastidx = idx;
-      auto last = node->next_.load(std::memory_order_relaxed);
-      for (; last != nullptr;
-           last = last->next_.load(std::memory_order_relaxed)) {
-        auto k = getIdx(bucket_count, HashFn()(last->getItem().first));
-        if (k != lastidx) {
-          lastidx = k;
-          lastrun = last;
-        }
-      }
-      // Set longest last run in new bucket, incrementing the refcount.
-      lastrun->acquire_link(); // defined in hazptr_obj_base_linked
-      newbuckets->array()[lastidx]().store(lastrun, std::memory_order_relaxed);
-      // Clone remaining nodes
-      for (; node != lastrun;
-           node = node->next_.load(std::memory_order_relaxed)) {
-        auto newnode = (Node*)Allocator().allocate(sizeof(Node));
-        new (newnode) Node(cohort, node);
-        auto k = getIdx(bucket_count, HashFn()(node->getItem().first));
-        auto prevhead = &newbuckets->array()[k]();
-        newnode->next_.store(prevhead->load(std::memory_order_relaxed));
-        prevhead->store(newnode, std::memory_order_relaxed);
-      }
-    }
+    startRehash(bucket_count, cohort);
+    finishRehash();
+  }
 
-    auto oldbuckets = buckets_.load(std::memory_order_relaxed);
-    DCHECK(oldbuckets); // Use-after-destruction by user.
-    seqlock_.fetch_add(1, std::memory_order_release);
-    bucket_count_.store(bucket_count, std::memory_order_release);
-    buckets_.store(newbuckets, std::memory_order_release);
-    seqlock_.fetch_add(1, std::memory_order_release);
-    oldbuckets->retire(concurrenthashmap::HazptrTableDeleter(oldcount));
+  // Grows the table, if needed, so that it holds count nodes without
+  // another rehash.
+  void reserve(size_t count, hazptr_obj_cohort<Atom>* cohort) {
+    size_t min_buckets = to_integral(static_cast<float>(count) / load_factor_);
+    std::lock_guard g(m_);
+    rehash(folly::nextPowTwo(min_buckets + 1), cohort);
   }
 
   template <typename K>
@@ -501,6 +467,7 @@ class alignas(64) BucketTable {
     Node* node{nullptr};
     {
       std::lock_guard g(m_);
+      continueRehash(kRehashStep);
 
       size_t bcount = bucket_count_.load(std::memory_order_relaxed);
       auto buckets = buckets_.load(std::memory_order_relaxed);
@@ -524,6 +491,7 @@ class alignas(64) BucketTable {
             // Must be head of list.
             head->store(next, std::memory_order_release);
           }
+          recopyBucket(idx);
 
           if (iter) {
             iter->hazptrs_[0].reset_protection(buckets);
@@ -555,6 +523,10 @@ class alignas(64) BucketTable {
     Buckets* buckets;
     {
       std::lock_guard g(m_);
+      if (newbuckets_) {
+        // Nothing to copy anymore.
+        std::exchange(newbuckets_, nullptr)->destroy(newcount_);
+      }
       bcount = bucket_count_.load(std::memory_order_relaxed);
       auto newbuckets = Buckets::create(bcount, cohort);
       buckets = buckets_.load(std::memory_order_relaxed);
@@ -740,6 +712,113 @@ class alignas(64) BucketTable {
     DCHECK(buckets) << "Use-after-destruction by user.";
   }
 
+  // Rehashing is incremental: once a table reaches its load factor, the
+  // nodes are copied into a larger table that readers don't see yet,
+  // kRehashStep buckets at a time by every writer taking the lock, and the
+  // tables are only switched once all of them are. Writes keep going to
+  // the current table in the meantime, and a bucket that was already
+  // copied is copied again after each write to it.
+  static constexpr size_t kRehashStep = 16;
+
+  // Must hold lock.
+  void startRehash(size_t bucket_count, hazptr_obj_cohort<Atom>* cohort) {
+    DCHECK(!newbuckets_);
+    newbuckets_ = Buckets::create(bucket_count, cohort);
+    newcount_ = bucket_count;
+    rehashed_ = 0;
+    rehash_cohort_ = cohort;
+  }
+
+  // Must hold lock. Copies up to count more buckets into the new table, and
+  // switches to it once they all are.
+  void continueRehash(size_t count) {
+    if (!newbuckets_) {
+      return;
+    }
+    auto oldcount = bucket_count_.load(std::memory_order_relaxed);
+    auto buckets = buckets_.load(std::memory_order_relaxed);
+    DCHECK(buckets); // Use-after-destruction by user.
+    count = std::min(count, oldcount - rehashed_);
+    for (; count > 0; --count) {
+      copyBucket(buckets, rehashed_++);
+    }
+    if (rehashed_ < oldcount) {
+      return;
+    }
+
+    load_factor_nodes_ =
+        to_integral(static_cast<float>(newcount_) * load_factor_);
+    seqlock_.fetch_add(1, std::memory_order_release);
+    bucket_count_.store(newcount_, std::memory_order_release);
+    buckets_.store(newbuckets_, std::memory_order_release);
+    seqlock_.fetch_add(1, std::memory_order_release);
+    newbuckets_ = nullptr;
+    buckets->retire(concurrenthashmap::HazptrTableDeleter(oldcount));
+  }
+
+  // Must hold lock.
+  void finishRehash() {
+    continueRehash(std::numeric_limits<size_t>::max());
+  }
+
+  // Must hold lock. Copies the nodes of bucket i into the new table.
+  void copyBucket(Buckets* buckets, size_t i) {
+    auto bucket = &buckets->array()[i]();
+    auto node = bucket->load(std::memory_order_relaxed);
+    if (!node) {
+      return;
+    }
+    auto h = HashFn()(node->getItem().first);
+    auto idx = getIdx(newcount_, h);
+    // Reuse as long a chain as possible from the end.  Since the
+    // nodes don't have previous pointers, the longest last chain
+    // will be the same for both the previous hashmap and the new one,
+    // assuming all the nodes hash to the same bucket.
+    auto lastrun = node;
+    auto lastidx = idx;
+    auto last = node->next_.load(std::memory_order_relaxed);
+    for (; last != nullptr;
+         last = last->next_.load(std::memory_order_relaxed)) {
+      auto k = getIdx(newcount_, HashFn()(last->getItem().first));
+      if (k != lastidx) {
+        lastidx = k;
+        lastrun = last;
+      }
+    }
+    // Set longest last run in new bucket, incrementing the refcount.
+    lastrun->acquire_link(); // defined in hazptr_obj_base_linked
+    newbuckets_->array()[lastidx]().store(lastrun, std::memory_order_relaxed);
+    // Clone remaining nodes
+    for (; node != lastrun;
+         node = node->next_.load(std::memory_order_relaxed)) {
+      auto newnode = (Node*)Allocator().allocate(sizeof(Node));
+      new (newnode) Node(rehash_cohort_, node);
+      auto k = getIdx(newcount_, HashFn()(node->getItem().first));
+      auto prevhead = &newbuckets_->array()[k]();
+      newnode->next_.store(prevhead->load(std::memory_order_relaxed));
+      prevhead->store(newnode, std::memory_order_relaxed);
+    }
+  }
+
+  // Must hold lock, after a write to bucket i. Brings the new table up to
+  // date if that bucket was copied already.
+  void recopyBucket(size_t i) {
+    if (!newbuckets_ || i >= rehashed_) {
+      return;
+    }
+    // The bucket's nodes all went to the new buckets with the same low bits.
+    auto oldcount = bucket_count_.load(std::memory_order_relaxed);
+    for (size_t k = i; k < newcount_; k += oldcount) {
+      auto& root = newbuckets_->array()[k]();
+      auto node = root.load(std::memory_order_relaxed);
+      if (node) {
+        root.store(nullptr, std::memory_order_relaxed);
+        node->release();
+      }
+    }
+    copyBucket(buckets_.load(std::memory_order_relaxed), i);
+  }
+
   template <typename MatchFunc, typename K, typename... Args>
   bool doInsert(
       Iterator& it,
@@ -751,18 +830,20 @@ class alignas(64) BucketTable {
       hazptr_obj_cohort<Atom>* cohort,
       Args&&... args) {
     std::unique_lock g(m_);
+    continueRehash(kRehashStep);
 
     size_t bcount = bucket_count_.load(std::memory_order_relaxed);
     auto buckets = buckets_.load(std::memory_order_relaxed);
     // Check for rehash needed for DOES_NOT_EXIST
-    if (size() >= load_factor_nodes_ &&
+    if (!newbuckets_ && size() >= load_factor_nodes_ &&
         (type == InsertType::DOES_NOT_EXIST ||
          type == InsertType::MATCH_OR_DOES_NOT_EXIST)) {
       if (max_size_ && size() << 1 > max_size_) {
         // Would exceed max size.
         throw_exception<std::bad_alloc>();
       }
-      rehash(bcount << 1, cohort);
+      startRehash(bcount << 1, cohort);
+      continueRehash(kRehashStep);
       buckets = buckets_.load(std::memory_order_relaxed);
       bcount = bucket_count_.load(std::memory_order_relaxed);
     }
@@ -803,6 +884,7 @@ class alignas(64) BucketTable {
             next->acquire_link(); // defined in hazptr_obj_base_linked
           }
           prev->store(cur, std::memory_order_release);
+          recopyBucket(idx);
           it.setNode(cur, buckets, bcount, idx);
           haznode.reset_protection(cur);
           g.unlock();
@@ -823,21 +905,25 @@ class alignas(64) BucketTable {
       return false;
     }
     // Node not found, check for rehash on ANY
-    if (size() >= load_factor_nodes_ && type == InsertType::ANY) {
+    if (!newbuckets_ && size() >= load_factor_nodes_ &&
+        type == InsertType::ANY) {
       if (max_size_ && size() << 1 > max_size_) {
         // Would exceed max size.
         throw_exception<std::bad_alloc>();
       }
-      rehash(bcount << 1, cohort);
-
-      // Reload correct bucket.
-      buckets = buckets_.load(std::memory_order_relaxed);
-      DCHECK(buckets); // Use-after-destruction by user.
-      bcount <<= 1;
-      hazbuckets.reset_protection(buckets);
-      idx = getIdx(bcount, h);
-      head = &buckets->array()[idx]();
-      headnode = head->load(std::memory_order_relaxed);
+      startRehash(bcount << 1, cohort);
+      continueRehash(kRehashStep);
+
+      if (!newbuckets_) {
+        // Small enough to be rehashed at once, reload correct bucket.
+        buckets = buckets_.load(std::memory_order_relaxed);
+        DCHECK(buckets); // Use-after-destruction by user.
+        bcount <<= 1;
+        hazbuckets.reset_protection(buckets);
+        idx = getIdx(bcount, h);
+        head = &buckets->array()[idx]();
+        headnode = head->load(std::memory_order_relaxed);
+      }
     }
 
     // We found a slot to put the node.
@@ -853,6 +939,7 @@ class alignas(64) BucketTable {
     }
     cur->next_.store(headnode, std::memory_order_relaxed);
     head->store(cur, std::memory_order_release);
+    recopyBucket(idx);
     it.setNode(cur, buckets, bcount, idx);
     haznode.reset_protection(cur);
     return true;
@@ -864,6 +951,13 @@ class alignas(64) BucketTable {
   Atom<size_t> size_{0};
   size_t const max_size_;
 
+  // The table being filled by an incremental rehash, if any, and how many
+  // buckets of the current one were copied into it.
+  Buckets* newbuckets_{nullptr};
+  size_t newcount_{0};
+  size_t rehashed_{0};
+  hazptr_obj_cohort<Atom>* rehash_cohort_{nullptr};
+
   // Fields needed for read-only access, on separate cacheline.
   alignas(64) Atom<Buckets*> buckets_{nullptr};
   std::atomic<uint64_t> seqlock_{0};
@@ -1317,6 +1411,10 @@ class alignas(64) SIMDTable {
     auto count = chunk_count_.load(std::memory_order_relaxed);
     chunks->reclaim_nodes(count);
     chunks->destroy(count);
+    if (new_chunks_) {
+      // Only holds nodes of the current chunks.
+      new_chunks_->destroy(new_chunk_count_);
+    }
   }
 
   size_t size() { return size_.load(std::memory_order_acquire); }
@@ -1379,6 +1477,7 @@ class alignas(64) SIMDTable {
 
     Chunk* chunk = chunks->getChunk(chunk_idx, ccount);
     chunk->setNodeAndTag(tag_idx, cur, hp.second);
+    copyWrite(chunk_idx, hp, node, cur);
     it.setNode(cur, chunks, ccount, chunk_idx, tag_idx);
     it.hazptrs_[1].reset_protection(cur);
 
@@ -1431,6 +1530,7 @@ class alignas(64) SIMDTable {
 
     Chunk* chunk = chunks->getChunk(chunk_idx, ccount);
     chunk->setNodeAndTag(tag_idx, cur, hp.second);
+    copyWrite(chunk_idx, hp, node, cur);
     it.setNode(cur, chunks, ccount, chunk_idx, tag_idx);
     it.hazptrs_[1].reset_protection(cur);
 
@@ -1447,6 +1547,15 @@ class alignas(64) SIMDTable {
     rehash_internal(folly::nextPowTwo(new_chunk_count), cohort);
   }
 
+  // Grows the table, if needed, so that it holds count nodes without
+  // another rehash.
+  void reserve(size_t count, hazptr_obj_cohort<Atom>* cohort) {
+    size_t min_chunks = to_integral(
+        static_cast<float>(count) / (Chunk::kCapacity * load_factor_));
+    std::lock_guard g(m_);
+    rehash_internal(folly::nextPowTwo(min_chunks + 1), cohort);
+  }
+
   template <typename K>
   bool find(Iterator& res, size_t h, const K& k) {
     auto& hazz = res.hazptrs_[1];
@@ -1484,6 +1593,7 @@ class alignas(64) SIMDTable {
     const HashPair hp = splitHash(h);
 
     std::unique_lock g(m_);
+    continueRehash(kRehashStep);
 
     size_t ccount = chunk_count_.load(std::memory_order_relaxed);
     auto chunks = chunks_.load(std::memory_order_relaxed);
@@ -1500,28 +1610,8 @@ class alignas(64) SIMDTable {
       return 0;
     }
 
-    Chunk* chunk = chunks->getChunk(chunk_idx, ccount);
-
-    // Decrement any overflow counters
-    if (chunk->hostedOverflowCount() != 0) {
-      size_t index = hp.first;
-      size_t delta = probeDelta(hp);
-      bool preferredChunk = true;
-      while (true) {
-        Chunk* overflowChunk = chunks->getChunk(index, ccount);
-        if (chunk == overflowChunk) {
-          if (!preferredChunk) {
-            overflowChunk->decrHostedOverflowCount();
-          }
-          break;
-        }
-        overflowChunk->decrOutboundOverflowCount();
-        preferredChunk = false;
-        index += delta;
-      }
-    }
-
-    chunk->clearNodeAndTag(tag_idx);
+    eraseAt(chunks, ccount, hp, chunk_idx, tag_idx);
+    copyWrite(chunk_idx, hp, node, nullptr);
 
     decSize();
     if (iter) {
@@ -1540,6 +1630,10 @@ class alignas(64) SIMDTable {
     Chunks* chunks;
     {
       std::lock_guard g(m_);
+      if (new_chunks_) {
+        // Nothing to copy anymore.
+        std::exchange(new_chunks_, nullptr)->destroy(new_chunk_count_);
+      }
       ccount = chunk_count_.load(std::memory_order_relaxed);
       auto newchunks = Chunks::create(ccount, cohort);
       chunks = chunks_.load(std::memory_order_relaxed);
@@ -1559,7 +1653,7 @@ class alignas(64) SIMDTable {
     std::lock_guard g(m_);
     load_factor_ = factor;
     auto ccount = chunk_count_.load(std::memory_order_relaxed);
-    grow_threshold_ = ccount * Chunk::kCapacity * load_factor_;
+    setThresholds(ccount);
   }
 
   Iterator cbegin() {
@@ -1620,6 +1714,37 @@ class alignas(64) SIMDTable {
     return nullptr;
   }
 
+  // Must hold lock. Clears the slot of the node found at chunk_idx, tag_idx.
+  void eraseAt(
+      Chunks* chunks,
+      size_t ccount,
+      const HashPair& hp,
+      size_t chunk_idx,
+      size_t tag_idx) {
+    Chunk* chunk = chunks->getChunk(chunk_idx, ccount);
+
+    // Decrement any overflow counters
+    if (chunk->hostedOverflowCount() != 0) {
+      size_t index = hp.first;
+      size_t delta = probeDelta(hp);
+      bool preferredChunk = true;
+      while (true) {
+        Chunk* overflowChunk = chunks->getChunk(index, ccount);
+        if (chunk == overflowChunk) {
+          if (!preferredChunk) {
+            overflowChunk->decrHostedOverflowCount();
+          }
+          break;
+        }
+        overflowChunk->decrOutboundOverflowCount();
+        preferredChunk = false;
+        index += delta;
+      }
+    }
+
+    chunk->clearNodeAndTag(tag_idx);
+  }
+
   template <typename MatchFunc, typename K, typename... Args>
   bool prepare_insert(
       Iterator& it,
@@ -1633,17 +1758,14 @@ class alignas(64) SIMDTable {
       Chunks*& chunks,
       size_t& ccount,
       const HashPair& hp) {
+    continueRehash(kRehashStep);
     ccount = chunk_count_.load(std::memory_order_relaxed);
     chunks = chunks_.load(std::memory_order_relaxed);
 
-    if (size() >= grow_threshold_ &&
+    if (size() >= rehash_threshold_ &&
         (type == InsertType::DOES_NOT_EXIST ||
          type == InsertType::MATCH_OR_DOES_NOT_EXIST)) {
-      if (max_size_ && size() << 1 > max_size_) {
-        // Would exceed max size.
-        throw_exception<std::bad_alloc>();
-      }
-      rehash_internal(ccount << 1, cohort);
+      grow(ccount, cohort);
       ccount = chunk_count_.load(std::memory_order_relaxed);
       chunks = chunks_.load(std::memory_order_relaxed);
     }
@@ -1671,12 +1793,8 @@ class alignas(64) SIMDTable {
         return false;
       }
       // Already checked for rehash on DOES_NOT_EXIST, now check on ANY
-      if (size() >= grow_threshold_ && type == InsertType::ANY) {
-        if (max_size_ && size() << 1 > max_size_) {
-          // Would exceed max size.
-          throw_exception<std::bad_alloc>();
-        }
-        rehash_internal(ccount << 1, cohort);
+      if (size() >= rehash_threshold_ && type == InsertType::ANY) {
+        grow(ccount, cohort);
         ccount = chunk_count_.load(std::memory_order_relaxed);
         chunks = chunks_.load(std::memory_order_relaxed);
         DCHECK(chunks); // Use-after-destruction by user.
@@ -1689,42 +1807,132 @@ class alignas(64) SIMDTable {
   void rehash_internal(
       size_t new_chunk_count, hazptr_obj_cohort<Atom>* cohort) {
     DCHECK(isPowTwo(new_chunk_count));
+    finishRehash();
     auto old_chunk_count = chunk_count_.load(std::memory_order_relaxed);
     if (old_chunk_count >= new_chunk_count) {
       return;
     }
-    auto new_chunks = Chunks::create(new_chunk_count, cohort);
-    auto old_chunks = chunks_.load(std::memory_order_relaxed);
-    grow_threshold_ =
-        to_integral(new_chunk_count * Chunk::kCapacity * load_factor_);
+    startRehash(new_chunk_count, cohort);
+    finishRehash();
+  }
+
+  // Rehashing is incremental: it starts before the table is full, at
+  // rehash_threshold_, and the nodes are then moved to a larger table that
+  // readers don't see yet, kRehashStep chunks at a time by every writer
+  // taking the lock. The tables are switched once all the chunks are moved.
+  // Writes keep going to the current table in the meantime, and are
+  // repeated in the new one for the chunks already moved. An insert that
+  // reaches grow_threshold_ first moves the remaining chunks.
+  static constexpr size_t kRehashStep = 2;
+
+  void setThresholds(size_t ccount) {
+    grow_threshold_ = to_integral(ccount * Chunk::kCapacity * load_factor_);
+    rehash_threshold_ = grow_threshold_ - grow_threshold_ / 8;
+  }
+
+  // Must hold lock. Called by inserts from rehash_threshold_ on.
+  void grow(size_t ccount, hazptr_obj_cohort<Atom>* cohort) {
+    if (size() >= grow_threshold_) {
+      if (!new_chunks_ && max_size_ && size() << 1 > max_size_) {
+        // Would exceed max size.
+        throw_exception<std::bad_alloc>();
+      }
+      rehash_internal(ccount << 1, cohort);
+    } else if (
+        !new_chunks_ && (!max_size_ || grow_threshold_ << 1 <= max_size_)) {
+      // Only start if growing at grow_threshold_ would not exceed max size.
+      startRehash(ccount << 1, cohort);
+      continueRehash(kRehashStep);
+    }
+  }
 
-    for (size_t i = 0; i < old_chunk_count; i++) {
+  // Must hold lock.
+  void startRehash(size_t new_chunk_count, hazptr_obj_cohort<Atom>* cohort) {
+    DCHECK(!new_chunks_);
+    new_chunks_ = Chunks::create(new_chunk_count, cohort);
+    new_chunk_count_ = new_chunk_count;
+    rehashed_chunks_ = 0;
+  }
+
+  // Must hold lock. Moves the nodes of up to count more chunks to the new
+  // table, and switches to it once they all are.
+  void continueRehash(size_t count) {
+    if (!new_chunks_) {
+      return;
+    }
+    auto old_chunk_count = chunk_count_.load(std::memory_order_relaxed);
+    auto old_chunks = chunks_.load(std::memory_order_relaxed);
+    count = std::min(count, old_chunk_count - rehashed_chunks_);
+    for (; count > 0; --count) {
       DCHECK(old_chunks); // Use-after-destruction by user.
-      Chunk* oldchunk = old_chunks->getChunk(i, old_chunk_count);
+      Chunk* oldchunk =
+          old_chunks->getChunk(rehashed_chunks_++, old_chunk_count);
       auto occupied = oldchunk->occupiedIter();
       while (occupied.hasNext()) {
         auto idx = occupied.next();
         Node* node = oldchunk->item(idx).load(std::memory_order_relaxed);
-        size_t new_chunk_idx;
-        size_t new_tag_idx;
         auto h = HashFn()(node->getItem().first);
-        auto hp = splitHash(h);
-        std::tie(new_chunk_idx, new_tag_idx) =
-            findEmptyInsertLocation(new_chunks, new_chunk_count, hp);
-        Chunk* newchunk = new_chunks->getChunk(new_chunk_idx, new_chunk_count);
-        newchunk->setNodeAndTag(new_tag_idx, node, hp.second);
+        copyNode(splitHash(h), node);
       }
     }
+    if (rehashed_chunks_ < old_chunk_count) {
+      return;
+    }
 
+    setThresholds(new_chunk_count_);
     seqlock_.fetch_add(1, std::memory_order_release);
-    chunk_count_.store(new_chunk_count, std::memory_order_release);
-    chunks_.store(new_chunks, std::memory_order_release);
+    chunk_count_.store(new_chunk_count_, std::memory_order_release);
+    chunks_.store(new_chunks_, std::memory_order_release);
     seqlock_.fetch_add(1, std::memory_order_release);
+    new_chunks_ = nullptr;
     if (old_chunks) {
       old_chunks->retire(HazptrTableDeleter(old_chunk_count));
     }
   }
 
+  // Must hold lock.
+  void finishRehash() {
+    continueRehash(std::numeric_limits<size_t>::max());
+  }
+
+  // Must hold lock.
+  void copyNode(const HashPair& hp, Node* node) {
+    size_t new_chunk_idx;
+    size_t new_tag_idx;
+    std::tie(new_chunk_idx, new_tag_idx) =
+        findEmptyInsertLocation(new_chunks_, new_chunk_count_, hp);
+    Chunk* newchunk = new_chunks_->getChunk(new_chunk_idx, new_chunk_count_);
+    newchunk->setNodeAndTag(new_tag_idx, node, hp.second);
+  }
+
+  // Must hold lock, after node was replaced with cur in chunk chunk_idx,
+  // where either may be null. Repeats that in the new table if the chunk
+  // was moved already.
+  void copyWrite(size_t chunk_idx, const HashPair& hp, Node* node, Node* cur) {
+    if (!new_chunks_ || chunk_idx >= rehashed_chunks_) {
+      return;
+    }
+    if (!node) {
+      copyNode(hp, cur);
+      return;
+    }
+    size_t new_chunk_idx, new_tag_idx;
+    [[maybe_unused]] Node* found = find_internal(
+        node->getItem().first,
+        hp,
+        new_chunks_,
+        new_chunk_count_,
+        new_chunk_idx,
+        new_tag_idx);
+    DCHECK_EQ(node, found);
+    if (cur) {
+      new_chunks_->getChunk(new_chunk_idx, new_chunk_count_)
+          ->setNodeAndTag(new_tag_idx, cur, hp.second);
+    } else {
+      eraseAt(new_chunks_, new_chunk_count_, hp, new_chunk_idx, new_tag_idx);
+    }
+  }
+
   void getChunksAndCount(
       size_t& ccount, Chunks*& chunks, hazptr_holder<Atom>& hazptr) {
     while (true) {
@@ -1762,9 +1970,16 @@ class alignas(64) SIMDTable {
   Mutex m_;
   float load_factor_; // ceil of 1.0
   size_t grow_threshold_;
+  size_t rehash_threshold_;
   Atom<size_t> size_{0};
   size_t const max_size_;
 
+  // The table being filled by an incremental rehash, if any, and how many
+  // chunks of the current one were moved to it.
+  Chunks* new_chunks_{nullptr};
+  size_t new_chunk_count_{0};
+  size_t rehashed_chunks_{0};
+
   // Fields needed for read-only access, on separate cacheline.
   alignas(64) Atom<Chunks*> chunks_{nullptr};
   std::atomic<uint64_t> seqlock_{0};
@@ -2028,6 +2243,8 @@ class alignas(64) ConcurrentHashMapSegment {
     impl_.rehash(folly::nextPowTwo(bucket_count), cohort_);
   }
 
+  void reserve(size_t count) { impl_.reserve(count, cohort_); }
+
   template <typename K>
   bool find(Iterator& res, size_t h, const K& k) {
     return impl_.find(res, h, k);
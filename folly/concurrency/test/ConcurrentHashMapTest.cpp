@@ -19,7 +19,9 @@
 #include <atomic>
 #include <limits>
 #include <memory>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <folly/Traits.h>
@@ -227,6 +229,168 @@ TYPED_TEST_P(ConcurrentHashMapTest, ReserveTest) {
   EXPECT_EQ(insert_count, actual_count);
 }
 
+TYPED_TEST_P(ConcurrentHashMapTest, InsertBulkTest) {
+  CHM<uint64_t, uint64_t> foomap;
+  std::vector<std::pair<uint64_t, uint64_t>> items;
+  EXPECT_EQ(0, foomap.insertBulk(items.begin(), items.end()));
+  EXPECT_TRUE(foomap.empty());
+
+  for (uint64_t i = 0; i < 10000; i++) {
+    items.emplace_back(i, i * 2);
+  }
+  foomap.insert(5, 5);
+  EXPECT_EQ(items.size() - 1, foomap.insertBulk(items.begin(), items.end()));
+  EXPECT_EQ(items.size(), foomap.size());
+  for (uint64_t i = 0; i < 10000; i++) {
+    auto res = foomap.find(i);
+    ASSERT_NE(res, foomap.cend());
+    EXPECT_EQ(i == 5 ? 5 : i * 2, res->second);
+  }
+  // Everything is already present.
+  EXPECT_EQ(0, foomap.insertBulk(items.begin(), items.end()));
+}
+
+TYPED_TEST_P(ConcurrentHashMapTest, InsertBulkMoveTest) {
+  CHM<std::string, std::unique_ptr<int>> foomap;
+  std::vector<std::pair<std::string, std::unique_ptr<int>>> items;
+  for (int i = 0; i < 100; i++) {
+    items.emplace_back(std::to_string(i), std::make_unique<int>(i));
+  }
+  foomap.insert("7", std::make_unique<int>(-7));
+  EXPECT_EQ(
+      items.size() - 1,
+      foomap.insertBulk(
+          std::make_move_iterator(items.begin()),
+          std::make_move_iterator(items.end())));
+  for (int i = 0; i < 100; i++) {
+    auto res = foomap.find(std::to_string(i));
+    ASSERT_NE(res, foomap.cend());
+    if (i == 7) {
+      // Not moved out, since the key was already present.
+      EXPECT_EQ("7", items[i].first);
+      ASSERT_NE(nullptr, items[i].second);
+      EXPECT_EQ(7, *items[i].second);
+      EXPECT_EQ(-7, *res->second);
+    } else {
+      EXPECT_EQ(nullptr, items[i].second);
+      EXPECT_EQ(i, *res->second);
+    }
+  }
+}
+
+TYPED_TEST_P(ConcurrentHashMapTest, InsertBulkStressTest) {
+  CHM<uint64_t, uint64_t> foomap;
+  unsigned num_threads = 8;
+  uint64_t per_thread = 10000;
+  std::vector<std::thread> threads;
+  std::atomic<uint64_t> inserted{0};
+  for (unsigned t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      // Half of each thread's keys overlap with the next thread's.
+      std::vector<std::pair<uint64_t, uint64_t>> items;
+      for (uint64_t i = 0; i < per_thread; i++) {
+        auto k = t * per_thread / 2 + i;
+        items.emplace_back(k, k);
+      }
+      inserted += foomap.insertBulk(items.begin(), items.end());
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  uint64_t expected = (num_threads + 1) * per_thread / 2;
+  EXPECT_EQ(expected, inserted.load());
+  EXPECT_EQ(expected, foomap.size());
+  for (uint64_t k = 0; k < expected; ++k) {
+    auto res = foomap.find(k);
+    ASSERT_NE(res, foomap.cend());
+    EXPECT_EQ(k, res->second);
+  }
+}
+
+TYPED_TEST_P(ConcurrentHashMapTest, IncrementalRehashTest) {
+  // Mixes inserts, assignments and erases, so that many of them land in
+  // buckets already copied by an incremental rehash in progress.
+  CHM<uint64_t, uint64_t> foomap(2);
+  std::unordered_map<uint64_t, uint64_t> expected;
+  uint64_t next = 0;
+  for (uint64_t i = 0; i < 100000; i++) {
+    uint64_t k = folly::hash::jenkins_rev_mix32(next);
+    switch (i % 4) {
+      case 0:
+      case 1:
+        EXPECT_TRUE(foomap.insert(k, i).second);
+        expected[k] = i;
+        next++;
+        break;
+      case 2:
+        k = folly::hash::jenkins_rev_mix32(next / 2);
+        EXPECT_TRUE(foomap.insert_or_assign(k, i).second);
+        expected[k] = i;
+        break;
+      case 3:
+        k = folly::hash::jenkins_rev_mix32(next - 1);
+        EXPECT_EQ(1, foomap.erase(k));
+        expected.erase(k);
+        EXPECT_TRUE(foomap.insert(k, i).second);
+        expected[k] = i;
+        break;
+    }
+    auto res = foomap.find(k);
+    ASSERT_NE(res, foomap.cend());
+    EXPECT_EQ(expected[k], res->second);
+  }
+  EXPECT_EQ(expected.size(), foomap.size());
+  size_t count = 0;
+  for (auto it = foomap.cbegin(); it != foomap.cend(); ++it) {
+    EXPECT_EQ(expected[it->first], it->second);
+    count++;
+  }
+  EXPECT_EQ(expected.size(), count);
+}
+
+TYPED_TEST_P(ConcurrentHashMapTest, IncrementalRehashReadersTest) {
+  // Readers keep finding the keys that are there while writers grow the
+  // map, each one only copying part of the nodes.
+  CHM<uint64_t, uint64_t> foomap(2);
+  uint64_t fixed = 1000;
+  for (uint64_t k = 0; k < fixed; k++) {
+    foomap.insert(k, k);
+  }
+  unsigned num_writers = 2;
+  uint64_t per_writer = 50000;
+  std::atomic<unsigned> writing{num_writers};
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < num_writers; ++t) {
+    threads.emplace_back([&, t] {
+      for (uint64_t i = 0; i < per_writer; i++) {
+        uint64_t k = fixed + t * per_writer + i;
+        EXPECT_TRUE(foomap.insert(k, k).second);
+        if (i % 3 == 0) {
+          EXPECT_EQ(1, foomap.erase(k));
+        }
+      }
+      writing--;
+    });
+  }
+  for (unsigned t = 0; t < 2; ++t) {
+    threads.emplace_back([&] {
+      while (writing.load()) {
+        for (uint64_t k = 0; k < fixed; k++) {
+          auto res = foomap.find(k);
+          ASSERT_NE(res, foomap.cend());
+          EXPECT_EQ(k, res->second);
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  uint64_t erased = num_writers * ((per_writer + 2) / 3);
+  EXPECT_EQ(fixed + num_writers * per_writer - erased, foomap.size());
+}
+
 // Ensure we can insert objects without copy constructors.
 TYPED_TEST_P(ConcurrentHashMapTest, MapNoCopiesTest) {
   struct Uncopyable {
@@ -1254,6 +1418,11 @@ REGISTER_TYPED_TEST_SUITE_P(
     EmplaceTest,
     MapResizeTest,
     ReserveTest,
+    InsertBulkTest,
+    InsertBulkMoveTest,
+    InsertBulkStressTest,
+    IncrementalRehashTest,
+    IncrementalRehashReadersTest,
     MapNoCopiesTest,
     MapMovableKeysTest,
     MapUpdateTest,
@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * F14MappedMap is a read-only hash table whose storage is a flat byte
+ * image, so it can be written to a file once and later served straight
+ * out of an mmap of that file.  Opening a table costs a MemoryMapping and
+ * a header check rather than a rebuild, and lookups fault pages in from
+ * the page cache on demand.
+ *
+ * The image uses the F14 chunk layout: each chunk holds 14 (or 12) tag
+ * bytes, the overflow counter, and the items themselves, and find()
+ * runs the same vectorized tag filter and double-hashing probe as
+ * F14ValueMap.  The image contains no pointers, so it is relocatable;
+ * it can be mapped at any address or embedded in a larger buffer.
+ *
+ * Requirements:
+ *
+ * - Key and Mapped must be trivially copyable, since they are stored as
+ *   raw bytes.
+ * - Hasher must be deterministic across processes, as the default hasher
+ *   is for integral keys.  Opening an image rehashes one stored key and
+ *   rejects the image if the result disagrees with the writer's, which
+ *   catches a different hasher or a build with different F14 hash mixing.
+ * - The image uses the host's byte order and is only readable by a build
+ *   with the same type sizes and F14 chunk geometry; both are checked.
+ *
+ * Example:
+ *
+ *   F14ValueMap<uint64_t, Entry> m = buildFromSource();
+ *   F14MappedMap<uint64_t, Entry>::write(m, "/data/entries.f14");
+ *   ...
+ *   F14MappedMap<uint64_t, Entry> table("/data/entries.f14");
+ *   if (auto* e = table.find(id)) { use(e->second); }
+ *
+ * Only available when F14 vector intrinsics are (see
+ * FOLLY_F14_VECTOR_INTRINSICS_AVAILABLE).
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+
+#include <folly/File.h>
+#include <folly/Range.h>
+#include <folly/container/detail/F14Table.h>
+#include <folly/lang/Bits.h>
+#include <folly/lang/Exception.h>
+#include <folly/system/MemoryMapping.h>
+
+#if FOLLY_F14_VECTOR_INTRINSICS_AVAILABLE
+
+namespace folly {
+
+namespace f14 {
+namespace detail {
+
+struct F14MappedMapHeader {
+  static constexpr uint64_t kMagic = 0x3170614d34314631; // "1F14Map1"
+  static constexpr uint32_t kVersion = 1;
+  // Chunks start here, which keeps them vector (and cache line) aligned
+  // whenever the image itself is.
+  static constexpr std::size_t kDataOffset = 64;
+
+  uint64_t magic;
+  uint32_t version;
+  uint32_t chunkSize;
+  uint32_t keySize;
+  uint32_t mappedSize;
+  uint64_t chunkCount;
+  uint64_t size;
+  // Location of one stored item, rehashed at open time to check that the
+  // reader's hash function agrees with the writer's.
+  uint64_t checkChunk;
+  uint32_t checkIndex;
+  uint32_t reserved;
+};
+
+static_assert(
+    sizeof(F14MappedMapHeader) <= F14MappedMapHeader::kDataOffset,
+    "F14MappedMapHeader too big");
+
+} // namespace detail
+} // namespace f14
+
+template <
+    typename Key,
+    typename Mapped,
+    typename Hasher = f14::DefaultHasher<Key>,
+    typename KeyEqual = f14::DefaultKeyEqual<Key>>
+class F14MappedMap {
+  static_assert(
+      std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Mapped>,
+      "F14MappedMap stores keys and values as raw bytes");
+
+ public:
+  using key_type = Key;
+  using mapped_type = Mapped;
+  using value_type = std::pair<Key, Mapped>;
+  using size_type = std::size_t;
+  using hasher = Hasher;
+  using key_equal = KeyEqual;
+
+ private:
+  using Header = f14::detail::F14MappedMapHeader;
+  using Chunk = f14::detail::F14Chunk<value_type>;
+  using HashPair = std::pair<std::size_t, std::size_t>;
+
+ public:
+  // Maps the image stored in the file at path.
+  explicit F14MappedMap(const char* path) : F14MappedMap(MemoryMapping(path)) {}
+
+  explicit F14MappedMap(MemoryMapping mapping) : mapping_(std::move(mapping)) {
+    init(mapping_->range());
+  }
+
+  // Reads an image owned by the caller, which must outlive this object.
+  // The image must be 16-byte aligned.
+  explicit F14MappedMap(ByteRange image) { init(image); }
+
+  F14MappedMap(F14MappedMap&&) = default;
+  F14MappedMap& operator=(F14MappedMap&&) = default;
+
+  // Size in bytes of the image of a table with n entries.
+  static std::size_t imageSize(std::size_t n) {
+    return Header::kDataOffset + chunkCountFor(n) * sizeof(Chunk);
+  }
+
+  // Builds the image of map, which can be any range of unique key/value
+  // pairs with a size(), into out.  out must be imageSize(map.size()) bytes
+  // long and 16-byte aligned.
+  template <typename Map>
+  static void writeImage(Map const& map, MutableByteRange out) {
+    std::size_t n = map.size();
+    if (out.size() != imageSize(n) ||
+        reinterpret_cast<uintptr_t>(out.data()) % alignof(Chunk) != 0) {
+      throw_exception<std::invalid_argument>(
+          "F14MappedMap: output buffer has the wrong size or alignment");
+    }
+    std::memset(out.data(), 0, out.size());
+
+    Header header{};
+    header.magic = Header::kMagic;
+    header.version = Header::kVersion;
+    header.chunkSize = sizeof(Chunk);
+    header.keySize = sizeof(Key);
+    header.mappedSize = sizeof(Mapped);
+    header.chunkCount = chunkCountFor(n);
+    header.size = n;
+
+    auto chunks = reinterpret_cast<Chunk*>(out.data() + Header::kDataOffset);
+    std::size_t const chunkMask = header.chunkCount - 1;
+    bool first = true;
+    for (auto const& kv : map) {
+      auto hp = splitHash(Hasher{}(kv.first));
+      std::size_t index = hp.first;
+      std::size_t step = probeDelta(hp);
+      Chunk* chunk;
+      std::size_t slot;
+      // Same placement as F14Table::insert: take the first empty slot along
+      // the probe sequence, counting an outbound overflow on every full
+      // chunk passed.  The load is below kCapacity so this terminates.
+      while (true) {
+        chunk = chunks + (index & chunkMask);
+        auto firstEmpty = chunk->firstEmpty();
+        if (firstEmpty.hasIndex()) {
+          slot = firstEmpty.index();
+          break;
+        }
+        chunk->incrOutboundOverflowCount();
+        index += step;
+      }
+      chunk->setTag(slot, hp.second);
+      new (chunk->itemAddr(slot)) value_type(kv.first, kv.second);
+      if (first) {
+        header.checkChunk = static_cast<uint64_t>(chunk - chunks);
+        header.checkIndex = static_cast<uint32_t>(slot);
+        first = false;
+      }
+    }
+    std::memcpy(out.data(), &header, sizeof(header));
+  }
+
+  // Writes the image of map to the file at path, replacing its contents.
+  // To swap a table under running readers, write to a temporary path and
+  // rename() it into place.
+  template <typename Map>
+  static void write(Map const& map, const char* path) {
+    auto len = imageSize(map.size());
+    MemoryMapping out(
+        File(path, O_RDWR | O_CREAT | O_TRUNC),
+        0,
+        static_cast<off64_t>(len),
+        MemoryMapping::writable());
+    writeImage(map, out.writableRange());
+  }
+
+  size_type size() const noexcept { return size_; }
+
+  bool empty() const noexcept { return size_ == 0; }
+
+  // Returns the entry for key, or nullptr if it is not present.  The entry
+  // lives in the image and is valid as long as this object is.
+  value_type const* find(key_type const& key) const {
+    auto hp = splitHash(Hasher{}(key));
+#if FOLLY_ARM_FEATURE_NEON_SVE_BRIDGE
+    svbool_t pred = svwhilelt_b8_u32(0, Chunk::kCapacity);
+#endif
+    std::size_t index = hp.first;
+    std::size_t step = probeDelta(hp);
+    auto needleV = loadNeedleV(hp.second);
+    for (std::size_t tries = chunkMask_ + 1; tries > 0; --tries) {
+      Chunk const* chunk = chunks_ + (index & chunkMask_);
+      if (sizeof(Chunk) > 64) {
+        f14::detail::prefetchAddr(chunk->itemAddr(8));
+      }
+#if FOLLY_ARM_FEATURE_NEON_SVE_BRIDGE
+      auto hits = chunk->tagMatchIter(needleV, pred);
+#else
+      auto hits = chunk->tagMatchIter(needleV);
+#endif
+      while (hits.hasNext()) {
+        auto i = hits.next();
+        auto& item = chunk->citem(i);
+        if (FOLLY_LIKELY(KeyEqual{}(key, item.first))) {
+          return &item;
+        }
+      }
+      if (FOLLY_LIKELY(chunk->outboundOverflowCount() == 0)) {
+        break;
+      }
+      index += step;
+    }
+    return nullptr;
+  }
+
+  bool contains(key_type const& key) const { return find(key) != nullptr; }
+
+  size_type count(key_type const& key) const { return contains(key) ? 1 : 0; }
+
+  mapped_type const& at(key_type const& key) const {
+    auto item = find(key);
+    if (!item) {
+      throw_exception<std::out_of_range>("at() did not find key");
+    }
+    return item->second;
+  }
+
+ private:
+  static std::size_t chunkCountFor(std::size_t n) {
+    return nextPowTwo(
+        std::max<std::size_t>(
+            1, (n + Chunk::kDesiredCapacity - 1) / Chunk::kDesiredCapacity));
+  }
+
+  static HashPair splitHash(std::size_t hash) {
+    return f14::detail::splitHashImpl<Hasher, Key>(hash);
+  }
+
+  static std::size_t probeDelta(HashPair hp) { return 2 * hp.second + 1; }
+
+  static auto loadNeedleV(std::size_t needle) {
+#if FOLLY_NEON
+    return vdupq_n_u8(static_cast<uint8_t>(needle));
+#elif FOLLY_SSE >= 2
+    return _mm_set1_epi8(static_cast<uint8_t>(needle));
+#else
+    return needle;
+#endif
+  }
+
+  [[noreturn]] static void throwBadImage(char const* what) {
+    throw_exception<std::runtime_error>(std::string("F14MappedMap: ") + what);
+  }
+
+  void init(ByteRange image) {
+    Header header;
+    if (image.size() < sizeof(header)) {
+      throwBadImage("image too small");
+    }
+    std::memcpy(&header, image.data(), sizeof(header));
+    if (header.magic != Header::kMagic) {
+      throwBadImage("bad magic (not an image, or different byte order)");
+    }
+    if (header.version != Header::kVersion) {
+      throwBadImage("unsupported version");
+    }
+    if (header.chunkSize != sizeof(Chunk) || header.keySize != sizeof(Key) ||
+        header.mappedSize != sizeof(Mapped)) {
+      throwBadImage("written with different key, value or chunk types");
+    }
+    if (header.chunkCount != chunkCountFor(header.size) ||
+        image.size() != imageSize(header.size)) {
+      throwBadImage("corrupt header or truncated image");
+    }
+    if (reinterpret_cast<uintptr_t>(image.data()) % alignof(Chunk) != 0) {
+      throwBadImage("image is misaligned");
+    }
+    chunks_ = reinterpret_cast<Chunk const*>(image.data() + Header::kDataOffset);
+    chunkMask_ = header.chunkCount - 1;
+    size_ = header.size;
+
+    if (size_ != 0) {
+      if (header.checkChunk >= header.chunkCount ||
+          header.checkIndex >= Chunk::kCapacity) {
+        throwBadImage("corrupt header");
+      }
+      auto chunk = chunks_ + header.checkChunk;
+      if (!chunk->occupied(header.checkIndex) ||
+          find(chunk->citem(header.checkIndex).first) !=
+              &chunk->citem(header.checkIndex)) {
+        throwBadImage("hash function differs from the one used to write");
+      }
+    }
+  }
+
+  std::optional<MemoryMapping> mapping_;
+  Chunk const* chunks_{nullptr};
+  std::size_t chunkMask_{0};
+  std::size_t size_{0};
+};
+
+} // namespace folly
+
+#endif // FOLLY_F14_VECTOR_INTRINSICS_AVAILABLE
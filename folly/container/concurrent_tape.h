@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Likely.h>
+#include <folly/container/tape.h>
+#include <folly/lang/Align.h>
+#include <folly/synchronization/AtomicRef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+namespace folly {
+
+/* # concurrent_tape
+ *
+ * A multi-producer, append-only version of `string_tape` over a buffer of
+ * fixed capacity, for logs of variable-length records (trace spans, access
+ * log lines) that would otherwise cost one heap allocation per record.
+ *
+ * Each record is a 4-byte header followed by its bytes, padded to 4 bytes:
+ *
+ * [hdr|first record..|hdr|second|hdr|third record.....|0000 unreserved ...]
+ *
+ * A producer reserves space with one atomic `fetch_add` on the tail, copies
+ * its bytes in, and then publishes the record by storing its header with
+ * release ordering. Producers never wait for each other.
+ *
+ * Readers walk the buffer from the front, loading each header with acquire
+ * ordering, and stop at the first record that is not published yet. So a
+ * reader sees a prefix of the records in reservation order, and every
+ * record it sees is complete. A record whose producer is still copying
+ * hides the records reserved after it until it is published; producers are
+ * expected to publish promptly.
+ *
+ * When a record does not fit in the remaining capacity, `push_back` returns
+ * false and the tape stays full until `clear()`. There is no growth, since
+ * moving the buffer would invalidate concurrent readers and producers.
+ *
+ * Thread safety: `push_back`, `emplace_back`, and iteration can be used from
+ * any number of threads concurrently. `clear()`, moves, and destruction need
+ * exclusive access.
+ */
+class concurrent_tape {
+  // Header layout: (size << 2) | kDropped | kPublished. Unreserved and
+  // unpublished space reads as zero. A dropped record is one whose `fill`
+  // threw; readers skip it.
+  using header_type = std::uint32_t;
+  static constexpr header_type kPublished = 1;
+  static constexpr header_type kDropped = 2;
+  static constexpr int kFlagBits = 2;
+  static constexpr std::size_t kHeaderSize = sizeof(header_type);
+
+ public:
+  using value_type = std::string_view;
+  using reference = std::string_view;
+  using const_reference = std::string_view;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+
+  // Longest record that can be stored.
+  static constexpr size_type max_record_size =
+      std::numeric_limits<header_type>::max() >> kFlagBits;
+
+  class const_iterator;
+  using iterator = const_iterator;
+
+  concurrent_tape() noexcept = default;
+
+  // capacity is in bytes and includes the per-record overhead of 4 bytes of
+  // header plus padding to a multiple of 4.
+  explicit concurrent_tape(size_type capacity)
+      : words_(new header_type[(capacity + kHeaderSize - 1) / kHeaderSize]()),
+        capacity_(capacity / kHeaderSize * kHeaderSize) {}
+
+  concurrent_tape(const concurrent_tape&) = delete;
+  concurrent_tape& operator=(const concurrent_tape&) = delete;
+
+  concurrent_tape(concurrent_tape&& other) noexcept
+      : words_(std::move(other.words_)),
+        capacity_(std::exchange(other.capacity_, 0)),
+        tail_(other.tail_.exchange(0, std::memory_order_relaxed)) {}
+
+  concurrent_tape& operator=(concurrent_tape&& other) noexcept {
+    words_ = std::move(other.words_);
+    capacity_ = std::exchange(other.capacity_, 0);
+    tail_.store(
+        other.tail_.exchange(0, std::memory_order_relaxed),
+        std::memory_order_relaxed);
+    return *this;
+  }
+
+  // Bytes a record of `size` bytes takes up, including its header.
+  static constexpr size_type record_footprint(size_type size) noexcept {
+    return kHeaderSize + (size + kHeaderSize - 1) / kHeaderSize * kHeaderSize;
+  }
+
+  [[nodiscard]] size_type capacity() const noexcept { return capacity_; }
+
+  // Bytes handed out to producers so far, including headers and padding.
+  [[nodiscard]] size_type reserved_bytes() const noexcept {
+    return std::min(tail_.load(std::memory_order_relaxed), capacity_);
+  }
+
+  // append ------
+
+  // Appends a copy of `record`. Returns false, and stores nothing, if the
+  // tape does not have room for it.
+  bool push_back(std::string_view record) noexcept {
+    return emplace_back(record.size(), [&](char* out) {
+      std::memcpy(out, record.data(), record.size());
+    });
+  }
+
+  // Reserves `size` bytes, calls `fill(char* out)` to write exactly `size`
+  // bytes in place, and publishes the record. Returns false without calling
+  // `fill` if the tape does not have room for it. `fill` should not block,
+  // since the record hides later ones from readers until it returns. If
+  // `fill` throws, the space stays used by a record that readers skip, and
+  // the exception propagates.
+  template <typename Fill>
+  bool emplace_back(size_type size, Fill&& fill) {
+    if (FOLLY_UNLIKELY(size > max_record_size)) {
+      return false;
+    }
+    auto footprint = record_footprint(size);
+    auto pos = tail_.fetch_add(footprint, std::memory_order_relaxed);
+    if (FOLLY_UNLIKELY(pos > capacity_ || capacity_ - pos < footprint)) {
+      return false;
+    }
+    try {
+      fill(bytes() + pos + kHeaderSize);
+    } catch (...) {
+      // Still publish, or the record would hide every later one.
+      header(pos).store(
+          static_cast<header_type>(size << kFlagBits) | kDropped | kPublished,
+          std::memory_order_release);
+      throw;
+    }
+    header(pos).store(
+        static_cast<header_type>(size << kFlagBits) | kPublished,
+        std::memory_order_release);
+    return true;
+  }
+
+  // iteration ------
+
+  // Iterators see the records published before they reach them. An
+  // iterator becomes end() at the first unpublished record and stays there.
+  [[nodiscard]] const_iterator begin() const noexcept;
+  [[nodiscard]] const_iterator cbegin() const noexcept;
+  [[nodiscard]] const_iterator end() const noexcept;
+  [[nodiscard]] const_iterator cend() const noexcept;
+
+  [[nodiscard]] bool empty() const noexcept;
+
+  // Copies the currently visible records into a string_tape.
+  [[nodiscard]] string_tape to_tape() const;
+
+  // Drops all records. Requires exclusive access.
+  void clear() noexcept {
+    auto used = reserved_bytes();
+    std::memset(words_.get(), 0, used);
+    tail_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  char* bytes() const noexcept {
+    return reinterpret_cast<char*>(words_.get());
+  }
+
+  atomic_ref<header_type> header(size_type pos) const noexcept {
+    return atomic_ref<header_type>{words_[pos / kHeaderSize]};
+  }
+
+  // Returns the header of the record at `pos`, which is 0 if there is none
+  // or it is not published yet.
+  header_type published_header(size_type pos) const noexcept {
+    if (pos + kHeaderSize > capacity_) {
+      return 0;
+    }
+    return header(pos).load(std::memory_order_acquire);
+  }
+
+  std::unique_ptr<header_type[]> words_;
+  size_type capacity_{0};
+  alignas(hardware_destructive_interference_size) std::atomic<size_type> tail_{
+      0};
+};
+
+class concurrent_tape::const_iterator {
+ public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = std::string_view;
+  using reference = std::string_view;
+  using pointer = void;
+  using difference_type = std::ptrdiff_t;
+
+  const_iterator() noexcept = default;
+
+  reference operator*() const noexcept {
+    return {tape_->bytes() + pos_ + kHeaderSize, size_};
+  }
+
+  const_iterator& operator++() noexcept {
+    seek(pos_ + record_footprint(size_));
+    return *this;
+  }
+
+  const_iterator operator++(int) noexcept {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  friend bool operator==(
+      const const_iterator& x, const const_iterator& y) noexcept {
+    return x.pos_ == y.pos_;
+  }
+  friend bool operator!=(
+      const const_iterator& x, const const_iterator& y) noexcept {
+    return !(x == y);
+  }
+
+ private:
+  friend class concurrent_tape;
+
+  static constexpr size_type kEnd = static_cast<size_type>(-1);
+
+  explicit const_iterator(const concurrent_tape* tape) noexcept
+      : tape_(tape) {}
+
+  void seek(size_type pos) noexcept {
+    while (true) {
+      auto h = tape_->published_header(pos);
+      if (!(h & kPublished)) {
+        pos_ = kEnd;
+        size_ = 0;
+        return;
+      }
+      auto size = static_cast<size_type>(h >> kFlagBits);
+      if (!(h & kDropped)) {
+        pos_ = pos;
+        size_ = size;
+        return;
+      }
+      pos += record_footprint(size);
+    }
+  }
+
+  const concurrent_tape* tape_{nullptr};
+  size_type pos_{kEnd};
+  size_type size_{0};
+};
+
+inline concurrent_tape::const_iterator concurrent_tape::begin() const noexcept {
+  const_iterator it{this};
+  it.seek(0);
+  return it;
+}
+
+inline concurrent_tape::const_iterator concurrent_tape::end() const noexcept {
+  return const_iterator{this};
+}
+
+inline concurrent_tape::const_iterator concurrent_tape::cbegin()
+    const noexcept {
+  return begin();
+}
+
+inline concurrent_tape::const_iterator concurrent_tape::cend() const noexcept {
+  return end();
+}
+
+inline bool concurrent_tape::empty() const noexcept {
+  return begin() == end();
+}
+
+inline string_tape concurrent_tape::to_tape() const {
+  string_tape res;
+  for (auto record : *this) {
+    res.push_back(record);
+  }
+  return res;
+}
+
+} // namespace folly
@@ -1793,6 +1793,54 @@ class F14Table : public Policy {
     return findImpl(static_cast<HashPair>(token), key, Prefetch::DISABLED);
   }
 
+  // Number of lookups findBatch() keeps in flight.  Large enough to cover
+  // main memory latency with a few independent misses, small enough that
+  // the prefetched lines are still resident when they are probed.
+  static constexpr std::size_t kFindBatchWindow = 16;
+
+  // findBatch() is the pipelined equivalent of calling find() on each key
+  // in [first, last).  It computes the hash and prefetches the first chunk
+  // of the probe sequence kFindBatchWindow keys ahead of the key whose tags
+  // are being matched, so the cache misses of independent lookups overlap.
+  // func(key, iter) is invoked for each key, in order.  KeyIter must be a
+  // forward iterator since each key is visited twice.
+  template <typename KeyIter, typename F>
+  void findBatch(KeyIter first, KeyIter last, F&& func) const {
+    if (size() == 0) {
+      for (; first != last; ++first) {
+        func(*first, ItemIter{});
+      }
+      return;
+    }
+    HashPair hps[kFindBatchWindow];
+    KeyIter ahead = first;
+    std::size_t inFlight = 0;
+    for (; inFlight < kFindBatchWindow && ahead != last; ++inFlight, ++ahead) {
+      hps[inFlight] = computeHash(*ahead);
+      prefetchFirstChunk(hps[inFlight]);
+    }
+    for (std::size_t slot = 0; first != last; ++first) {
+      HashPair hp = hps[slot];
+      if (ahead != last) {
+        hps[slot] = computeHash(*ahead);
+        prefetchFirstChunk(hps[slot]);
+        ++ahead;
+      }
+      func(*first, findImpl(hp, *first, Prefetch::DISABLED));
+      slot = slot + 1 == inFlight ? 0 : slot + 1;
+    }
+  }
+
+ private:
+  FOLLY_ALWAYS_INLINE void prefetchFirstChunk(HashPair hp) const {
+    ChunkPtr chunk = chunks_ + moduloByChunkCount(hp.first);
+    prefetchAddr(chunk);
+    if constexpr (sizeof(Chunk) > 64) {
+      prefetchAddr(chunk->itemAddr(8));
+    }
+  }
+
+ public:
   // Searches for a key using a key predicate that is a refinement
   // of key equality.  func(k) should return true only if k is equal
   // to key according to key_eq(), but is allowed to apply additional
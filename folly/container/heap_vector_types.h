@@ -363,6 +363,38 @@ void heapify(Container& cont) {
   }
 }
 
+// Inplace conversion of a heap layout vector back to sorted order, the
+// inverse of heapify. Each element moves from its offset to its index along
+// the same cycles, so the conversion is linear rather than a full sort.
+template <class Container>
+void unheapify(Container& cont) {
+  using size_type = typename Container::size_type;
+  size_type size = cont.size();
+  if (size < 2) {
+    return;
+  }
+  std::vector<size_type> offsets;
+  offsets.resize(size);
+  getOffsets(size, offsets);
+
+  for (size_type index = 0; index < size; index++) {
+    // already moved, or in place
+    if (offsets[index] == size || offsets[index] == index) {
+      continue;
+    }
+    typename Container::value_type tmp = std::move(cont[index]);
+    size_type cur = index;
+    while (offsets[cur] != index) {
+      size_type next = offsets[cur];
+      cont[cur] = std::move(cont[next]);
+      offsets[cur] = size;
+      cur = next;
+    }
+    cont[cur] = std::move(tmp);
+    offsets[cur] = size;
+  }
+}
+
 // Below helper functions to implement inplace insertion/deletion.
 
 // Returns the sequence of offsets that need to be moved. This sequence
@@ -1128,7 +1160,7 @@ class heap_vector_container : growth_policy_wrapper<GrowthPolicy> {
       insert(*first);
       return;
     }
-    std::sort(m_.cont_.begin(), m_.cont_.end(), value_comp());
+    heap_vector_detail::unheapify(m_.cont_);
     heap_vector_detail::bulk_insert(*this, m_.cont_, first, last);
   }
 
@@ -1202,7 +1234,7 @@ class heap_vector_container : growth_policy_wrapper<GrowthPolicy> {
       return erase(first);
     }
     auto it = m_.cont_.begin() + (first - begin());
-    std::sort(m_.cont_.begin(), m_.cont_.end(), value_comp());
+    heap_vector_detail::unheapify(m_.cont_);
     it = m_.cont_.erase(it, it + dist);
     heap_vector_detail::heapify(m_.cont_);
     return begin() + (it - m_.cont_.begin());
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * static_btree_set is a read-mostly set of integers laid out as a static
+ * B+ tree (an "S+ tree") for fast lower_bound on large key sets.
+ *
+ * sorted_vector_set performs a binary search, touching about log2(n) cache
+ * lines per lookup. heap_vector_set's Eytzinger layout makes the descent
+ * branchless and prefetch-friendly but still visits log2(n) nodes. Here each
+ * node holds a full cache line of keys (16 32-bit or 8 64-bit keys by
+ * default) and is searched with one or two SIMD compares, so a lookup
+ * touches about log_{B+1}(n) lines: 7 instead of 27 for 100M 32-bit keys.
+ *
+ * Layout: the sorted keys themselves form the leaf layer, padded to a whole
+ * number of nodes, so iteration is a plain pointer walk and an iterator's
+ * distance from begin() is the key's rank. Above it, layer h node m has
+ * B + 1 children m * (B + 1) + i in layer h - 1, and its key i is the
+ * smallest key under child i + 1. Missing keys are padded with the
+ * maximum value of T, which never compares less than a search key, so
+ * padding is never descended into.
+ *
+ * The set is immutable except through bulk insert(first, last), which
+ * merges the new keys into the leaf layer and rebuilds the inner layers in
+ * linear time.
+ *
+ * Only integral key types are supported; 32- and 64-bit keys use AVX2 or
+ * AVX-512 compares when the build targets them, and a loop the compiler
+ * can vectorize otherwise.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include <folly/Memory.h>
+#include <folly/Portability.h>
+#include <folly/container/sorted_vector_types.h>
+#include <folly/lang/Bits.h>
+
+#if FOLLY_X64
+#include <immintrin.h>
+#endif
+
+namespace folly {
+
+namespace detail {
+namespace static_btree_detail {
+
+// Returns the number of keys in node[0, B) that are less than x.
+template <typename T, std::size_t B>
+FOLLY_ALWAYS_INLINE std::size_t rank(const T* node, T x) {
+  constexpr bool kSimd = (sizeof(T) == 4 || sizeof(T) == 8) &&
+      (B * sizeof(T)) % 32 == 0;
+#if FOLLY_X64 && defined(__AVX512F__)
+  if constexpr (kSimd && (B * sizeof(T)) % 64 == 0) {
+    std::size_t r = 0;
+    for (std::size_t i = 0; i < B * sizeof(T); i += 64) {
+      auto keys = _mm512_load_si512(
+          reinterpret_cast<const char*>(node) + i);
+      if constexpr (sizeof(T) == 4) {
+        auto xv = _mm512_set1_epi32(static_cast<int32_t>(x));
+        r += popcount(
+            std::is_signed_v<T> ? _mm512_cmplt_epi32_mask(keys, xv)
+                                : _mm512_cmplt_epu32_mask(keys, xv));
+      } else {
+        auto xv = _mm512_set1_epi64(static_cast<int64_t>(x));
+        r += popcount(
+            std::is_signed_v<T> ? _mm512_cmplt_epi64_mask(keys, xv)
+                                : _mm512_cmplt_epu64_mask(keys, xv));
+      }
+    }
+    return r;
+  }
+#endif
+#if FOLLY_X64 && defined(__AVX2__)
+  if constexpr (kSimd) {
+    // AVX2 only has signed compares; flipping the sign bit of both sides
+    // turns them into unsigned ones.
+    std::size_t r = 0;
+    for (std::size_t i = 0; i < B * sizeof(T); i += 32) {
+      auto keys = _mm256_load_si256(reinterpret_cast<const __m256i*>(
+          reinterpret_cast<const char*>(node) + i));
+      if constexpr (sizeof(T) == 4) {
+        auto xv = _mm256_set1_epi32(static_cast<int32_t>(x));
+        if constexpr (!std::is_signed_v<T>) {
+          auto flip = _mm256_set1_epi32(std::numeric_limits<int32_t>::min());
+          keys = _mm256_xor_si256(keys, flip);
+          xv = _mm256_xor_si256(xv, flip);
+        }
+        auto lt = _mm256_cmpgt_epi32(xv, keys);
+        r += popcount(
+            static_cast<uint32_t>(
+                _mm256_movemask_ps(_mm256_castsi256_ps(lt))));
+      } else {
+        auto xv = _mm256_set1_epi64x(static_cast<int64_t>(x));
+        if constexpr (!std::is_signed_v<T>) {
+          auto flip = _mm256_set1_epi64x(std::numeric_limits<int64_t>::min());
+          keys = _mm256_xor_si256(keys, flip);
+          xv = _mm256_xor_si256(xv, flip);
+        }
+        auto lt = _mm256_cmpgt_epi64(xv, keys);
+        r += popcount(
+            static_cast<uint32_t>(
+                _mm256_movemask_pd(_mm256_castsi256_pd(lt))));
+      }
+    }
+    return r;
+  }
+#endif
+  (void)kSimd;
+  std::size_t r = 0;
+  for (std::size_t i = 0; i < B; ++i) {
+    r += node[i] < x;
+  }
+  return r;
+}
+
+} // namespace static_btree_detail
+} // namespace detail
+
+/**
+ * A static_btree_set is a sorted set of integers stored as an S+ tree.
+ *
+ * @tparam T    Integral key type
+ * @tparam B    Keys per node; defaults to one cache line's worth
+ */
+template <typename T, std::size_t B = 64 / sizeof(T)>
+class static_btree_set {
+  static_assert(std::is_integral_v<T>, "static_btree_set needs integer keys");
+  static_assert(B >= 2, "static_btree_set nodes need at least two keys");
+
+  static constexpr std::size_t kNodeBytes = B * sizeof(T);
+  // Nodes are aligned to the widest vector that evenly covers them.
+  static constexpr std::size_t kAlign = kNodeBytes % 64 == 0 ? 64
+      : kNodeBytes % 32 == 0                                 ? 32
+                                                             : sizeof(void*);
+  static constexpr T kPad = std::numeric_limits<T>::max();
+
+  using Storage = std::vector<T, AlignedSysAllocator<T, FixedAlign<kAlign>>>;
+
+ public:
+  using key_type = T;
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using key_compare = std::less<T>;
+  using value_compare = std::less<T>;
+  using reference = const T&;
+  using const_reference = const T&;
+  using const_iterator = const T*;
+  using iterator = const_iterator;
+
+  static_btree_set() = default;
+
+  template <class InputIterator>
+  static_btree_set(InputIterator first, InputIterator last) {
+    insert(first, last);
+  }
+
+  // Range must be sorted and free of duplicates; checked in debug builds.
+  template <class InputIterator>
+  static_btree_set(sorted_unique_t, InputIterator first, InputIterator last) {
+    std::vector<T> keys(first, last);
+    assert(detail::is_sorted_unique(keys.begin(), keys.end(), key_compare{}));
+    build(keys);
+  }
+
+  static_btree_set(std::initializer_list<T> list)
+      : static_btree_set(list.begin(), list.end()) {}
+
+  size_type size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  const_iterator begin() const { return data_.data(); }
+
+  const_iterator end() const { return data_.data() + size_; }
+
+  const_iterator cbegin() const { return begin(); }
+
+  const_iterator cend() const { return end(); }
+
+  /// First element not less than x, or end().
+  const_iterator lower_bound(T x) const {
+    if (empty()) {
+      return end();
+    }
+    const T* data = data_.data();
+    std::size_t k = 0;
+    for (std::size_t h = offsets_.size() - 1; h > 0; --h) {
+      auto i =
+          detail::static_btree_detail::rank<T, B>(data + offsets_[h] + k, x);
+      k = k * (B + 1) + i * B;
+    }
+    auto i = detail::static_btree_detail::rank<T, B>(data + k, x);
+    return begin() + std::min(k + i, size_);
+  }
+
+  /// First element greater than x, or end().
+  const_iterator upper_bound(T x) const {
+    if (x == kPad) {
+      return end();
+    }
+    return lower_bound(static_cast<T>(x + 1));
+  }
+
+  const_iterator find(T x) const {
+    auto it = lower_bound(x);
+    return it != end() && *it == x ? it : end();
+  }
+
+  bool contains(T x) const { return find(x) != end(); }
+
+  size_type count(T x) const { return contains(x) ? 1 : 0; }
+
+  /// Merges [first, last) into the set and rebuilds the tree. Costs one
+  /// sort of the new keys plus linear work in the size of the result.
+  template <class InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    std::vector<T> keys(begin(), end());
+    auto middle = keys.size();
+    keys.insert(keys.end(), first, last);
+    if (keys.size() == middle) {
+      return;
+    }
+    std::sort(keys.begin() + middle, keys.end());
+    std::inplace_merge(keys.begin(), keys.begin() + middle, keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    build(keys);
+  }
+
+  void insert(std::initializer_list<T> list) {
+    insert(list.begin(), list.end());
+  }
+
+  void clear() {
+    data_.clear();
+    offsets_.clear();
+    size_ = 0;
+  }
+
+  void swap(static_btree_set& o) noexcept {
+    data_.swap(o.data_);
+    offsets_.swap(o.offsets_);
+    std::swap(size_, o.size_);
+  }
+
+  friend bool operator==(
+      const static_btree_set& a, const static_btree_set& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end());
+  }
+
+  friend bool operator!=(
+      const static_btree_set& a, const static_btree_set& b) {
+    return !(a == b);
+  }
+
+ private:
+  static std::size_t blocks(std::size_t n) { return (n + B - 1) / B; }
+
+  // Number of keys in the layer above a layer of n keys.
+  static std::size_t keysAbove(std::size_t n) {
+    return (blocks(n) + B) / (B + 1) * B;
+  }
+
+  void build(const std::vector<T>& keys) {
+    clear();
+    size_ = keys.size();
+    if (size_ == 0) {
+      return;
+    }
+    // offsets_[h] is where layer h starts; the top layer is a single node.
+    std::size_t total = 0;
+    for (std::size_t n = size_;; n = keysAbove(n)) {
+      offsets_.push_back(total);
+      total += blocks(n) * B;
+      if (n <= B) {
+        break;
+      }
+    }
+    data_.assign(total, kPad);
+    std::copy(keys.begin(), keys.end(), data_.begin());
+    for (std::size_t h = 1; h < offsets_.size(); ++h) {
+      auto layerEnd = h + 1 < offsets_.size() ? offsets_[h + 1] : total;
+      for (std::size_t i = 0; i < layerEnd - offsets_[h]; ++i) {
+        // Key j of node m is the first leaf key under child j + 1.
+        std::size_t m = i / B;
+        std::size_t j = i % B;
+        std::size_t leaf = m * (B + 1) + j + 1;
+        for (std::size_t l = 1; l < h; ++l) {
+          leaf *= B + 1;
+        }
+        data_[offsets_[h] + i] = leaf * B < size_ ? data_[leaf * B] : kPad;
+      }
+    }
+  }
+
+  Storage data_;
+  std::vector<std::size_t> offsets_;
+  std::size_t size_{0};
+};
+
+template <typename T, std::size_t B>
+void swap(static_btree_set<T, B>& a, static_btree_set<T, B>& b) noexcept {
+  a.swap(b);
+}
+
+} // namespace folly
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/container/F14Map.h>
+#include <folly/hash/Hash.h>
+#include <folly/init/Init.h>
+#include <folly/portability/GFlags.h>
+
+// The default table is a few hundred MB, well beyond the size of any LLC, so
+// that almost every probe is a cache miss.
+DEFINE_uint64(entries, uint64_t(1) << 24, "number of entries in the map");
+DEFINE_uint64(batch, 1024, "number of keys per findBatch() call");
+
+using namespace folly;
+
+namespace {
+
+struct Fixture {
+  Fixture() {
+    map.reserve(FLAGS_entries);
+    for (uint64_t i = 0; i < FLAGS_entries; ++i) {
+      map.emplace(hash::twang_mix64(i), i);
+    }
+    // Half hits and half misses, in random order.
+    std::mt19937_64 rng(0);
+    std::uniform_int_distribution<uint64_t> dist(0, 2 * FLAGS_entries - 1);
+    keys.resize(FLAGS_batch * 64);
+    for (auto& k : keys) {
+      k = hash::twang_mix64(dist(rng));
+    }
+  }
+
+  F14ValueMap<uint64_t, uint64_t> map;
+  std::vector<uint64_t> keys;
+};
+
+Fixture& fixture() {
+  static Fixture f;
+  return f;
+}
+
+} // namespace
+
+BENCHMARK(F14ValueMap_find_loop, iters) {
+  const uint64_t* keys;
+  std::size_t nkeys;
+  BENCHMARK_SUSPEND {
+    keys = fixture().keys.data();
+    nkeys = fixture().keys.size();
+  }
+  auto const& map = fixture().map;
+  std::size_t pos = 0;
+  uint64_t sum = 0;
+  for (std::size_t i = 0; i < iters; ++i) {
+    for (std::size_t j = 0; j < FLAGS_batch; ++j) {
+      auto it = map.find(keys[pos + j]);
+      sum += it == map.end() ? 0 : it->second;
+    }
+    pos = pos + 2 * FLAGS_batch > nkeys ? 0 : pos + FLAGS_batch;
+  }
+  doNotOptimizeAway(sum);
+}
+
+BENCHMARK_RELATIVE(F14ValueMap_findBatch, iters) {
+  const uint64_t* keys;
+  std::size_t nkeys;
+  std::vector<F14ValueMap<uint64_t, uint64_t>::const_iterator> found;
+  BENCHMARK_SUSPEND {
+    keys = fixture().keys.data();
+    nkeys = fixture().keys.size();
+    found.resize(FLAGS_batch);
+  }
+  auto const& map = fixture().map;
+  std::size_t pos = 0;
+  uint64_t sum = 0;
+  for (std::size_t i = 0; i < iters; ++i) {
+    map.findBatch(keys + pos, keys + pos + FLAGS_batch, found.begin());
+    for (auto& it : found) {
+      sum += it == map.end() ? 0 : it->second;
+    }
+    pos = pos + 2 * FLAGS_batch > nkeys ? 0 : pos + FLAGS_batch;
+  }
+  doNotOptimizeAway(sum);
+}
+
+int main(int argc, char** argv) {
+  folly::Init init(&argc, &argv);
+  fixture();
+  folly::runBenchmarks();
+  return 0;
+}
@@ -925,6 +925,82 @@ TEST(F14FastMap, prehash) {
   runPrehash<F14FastMap<std::string, std::string>>();
 }
 
+template <typename T>
+void runFindBatch() {
+  T h;
+  std::vector<uint64_t> keys;
+  for (uint64_t i = 0; i < 100; ++i) {
+    keys.push_back(i * 7);
+  }
+  std::vector<typename T::const_iterator> found;
+
+  // empty map
+  auto const& ch = h;
+  ch.findBatch(keys.begin(), keys.end(), std::back_inserter(found));
+  ASSERT_EQ(keys.size(), found.size());
+  for (auto& it : found) {
+    EXPECT_TRUE(it == h.end());
+  }
+
+  for (uint64_t i = 0; i < 1000; i += 2) {
+    h.emplace(i, i + 1);
+  }
+
+  // Fewer keys than the pipeline window, then many more.
+  for (std::size_t n : {std::size_t(0), std::size_t(3), keys.size()}) {
+    found.clear();
+    ch.findBatch(keys.begin(), keys.begin() + n, std::back_inserter(found));
+    ASSERT_EQ(n, found.size());
+    for (std::size_t i = 0; i < n; ++i) {
+      EXPECT_TRUE(found[i] == h.find(keys[i])) << keys[i];
+      if (keys[i] % 2 == 0) {
+        ASSERT_TRUE(found[i] != h.end());
+        EXPECT_EQ(keys[i] + 1, found[i]->second);
+      }
+    }
+  }
+
+  std::vector<typename T::iterator> mutableFound(keys.size());
+  auto end = h.findBatch(keys.begin(), keys.end(), mutableFound.begin());
+  EXPECT_TRUE(end == mutableFound.end());
+  for (auto& it : mutableFound) {
+    if (it != h.end()) {
+      ++it->second;
+    }
+  }
+  EXPECT_EQ(2, h.at(0));
+  EXPECT_EQ(16, h.at(14));
+}
+
+TEST(F14ValueMap, findBatch) {
+  runFindBatch<F14ValueMap<uint64_t, uint64_t>>();
+}
+
+TEST(F14NodeMap, findBatch) {
+  runFindBatch<F14NodeMap<uint64_t, uint64_t>>();
+}
+
+TEST(F14VectorMap, findBatch) {
+  runFindBatch<F14VectorMap<uint64_t, uint64_t>>();
+}
+
+TEST(F14FastMap, findBatch) {
+  runFindBatch<F14FastMap<uint64_t, uint64_t>>();
+}
+
+TEST(F14ValueMap, findBatchHeterogeneous) {
+  F14ValueMap<std::string, int> h;
+  h.emplace("abc", 1);
+  h.emplace("def", 2);
+  std::vector<StringPiece> keys = {"def"_sp, "xyz"_sp, "abc"_sp};
+  std::vector<F14ValueMap<std::string, int>::iterator> found;
+  h.findBatch(keys.begin(), keys.end(), std::back_inserter(found));
+  ASSERT_EQ(3, found.size());
+  EXPECT_EQ(2, found[0]->second);
+  EXPECT_TRUE(found[1] == h.end());
+  EXPECT_EQ(1, found[2]->second);
+}
+
 TEST(F14ValueMap, random) {
   runRandom<F14ValueMap<
       uint64_t,
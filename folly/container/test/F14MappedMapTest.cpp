@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/F14MappedMap.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <folly/container/F14Map.h>
+#include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
+
+#if FOLLY_F14_VECTOR_INTRINSICS_AVAILABLE
+
+using namespace folly;
+
+namespace {
+
+struct Payload {
+  uint64_t a;
+  uint32_t b;
+  char c[4];
+};
+
+using Table = F14MappedMap<uint64_t, Payload>;
+
+F14ValueMap<uint64_t, Payload> makeSource(uint64_t n) {
+  F14ValueMap<uint64_t, Payload> m;
+  for (uint64_t i = 0; i < n; ++i) {
+    // Spread the keys so that some of them collide in the low bits.
+    m[i * 0x10001] = Payload{i, static_cast<uint32_t>(i * 3), {'a', 'b'}};
+  }
+  return m;
+}
+
+void checkMatches(Table const& t, F14ValueMap<uint64_t, Payload> const& m) {
+  EXPECT_EQ(m.size(), t.size());
+  EXPECT_EQ(m.empty(), t.empty());
+  for (auto const& kv : m) {
+    auto found = t.find(kv.first);
+    ASSERT_NE(nullptr, found);
+    EXPECT_EQ(kv.first, found->first);
+    EXPECT_EQ(kv.second.a, found->second.a);
+    EXPECT_EQ(kv.second.b, found->second.b);
+    EXPECT_EQ('a', found->second.c[0]);
+    EXPECT_TRUE(t.contains(kv.first));
+    EXPECT_EQ(1, t.count(kv.first));
+    // Keys that aren't multiples of 0x10001 are absent.
+    EXPECT_EQ(nullptr, t.find(kv.first + 1));
+  }
+}
+
+// std::vector<unsigned char> doesn't guarantee the 16-byte alignment that
+// images need.
+struct alignas(16) Block {
+  unsigned char bytes[16];
+};
+
+MutableByteRange alignedImage(std::vector<Block>& storage, std::size_t len) {
+  storage.resize(len / sizeof(Block) + 1);
+  return MutableByteRange(
+      reinterpret_cast<unsigned char*>(storage.data()), len);
+}
+
+} // namespace
+
+TEST(F14MappedMap, roundTripFile) {
+  for (uint64_t n : {0, 1, 11, 12, 13, 1000, 100000}) {
+    auto m = makeSource(n);
+    test::TemporaryFile file;
+    Table::write(m, file.path().c_str());
+    Table t(file.path().c_str());
+    checkMatches(t, m);
+    if (n == 0) {
+      EXPECT_EQ(nullptr, t.find(0));
+    }
+  }
+}
+
+TEST(F14MappedMap, at) {
+  auto m = makeSource(100);
+  test::TemporaryFile file;
+  Table::write(m, file.path().c_str());
+  Table t(MemoryMapping(file.path().c_str()));
+  EXPECT_EQ(7, t.at(7 * 0x10001).a);
+  EXPECT_THROW(t.at(1), std::out_of_range);
+}
+
+TEST(F14MappedMap, moveKeepsMapping) {
+  auto m = makeSource(1000);
+  test::TemporaryFile file;
+  Table::write(m, file.path().c_str());
+  Table t1(file.path().c_str());
+  Table t2(std::move(t1));
+  checkMatches(t2, m);
+}
+
+TEST(F14MappedMap, inMemoryImage) {
+  auto m = makeSource(5000);
+  std::vector<Block> storage;
+  auto image = alignedImage(storage, Table::imageSize(m.size()));
+  Table::writeImage(m, image);
+  Table t{ByteRange(image)};
+  checkMatches(t, m);
+}
+
+TEST(F14MappedMap, rejectsBadImages) {
+  auto m = makeSource(100);
+  std::vector<Block> storage;
+  auto image = alignedImage(storage, Table::imageSize(m.size()));
+
+  EXPECT_THROW(
+      Table::writeImage(m, image.subpiece(0, image.size() - 16)),
+      std::invalid_argument);
+  Table::writeImage(m, image);
+
+  // Truncated.
+  EXPECT_THROW(
+      Table{ByteRange(image.subpiece(0, image.size() - 1))},
+      std::runtime_error);
+  EXPECT_THROW(Table{ByteRange(image.subpiece(0, 8))}, std::runtime_error);
+
+  // Read as a different value type.
+  EXPECT_THROW(
+      (F14MappedMap<uint64_t, uint64_t>{ByteRange(image)}), std::runtime_error);
+
+  // Read with a different hasher.
+  struct OtherHash {
+    size_t operator()(uint64_t k) const { return ~k * 0x9e3779b97f4a7c15; }
+  };
+  EXPECT_THROW(
+      (F14MappedMap<uint64_t, Payload, OtherHash>{ByteRange(image)}),
+      std::runtime_error);
+
+  // Bad magic.
+  image[0] ^= 1;
+  EXPECT_THROW(Table{ByteRange(image)}, std::runtime_error);
+}
+
+#endif // FOLLY_F14_VECTOR_INTRINSICS_AVAILABLE
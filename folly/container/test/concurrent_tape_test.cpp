@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/concurrent_tape.h>
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+
+namespace {
+
+std::vector<std::string> records(const folly::concurrent_tape& t) {
+  return {t.begin(), t.end()};
+}
+
+} // namespace
+
+TEST(ConcurrentTape, Empty) {
+  folly::concurrent_tape t;
+  ASSERT_TRUE(t.empty());
+  ASSERT_EQ(t.begin(), t.end());
+  ASSERT_FALSE(t.push_back("a"));
+
+  folly::concurrent_tape t2(64);
+  ASSERT_TRUE(t2.empty());
+  ASSERT_EQ(t2.begin(), t2.end());
+  ASSERT_EQ(64, t2.capacity());
+}
+
+TEST(ConcurrentTape, PushBack) {
+  folly::concurrent_tape t(1024);
+  ASSERT_TRUE(t.push_back("ab"));
+  ASSERT_TRUE(t.push_back(""));
+  ASSERT_TRUE(t.push_back("abcdefgh"));
+  ASSERT_FALSE(t.empty());
+  ASSERT_THAT(records(t), testing::ElementsAre("ab", "", "abcdefgh"));
+  ASSERT_EQ(
+      folly::concurrent_tape::record_footprint(2) +
+          folly::concurrent_tape::record_footprint(0) +
+          folly::concurrent_tape::record_footprint(8),
+      t.reserved_bytes());
+
+  auto tape = t.to_tape();
+  ASSERT_EQ(3, tape.size());
+  ASSERT_EQ("abcdefgh", tape[2]);
+}
+
+TEST(ConcurrentTape, EmplaceBack) {
+  folly::concurrent_tape t(1024);
+  ASSERT_TRUE(t.emplace_back(5, [](char* out) {
+    for (int i = 0; i < 5; ++i) {
+      out[i] = static_cast<char>('a' + i);
+    }
+  }));
+  ASSERT_THAT(records(t), testing::ElementsAre("abcde"));
+}
+
+TEST(ConcurrentTape, Full) {
+  folly::concurrent_tape t(folly::concurrent_tape::record_footprint(3) * 2);
+  ASSERT_TRUE(t.push_back("abc"));
+  ASSERT_FALSE(t.push_back("abcdefgh"));
+  // Once a reservation fails, the tape stays full.
+  ASSERT_FALSE(t.push_back("ab"));
+  bool called = false;
+  ASSERT_FALSE(t.emplace_back(1, [&](char*) { called = true; }));
+  ASSERT_FALSE(called);
+  ASSERT_THAT(records(t), testing::ElementsAre("abc"));
+
+  t.clear();
+  ASSERT_TRUE(t.empty());
+  ASSERT_TRUE(t.push_back("xyz"));
+  ASSERT_TRUE(t.push_back("uvw"));
+  ASSERT_THAT(records(t), testing::ElementsAre("xyz", "uvw"));
+}
+
+TEST(ConcurrentTape, UnpublishedRecordHidesLaterOnes) {
+  folly::concurrent_tape t(1024);
+  ASSERT_TRUE(t.push_back("first"));
+  ASSERT_TRUE(t.emplace_back(6, [&](char* out) {
+    std::memcpy(out, "second", 6);
+    // Not published yet: readers only see the prefix before this record.
+    ASSERT_THAT(records(t), testing::ElementsAre("first"));
+  }));
+  ASSERT_THAT(records(t), testing::ElementsAre("first", "second"));
+}
+
+TEST(ConcurrentTape, ThrowingFillIsSkipped) {
+  folly::concurrent_tape t(1024);
+  ASSERT_TRUE(t.push_back("first"));
+  ASSERT_THROW(
+      t.emplace_back(6, [](char*) { throw std::runtime_error("fill"); }),
+      std::runtime_error);
+  ASSERT_TRUE(t.push_back("third"));
+  ASSERT_THAT(records(t), testing::ElementsAre("first", "third"));
+
+  t.clear();
+  ASSERT_THROW(
+      t.emplace_back(0, [](char*) { throw std::runtime_error("fill"); }),
+      std::runtime_error);
+  ASSERT_TRUE(t.empty());
+  ASSERT_TRUE(t.push_back("x"));
+  ASSERT_THAT(records(t), testing::ElementsAre("x"));
+}
+
+TEST(ConcurrentTape, Move) {
+  folly::concurrent_tape t(1024);
+  t.push_back("a");
+  folly::concurrent_tape t2(std::move(t));
+  ASSERT_THAT(records(t2), testing::ElementsAre("a"));
+  t = std::move(t2);
+  ASSERT_TRUE(t.push_back("b"));
+  ASSERT_THAT(records(t), testing::ElementsAre("a", "b"));
+}
+
+TEST(ConcurrentTape, ConcurrentProducersAndReaders) {
+  constexpr int kProducers = 4;
+  constexpr int kPerProducer = 20000;
+  folly::concurrent_tape t(kProducers * kPerProducer * 32);
+  std::atomic<bool> done{false};
+
+  // Records are "<producer>:<seq>" padded with '.' to a length that varies
+  // with seq, so torn or misplaced records are detected.
+  auto make = [](int p, int seq) {
+    auto s = std::to_string(p) + ":" + std::to_string(seq);
+    s.append(seq % 7, '.');
+    return s;
+  };
+  auto check = [&](std::string_view r, std::vector<int>& next) {
+    auto colon = r.find(':');
+    ASSERT_NE(std::string_view::npos, colon);
+    int p = std::stoi(std::string(r.substr(0, colon)));
+    int seq = std::stoi(std::string(r.substr(colon + 1)));
+    ASSERT_EQ(make(p, seq), r);
+    // Each producer's records appear in the order it pushed them.
+    ASSERT_EQ(next[p], seq);
+    ++next[p];
+  };
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 2; ++i) {
+    readers.emplace_back([&] {
+      while (!done.load()) {
+        std::vector<int> next(kProducers);
+        for (auto r : t) {
+          check(r, next);
+        }
+      }
+    });
+  }
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&, p] {
+      for (int seq = 0; seq < kPerProducer; ++seq) {
+        ASSERT_TRUE(t.push_back(make(p, seq)));
+      }
+    });
+  }
+  for (auto& th : producers) {
+    th.join();
+  }
+  done = true;
+  for (auto& th : readers) {
+    th.join();
+  }
+
+  std::vector<int> next(kProducers);
+  std::size_t count = 0;
+  for (auto r : t) {
+    check(r, next);
+    ++count;
+  }
+  ASSERT_EQ(kProducers * kPerProducer, count);
+}
@@ -17,6 +17,7 @@
 #include <iterator>
 #include <list>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -1049,6 +1050,37 @@ TEST(HeapVectorTypes, TestSetBulkInsertionSortMerge) {
   EXPECT_THAT(vset, testing::ElementsAreArray({1, 2, 4, 5, 6, 7, 8, 10}));
 }
 
+TEST(HeapVectorTypes, TestUnheapifyInvertsHeapify) {
+  for (int size = 1; size < 100; ++size) {
+    std::vector<int> sorted(size);
+    for (int i = 0; i < size; ++i) {
+      sorted[i] = i;
+    }
+    auto v = sorted;
+    folly::detail::heap_vector_detail::heapify(v);
+    folly::detail::heap_vector_detail::unheapify(v);
+    EXPECT_EQ(sorted, v);
+  }
+}
+
+TEST(HeapVectorTypes, TestSetBulkInsertionLarge) {
+  heap_vector_set<int> vset;
+  std::set<int> expected;
+  for (int round = 0; round < 10; ++round) {
+    std::vector<int> s;
+    for (int i = 0; i < 1000; ++i) {
+      s.push_back(folly::Random::rand32(5000));
+    }
+    vset.insert(s.begin(), s.end());
+    expected.insert(s.begin(), s.end());
+    check_invariant(vset);
+    EXPECT_THAT(vset, testing::ElementsAreArray(expected));
+  }
+  for (auto i : expected) {
+    EXPECT_EQ(1, vset.count(i));
+  }
+}
+
 TEST(HeapVectorTypes, TestBulkInsertionUncopyableTypes) {
   {
     std::vector<std::pair<int, std::unique_ptr<int>>> s;
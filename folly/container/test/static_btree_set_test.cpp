@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/static_btree_set.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <vector>
+
+#include <folly/Random.h>
+#include <folly/portability/GTest.h>
+
+using folly::static_btree_set;
+
+namespace {
+
+// Checks lower_bound and find against the sorted keys for every key, its
+// neighbours, and the extremes of T.
+template <class Set, class T = typename Set::key_type>
+void checkAgainst(const Set& s, const std::vector<T>& sorted) {
+  ASSERT_EQ(sorted.size(), s.size());
+  ASSERT_TRUE(std::equal(s.begin(), s.end(), sorted.begin(), sorted.end()));
+  auto check = [&](T x) {
+    auto expected = std::lower_bound(sorted.begin(), sorted.end(), x);
+    auto it = s.lower_bound(x);
+    ASSERT_EQ(expected - sorted.begin(), it - s.begin()) << x;
+    bool present = expected != sorted.end() && *expected == x;
+    ASSERT_EQ(present, s.contains(x)) << x;
+    ASSERT_EQ(present ? it : s.end(), s.find(x));
+  };
+  check(std::numeric_limits<T>::min());
+  check(std::numeric_limits<T>::max());
+  for (auto x : sorted) {
+    check(x);
+    if (x != std::numeric_limits<T>::min()) {
+      check(x - 1);
+    }
+    if (x != std::numeric_limits<T>::max()) {
+      check(x + 1);
+    }
+  }
+}
+
+template <class T, std::size_t B = 64 / sizeof(T)>
+void checkSizes() {
+  for (std::size_t n = 0; n < 3000; n += (n < 300 ? 1 : 97)) {
+    std::vector<T> keys;
+    for (std::size_t i = 0; i < n; ++i) {
+      keys.push_back(static_cast<T>(3 * i - n));
+    }
+    std::sort(keys.begin(), keys.end());
+    static_btree_set<T, B> s(keys.begin(), keys.end());
+    checkAgainst(s, keys);
+  }
+}
+
+} // namespace
+
+TEST(StaticBtreeSet, Empty) {
+  static_btree_set<uint32_t> s;
+  EXPECT_TRUE(s.empty());
+  EXPECT_EQ(s.begin(), s.end());
+  EXPECT_EQ(s.end(), s.lower_bound(0));
+  EXPECT_EQ(s.end(), s.find(42));
+  EXPECT_FALSE(s.contains(std::numeric_limits<uint32_t>::max()));
+}
+
+TEST(StaticBtreeSet, AllSizesUnsigned32) {
+  checkSizes<uint32_t>();
+}
+
+TEST(StaticBtreeSet, AllSizesUnsigned64) {
+  checkSizes<uint64_t>();
+}
+
+TEST(StaticBtreeSet, AllSizesSigned) {
+  checkSizes<int32_t>();
+  checkSizes<int64_t>();
+}
+
+TEST(StaticBtreeSet, OddNodeSizes) {
+  checkSizes<uint32_t, 3>();
+  checkSizes<uint16_t>();
+  checkSizes<uint64_t, 5>();
+}
+
+TEST(StaticBtreeSet, MaxKeyIsAValidElement) {
+  constexpr auto kMax = std::numeric_limits<uint32_t>::max();
+  static_btree_set<uint32_t> s{kMax, 0, kMax - 1};
+  EXPECT_EQ(3, s.size());
+  EXPECT_TRUE(s.contains(kMax));
+  EXPECT_EQ(2, s.lower_bound(kMax) - s.begin());
+  EXPECT_EQ(s.end(), s.upper_bound(kMax));
+  EXPECT_EQ(1, s.upper_bound(0) - s.begin());
+}
+
+TEST(StaticBtreeSet, DuplicatesAreDropped) {
+  std::vector<int> keys{5, 1, 5, 3, 1, 1, 9};
+  static_btree_set<int> s(keys.begin(), keys.end());
+  EXPECT_EQ((std::vector<int>{1, 3, 5, 9}), std::vector<int>(s.begin(), s.end()));
+  EXPECT_EQ(1, s.count(5));
+  EXPECT_EQ(0, s.count(4));
+}
+
+TEST(StaticBtreeSet, SortedUnique) {
+  std::vector<uint64_t> keys{1, 2, 4, 8, 16};
+  static_btree_set<uint64_t> s(
+      folly::sorted_unique, keys.begin(), keys.end());
+  checkAgainst(s, keys);
+}
+
+TEST(StaticBtreeSet, BulkInsert) {
+  std::set<uint64_t> expected;
+  static_btree_set<uint64_t> s;
+  for (int round = 0; round < 20; ++round) {
+    std::vector<uint64_t> batch;
+    for (int i = 0; i < 500; ++i) {
+      batch.push_back(folly::Random::rand64(100000));
+    }
+    expected.insert(batch.begin(), batch.end());
+    s.insert(batch.begin(), batch.end());
+    checkAgainst(s, std::vector<uint64_t>(expected.begin(), expected.end()));
+  }
+  s.insert({});
+  EXPECT_EQ(expected.size(), s.size());
+}
+
+TEST(StaticBtreeSet, RandomKeys) {
+  std::vector<uint32_t> keys;
+  for (int i = 0; i < 200000; ++i) {
+    keys.push_back(folly::Random::rand32());
+  }
+  static_btree_set<uint32_t> s(keys.begin(), keys.end());
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  checkAgainst(s, keys);
+}
+
+TEST(StaticBtreeSet, SwapAndCompare) {
+  static_btree_set<int> a{1, 2, 3};
+  static_btree_set<int> b{4};
+  swap(a, b);
+  EXPECT_EQ(static_btree_set<int>({4}), a);
+  EXPECT_EQ(static_btree_set<int>({1, 2, 3}), b);
+  EXPECT_NE(a, b);
+  a.clear();
+  EXPECT_TRUE(a.empty());
+}
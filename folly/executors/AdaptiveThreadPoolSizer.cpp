@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/AdaptiveThreadPoolSizer.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std::chrono;
+
+namespace folly {
+
+namespace {
+
+uint64_t toNs(steady_clock::time_point t) {
+  return duration_cast<nanoseconds>(t.time_since_epoch()).count();
+}
+
+} // namespace
+
+AdaptiveThreadPoolSizer::AdaptiveThreadPoolSizer()
+    : AdaptiveThreadPoolSizer(Options()) {}
+
+AdaptiveThreadPoolSizer::AdaptiveThreadPoolSizer(const Options& options)
+    : options_(options),
+      targetWaitNs_(
+          duration_cast<nanoseconds>(options.targetWait()).count()),
+      intervalEndNs_(toNs(steady_clock::now() + options.interval())) {
+  if (options.targetWait() <= milliseconds::zero() ||
+      options.interval() <= milliseconds::zero()) {
+    throw std::invalid_argument(
+        "AdaptiveThreadPoolSizer: targetWait and interval must be positive");
+  }
+  if (!(options.percentile() > 0 && options.percentile() < 1)) {
+    throw std::invalid_argument(
+        "AdaptiveThreadPoolSizer: percentile must be in (0, 1)");
+  }
+}
+
+bool AdaptiveThreadPoolSizer::recordWait(
+    nanoseconds wait, steady_clock::time_point now) {
+  auto waitNs = static_cast<uint64_t>(std::max(wait.count(), int64_t(0)));
+  numWaits_.fetch_add(1, std::memory_order_relaxed);
+  if (waitNs > targetWaitNs_ / 2) {
+    numOverHalfTarget_.fetch_add(1, std::memory_order_relaxed);
+    if (waitNs > targetWaitNs_) {
+      numOverTarget_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  // Only write when lowering the minimum, to keep the line shared.
+  auto minWait = minWaitNs_.load(std::memory_order_relaxed);
+  while (waitNs < minWait &&
+         !minWaitNs_.compare_exchange_weak(
+             minWait, waitNs, std::memory_order_relaxed)) {
+  }
+  return intervalExpired(now);
+}
+
+bool AdaptiveThreadPoolSizer::intervalExpired(steady_clock::time_point now) {
+  auto nowNs = toNs(now);
+  auto end = intervalEndNs_.load(std::memory_order_relaxed);
+  if (nowNs < end) {
+    return false;
+  }
+  // Whoever moves the interval end runs the update; acq_rel orders one
+  // update() after the previous one.
+  auto next = nowNs +
+      static_cast<uint64_t>(
+                  duration_cast<nanoseconds>(options_.interval()).count());
+  return intervalEndNs_.compare_exchange_strong(
+      end, next, std::memory_order_acq_rel, std::memory_order_relaxed);
+}
+
+size_t AdaptiveThreadPoolSizer::update(
+    size_t current,
+    size_t minThreads,
+    size_t maxThreads,
+    double cpuUtilization,
+    size_t pending) {
+  auto numWaits = numWaits_.exchange(0, std::memory_order_relaxed);
+  auto numOverTarget = numOverTarget_.exchange(0, std::memory_order_relaxed);
+  auto numOverHalfTarget =
+      numOverHalfTarget_.exchange(0, std::memory_order_relaxed);
+  auto minWait = minWaitNs_.exchange(UINT64_MAX, std::memory_order_relaxed);
+
+  auto hi = maxThreads;
+  auto lo = std::min(std::max<size_t>(minThreads, 1), hi);
+  current = std::clamp(current, lo, hi);
+
+  auto allowed = (1 - options_.percentile()) * static_cast<double>(numWaits);
+  bool overTarget = numWaits == 0
+      ? pending > 0
+      : static_cast<double>(numOverTarget) > allowed;
+  if (overTarget) {
+    if (cpuUtilization > options_.maxCpuUtilization()) {
+      return current;
+    }
+    bool standing = numWaits == 0 || minWait > targetWaitNs_;
+    size_t step = standing ? std::max<size_t>(current / 4, 1) : 1;
+    return std::min(current + step, hi);
+  }
+  if (static_cast<double>(numOverHalfTarget) <= allowed && current > lo) {
+    return current - 1;
+  }
+  return current;
+}
+
+} // namespace folly
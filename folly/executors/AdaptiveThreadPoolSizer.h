@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace folly {
+
+/// Picks the number of threads of a thread pool from the queueing delay of
+/// its tasks (the time from enqueue to dequeue), aiming to keep a percentile
+/// of that delay under a target. This lets a pool absorb bursts without
+/// keeping enough threads for the worst burst around all the time.
+///
+/// Like Codel, it works in intervals. Feed the delay of every dequeued task
+/// to recordWait(). When an interval has ended, one caller gets true and
+/// should call update() to get the new thread count:
+///
+/// - If more than (1 - percentile) of the tasks waited longer than the
+///   target, the pool is too small, and grows by one thread. If even the
+///   shortest wait of the interval was over the target, the queue is
+///   standing rather than bursting (Codel's signal), and the pool grows by a
+///   quarter instead.
+/// - It does not grow while its threads use more than maxCpuUtilization of
+///   the machine's CPUs: more threads would only add context switches.
+/// - If at most (1 - percentile) of the tasks waited longer than half the
+///   target, the pool shrinks by one thread. The gap between the two
+///   thresholds keeps the size from oscillating.
+/// - An interval with tasks pending but none dequeued counts as over the
+///   target, since every thread is busy with a long task.
+///
+/// Comparing the fraction of waits over the target with 1 - percentile is
+/// the same as comparing the percentile with the target, so no histogram is
+/// kept: recordWait() is a few relaxed atomic increments.
+class AdaptiveThreadPoolSizer {
+ public:
+  class Options {
+   public:
+    std::chrono::milliseconds targetWait() const { return targetWait_; }
+
+    Options& setTargetWait(std::chrono::milliseconds value) {
+      targetWait_ = value;
+      return *this;
+    }
+
+    double percentile() const { return percentile_; }
+
+    Options& setPercentile(double value) {
+      percentile_ = value;
+      return *this;
+    }
+
+    std::chrono::milliseconds interval() const { return interval_; }
+
+    Options& setInterval(std::chrono::milliseconds value) {
+      interval_ = value;
+      return *this;
+    }
+
+    double maxCpuUtilization() const { return maxCpuUtilization_; }
+
+    Options& setMaxCpuUtilization(double value) {
+      maxCpuUtilization_ = value;
+      return *this;
+    }
+
+   private:
+    std::chrono::milliseconds targetWait_{5};
+    double percentile_{0.99};
+    std::chrono::milliseconds interval_{100};
+    double maxCpuUtilization_{0.9};
+  };
+
+  AdaptiveThreadPoolSizer();
+
+  /// Throws std::invalid_argument if the options are out of range.
+  explicit AdaptiveThreadPoolSizer(const Options& options);
+
+  const Options& options() const { return options_; }
+
+  /// Records the queueing delay of a dequeued task. Returns true if the
+  /// current interval has ended, in which case the caller should call
+  /// update(). Only one of concurrent callers gets true.
+  bool recordWait(std::chrono::nanoseconds wait) {
+    return recordWait(wait, std::chrono::steady_clock::now());
+  }
+  bool recordWait(
+      std::chrono::nanoseconds wait, std::chrono::steady_clock::time_point now);
+
+  /// Like recordWait() without a delay, for when no task is being dequeued.
+  bool intervalExpired(std::chrono::steady_clock::time_point now);
+
+  /// Returns the number of threads for the next interval, in
+  /// [max(minThreads, 1), maxThreads], and resets the counts for it.
+  ///
+  /// @param current         Current number of threads
+  /// @param cpuUtilization  Fraction of the machine's CPUs used by the pool
+  ///                        during the interval
+  /// @param pending         Number of tasks waiting in the queue
+  size_t update(
+      size_t current,
+      size_t minThreads,
+      size_t maxThreads,
+      double cpuUtilization,
+      size_t pending);
+
+ private:
+  const Options options_;
+  const uint64_t targetWaitNs_;
+
+  std::atomic<uint64_t> intervalEndNs_;
+  std::atomic<uint64_t> numWaits_{0};
+  std::atomic<uint64_t> numOverTarget_{0};
+  std::atomic<uint64_t> numOverHalfTarget_{0};
+  std::atomic<uint64_t> minWaitNs_{UINT64_MAX};
+};
+
+} // namespace folly
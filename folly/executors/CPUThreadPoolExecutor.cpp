@@ -17,15 +17,21 @@
 #include <folly/Executor.h>
 #include <folly/executors/CPUThreadPoolExecutor.h>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <vector>
+
 #include <folly/Memory.h>
 #include <folly/Optional.h>
 #include <folly/executors/QueueObserver.h>
 #include <folly/executors/task_queue/PriorityLifoSemMPMCQueue.h>
 #include <folly/executors/task_queue/PriorityUnboundedBlockingQueue.h>
 #include <folly/executors/task_queue/UnboundedBlockingQueue.h>
+#include <folly/executors/task_queue/WorkStealingBlockingQueue.h>
 #include <folly/portability/GFlags.h>
 #include <folly/synchronization/ThrottledLifoSem.h>
+#include <folly/system/HardwareConcurrency.h>
 
 FOLLY_GFLAGS_DEFINE_bool(
     dynamic_cputhreadpoolexecutor,
@@ -96,6 +102,18 @@ CPUThreadPoolExecutor::CPUTask::CPUTask()
       numPriorities, opts);
 }
 
+/* static */ auto CPUThreadPoolExecutor::makeWorkStealingQueue(
+    size_t maxWorkers, std::chrono::nanoseconds wakeUpInterval)
+    -> std::unique_ptr<BlockingQueue<CPUTask>> {
+  ThrottledLifoSem::Options opts;
+  opts.wakeUpInterval = wakeUpInterval;
+  if (maxWorkers == 0) {
+    maxWorkers = folly::available_concurrency();
+  }
+  return std::make_unique<
+      WorkStealingBlockingQueue<CPUTask, ThrottledLifoSem>>(maxWorkers, opts);
+}
+
 CPUThreadPoolExecutor::CPUThreadPoolExecutor(
     size_t numThreads,
     std::unique_ptr<BlockingQueue<CPUTask>> taskQueue,
@@ -117,6 +135,10 @@ CPUThreadPoolExecutor::CPUThreadPoolExecutor(
           numThreads.first, numThreads.second, std::move(threadFactory)),
       taskQueue_(std::move(taskQueue)),
       prohibitBlockingOnThreadPools_{opt.blocking} {
+  if (opt.waitOptions) {
+    taskQueue_->setWaitOptions(*opt.waitOptions);
+    measureIdleWait_ = true;
+  }
   setNumThreads(numThreads.first);
   if (numThreads.second == 0) {
     minThreads_.store(1, std::memory_order_relaxed);
@@ -245,6 +267,37 @@ void CPUThreadPoolExecutor::add(
       std::move(task));
 }
 
+void CPUThreadPoolExecutor::addBatch(span<Func> funcs) {
+  std::vector<CPUTask> tasks;
+  tasks.reserve(funcs.size());
+  for (auto& func : funcs) {
+    CPUTask task(std::move(func), std::chrono::milliseconds(0), nullptr, 0);
+    if (prepareTask(task)) {
+      tasks.push_back(std::move(task));
+    }
+  }
+  if (tasks.empty()) {
+    return;
+  }
+  enqueueTasks(tasks.size(), [&] {
+    return taskQueue_->addBatch(span<CPUTask>(tasks.data(), tasks.size()));
+  });
+}
+
+bool CPUThreadPoolExecutor::prepareTask(CPUTask& task) {
+  if (!task.func_) {
+    // Reserve empty funcs as poison by logging the error inline.
+    invokeCatchingExns("ThreadPoolExecutor: func", std::move(task.func_));
+    return false;
+  }
+
+  if (auto queueObserver = getQueueObserver(task.priority())) {
+    task.queueObserverPayload_ = queueObserver->onEnqueued(task.context_.get());
+  }
+  registerTaskEnqueue(task);
+  return true;
+}
+
 uint8_t CPUThreadPoolExecutor::getNumPriorities() const {
   return taskQueue_->getNumPriorities();
 }
@@ -253,6 +306,92 @@ size_t CPUThreadPoolExecutor::getTaskQueueSize() const {
   return taskQueue_->size();
 }
 
+// Feeds the wait times of tasks to the sizer, and applies its decisions from
+// whichever thread ends an interval.
+class CPUThreadPoolExecutor::AdaptiveSizingObserver : public TaskObserver {
+ public:
+  AdaptiveSizingObserver(
+      CPUThreadPoolExecutor& executor,
+      const AdaptiveThreadPoolSizer::Options& options)
+      : executor_(executor),
+        sizer_(options),
+        lastUpdateTime_(std::chrono::steady_clock::now()),
+        lastCpuTime_(executor.getUsedCpuTime()) {}
+
+  std::chrono::milliseconds interval() const {
+    return sizer_.options().interval();
+  }
+
+  void taskEnqueued(const TaskInfo& info) noexcept override {
+    // Also checked on enqueue, so that the pool grows when every thread is
+    // stuck on a long task and nothing is dequeued.
+    if (sizer_.intervalExpired(info.enqueueTime)) {
+      update(info.enqueueTime);
+    }
+  }
+
+  void taskDequeued(const DequeuedTaskInfo& info) noexcept override {
+    auto now = info.enqueueTime + info.waitTime;
+    if (sizer_.recordWait(info.waitTime, now)) {
+      update(now);
+    }
+  }
+
+ private:
+  void update(std::chrono::steady_clock::time_point now) noexcept {
+    invokeCatchingExns("CPUThreadPoolExecutor: adaptive sizing", [&] {
+      auto& ex = executor_;
+      auto cpuTime = ex.getUsedCpuTime();
+      auto wallTime = std::chrono::duration<double>(now - lastUpdateTime_);
+      double utilization = wallTime.count() > 0
+          ? std::chrono::duration<double>(cpuTime - lastCpuTime_).count() /
+              (wallTime.count() * folly::available_concurrency())
+          : 0;
+      lastUpdateTime_ = now;
+      lastCpuTime_ = cpuTime;
+
+      auto pending = ex.getPendingTaskCount();
+      auto cap = sizer_.update(
+          std::min(
+              ex.activeThreadsCap_.load(std::memory_order_relaxed),
+              ex.activeThreads_.load(std::memory_order_relaxed)),
+          ex.minThreads_.load(std::memory_order_relaxed),
+          ex.maxThreads_.load(std::memory_order_relaxed),
+          utilization,
+          pending);
+      ex.activeThreadsCap_.store(cap, std::memory_order_relaxed);
+
+      // Serve the queued tasks now rather than on the next add().
+      for (size_t i = 0; i < pending &&
+           ex.activeThreads_.load(std::memory_order_relaxed) <
+               ex.maxActiveThreads();
+           ++i) {
+        ex.ensureActiveThreads();
+      }
+    });
+  }
+
+  CPUThreadPoolExecutor& executor_;
+  AdaptiveThreadPoolSizer sizer_;
+  // Only accessed by the thread that ended the interval.
+  std::chrono::steady_clock::time_point lastUpdateTime_;
+  std::chrono::nanoseconds lastCpuTime_;
+};
+
+void CPUThreadPoolExecutor::enableAdaptiveSizing(
+    const AdaptiveThreadPoolSizer::Options& options) {
+  auto observer = std::make_unique<AdaptiveSizingObserver>(*this, options);
+  AdaptiveSizingObserver* expected = nullptr;
+  CHECK(adaptiveSizing_.compare_exchange_strong(
+      expected, observer.get(), std::memory_order_relaxed))
+      << "Adaptive sizing is already enabled";
+  // Start from the threads running now.
+  activeThreadsCap_.store(
+      std::max<size_t>(activeThreads_.load(std::memory_order_relaxed), 1),
+      std::memory_order_relaxed);
+  addTaskObserver(std::move(observer));
+}
+
 WorkerProvider* CPUThreadPoolExecutor::getThreadIdCollector() {
   return threadIdCollector_.get();
 }
@@ -284,6 +423,10 @@ void CPUThreadPoolExecutor::stopThread(const ThreadPtr& thread) {
   }
   stoppedThreadProcessedTasks_ += thread->processedTasks;
   thread->processedTasks = 0;
+  stoppedThreadIdleSpinTimeNs_ += thread->idleSpinTimeNs;
+  thread->idleSpinTimeNs = 0;
+  stoppedThreadIdleParkTimeNs_ += thread->idleParkTimeNs;
+  thread->idleParkTimeNs = 0;
   threadList_.remove(thread);
   stoppedThreads_.add(folly::copy(thread));
 }
@@ -306,15 +449,22 @@ void CPUThreadPoolExecutor::threadRun(ThreadPtr thread) {
     threadIdCollector_->removeTid(folly::getOSThreadID());
   });
   while (true) {
-    auto task = taskQueue_->try_take_for(
-        threadTimeout_.load(std::memory_order_relaxed));
+    folly::Optional<CPUTask> task;
+    if (FOLLY_UNLIKELY(measureIdleWait_)) {
+      WaitStats stats;
+      task = taskQueue_->try_take_for_with_stats(idleWaitTimeout(), stats);
+      thread->idleSpinTimeNs += stats.spin.count();
+      thread->idleParkTimeNs += stats.park.count();
+    } else {
+      task = taskQueue_->try_take_for(idleWaitTimeout());
+    }
 
     // Handle thread stopping, either by task timeout, or by 'poison' task added
     // by stopThreads().
     if (bool timeout = !task; FOLLY_UNLIKELY(timeout || !task->func_)) {
       std::unique_lock w{threadListLock_};
       if (shouldStopThread(/* isPoison */ !timeout) ||
-          (timeout && tryTimeoutThread())) {
+          (timeout && idleThreadExpired(*thread) && tryTimeoutThread())) {
         stopThread(thread);
         return;
       }
@@ -334,6 +484,30 @@ void CPUThreadPoolExecutor::threadRun(ThreadPtr thread) {
   }
 }
 
+std::chrono::milliseconds CPUThreadPoolExecutor::idleWaitTimeout() const {
+  auto timeout = threadTimeout_.load(std::memory_order_relaxed);
+  if (auto sizing = adaptiveSizing_.load(std::memory_order_relaxed)) {
+    // Wake up every interval to check whether the cap dropped below the
+    // number of threads.
+    timeout = std::min(timeout, sizing->interval());
+  }
+  return timeout;
+}
+
+// Called when a thread's wait for a task timed out.
+bool CPUThreadPoolExecutor::idleThreadExpired(const Thread& thread) const {
+  if (adaptiveSizing_.load(std::memory_order_relaxed) == nullptr) {
+    return true;
+  }
+  if (activeThreads_.load(std::memory_order_relaxed) >
+      activeThreadsCap_.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  auto idle = std::chrono::steady_clock::now() -
+      thread.lastActiveTime.load(std::memory_order_relaxed);
+  return idle >= threadTimeout_.load(std::memory_order_relaxed);
+}
+
 void CPUThreadPoolExecutor::stopThreads(size_t n) {
   threadsToStop_ += n;
   for (size_t i = 0; i < n; i++) {
@@ -19,9 +19,12 @@
 #include <limits.h>
 
 #include <array>
+#include <optional>
 
+#include <folly/executors/AdaptiveThreadPoolSizer.h>
 #include <folly/executors/QueueObserver.h>
 #include <folly/executors/ThreadPoolExecutor.h>
+#include <folly/synchronization/WaitOptions.h>
 
 FOLLY_GFLAGS_DECLARE_bool(dynamic_cputhreadpoolexecutor);
 
@@ -76,7 +79,18 @@ class CPUThreadPoolExecutor
       return *this;
     }
 
+    // How the threads wait for tasks: they spin for up to spin_max() before
+    // they block on the queue, trading CPU for wake-up latency (see
+    // BlockingQueue::setWaitOptions() for the queues that honor it). The
+    // time spent spinning and blocked is reported in PoolStats. Unset, the
+    // queue waits the default way and the time is not measured.
+    Options& setWaitOptions(const WaitOptions& w) {
+      waitOptions = w;
+      return *this;
+    }
+
     Blocking blocking;
+    std::optional<WaitOptions> waitOptions;
   };
 
   // These function return unbounded blocking queues with the default semaphore.
@@ -96,6 +110,14 @@ class CPUThreadPoolExecutor
   makeThrottledLifoSemPriorityQueue(
       int8_t numPriorities, std::chrono::nanoseconds wakeUpInterval = {});
 
+  // Returns an unbounded WorkStealingBlockingQueue: tasks added from pool
+  // threads go to a per-thread deque and idle threads steal from the
+  // others. Suited to fine-grained tasks that spawn continuations. Up to
+  // maxWorkers threads get a deque (0 means one per available CPU); it
+  // supports a single priority.
+  static std::unique_ptr<BlockingQueue<CPUTask>> makeWorkStealingQueue(
+      size_t maxWorkers = 0, std::chrono::nanoseconds wakeUpInterval = {});
+
   CPUThreadPoolExecutor(
       size_t numThreads,
       std::unique_ptr<BlockingQueue<CPUTask>> taskQueue,
@@ -147,6 +169,11 @@ class CPUThreadPoolExecutor
       Func expireCallback = nullptr) override;
 
   void addWithPriority(Func func, int8_t priority) override;
+
+  // Enqueues the batch at medium priority with a single BlockingQueue
+  // addBatch(), so the queue wakes up to funcs.size() idle threads at once.
+  void addBatch(span<Func> funcs) override;
+
   virtual void add(
       Func func,
       int8_t priority,
@@ -155,6 +182,20 @@ class CPUThreadPoolExecutor
 
   size_t getTaskQueueSize() const;
 
+  /**
+   * Sizes the pool from the queueing delay of its tasks. By default, a task
+   * that finds no idle thread starts a new one, up to numThreads(), and the
+   * threads linger until idle for the thread death timeout. With adaptive
+   * sizing, the pool only starts threads up to a cap that an
+   * AdaptiveThreadPoolSizer moves between the minimum number of threads and
+   * numThreads() every interval, and threads over the cap retire after an
+   * interval without work. Idle threads wake up once per interval to check.
+   *
+   * Can only be called once.
+   */
+  void enableAdaptiveSizing(
+      const AdaptiveThreadPoolSizer::Options& options = {});
+
   uint8_t getNumPriorities() const override;
 
   /// Implements the GetThreadIdCollector interface
@@ -185,12 +226,24 @@ class CPUThreadPoolExecutor
       std::make_unique<ThreadIdWorkerProvider>()};
 
  private:
+  class AdaptiveSizingObserver;
+
+  // Runs the enqueue-time observers of a task, or logs and drops it if its
+  // func is empty. Returns whether the task should be queued.
+  bool prepareTask(CPUTask& task);
+  // Queues numTasks prepared tasks through enqueue(), and starts threads for
+  // them if the queue did not hand them to an idle one.
+  template <typename EnqueueTasks>
+  void enqueueTasks(size_t numTasks, EnqueueTasks&& enqueue);
+
   void threadRun(ThreadPtr thread) override;
   void stopThreads(size_t n) override;
   size_t getPendingTaskCountImpl() const override final;
 
   bool shouldStopThread(bool isPoison);
   void stopThread(const ThreadPtr& thread);
+  std::chrono::milliseconds idleWaitTimeout() const;
+  bool idleThreadExpired(const Thread& thread) const;
 
   std::unique_ptr<folly::QueueObserverFactory> createQueueObserverFactory();
   QueueObserver* FOLLY_NULLABLE getQueueObserver(int8_t pri);
@@ -202,37 +255,44 @@ class CPUThreadPoolExecutor
       createQueueObserverFactory()};
   std::atomic<size_t> threadsToStop_{0};
   Options::Blocking prohibitBlockingOnThreadPools_ = Options::Blocking::allow;
+  // Whether the threads measure how they wait for tasks, see PoolStats.
+  bool measureIdleWait_{false};
+  // Owned by the task observer list.
+  std::atomic<AdaptiveSizingObserver*> adaptiveSizing_{nullptr};
 };
 
 template <typename EnqueueTask>
 void CPUThreadPoolExecutor::addImpl(EnqueueTask&& enqueueTask, CPUTask&& task) {
-  if (!task.func_) {
-    // Reserve empty funcs as poison by logging the error inline.
-    invokeCatchingExns("ThreadPoolExecutor: func", std::move(task.func_));
+  if (!prepareTask(task)) {
     return;
   }
+  enqueueTasks(1, [&] { return enqueueTask(std::move(task)); });
+}
 
-  if (auto queueObserver = getQueueObserver(task.priority())) {
-    task.queueObserverPayload_ = queueObserver->onEnqueued(task.context_.get());
-  }
-  registerTaskEnqueue(task);
-
+template <typename EnqueueTasks>
+void CPUThreadPoolExecutor::enqueueTasks(
+    size_t numTasks, EnqueueTasks&& enqueue) {
   // It's not safe to expect that the executor is alive after a task is added to
   // the queue (this task could be holding the last KeepAlive and when finished
   // - it may unblock the executor shutdown).
   // If we need executor to be alive after adding into the queue, we have to
   // acquire a KeepAlive.
   bool mayNeedToAddThreads = minThreads_.load(std::memory_order_relaxed) == 0 ||
-      activeThreads_.load(std::memory_order_relaxed) <
-          maxThreads_.load(std::memory_order_relaxed);
+      activeThreads_.load(std::memory_order_relaxed) < maxActiveThreads();
   folly::Executor::KeepAlive<> ka = mayNeedToAddThreads
       ? getKeepAliveToken(this)
       : folly::Executor::KeepAlive<>{};
 
-  auto result = enqueueTask(std::move(task));
+  auto result = enqueue();
 
   if (mayNeedToAddThreads && !result.reusedThread) {
-    ensureActiveThreads();
+    // Up to one new thread per task, until the pool is at its size.
+    size_t i = 0;
+    do {
+      ensureActiveThreads();
+    } while (++i < numTasks &&
+             activeThreads_.load(std::memory_order_relaxed) <
+                 maxActiveThreads());
   }
 }
 
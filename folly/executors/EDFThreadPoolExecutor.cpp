@@ -22,6 +22,7 @@
 #include <chrono>
 #include <cstddef>
 #include <exception>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <queue>
@@ -29,7 +30,10 @@
 #include <vector>
 
 #include <glog/logging.h>
+#include <folly/Random.h>
+#include <folly/concurrency/CacheLocality.h>
 #include <folly/concurrency/ProcessLocalUniqueId.h>
+#include <folly/lang/Align.h>
 #include <folly/portability/GFlags.h>
 #include <folly/synchronization/LifoSem.h>
 #include <folly/synchronization/ThrottledLifoSem.h>
@@ -135,6 +139,7 @@ class EDFThreadPoolExecutor::TaskQueue {
       task->setEnqueueOrder(bucket.enqueued++);
       bucket.tasks.push(std::move(task));
       bucket.empty.store(bucket.tasks.empty(), std::memory_order_relaxed);
+      numTasks_.fetch_add(1, std::memory_order_relaxed);
     }
 
     // Update current earliest deadline if necessary
@@ -147,10 +152,14 @@ class EDFThreadPoolExecutor::TaskQueue {
         curDeadline, deadline, std::memory_order_relaxed));
   }
 
-  // Should only be called on a nonempty queue.
-  TaskPtr pop() {
+  // Returns nullptr once the queue holds no tasks, including finished ones
+  // not yet removed.
+  TaskPtr tryPop() {
     bool needDeadlineUpdate = false;
     for (;;) {
+      if (numTasks_.load(std::memory_order_relaxed) == 0) {
+        return nullptr;
+      }
       auto curDeadline = curDeadline_.load(std::memory_order_relaxed);
       auto& bucket = getBucket(curDeadline);
 
@@ -190,6 +199,7 @@ class EDFThreadPoolExecutor::TaskQueue {
           // Current task finished. Remove from the queue.
           bucket.tasks.pop();
           bucket.empty.store(bucket.tasks.empty(), std::memory_order_relaxed);
+          numTasks_.fetch_sub(1, std::memory_order_relaxed);
         }
       }
 
@@ -199,6 +209,16 @@ class EDFThreadPoolExecutor::TaskQueue {
     }
   }
 
+  bool emptyGuess() const {
+    return numTasks_.load(std::memory_order_relaxed) == 0;
+  }
+
+  // A lower bound of the earliest deadline in the queue, unless a pop is
+  // concurrently updating it.
+  uint64_t earliestDeadlineGuess() const {
+    return curDeadline_.load(std::memory_order_relaxed);
+  }
+
  private:
   Bucket& getBucket(uint64_t deadline) {
     return buckets_[deadline % kNumBuckets];
@@ -248,6 +268,71 @@ class EDFThreadPoolExecutor::TaskQueue {
 
   std::array<Bucket, kNumBuckets> buckets_;
   std::atomic<uint64_t> curDeadline_ = kLatestDeadline;
+  // Tasks in the buckets, finished or not.
+  std::atomic<std::size_t> numTasks_{0};
+};
+
+class EDFThreadPoolExecutor::StripedTaskQueue {
+ public:
+  using TaskPtr = TaskQueue::TaskPtr;
+
+  explicit StripedTaskQueue(std::size_t numStripes)
+      : numStripes_(numStripes), stripes_(new Stripe[numStripes]) {
+    CHECK_GT(numStripes, 0);
+  }
+
+  std::size_t numStripes() const { return numStripes_; }
+
+  void push(TaskPtr task) {
+    stripes_[currentStripe()].push(std::move(task));
+  }
+
+  // Should only be called on a nonempty queue.
+  TaskPtr pop() {
+    if (numStripes_ == 1) {
+      for (;;) {
+        if (auto task = stripes_[0].tryPop()) {
+          return task;
+        }
+      }
+    }
+
+    auto local = currentStripe();
+    for (;;) {
+      auto* first = &stripes_[local];
+      auto* second = &stripes_
+          [(local + 1 + Random::rand32(numStripes_ - 1)) % numStripes_];
+      if (first->emptyGuess() ||
+          (!second->emptyGuess() &&
+           second->earliestDeadlineGuess() < first->earliestDeadlineGuess())) {
+        std::swap(first, second);
+      }
+      if (auto task = first->tryPop()) {
+        return task;
+      }
+      if (auto task = second->tryPop()) {
+        return task;
+      }
+      // Both were drained meanwhile, but the caller was promised a task:
+      // look at every stripe.
+      for (std::size_t i = 1; i < numStripes_; ++i) {
+        if (auto task = stripes_[(local + i) % numStripes_].tryPop()) {
+          return task;
+        }
+      }
+    }
+  }
+
+ private:
+  struct alignas(hardware_destructive_interference_size) Stripe
+      : TaskQueue {};
+
+  std::size_t currentStripe() const {
+    return numStripes_ == 1 ? 0 : AccessSpreader<>::cachedCurrent(numStripes_);
+  }
+
+  const std::size_t numStripes_;
+  const std::unique_ptr<Stripe[]> stripes_;
 };
 
 /* static */ std::unique_ptr<EDFThreadPoolSemaphore>
@@ -273,9 +358,13 @@ EDFThreadPoolExecutor::makeThrottledLifoSemSemaphore(
 EDFThreadPoolExecutor::EDFThreadPoolExecutor(
     std::size_t numThreads,
     std::shared_ptr<ThreadFactory> threadFactory,
-    std::unique_ptr<EDFThreadPoolSemaphore> semaphore)
+    std::unique_ptr<EDFThreadPoolSemaphore> semaphore,
+    const Options& options)
     : ThreadPoolExecutor(numThreads, numThreads, std::move(threadFactory)),
-      taskQueue_(std::make_unique<TaskQueue>()),
+      taskQueue_(std::make_unique<StripedTaskQueue>(
+          options.numQueueStripes != 0
+              ? options.numQueueStripes
+              : LLCAccessSpreader::get().numStripes())),
       sem_(std::move(semaphore)) {
   setNumThreads(numThreads);
   registerThreadPoolExecutor(this);
@@ -309,10 +398,21 @@ void EDFThreadPoolExecutor::add(std::vector<Func> fs, uint64_t deadline) {
   sem_->post(static_cast<uint32_t>(total));
 }
 
+void EDFThreadPoolExecutor::addBatch(span<Func> funcs) {
+  add(std::vector<Func>(
+          std::make_move_iterator(funcs.begin()),
+          std::make_move_iterator(funcs.end())),
+      kLatestDeadline);
+}
+
 size_t EDFThreadPoolExecutor::getTaskQueueSize() const {
   return sem_->valueGuess();
 }
 
+std::size_t EDFThreadPoolExecutor::getNumQueueStripes() const {
+  return taskQueue_->numStripes();
+}
+
 bool EDFThreadPoolExecutor::tryStopThread(
     const ThreadPtr& thread, bool isPoison) {
   auto threadsToStop = threadsToStop_.load(std::memory_order_relaxed);
@@ -376,11 +476,20 @@ void EDFThreadPoolExecutor::threadRun(ThreadPtr thread) {
     forEachTaskObserver([&](auto& observer) {
       observer.taskDequeued(taskInfo);
     });
+    // The task may be destroyed by run().
+    taskInfo.context = nullptr;
+    const bool measureCpuTime =
+        taskCpuTimeEnabled_.load(std::memory_order_relaxed);
+    auto startCpuTime =
+        measureCpuTime ? currentThreadCpuTime() : std::chrono::nanoseconds(0);
 
     invokeCatchingExns("EDFThreadPoolExecutor: func", [&] {
       std::exchange(task, {})->run(iter);
     });
     taskInfo.runTime = std::chrono::steady_clock::now() - startTime;
+    if (measureCpuTime) {
+      taskInfo.cpuTime = currentThreadCpuTime() - startCpuTime;
+    }
 
     FOLLY_SDT(
         folly,
@@ -430,6 +539,7 @@ void EDFThreadPoolExecutor::fillTaskInfo(const Task& task, TaskInfo& info) {
   }
   info.enqueueTime = task.enqueueTime_;
   info.taskId = task.taskId_;
+  info.context = task.context_.get();
 }
 
 void EDFThreadPoolExecutor::registerTaskEnqueue(const Task& task) {
@@ -54,6 +54,23 @@ class EDFThreadPoolSemaphoreImpl : public EDFThreadPoolSemaphore {
  * `EDFThreadPoolExecutor` is a `SoftRealTimeExecutor` that implements the
  * earliest-deadline-first scheduling policy. Deadline ties are resolved by
  * submission order.
+ *
+ * By default all tasks go through one deadline-ordered queue, which every
+ * submitting and running thread contends on. With `Options::numQueueStripes`
+ * greater than 1 the queue is split into stripes, and the policy is relaxed:
+ *
+ * - A task is pushed to the stripe of the submitting CPU, as assigned by
+ *   `AccessSpreader`, so stripes follow the cache topology.
+ * - A worker samples its own stripe and one other at random, and runs the
+ *   earliest task of the two ("power of two choices").
+ *
+ * Each task run is thus the earliest of its stripe, but not necessarily of
+ * the whole pool. As in the MultiQueue analysis, the number of queued tasks
+ * with an earlier deadline is O(numQueueStripes) in expectation when
+ * submissions are spread over the stripes; every stripe is sampled with
+ * probability at least 1 / numQueueStripes on each pop, so no task is
+ * starved. Deadline ties are resolved by submission order only among tasks
+ * in the same stripe.
  */
 class EDFThreadPoolExecutor
     : public SoftRealTimeExecutor,
@@ -66,6 +83,19 @@ class EDFThreadPoolExecutor
   static constexpr uint64_t kLatestDeadline =
       std::numeric_limits<uint64_t>::max();
 
+  struct Options {
+    constexpr Options() noexcept : numQueueStripes{1} {}
+
+    Options& setNumQueueStripes(std::size_t n) {
+      numQueueStripes = n;
+      return *this;
+    }
+
+    // Number of independent deadline queues; see above. 1 keeps exact EDF
+    // order, 0 picks one stripe per last-level cache.
+    std::size_t numQueueStripes;
+  };
+
   static std::unique_ptr<EDFThreadPoolSemaphore> makeDefaultSemaphore();
   static std::unique_ptr<EDFThreadPoolSemaphore> makeLifoSemSemaphore();
   static std::unique_ptr<EDFThreadPoolSemaphore> makeThrottledLifoSemSemaphore(
@@ -76,7 +106,8 @@ class EDFThreadPoolExecutor
       std::shared_ptr<ThreadFactory> threadFactory =
           std::make_shared<NamedThreadFactory>("EDFThreadPool"),
       std::unique_ptr<EDFThreadPoolSemaphore> semaphore =
-          makeDefaultSemaphore());
+          makeDefaultSemaphore(),
+      const Options& options = {});
 
   ~EDFThreadPoolExecutor() override;
 
@@ -86,20 +117,28 @@ class EDFThreadPoolExecutor
   void add(Func f, uint64_t deadline) override;
   void add(std::vector<Func> fs, uint64_t deadline) override;
 
+  // Enqueues the batch as one multi-function task with the latest deadline:
+  // one queue push and one semaphore post for the whole batch.
+  void addBatch(span<Func> funcs) override;
+
   size_t getTaskQueueSize() const;
 
+  std::size_t getNumQueueStripes() const;
+
  protected:
   void threadRun(ThreadPtr thread) override;
   void stopThreads(std::size_t numThreads) override;
   std::size_t getPendingTaskCountImpl() const override final;
 
  private:
+  class StripedTaskQueue;
+
   bool tryStopThread(const ThreadPtr& thread, bool isPoison);
 
   void fillTaskInfo(const Task& task, TaskInfo& info);
   void registerTaskEnqueue(const Task& task);
 
-  std::unique_ptr<TaskQueue> taskQueue_;
+  std::unique_ptr<StripedTaskQueue> taskQueue_;
   std::unique_ptr<EDFThreadPoolSemaphore> sem_;
   std::atomic<int> threadsToStop_{0};
 };
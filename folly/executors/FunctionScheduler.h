@@ -49,6 +49,10 @@ namespace folly {
  *       ThreadedRepeatingFunctionRunner.h for a much simpler contract of
  *       "run each function periodically in its own thread".
  *
+ * Note: adding, cancelling and running a function cost O(log n). To schedule
+ *       hundreds of thousands of functions, see
+ *       TimingWheelFunctionScheduler.h.
+ *
  * start() schedules the functions, while shutdown() terminates further
  * scheduling (after any running function terminates).
  */
@@ -16,10 +16,21 @@
 
 #include <folly/executors/IOThreadPoolExecutor.h>
 
+#include <algorithm>
+#include <string>
+
 #include <glog/logging.h>
 
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/Indestructible.h>
+#include <folly/String.h>
+#include <folly/concurrency/CacheLocality.h>
 #include <folly/detail/MemoryIdler.h>
+#include <folly/lang/Assume.h>
 #include <folly/portability/GFlags.h>
+#include <folly/portability/Sched.h>
+#include <folly/portability/Unistd.h>
 
 FOLLY_GFLAGS_DEFINE_bool(
     dynamic_iothreadpoolexecutor,
@@ -87,6 +98,157 @@ class MemoryIdlerTimeout : public AsyncTimeout, public EventBase::LoopCallback {
   size_t num_{0};
 };
 
+// Publishes the idle time of an EventBase that spins before it blocks to the
+// stats of its thread, before every loop.
+class IdleWaitStatsUpdater : public EventBase::LoopCallback {
+ public:
+  IdleWaitStatsUpdater(
+      EventBase* b,
+      relaxed_atomic<uint64_t>& spinTimeNs,
+      relaxed_atomic<uint64_t>& parkTimeNs)
+      : base_(b),
+        spinTimeNs_(spinTimeNs),
+        parkTimeNs_(parkTimeNs),
+        baseSpinTime_(b->getIdleSpinTime()),
+        baseParkTime_(b->getIdleParkTime()) {}
+
+  void runLoopCallback() noexcept override {
+    spinTimeNs_ = (base_->getIdleSpinTime() - baseSpinTime_).count();
+    parkTimeNs_ = (base_->getIdleParkTime() - baseParkTime_).count();
+    base_->runBeforeLoop(this);
+  }
+
+ private:
+  EventBase* base_;
+  relaxed_atomic<uint64_t>& spinTimeNs_;
+  relaxed_atomic<uint64_t>& parkTimeNs_;
+  const std::chrono::nanoseconds baseSpinTime_;
+  const std::chrono::nanoseconds baseParkTime_;
+};
+
+// The CPU topology that thread affinities and locality hints are based on.
+struct Topology {
+  // The CPUs the process may run on, ordered so that any number of the first
+  // of them are split evenly between the last-level caches: the first CPU of
+  // each cache, in CacheLocality order, then the second one, and so on.
+  std::vector<size_t> spreadCpus;
+  // The CPUs the process may run on, by last-level cache, for the caches
+  // that have any.
+  std::vector<std::vector<size_t>> cpusByCache;
+  // Last-level cache of each CPU, as an arbitrary identifier.
+  std::vector<size_t> cacheByCpu;
+  // NUMA node of each CPU; all 0 if the system does not report nodes.
+  std::vector<size_t> nodeByCpu;
+
+  static const Topology& get() {
+    static const Indestructible<Topology> topology{read()};
+    return *topology;
+  }
+
+ private:
+  static Topology read() {
+    const auto& locality = CacheLocality::system();
+    Topology topology;
+    auto numCpus = locality.numCpus;
+    std::vector<size_t> cpusByLocality(numCpus);
+    topology.cacheByCpu.resize(numCpus);
+    topology.nodeByCpu.assign(numCpus, 0);
+    for (size_t cpu = 0; cpu < numCpus; ++cpu) {
+      cpusByLocality[locality.localityIndexByCpu[cpu]] = cpu;
+      topology.cacheByCpu[cpu] = locality.equivClassesByCpu[cpu].back();
+    }
+    auto allowed = allowedCpus(numCpus);
+    for (auto cpu : cpusByLocality) {
+      if (!allowed[cpu]) {
+        continue;
+      }
+      auto& caches = topology.cpusByCache;
+      auto it = std::find_if(caches.begin(), caches.end(), [&](auto& cpus) {
+        return topology.cacheByCpu[cpus[0]] == topology.cacheByCpu[cpu];
+      });
+      if (it == caches.end()) {
+        caches.emplace_back();
+        it = caches.end() - 1;
+      }
+      it->push_back(cpu);
+    }
+    for (size_t i = 0;; ++i) {
+      auto size = topology.spreadCpus.size();
+      for (const auto& cpus : topology.cpusByCache) {
+        if (i < cpus.size()) {
+          topology.spreadCpus.push_back(cpus[i]);
+        }
+      }
+      if (topology.spreadCpus.size() == size) {
+        break;
+      }
+    }
+    // Each node lists its CPUs as ranges, e.g. "0-3,8-11".
+    for (size_t node = 0;; ++node) {
+      std::string cpuList;
+      auto path =
+          to<std::string>("/sys/devices/system/node/node", node, "/cpulist");
+      if (!readFile(path.c_str(), cpuList)) {
+        break;
+      }
+      std::vector<StringPiece> ranges;
+      split(',', trimWhitespace(cpuList), ranges, /* ignoreEmpty */ true);
+      for (auto range : ranges) {
+        auto first = range.split_step('-');
+        auto lo = tryTo<size_t>(first);
+        auto hi = range.empty() ? lo : tryTo<size_t>(range);
+        if (!lo || !hi) {
+          continue;
+        }
+        for (auto cpu = *lo; cpu <= *hi && cpu < numCpus; ++cpu) {
+          topology.nodeByCpu[cpu] = node;
+        }
+      }
+    }
+    return topology;
+  }
+
+  // The CPUs of the process' affinity, e.g. of a restricted cpuset; all of
+  // them if it cannot be read. The affinity of the main thread stands for
+  // the process', as this may run on a thread pinned to fewer CPUs.
+  static std::vector<bool> allowedCpus(size_t numCpus) {
+    std::vector<bool> allowed(numCpus, true);
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(getpid(), sizeof(set), &set) == 0) {
+      for (size_t cpu = 0; cpu < numCpus; ++cpu) {
+        allowed[cpu] = cpu < CPU_SETSIZE && CPU_ISSET(cpu, &set);
+      }
+    }
+    if (std::find(allowed.begin(), allowed.end(), true) == allowed.end()) {
+      // None of the CPUs CacheLocality knows of.
+      allowed.assign(numCpus, true);
+    }
+#endif
+    return allowed;
+  }
+};
+
+void pinCurrentThread(const std::vector<size_t>& cpus) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    // E.g. the CPUs are outside of the process' cpuset.
+    PLOG(WARNING) << "IOThreadPoolExecutor: failed to pin thread to CPUs "
+                  << join(',', cpus);
+  }
+#else
+  (void)cpus;
+#endif
+}
+
 } // namespace
 
 // IOThreadPoolExecutorBase
@@ -125,7 +287,9 @@ IOThreadPoolExecutor::IOThreadPoolExecutor(
       isWaitForAll_(options.waitForAll),
       nextThread_(0),
       eventBaseManager_(ebm),
-      maxReadAtOnce_(options.maxReadAtOnce) {
+      maxReadAtOnce_(options.maxReadAtOnce),
+      waitOptions_(options.waitOptions),
+      threadAffinity_(options.threadAffinity) {
   setNumThreads(maxThreads);
   registerThreadPoolExecutor(this);
   if (options.enableThreadIdCollection) {
@@ -162,6 +326,52 @@ void IOThreadPoolExecutor::add(
   ioThread->eventBase->runInEventBaseThread(std::move(wrappedFunc));
 }
 
+void IOThreadPoolExecutor::addBatch(span<Func> funcs) {
+  if (funcs.empty()) {
+    return;
+  }
+  ensureActiveThreads();
+  std::shared_lock r{threadListLock_};
+  auto& ths = threadList_.get();
+  if (ths.empty()) {
+    throw std::runtime_error("No threads available");
+  }
+
+  auto post = [&](std::shared_ptr<IOThread> ioThread, span<Func> chunk) {
+    std::vector<Task> tasks;
+    tasks.reserve(chunk.size());
+    for (auto& func : chunk) {
+      auto& task = tasks.emplace_back(
+          std::move(func), std::chrono::milliseconds(0), nullptr);
+      registerTaskEnqueue(task);
+    }
+    ioThread->pendingTasks += tasks.size();
+    ioThread->eventBase->runInEventBaseThread(
+        [this, ioThread, tasks = std::move(tasks)]() mutable {
+          for (auto& task : tasks) {
+            runTask(ioThread, std::move(task));
+            ioThread->pendingTasks--;
+          }
+        });
+  };
+
+  auto& me = *thisThread_;
+  if (me && threadList_.contains(me)) {
+    post(me, funcs);
+    return;
+  }
+  auto n = std::min(ths.size(), funcs.size());
+  auto first = nextThread_.fetch_add(n);
+  for (size_t i = 0; i < n; ++i) {
+    // Chunk i gets funcs [i * size / n, (i + 1) * size / n).
+    auto begin = i * funcs.size() / n;
+    auto end = (i + 1) * funcs.size() / n;
+    post(
+        std::static_pointer_cast<IOThread>(ths[(first + i) % ths.size()]),
+        funcs.subspan(begin, end - begin));
+  }
+}
+
 std::shared_ptr<IOThreadPoolExecutor::IOThread>
 IOThreadPoolExecutor::pickThread() {
   auto& me = *thisThread_;
@@ -198,6 +408,65 @@ EventBase* IOThreadPoolExecutor::getEventBase() {
   return pickThread()->eventBase;
 }
 
+std::shared_ptr<IOThreadPoolExecutor::IOThread>
+IOThreadPoolExecutor::pickThread(Locality hint) {
+  const auto& topology = Topology::get();
+  auto numCpus = topology.cacheByCpu.size();
+  auto& ths = threadList_.get();
+  // Closeness of a thread to the hint, from 0 (unrelated) to 3 (same CPU).
+  auto closeness = [&](const IOThread& thread) -> int {
+    if (thread.cpus.empty()) {
+      return 0;
+    }
+    if (hint.cpu_ < numCpus) {
+      if (thread.cpus.size() == 1 && thread.cpus[0] == hint.cpu_) {
+        return 3;
+      }
+      if (topology.cacheByCpu[thread.cpus[0]] ==
+          topology.cacheByCpu[hint.cpu_]) {
+        return 2;
+      }
+      if (topology.nodeByCpu[thread.cpus[0]] ==
+          topology.nodeByCpu[hint.cpu_]) {
+        return 1;
+      }
+    } else if (topology.nodeByCpu[thread.cpus[0]] == hint.node_) {
+      return 1;
+    }
+    return 0;
+  };
+  int best = 0;
+  size_t numBest = 0;
+  for (auto& thread : ths) {
+    auto c = closeness(static_cast<const IOThread&>(*thread));
+    if (c > best) {
+      best = c;
+      numBest = 0;
+    }
+    numBest += c == best;
+  }
+  if (best == 0) {
+    return pickThread();
+  }
+  // Round-robin among the closest threads.
+  auto k = nextThread_++ % numBest;
+  for (auto& thread : ths) {
+    if (closeness(static_cast<const IOThread&>(*thread)) == best && k-- == 0) {
+      return std::static_pointer_cast<IOThread>(thread);
+    }
+  }
+  folly::assume_unreachable();
+}
+
+EventBase* IOThreadPoolExecutor::getEventBase(Locality hint) {
+  ensureMaxActiveThreads();
+  std::shared_lock r{threadListLock_};
+  if (threadList_.get().empty()) {
+    throw std::runtime_error("No threads available");
+  }
+  return pickThread(hint)->eventBase;
+}
+
 std::vector<Executor::KeepAlive<EventBase>>
 IOThreadPoolExecutor::getAllEventBases() {
   ensureMaxActiveThreads();
@@ -215,8 +484,32 @@ EventBaseManager* IOThreadPoolExecutor::getEventBaseManager() {
   return eventBaseManager_;
 }
 
+// threadListLock_ is writelocked
 std::shared_ptr<ThreadPoolExecutor::Thread> IOThreadPoolExecutor::makeThread() {
-  return std::make_shared<IOThread>();
+  auto thread = std::make_shared<IOThread>();
+  if (threadAffinity_ != Options::ThreadAffinity::None) {
+    auto slot = std::find(usedSlots_.begin(), usedSlots_.end(), false) -
+        usedSlots_.begin();
+    if (size_t(slot) == usedSlots_.size()) {
+      usedSlots_.push_back(true);
+    } else {
+      usedSlots_[slot] = true;
+    }
+    thread->slot = slot;
+    thread->cpus = cpusForSlot(slot);
+  }
+  return thread;
+}
+
+// Threads take the lowest free slot, so whatever the number of threads, and
+// however it changed, they are on the first CPUs (or caches) of the spread,
+// and only share them once all are taken.
+std::vector<size_t> IOThreadPoolExecutor::cpusForSlot(size_t slot) const {
+  const auto& topology = Topology::get();
+  if (threadAffinity_ == Options::ThreadAffinity::Cpu) {
+    return {topology.spreadCpus[slot % topology.spreadCpus.size()]};
+  }
+  return topology.cpusByCache[slot % topology.cpusByCache.size()];
 }
 
 void IOThreadPoolExecutor::threadRun(ThreadPtr thread) {
@@ -224,6 +517,9 @@ void IOThreadPoolExecutor::threadRun(ThreadPtr thread) {
 
   const auto& ioThread = *thisThread_ =
       std::static_pointer_cast<IOThread>(thread);
+  if (!ioThread->cpus.empty()) {
+    pinCurrentThread(ioThread->cpus);
+  }
   ioThread->eventBase = eventBaseManager_->getEventBase();
   if (maxReadAtOnce_) {
     ioThread->eventBase->setMaxReadAtOnce(*maxReadAtOnce_);
@@ -242,6 +538,14 @@ void IOThreadPoolExecutor::threadRun(ThreadPtr thread) {
   auto idler = std::make_unique<MemoryIdlerTimeout>(ioThread->eventBase);
   ioThread->eventBase->runBeforeLoop(idler.get());
 
+  std::unique_ptr<IdleWaitStatsUpdater> idleWaitStats;
+  if (waitOptions_) {
+    ioThread->eventBase->setWaitOptions(*waitOptions_);
+    idleWaitStats = std::make_unique<IdleWaitStatsUpdater>(
+        ioThread->eventBase, thread->idleSpinTimeNs, thread->idleParkTimeNs);
+    ioThread->eventBase->runBeforeLoop(idleWaitStats.get());
+  }
+
   ioThread->eventBase->runInEventBaseThread([thread] {
     thread->startupBaton.post();
   });
@@ -257,6 +561,10 @@ void IOThreadPoolExecutor::threadRun(ThreadPtr thread) {
       }
     }
     idler.reset();
+    if (idleWaitStats) {
+      idleWaitStats.reset();
+      ioThread->eventBase->setWaitOptions(WaitOptions().spin_max({}));
+    }
     if (isWaitForAll_) {
       // some tasks, like thrift asynchronous calls, create additional
       // event base hookups, let's wait till all of them complete.
@@ -281,6 +589,9 @@ void IOThreadPoolExecutor::stopThreads(size_t n) {
       handleObserverUnregisterThread(ioThread.get(), *o);
     }
     ioThread->shouldRun = false;
+    if (!ioThread->cpus.empty()) {
+      usedSlots_[ioThread->slot] = false;
+    }
     stoppedThreads.push_back(ioThread);
     std::lock_guard guard(ioThread->eventBaseShutdownMutex_);
     if (ioThread->eventBase) {
@@ -290,6 +601,10 @@ void IOThreadPoolExecutor::stopThreads(size_t n) {
   for (const auto& thread : stoppedThreads) {
     stoppedThreadProcessedTasks_ += thread->processedTasks;
     thread->processedTasks = 0;
+    stoppedThreadIdleSpinTimeNs_ += thread->idleSpinTimeNs;
+    thread->idleSpinTimeNs = 0;
+    stoppedThreadIdleParkTimeNs_ += thread->idleParkTimeNs;
+    thread->idleParkTimeNs = 0;
     stoppedThreads_.add(folly::copy(thread));
     threadList_.remove(thread);
   }
@@ -16,12 +16,16 @@
 
 #pragma once
 
+#include <limits>
+#include <vector>
+
 #include <folly/Portability.h>
 #include <folly/executors/IOExecutor.h>
 #include <folly/executors/QueueObserver.h>
 #include <folly/executors/ThreadPoolExecutor.h>
 #include <folly/io/async/EventBaseManager.h>
 #include <folly/synchronization/RelaxedAtomic.h>
+#include <folly/synchronization/WaitOptions.h>
 
 FOLLY_GFLAGS_DECLARE_int32(folly_iothreadpoolexecutor_max_read_at_once);
 
@@ -76,6 +80,13 @@ class IOThreadPoolExecutorBase
  * @note ::getEventBase() will return an EventBase you can schedule IO work on
  * directly, chosen round-robin.
  *
+ * @note With Options::setThreadAffinity(), each thread is pinned to a CPU or
+ * to the CPUs of a last-level cache, of those the process may run on, split
+ * evenly between the caches, and ::getEventBase(Locality) can pick the
+ * EventBase closest to a CPU or a NUMA node. This lets a server keep an
+ * accepted connection on the core that receives its packets (see
+ * SO_INCOMING_CPU).
+ *
  * @note N.B. For this thread pool, stop() behaves like join() because
  * outstanding tasks belong to the event base and will be executed upon its
  * destruction.
@@ -83,9 +94,19 @@ class IOThreadPoolExecutorBase
 class IOThreadPoolExecutor : public IOThreadPoolExecutorBase {
  public:
   struct Options {
+    enum class ThreadAffinity {
+      // Threads may run on any CPU.
+      None,
+      // Each thread is pinned to one CPU.
+      Cpu,
+      // Each thread is pinned to the CPUs sharing one last-level cache.
+      LastLevelCache,
+    };
+
     Options()
         : waitForAll(false),
           enableThreadIdCollection(false),
+          threadAffinity(ThreadAffinity::None),
           maxReadAtOnce(
               FLAGS_folly_iothreadpoolexecutor_max_read_at_once < 0
                   ? decltype(maxReadAtOnce){}
@@ -104,10 +125,41 @@ class IOThreadPoolExecutor : public IOThreadPoolExecutorBase {
       this->maxReadAtOnce = w;
       return *this;
     }
+    Options& setThreadAffinity(ThreadAffinity a) {
+      this->threadAffinity = a;
+      return *this;
+    }
+    // The event loops poll for events for up to spin_max() before they
+    // block, see EventBase::setWaitOptions(). The time spent spinning and
+    // blocked is reported in PoolStats.
+    Options& setWaitOptions(const WaitOptions& w) {
+      this->waitOptions = w;
+      return *this;
+    }
 
     bool waitForAll;
     bool enableThreadIdCollection;
+    ThreadAffinity threadAffinity;
     std::optional<uint32_t> maxReadAtOnce;
+    std::optional<WaitOptions> waitOptions;
+  };
+
+  // Where a caller would like its EventBase to run.
+  class Locality {
+   public:
+    // A CPU, e.g. the SO_INCOMING_CPU of a socket.
+    static Locality cpu(size_t cpu) { return Locality(cpu, kNone); }
+    static Locality numaNode(size_t node) { return Locality(kNone, node); }
+
+   private:
+    friend class IOThreadPoolExecutor;
+
+    static constexpr size_t kNone = std::numeric_limits<size_t>::max();
+
+    Locality(size_t cpu, size_t node) : cpu_(cpu), node_(node) {}
+
+    size_t cpu_;
+    size_t node_;
   };
 
   explicit IOThreadPoolExecutor(
@@ -133,8 +185,20 @@ class IOThreadPoolExecutor : public IOThreadPoolExecutorBase {
       std::chrono::milliseconds expiration,
       Func expireCallback = nullptr) override;
 
+  // Posts the batch to the event bases in contiguous chunks, one
+  // runInEventBaseThread() per thread used. From a thread of this pool, the
+  // whole batch runs on that thread, as add() would.
+  void addBatch(span<Func> funcs) override;
+
   folly::EventBase* getEventBase() override;
 
+  // Returns the EventBase of a thread pinned closest to the hint: on the
+  // same CPU, else on the same last-level cache, else on the same NUMA
+  // node. Among equally close threads, and when no thread is close (or
+  // threads are not pinned), picks round-robin like getEventBase(). Starts
+  // all the threads, like getAllEventBases().
+  folly::EventBase* getEventBase(Locality hint);
+
   // Ensures that the maximum number of active threads is running and returns
   // the EventBase associated with each thread.
   std::vector<folly::Executor::KeepAlive<folly::EventBase>> getAllEventBases()
@@ -155,6 +219,10 @@ class IOThreadPoolExecutor : public IOThreadPoolExecutorBase {
     std::atomic<size_t> pendingTasks{0};
     folly::EventBase* eventBase{nullptr};
     std::mutex eventBaseShutdownMutex_;
+    // Set with a thread affinity: the thread's position in the pool, and
+    // the CPUs it is pinned to.
+    size_t slot{0};
+    std::vector<size_t> cpus;
   };
 
   void handleObserverRegisterThread(
@@ -165,6 +233,8 @@ class IOThreadPoolExecutor : public IOThreadPoolExecutorBase {
  private:
   ThreadPtr makeThread() override;
   std::shared_ptr<IOThread> pickThread();
+  std::shared_ptr<IOThread> pickThread(Locality hint);
+  std::vector<size_t> cpusForSlot(size_t slot) const;
   void threadRun(ThreadPtr thread) override;
   void stopThreads(size_t n) override;
   size_t getPendingTaskCountImpl() const override final;
@@ -174,6 +244,10 @@ class IOThreadPoolExecutor : public IOThreadPoolExecutorBase {
   folly::EventBaseManager* eventBaseManager_;
   std::unique_ptr<ThreadIdWorkerProvider> threadIdCollector_;
   const std::optional<uint32_t> maxReadAtOnce_;
+  const std::optional<WaitOptions> waitOptions_;
+  const Options::ThreadAffinity threadAffinity_;
+  // Slots of the running threads; guarded by threadListLock_.
+  std::vector<bool> usedSlots_;
 };
 
 FOLLY_POP_WARNING
@@ -59,6 +59,15 @@ std::shared_ptr<StrandContext> StrandContext::create() {
   return std::make_shared<StrandContext>(PrivateTag{});
 }
 
+std::shared_ptr<StrandContext> StrandContext::create(const Options& options) {
+  return std::make_shared<StrandContext>(PrivateTag{}, options);
+}
+
+StrandContext::StrandContext(PrivateTag, const Options& options)
+    : options_(options) {
+  CHECK_GE(options_.maxBatchSize, 1);
+}
+
 void StrandContext::add(Func func, Executor::KeepAlive<> executor) {
   addImpl(
       QueueItem{
@@ -95,20 +104,27 @@ void StrandContext::addImpl(QueueItem&& item) {
 
 void StrandContext::executeNext(
     std::shared_ptr<StrandContext> thisPtr) noexcept {
-  // Put a cap on the number of items we process in one batch before
-  // rescheduling on to the executor to avoid starvation of other
+  // Put a cap on the number of items (and the time) we process in one batch
+  // before rescheduling on to the executor to avoid starvation of other
   // items queued to the current executor.
-  const std::size_t maxItemsToProcessSynchronously = 32;
+  const auto& options = thisPtr->options_;
+  const bool hasDeadline = options.maxBatchTime.count() > 0;
+  const auto deadline = hasDeadline
+      ? std::chrono::steady_clock::now() + options.maxBatchTime
+      : std::chrono::steady_clock::time_point::max();
 
   std::size_t queueSize = thisPtr->scheduled_.load(std::memory_order_acquire);
   DCHECK(queueSize != 0u);
 
   const QueueItem* nextItem = nullptr;
+  // The priority the batch was scheduled with.
+  const auto batchPriority = thisPtr->queue_.try_peek()->priority.value_or(
+      Executor::MID_PRI);
 
   std::size_t pendingCount = 0;
   {
     RequestContextSaverScopeGuard ctxGuard;
-    for (std::size_t i = 0; i < maxItemsToProcessSynchronously; ++i) {
+    for (std::size_t i = 0; i < options.maxBatchSize; ++i) {
       QueueItem item = thisPtr->queue_.dequeue();
       RequestContext::setContext(std::move(item.requestCtx));
       Executor::invokeCatchingExns(
@@ -132,10 +148,14 @@ void StrandContext::executeNext(
       nextItem = thisPtr->queue_.try_peek();
       DCHECK(nextItem != nullptr);
 
-      // Check if the next item has the same executor.
-      // If so we'll go around the loop again, otherwise
-      // we'll dispatch to the other executor and return.
-      if (nextItem->executor.get() != item.executor.get()) {
+      // Check if the next item has the same executor, and can run at the
+      // batch's priority. If so we'll go around the loop again, otherwise
+      // we'll dispatch it to its executor and return.
+      if (nextItem->executor.get() != item.executor.get() ||
+          nextItem->priority.value_or(Executor::MID_PRI) < batchPriority) {
+        break;
+      }
+      if (hasDeadline && std::chrono::steady_clock::now() >= deadline) {
         break;
       }
     }
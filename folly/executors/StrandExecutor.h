@@ -17,6 +17,7 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 
 #include <folly/Optional.h>
@@ -76,11 +77,24 @@ class StrandExecutor;
 //
 class StrandContext : public std::enable_shared_from_this<StrandContext> {
  public:
+  // Limits on the functions run in one task on the parent executor, before
+  // the strand yields the parent's thread to other work. Consecutive
+  // functions only share a task if they are added for the same executor,
+  // and the later one does not have a lower priority: a function added with
+  // a low priority is always scheduled at that priority.
+  struct Options {
+    // Must be at least 1.
+    std::size_t maxBatchSize = 32;
+    // No limit if zero.
+    std::chrono::microseconds maxBatchTime{0};
+  };
+
   // Create a new StrandContext object. This will allow scheduling work
   // that will execute at most one task at a time but delegate the actual
   // execution to an execution context associated with each particular
   // function.
   static std::shared_ptr<StrandContext> create();
+  static std::shared_ptr<StrandContext> create(const Options& options);
 
   // Schedule 'func()' to be called on 'executor' after all prior functions
   // scheduled to this context have completed.
@@ -103,6 +117,7 @@ class StrandContext : public std::enable_shared_from_this<StrandContext> {
   // private constructor. Try to enforce this by forcing use of a private
   // tag-type as a parameter.
   explicit StrandContext(PrivateTag) {}
+  StrandContext(PrivateTag, const Options& options);
 
  private:
   struct QueueItem {
@@ -117,6 +132,7 @@ class StrandContext : public std::enable_shared_from_this<StrandContext> {
   static void dispatchFrontQueueItem(
       std::shared_ptr<StrandContext> thisPtr) noexcept;
 
+  const Options options_;
   std::atomic<std::size_t> scheduled_{0};
   UMPSCQueue<QueueItem, /*MayBlock=*/false, /*LgSegmentSize=*/6> queue_;
 };
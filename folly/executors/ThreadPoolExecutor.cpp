@@ -21,6 +21,7 @@
 #include <folly/concurrency/ProcessLocalUniqueId.h>
 #include <folly/executors/GlobalThreadPoolList.h>
 #include <folly/portability/PThread.h>
+#include <folly/portability/Time.h>
 #include <folly/synchronization/AsymmetricThreadFence.h>
 #include <folly/tracing/StaticTracepoint.h>
 
@@ -95,6 +96,16 @@ ThreadPoolExecutor::Task::Task(
   }
   info.enqueueTime = task.enqueueTime_;
   info.taskId = task.taskId_;
+  info.context = task.context_.get();
+}
+
+/* static */ std::chrono::nanoseconds
+ThreadPoolExecutor::currentThreadCpuTime() {
+  timespec tp{};
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &tp);
+#endif
+  return std::chrono::nanoseconds(tp.tv_nsec) + std::chrono::seconds(tp.tv_sec);
 }
 
 void ThreadPoolExecutor::registerTaskEnqueue(const Task& task) {
@@ -117,6 +128,8 @@ void ThreadPoolExecutor::runTask(const ThreadPtr& thread, Task&& task) {
   ProcessedTaskInfo taskInfo;
   fillTaskInfo(task, taskInfo);
   taskInfo.waitTime = startTime - task.enqueueTime_;
+  const bool measureCpuTime =
+      taskCpuTimeEnabled_.load(std::memory_order_relaxed);
   FOLLY_SDT(
       folly,
       thread_pool_executor_task_dequeued,
@@ -126,6 +139,9 @@ void ThreadPoolExecutor::runTask(const ThreadPtr& thread, Task&& task) {
       taskInfo.waitTime.count(),
       taskInfo.taskId);
   forEachTaskObserver([&](auto& observer) { observer.taskDequeued(taskInfo); });
+  taskInfo.context = nullptr; // See TaskInfo::context.
+  auto startCpuTime =
+      measureCpuTime ? currentThreadCpuTime() : std::chrono::nanoseconds(0);
 
   {
     folly::RequestContextScopeGuard rctx(task.context_);
@@ -148,6 +164,9 @@ void ThreadPoolExecutor::runTask(const ThreadPtr& thread, Task&& task) {
   }
   if (!taskInfo.expired) {
     taskInfo.runTime = std::chrono::steady_clock::now() - startTime;
+    if (measureCpuTime) {
+      taskInfo.cpuTime = currentThreadCpuTime() - startCpuTime;
+    }
   }
 
   // Times in this USDT use granularity of std::chrono::steady_clock::duration,
@@ -321,6 +340,8 @@ ThreadPoolExecutor::PoolStats ThreadPoolExecutor::getPoolStats() const {
   size_t activeTasks = 0;
   size_t idleAlive = 0;
   uint64_t processedTasks = stoppedThreadProcessedTasks_;
+  uint64_t idleSpinTimeNs = stoppedThreadIdleSpinTimeNs_;
+  uint64_t idleParkTimeNs = stoppedThreadIdleParkTimeNs_;
   for (const auto& thread : threadList_.get()) {
     if (thread->idle.load(std::memory_order_relaxed)) {
       const std::chrono::nanoseconds idleTime =
@@ -331,10 +352,14 @@ ThreadPoolExecutor::PoolStats ThreadPoolExecutor::getPoolStats() const {
       activeTasks++;
     }
     processedTasks += thread->processedTasks;
+    idleSpinTimeNs += thread->idleSpinTimeNs;
+    idleParkTimeNs += thread->idleParkTimeNs;
   }
   stats.pendingTaskCount = getPendingTaskCountImpl();
   stats.totalTaskCount = stats.pendingTaskCount + activeTasks;
   stats.processedTaskCount = processedTasks;
+  stats.idleSpinTime = std::chrono::nanoseconds(idleSpinTimeNs);
+  stats.idleParkTime = std::chrono::nanoseconds(idleParkTimeNs);
 
   stats.threadCount = maxThreads_.load(std::memory_order_relaxed);
   stats.activeThreadCount =
@@ -537,7 +562,7 @@ void ThreadPoolExecutor::ensureActiveThreads() {
 
   // Fast path assuming we are already at max threads.
   auto active = activeThreads_.load(std::memory_order_relaxed);
-  auto total = maxThreads_.load(std::memory_order_relaxed);
+  auto total = maxActiveThreads();
 
   if (active >= total) {
     return;
@@ -546,7 +571,7 @@ void ThreadPoolExecutor::ensureActiveThreads() {
   std::unique_lock w{threadListLock_};
   // Double check behind lock.
   active = activeThreads_.load(std::memory_order_relaxed);
-  total = maxThreads_.load(std::memory_order_relaxed);
+  total = maxActiveThreads();
   if (active >= total) {
     return;
   }
@@ -555,8 +580,7 @@ void ThreadPoolExecutor::ensureActiveThreads() {
 }
 
 void ThreadPoolExecutor::ensureMaxActiveThreads() {
-  while (activeThreads_.load(std::memory_order_relaxed) <
-         maxThreads_.load(std::memory_order_relaxed)) {
+  while (activeThreads_.load(std::memory_order_relaxed) < maxActiveThreads()) {
     ensureActiveThreads();
   }
 }
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <algorithm>
+#include <limits>
 #include <mutex>
 #include <queue>
 
@@ -124,10 +125,16 @@ class ThreadPoolExecutor : public DefaultKeepAliveExecutor {
           pendingTaskCount(0),
           totalTaskCount(0),
           processedTaskCount(0),
-          maxIdleTime(0) {}
+          maxIdleTime(0),
+          idleSpinTime(0),
+          idleParkTime(0) {}
     size_t threadCount, idleThreadCount, activeThreadCount;
     uint64_t pendingTaskCount, totalTaskCount, processedTaskCount;
     std::chrono::nanoseconds maxIdleTime;
+    // Time the threads spent waiting for work, spinning and blocked
+    // respectively. Only measured by pools configured to spin before they
+    // block (see their Options::setWaitOptions()).
+    std::chrono::nanoseconds idleSpinTime, idleParkTime;
   };
 
   PoolStats getPoolStats() const;
@@ -178,6 +185,9 @@ class ThreadPoolExecutor : public DefaultKeepAliveExecutor {
     uint64_t requestId = 0;
     std::chrono::steady_clock::time_point enqueueTime;
     uint64_t taskId;
+    // The RequestContext the task was added with, if any. Only valid in
+    // taskEnqueued() and taskDequeued().
+    const RequestContext* context = nullptr;
   };
 
   struct DequeuedTaskInfo : TaskInfo {
@@ -187,6 +197,9 @@ class ThreadPoolExecutor : public DefaultKeepAliveExecutor {
   struct ProcessedTaskInfo : DequeuedTaskInfo {
     bool expired = false;
     std::chrono::nanoseconds runTime{0};
+    // CPU time of the thread while running the task; only measured after
+    // enableTaskCpuTime().
+    std::chrono::nanoseconds cpuTime{0};
   };
 
   class TaskObserver {
@@ -217,6 +230,15 @@ class ThreadPoolExecutor : public DefaultKeepAliveExecutor {
     threadTimeout_ = timeout;
   }
 
+  /**
+   * Measures the thread CPU time of every task into
+   * ProcessedTaskInfo::cpuTime, at the cost of two clock_gettime() calls per
+   * task. Cannot be disabled.
+   */
+  void enableTaskCpuTime() {
+    taskCpuTimeEnabled_.store(true, std::memory_order_relaxed);
+  }
+
  protected:
   // Prerequisite: threadListLock_ writelocked
   void addThreads(size_t n);
@@ -244,6 +266,11 @@ class ThreadPoolExecutor : public DefaultKeepAliveExecutor {
     // the thread stops.
     folly::relaxed_atomic<uint64_t> processedTasks;
 
+    // Nanoseconds spent waiting for work, spinning and blocked respectively,
+    // see PoolStats.  Reset to zero when the thread stops.
+    folly::relaxed_atomic<uint64_t> idleSpinTimeNs{0};
+    folly::relaxed_atomic<uint64_t> idleParkTimeNs{0};
+
     std::thread handle;
     std::atomic<bool> idle;
     folly::AtomicStruct<std::chrono::steady_clock::time_point> lastActiveTime;
@@ -279,6 +306,8 @@ class ThreadPoolExecutor : public DefaultKeepAliveExecutor {
   };
 
   static void fillTaskInfo(const Task& task, TaskInfo& info);
+  // CPU time used by the calling thread, or 0 if that is not supported.
+  static std::chrono::nanoseconds currentThreadCpuTime();
   void registerTaskEnqueue(const Task& task);
   template <class F>
   void forEachTaskObserver(F&& f) const {
@@ -401,14 +430,27 @@ class ThreadPoolExecutor : public DefaultKeepAliveExecutor {
   std::atomic<size_t> maxThreads_{0};
   std::atomic<size_t> minThreads_{0};
   std::atomic<size_t> activeThreads_{0};
+  // Soft bound on activeThreads_ below maxThreads_, that ensureActiveThreads()
+  // does not start threads past; set by adaptive sizing.
+  std::atomic<size_t> activeThreadsCap_{std::numeric_limits<size_t>::max()};
+
+  size_t maxActiveThreads() const {
+    return std::min(
+        maxThreads_.load(std::memory_order_relaxed),
+        activeThreadsCap_.load(std::memory_order_relaxed));
+  }
 
   std::atomic<size_t> threadsToJoin_{0};
   std::atomic<std::chrono::milliseconds> threadTimeout_;
+  std::atomic<bool> taskCpuTimeEnabled_{false};
 
   // Number of tasks processed by stopped or joined threads.  Updated
   // when a thread stops, which preceeds joining.  Requires holding
   // the threadListLock_.
   uint64_t stoppedThreadProcessedTasks_{0};
+  // Likewise for Thread::idleSpinTimeNs and Thread::idleParkTimeNs.
+  uint64_t stoppedThreadIdleSpinTimeNs_{0};
+  uint64_t stoppedThreadIdleParkTimeNs_{0};
 
   bool joinKeepAliveOnce() {
     if (!std::exchange(keepAliveJoined_, true)) {
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/ThreadPoolTaskStats.h>
+
+#include <glog/logging.h>
+
+namespace folly {
+
+namespace {
+
+using RequestTag = ImmutableRequestData<std::string>;
+
+const RequestToken& requestTagToken() {
+  static const RequestToken token("folly::ThreadPoolTaskStats::tag");
+  return token;
+}
+
+} // namespace
+
+class ThreadPoolTaskStats::Observer : public ThreadPoolExecutor::TaskObserver {
+ public:
+  explicit Observer(std::shared_ptr<ThreadPoolTaskStats> stats)
+      : stats_(std::move(stats)) {}
+
+  void taskDequeued(
+      const ThreadPoolExecutor::DequeuedTaskInfo& info) noexcept override {
+    *stats_->currentTag_ = stats_->getTagStats(info.context);
+  }
+
+  void taskProcessed(
+      const ThreadPoolExecutor::ProcessedTaskInfo& info) noexcept override {
+    stats_->all_.add(info);
+    if (auto tag = std::exchange(*stats_->currentTag_, nullptr)) {
+      tag->add(info);
+    }
+  }
+
+ private:
+  const std::shared_ptr<ThreadPoolTaskStats> stats_;
+};
+
+/* static */ std::shared_ptr<ThreadPoolTaskStats> ThreadPoolTaskStats::attach(
+    ThreadPoolExecutor& executor) {
+  auto stats = std::make_shared<ThreadPoolTaskStats>();
+  executor.enableTaskCpuTime();
+  executor.addTaskObserver(std::make_unique<Observer>(stats));
+  return stats;
+}
+
+/* static */ void ThreadPoolTaskStats::setRequestTag(std::string tag) {
+  auto context = RequestContext::get();
+  CHECK(context) << "No RequestContext to tag";
+  context->overwriteContextData(
+      requestTagToken(), std::make_unique<RequestTag>(std::move(tag)));
+}
+
+/* static */ const std::string* ThreadPoolTaskStats::getRequestTag(
+    const RequestContext& context) {
+  // Only setRequestTag() stores data under this token.
+  auto data = static_cast<const RequestTag*>(
+      context.getContextData(requestTagToken()));
+  return data ? &data->value() : nullptr;
+}
+
+ThreadPoolTaskStats::Estimates ThreadPoolTaskStats::getEstimates(
+    Range<const double*> quantiles) {
+  return all_.estimate(quantiles);
+}
+
+std::vector<std::pair<std::string, ThreadPoolTaskStats::Estimates>>
+ThreadPoolTaskStats::getTagEstimates(Range<const double*> quantiles) {
+  std::vector<std::pair<std::string, Estimates>> result;
+  auto tags = tags_.rlock();
+  result.reserve(tags->size());
+  for (auto& [tag, stats] : *tags) {
+    result.emplace_back(tag, stats->estimate(quantiles));
+  }
+  return result;
+}
+
+ThreadPoolTaskStats::Stats* ThreadPoolTaskStats::getTagStats(
+    const RequestContext* context) {
+  if (context == nullptr) {
+    return nullptr;
+  }
+  auto tag = getRequestTag(*context);
+  if (tag == nullptr) {
+    return nullptr;
+  }
+  {
+    auto tags = tags_.rlock();
+    if (auto it = tags->find(*tag); it != tags->end()) {
+      return it->second.get();
+    }
+  }
+  auto tags = tags_.wlock();
+  auto& stats = (*tags)[*tag];
+  if (!stats) {
+    stats = std::make_unique<Stats>();
+  }
+  return stats.get();
+}
+
+void ThreadPoolTaskStats::Stats::add(
+    const ThreadPoolExecutor::ProcessedTaskInfo& info) {
+  auto now = info.enqueueTime + info.waitTime + info.runTime;
+  waitTime.addValue(info.waitTime.count(), now);
+  if (!info.expired) {
+    runTime.addValue(info.runTime.count(), now);
+    cpuTime.addValue(info.cpuTime.count(), now);
+  }
+}
+
+ThreadPoolTaskStats::Estimates ThreadPoolTaskStats::Stats::estimate(
+    Range<const double*> quantiles) {
+  waitTime.flush();
+  runTime.flush();
+  cpuTime.flush();
+  return {
+      waitTime.estimateQuantiles(quantiles),
+      runTime.estimateQuantiles(quantiles),
+      cpuTime.estimateQuantiles(quantiles)};
+}
+
+} // namespace folly
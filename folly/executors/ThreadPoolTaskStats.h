@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
+#include <folly/container/F14Map.h>
+#include <folly/executors/ThreadPoolExecutor.h>
+#include <folly/stats/QuantileEstimator.h>
+
+namespace folly {
+
+/**
+ * Aggregates the queue wait, wall time and thread CPU time of the tasks run
+ * by a ThreadPoolExecutor, for the whole pool and per request tag, into
+ * quantile estimators. This answers which kinds of requests keep the pool
+ * busy, or wait the longest for it.
+ *
+ * A request tag is a string carried by the RequestContext, set with
+ * setRequestTag(). Tasks added to the pool under a context with a tag are
+ * counted both in the pool's estimates and in the tag's.
+ *
+ * Recording a task costs two clock_gettime() calls (see
+ * ThreadPoolExecutor::enableTaskCpuTime()), a lookup of the tag in the
+ * context and in a map, and three appends to CPU-local buffers, which are
+ * merged into the estimators at most once a second or when read.
+ *
+ * Usage:
+ *
+ *   auto stats = ThreadPoolTaskStats::attach(executor);
+ *   ...
+ *   RequestContextScopeGuard guard;
+ *   ThreadPoolTaskStats::setRequestTag("getUser");
+ *   executor.add(...);
+ *   ...
+ *   for (auto& [tag, estimates] : stats->getTagEstimates(quantiles)) {
+ *     ...
+ *   }
+ */
+class ThreadPoolTaskStats {
+ public:
+  /// All times are in nanoseconds. Expired tasks only count towards
+  /// waitTime.
+  struct Estimates {
+    QuantileEstimates waitTime;
+    QuantileEstimates runTime;
+    QuantileEstimates cpuTime;
+  };
+
+  /**
+   * Starts aggregating the tasks of executor, and enables its task CPU time
+   * measurement. The returned object may outlive executor. There is no way
+   * to detach it, as task observers cannot be removed.
+   */
+  static std::shared_ptr<ThreadPoolTaskStats> attach(
+      ThreadPoolExecutor& executor);
+
+  /// Tags the current RequestContext, which must exist, replacing any
+  /// previous tag.
+  static void setRequestTag(std::string tag);
+
+  /// Returns the tag of the given context, or nullptr.
+  static const std::string* FOLLY_NULLABLE
+  getRequestTag(const RequestContext& context);
+
+  Estimates getEstimates(Range<const double*> quantiles);
+
+  std::vector<std::pair<std::string, Estimates>> getTagEstimates(
+      Range<const double*> quantiles);
+
+ private:
+  class Observer;
+
+  struct Stats {
+    void add(const ThreadPoolExecutor::ProcessedTaskInfo& info);
+    Estimates estimate(Range<const double*> quantiles);
+
+    SimpleQuantileEstimator<> waitTime;
+    SimpleQuantileEstimator<> runTime;
+    SimpleQuantileEstimator<> cpuTime;
+  };
+
+  Stats* FOLLY_NULLABLE getTagStats(const RequestContext* context);
+
+  Stats all_;
+  // Stats are recorded into under the read lock, and never freed until
+  // destruction.
+  Synchronized<F14FastMap<std::string, std::unique_ptr<Stats>>> tags_;
+  // Tag of the task the thread is running, from taskDequeued() to
+  // taskProcessed(); the context is gone by then.
+  ThreadLocal<Stats*> currentTag_;
+};
+
+} // namespace folly
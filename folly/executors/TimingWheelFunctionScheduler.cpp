@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/TimingWheelFunctionScheduler.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <glog/logging.h>
+
+#include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/lang/Bits.h>
+#include <folly/system/ThreadName.h>
+
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
+namespace folly {
+
+namespace {
+
+constexpr uint64_t kNever = std::numeric_limits<uint64_t>::max();
+
+} // namespace
+
+void TimingWheelFunctionScheduler::Task::run() {
+  if (canceled.load(std::memory_order_relaxed)) {
+    return;
+  }
+  try {
+    cb();
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Error running the scheduled function: "
+               << exceptionStr(ex);
+  }
+}
+
+TimingWheelFunctionScheduler::TimingWheelFunctionScheduler()
+    : TimingWheelFunctionScheduler(Options()) {}
+
+TimingWheelFunctionScheduler::TimingWheelFunctionScheduler(
+    const Options& options, Executor::KeepAlive<> executor)
+    : options_(options), executor_(std::move(executor)) {
+  if (options_.tick() <= microseconds::zero()) {
+    throw std::invalid_argument(
+        "TimingWheelFunctionScheduler: tick must be positive");
+  }
+}
+
+TimingWheelFunctionScheduler::~TimingWheelFunctionScheduler() {
+  // make sure to stop the thread (if it's running)
+  shutdown();
+}
+
+TimingWheelFunctionScheduler::FunctionId
+TimingWheelFunctionScheduler::addFunction(
+    Function<void()>&& cb, microseconds interval, microseconds startDelay) {
+  if (interval <= microseconds::zero()) {
+    throw std::invalid_argument(
+        "TimingWheelFunctionScheduler: time interval must be positive");
+  }
+  return add(std::move(cb), interval, startDelay, false);
+}
+
+TimingWheelFunctionScheduler::FunctionId
+TimingWheelFunctionScheduler::addFunctionOnce(
+    Function<void()>&& cb, microseconds startDelay) {
+  return add(std::move(cb), microseconds::zero(), startDelay, true);
+}
+
+TimingWheelFunctionScheduler::FunctionId TimingWheelFunctionScheduler::add(
+    Function<void()>&& cb,
+    microseconds interval,
+    microseconds startDelay,
+    bool runOnce) {
+  if (!cb) {
+    throw std::invalid_argument(
+        "TimingWheelFunctionScheduler: Scheduled function must be set");
+  }
+  if (startDelay < microseconds::zero()) {
+    throw std::invalid_argument(
+        "TimingWheelFunctionScheduler: start delay must be non-negative");
+  }
+  auto intervalTicks = runOnce ? 0 : std::max<uint64_t>(toTicks(interval), 1);
+  auto delayTicks = toTicks(startDelay);
+
+  std::unique_lock l(mutex_);
+  auto id = nextId_++;
+  auto& entry = *functions_
+                     .emplace(
+                         id,
+                         std::make_unique<Entry>(
+                             id, std::move(cb), intervalTicks, delayTicks))
+                     .first->second;
+  if (running_) {
+    schedule(entry);
+  }
+  return id;
+}
+
+bool TimingWheelFunctionScheduler::cancelFunction(FunctionId id) {
+  std::unique_lock l(mutex_);
+  auto it = functions_.find(id);
+  if (it == functions_.end()) {
+    return false;
+  }
+  // Destroying the entry unlinks it from its slot. A run that is due but not
+  // started yet sees the flag.
+  it->second->task->canceled.store(true, std::memory_order_relaxed);
+  functions_.erase(it);
+  return true;
+}
+
+void TimingWheelFunctionScheduler::cancelAllFunctions() {
+  std::unique_lock l(mutex_);
+  for (auto& [_, entry] : functions_) {
+    entry->task->canceled.store(true, std::memory_order_relaxed);
+  }
+  functions_.clear();
+  clearWheel();
+}
+
+size_t TimingWheelFunctionScheduler::numFunctions() const {
+  std::unique_lock l(mutex_);
+  return functions_.size();
+}
+
+bool TimingWheelFunctionScheduler::start() {
+  std::unique_lock l(mutex_);
+  if (running_) {
+    return false;
+  }
+
+  VLOG(1) << "Starting TimingWheelFunctionScheduler with "
+          << functions_.size() << " functions.";
+  // Rebase the wheel on now, and schedule the first run of all functions
+  // again: this is needed since one can shutdown() and start() again.
+  base_ = steady_clock::now();
+  curTick_ = 0;
+  wakeTick_ = 0;
+  clearWheel();
+  for (auto& [_, entry] : functions_) {
+    schedule(*entry);
+  }
+
+  thread_ = std::thread([&] { this->run(); });
+  running_ = true;
+
+  return true;
+}
+
+bool TimingWheelFunctionScheduler::shutdown() {
+  {
+    std::lock_guard g(mutex_);
+    if (!running_) {
+      return false;
+    }
+
+    running_ = false;
+    runningCondvar_.notify_one();
+  }
+  thread_.join();
+  return true;
+}
+
+void TimingWheelFunctionScheduler::setThreadName(StringPiece threadName) {
+  std::unique_lock l(mutex_);
+  threadName_ = threadName.str();
+}
+
+uint64_t TimingWheelFunctionScheduler::toTicks(microseconds duration) const {
+  auto tick = options_.tick().count();
+  return static_cast<uint64_t>((duration.count() + tick - 1) / tick);
+}
+
+uint64_t TimingWheelFunctionScheduler::nowTick() const {
+  return static_cast<uint64_t>((steady_clock::now() - base_) / options_.tick());
+}
+
+void TimingWheelFunctionScheduler::schedule(Entry& entry) {
+  // Tick t begins at base_ + t * tick, so rounding the current time up too
+  // keeps the first run from starting before its delay has elapsed.
+  entry.expireTick =
+      toTicks(std::chrono::ceil<microseconds>(steady_clock::now() - base_)) +
+      entry.delayTicks;
+  if (options_.startJitter() && entry.intervalTicks > 1) {
+    entry.expireTick += Random::rand64(entry.intervalTicks);
+  }
+  insert(entry);
+  if (entry.expireTick < wakeTick_) {
+    // Signal the running thread to wake up and see if it needs to change
+    // its current scheduling decision.
+    runningCondvar_.notify_one();
+  }
+}
+
+void TimingWheelFunctionScheduler::insert(Entry& entry) {
+  // Entries that are late go into the slot of the next tick; those beyond
+  // the wheel go into its last slot, and are placed again from there when
+  // it expires.
+  auto expire = std::max(entry.expireTick, curTick_);
+  auto delta = std::min(expire - curTick_, kMaxTicks - 1);
+  expire = curTick_ + delta;
+
+  size_t level = 0;
+  while (delta >> ((level + 1) * kSlotBits)) {
+    ++level;
+  }
+  auto index = (expire >> (level * kSlotBits)) & kSlotMask;
+  wheel_[level][index].push_back(entry);
+  if (level == 0) {
+    bitmap_[index / 64] |= uint64_t(1) << (index % 64);
+  }
+}
+
+void TimingWheelFunctionScheduler::cascade(size_t level, uint64_t tick) {
+  auto index = (tick >> (level * kSlotBits)) & kSlotMask;
+  Slot slot;
+  slot.swap(wheel_[level][index]);
+  while (!slot.empty()) {
+    auto& entry = slot.front();
+    slot.pop_front();
+    insert(entry);
+  }
+}
+
+void TimingWheelFunctionScheduler::expire(
+    uint64_t tick, std::vector<std::shared_ptr<Task>>& due) {
+  auto index = tick & kSlotMask;
+  bitmap_[index / 64] &= ~(uint64_t(1) << (index % 64));
+  Slot slot;
+  slot.swap(wheel_[0][index]);
+  // Place rescheduled entries relative to the next tick, so that none goes
+  // back into this slot.
+  curTick_ = tick + 1;
+  while (!slot.empty()) {
+    auto& entry = slot.front();
+    slot.pop_front();
+    if (entry.expireTick > tick) {
+      insert(entry);
+      continue;
+    }
+    due.push_back(entry.task);
+    if (entry.intervalTicks == 0) {
+      functions_.erase(entry.id);
+      continue;
+    }
+    // Keep the phase of the function, and skip the runs that were missed.
+    auto missed = (tick - entry.expireTick) / entry.intervalTicks;
+    entry.expireTick += (missed + 1) * entry.intervalTicks;
+    insert(entry);
+  }
+}
+
+uint64_t TimingWheelFunctionScheduler::nextTick(uint64_t tick) const {
+  auto index = tick & kSlotMask;
+  if (index == 0) {
+    return tick;
+  }
+  for (auto i = index; i < kSlots; i = (i | 63) + 1) {
+    auto word = bitmap_[i / 64] & (~uint64_t(0) << (i % 64));
+    if (word) {
+      return tick + (i / 64 * 64 + findFirstSet(word) - 1 - index);
+    }
+  }
+  return (tick | kSlotMask) + 1;
+}
+
+uint64_t TimingWheelFunctionScheduler::advance(
+    uint64_t now, std::vector<std::shared_ptr<Task>>& due) {
+  if (functions_.empty()) {
+    // The wheel is empty too, so there is nothing to cascade.
+    curTick_ = std::max(curTick_, now + 1);
+    return kNever;
+  }
+
+  // Only ticks that have begun are processed: curTick_ is already past now
+  // when the thread runs again within the tick it last processed.
+  for (auto tick = nextTick(curTick_); tick <= now; tick = nextTick(curTick_)) {
+    curTick_ = tick;
+    auto index = tick & kSlotMask;
+    if (index == 0) {
+      // The first level wrapped around: move the entries of the next slot of
+      // each level that wrapped around too down the wheel.
+      for (size_t level = 1; level < kLevels; ++level) {
+        cascade(level, tick);
+        if ((tick >> (level * kSlotBits)) & kSlotMask) {
+          break;
+        }
+      }
+    }
+    if (bitmap_[index / 64] & (uint64_t(1) << (index % 64))) {
+      expire(tick, due);
+    }
+    curTick_ = tick + 1;
+  }
+  return nextTick(curTick_);
+}
+
+void TimingWheelFunctionScheduler::clearWheel() {
+  for (auto& level : wheel_) {
+    for (auto& slot : level) {
+      slot.clear();
+    }
+  }
+  bitmap_.fill(0);
+}
+
+void TimingWheelFunctionScheduler::run() {
+  std::unique_lock lock(mutex_);
+
+  folly::setThreadName(threadName_);
+
+  std::vector<std::shared_ptr<Task>> due;
+  while (running_) {
+    wakeTick_ = advance(nowTick(), due);
+    if (!due.empty()) {
+      // Release the lock while we invoke or dispatch the user's functions
+      lock.unlock();
+      for (auto& task : due) {
+        if (!executor_) {
+          task->run();
+        } else if (!task->running.exchange(true)) {
+          executor_->add([task = std::move(task)] {
+            task->run();
+            task->running.store(false);
+          });
+        }
+      }
+      due.clear();
+      lock.lock();
+      continue;
+    }
+
+    if (wakeTick_ == kNever) {
+      runningCondvar_.wait(lock);
+    } else {
+      runningCondvar_.wait_until(
+          lock, base_ + options_.tick() * static_cast<int64_t>(wakeTick_));
+    }
+  }
+}
+
+} // namespace folly
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/Executor.h>
+#include <folly/Function.h>
+#include <folly/Range.h>
+#include <folly/container/F14Map.h>
+#include <folly/container/IntrusiveList.h>
+
+namespace folly {
+
+/**
+ * A FunctionScheduler for very large numbers of periodic functions, such as
+ * a job per tenant.
+ *
+ * FunctionScheduler keeps its functions in a heap indexed by name, so adding,
+ * cancelling and rescheduling a function cost O(log n) plus a string lookup.
+ * This scheduler keeps them in a hierarchical timing wheel, like
+ * HHWheelTimer: 4 levels of 256 slots, each slot of a level spanning all of
+ * the level below. Adding, cancelling and rescheduling a function are O(1),
+ * functions are identified by the FunctionId returned when adding them, and
+ * run times are rounded up to the tick (1ms by default).
+ *
+ *   TimingWheelFunctionScheduler fs(
+ *       TimingWheelFunctionScheduler::Options().setStartJitter(true),
+ *       getKeepAliveToken(cpuExecutor));
+ *   fs.start();
+ *   auto id = fs.addFunction([&] { refreshTenant(tenant); }, seconds(30));
+ *   ........
+ *   fs.cancelFunction(id);
+ *   fs.shutdown();
+ *
+ * Functions run on the scheduler's thread, unless an executor is given, in
+ * which case the thread only dispatches them to it. A function never runs
+ * concurrently with itself: if it is still running when it is due, that run
+ * is skipped.
+ *
+ * Functions are run at a fixed rate: each run is scheduled an interval after
+ * the time the previous one was due, not after it actually ran. Runs that
+ * were missed, e.g. because the thread was busy, collapse into one.
+ */
+class TimingWheelFunctionScheduler {
+ public:
+  using FunctionId = uint64_t;
+
+  class Options {
+   public:
+    std::chrono::microseconds tick() const { return tick_; }
+
+    /// The resolution of the wheel. Run times and intervals are rounded up
+    /// to a multiple of it. Intervals up to 2^32 ticks are exact; longer
+    /// ones cost a few more O(1) reschedules.
+    Options& setTick(std::chrono::microseconds value) {
+      tick_ = value;
+      return *this;
+    }
+
+    bool startJitter() const { return startJitter_; }
+
+    /// Delays the first run of each periodic function by a random fraction
+    /// of its interval, on top of its startDelay, so that functions added
+    /// together (e.g. on start()) do not all run on the same tick.
+    Options& setStartJitter(bool value) {
+      startJitter_ = value;
+      return *this;
+    }
+
+   private:
+    std::chrono::microseconds tick_{1000};
+    bool startJitter_{false};
+  };
+
+  TimingWheelFunctionScheduler();
+
+  /**
+   * If executor is set, functions are run on it, and it is kept alive until
+   * the scheduler is destroyed.
+   */
+  explicit TimingWheelFunctionScheduler(
+      const Options& options, Executor::KeepAlive<> executor = {});
+
+  /**
+   * On destruction, ensures that this instance is shutdown prior to deletion.
+   */
+  ~TimingWheelFunctionScheduler();
+
+  /**
+   * Adds a function to run every interval, the first time startDelay after
+   * it is added, or after start() if the scheduler is not running. Returns
+   * the id to cancel it with. Throws std::invalid_argument if the interval is
+   * not positive or the delay is negative.
+   */
+  FunctionId addFunction(
+      Function<void()>&& cb,
+      std::chrono::microseconds interval,
+      std::chrono::microseconds startDelay = std::chrono::microseconds(0));
+
+  /**
+   * Adds a function to run once, startDelay after it is added, or after
+   * start() if the scheduler is not running.
+   */
+  FunctionId addFunctionOnce(
+      Function<void()>&& cb,
+      std::chrono::microseconds startDelay = std::chrono::microseconds(0));
+
+  /**
+   * Cancels the function, so it will no longer be run. A run that has
+   * already started is not waited for.
+   *
+   * Returns false if the function does not exist, e.g. because it already
+   * ran once or was cancelled.
+   */
+  bool cancelFunction(FunctionId id);
+
+  /**
+   * All functions registered will be canceled.
+   */
+  void cancelAllFunctions();
+
+  size_t numFunctions() const;
+
+  /**
+   * Starts the scheduler. The first run of every function is scheduled
+   * anew, startDelay from now.
+   *
+   * Returns false if the scheduler was already running.
+   */
+  bool start();
+
+  /**
+   * Stops the scheduler, after waiting for any function running on its
+   * thread. Functions already dispatched to the executor may still run.
+   *
+   * Returns false if the scheduler was not running.
+   */
+  bool shutdown();
+
+  /**
+   * Set the name of the worker thread.
+   */
+  void setThreadName(StringPiece threadName);
+
+ private:
+  static constexpr size_t kLevels = 4;
+  static constexpr size_t kSlotBits = 8;
+  static constexpr size_t kSlots = size_t(1) << kSlotBits;
+  static constexpr uint64_t kSlotMask = kSlots - 1;
+  // Ticks spanned by the whole wheel.
+  static constexpr uint64_t kMaxTicks = uint64_t(1) << (kLevels * kSlotBits);
+
+  // State shared with the runs dispatched to the executor, which may outlive
+  // the entry.
+  struct Task {
+    explicit Task(Function<void()>&& cback) : cb(std::move(cback)) {}
+
+    void run();
+
+    Function<void()> cb;
+    std::atomic<bool> running{false};
+    std::atomic<bool> canceled{false};
+  };
+
+  struct Entry {
+    Entry(FunctionId i, Function<void()>&& cb, uint64_t interval, uint64_t d)
+        : id(i),
+          task(std::make_shared<Task>(std::move(cb))),
+          intervalTicks(interval),
+          delayTicks(d) {}
+
+    IntrusiveListHook hook;
+    const FunctionId id;
+    std::shared_ptr<Task> task;
+    // 0 for functions that run once.
+    const uint64_t intervalTicks;
+    const uint64_t delayTicks;
+    uint64_t expireTick{0};
+  };
+
+  using Slot = IntrusiveList<Entry, &Entry::hook>;
+
+  FunctionId add(
+      Function<void()>&& cb,
+      std::chrono::microseconds interval,
+      std::chrono::microseconds startDelay,
+      bool runOnce);
+  uint64_t toTicks(std::chrono::microseconds duration) const;
+  uint64_t nowTick() const;
+  // Schedules the first run of the entry, relative to the current tick.
+  void schedule(Entry& entry);
+  void insert(Entry& entry);
+  void cascade(size_t level, uint64_t tick);
+  // Unlinks the due entries of the tick, reschedules them, and appends their
+  // tasks to due.
+  void expire(uint64_t tick, std::vector<std::shared_ptr<Task>>& due);
+  // The first tick from tick on that may have work: the next non-empty slot
+  // of this turn of the first level, or the next cascade.
+  uint64_t nextTick(uint64_t tick) const;
+  // Processes the ticks that have begun by now, and returns the next tick
+  // that may have work, which is after now.
+  uint64_t advance(uint64_t now, std::vector<std::shared_ptr<Task>>& due);
+  void clearWheel();
+  void run();
+
+  const Options options_;
+  const Executor::KeepAlive<> executor_;
+
+  std::thread thread_;
+  // Mutex to protect our member variables.
+  mutable std::mutex mutex_;
+  bool running_{false};
+  std::condition_variable runningCondvar_;
+  std::string threadName_{"FuncSched"};
+
+  FunctionId nextId_{1};
+  F14FastMap<FunctionId, std::unique_ptr<Entry>> functions_;
+
+  std::chrono::steady_clock::time_point base_;
+  // The next tick to process; entries are placed relative to it.
+  uint64_t curTick_{0};
+  // The tick the thread sleeps until.
+  uint64_t wakeTick_{0};
+  std::array<std::array<Slot, kSlots>, kLevels> wheel_;
+  // Non-empty slots of the first level. A bit may stay set after its slot
+  // was emptied by cancellations, which only costs a spurious wakeup.
+  std::array<uint64_t, kSlots / 64> bitmap_{};
+};
+
+} // namespace folly
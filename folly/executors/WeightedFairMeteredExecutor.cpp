@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/WeightedFairMeteredExecutor.h>
+
+#include <glog/logging.h>
+
+namespace folly {
+
+WeightedFairMeteredExecutor::WeightedFairMeteredExecutor(
+    KeepAlive keepAlive, Options options)
+    : options_(std::move(options)), kaInner_(std::move(keepAlive)) {
+  CHECK_GE(options_.maxInQueue, 1);
+  CHECK_LT(options_.maxInQueue, uint32_t(1) << 31);
+  defaultTenant_ = &addTenant("default");
+}
+
+WeightedFairMeteredExecutor::WeightedFairMeteredExecutor(
+    std::unique_ptr<Executor> executor, Options options)
+    : WeightedFairMeteredExecutor(
+          getKeepAliveToken(*executor), std::move(options)) {
+  ownedExecutor_ = std::move(executor);
+}
+
+WeightedFairMeteredExecutor::~WeightedFairMeteredExecutor() {
+  joinKeepAlive();
+}
+
+WeightedFairMeteredExecutor::Tenant& WeightedFairMeteredExecutor::addTenant(
+    std::string name, uint32_t weight) {
+  CHECK_GE(weight, 1);
+  std::lock_guard g(tenantsMutex_);
+  tenants_.push_back(
+      std::unique_ptr<Tenant>(new Tenant(*this, std::move(name), weight)));
+  return *tenants_.back();
+}
+
+void WeightedFairMeteredExecutor::add(Func func) {
+  defaultTenant_->add(std::move(func));
+}
+
+std::vector<WeightedFairMeteredExecutor::TenantStats>
+WeightedFairMeteredExecutor::getTenantStats() const {
+  std::lock_guard g(tenantsMutex_);
+  std::vector<TenantStats> stats;
+  stats.reserve(tenants_.size());
+  for (auto& tenant : tenants_) {
+    stats.push_back(tenant->getStats());
+  }
+  return stats;
+}
+
+void WeightedFairMeteredExecutor::Tenant::add(Func func) {
+  queue_.enqueue(Task{
+      std::move(func),
+      RequestContext::saveContext(),
+      std::chrono::steady_clock::now()});
+
+  // Take a token if the tenant has fewer than its weight.
+  bool addToken = false;
+  uint64_t oldState = state_.load(std::memory_order_relaxed);
+  uint64_t newState;
+  do {
+    newState = oldState + kBacklogInc;
+    CHECK_NE(newState & kBacklogMask, 0)
+        << "Too many pending tasks in WeightedFairMeteredExecutor tenant";
+    addToken = (newState >> kTokensShift) < weight_;
+    if (addToken) {
+      newState += kTokensInc;
+    }
+  } while (!state_.compare_exchange_weak(
+      oldState,
+      newState,
+      std::memory_order_seq_cst,
+      std::memory_order_relaxed));
+
+  if (addToken) {
+    parent_.addToken(*this);
+  }
+}
+
+void WeightedFairMeteredExecutor::Tenant::dispatch() {
+  // Consume a task, and keep the token if there are as many tasks left as
+  // tokens.
+  bool keepToken = false;
+  uint64_t oldState = state_.load(std::memory_order_relaxed);
+  uint64_t newState;
+  do {
+    DCHECK_GT(oldState & kBacklogMask, 0);
+    newState = oldState - kBacklogInc;
+    keepToken = (newState >> kTokensShift) <= (newState & kBacklogMask);
+    if (!keepToken) {
+      newState -= kTokensInc;
+    }
+  } while (!state_.compare_exchange_weak(
+      oldState,
+      newState,
+      std::memory_order_seq_cst,
+      std::memory_order_relaxed));
+
+  if (keepToken) {
+    parent_.addToken(*this);
+  }
+
+  Task task;
+  CHECK(queue_.try_dequeue(task));
+  auto waitTime = std::chrono::steady_clock::now() - task.enqueueTime;
+  dispatched_.fetch_add(1, std::memory_order_relaxed);
+  waitTimeNs_.fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(waitTime).count(),
+      std::memory_order_relaxed);
+
+  folly::RequestContextScopeGuard rctxGuard{std::move(task.rctx)};
+  invokeCatchingExns("WeightedFairMeteredExecutor", std::move(task.func));
+}
+
+WeightedFairMeteredExecutor::TenantStats
+WeightedFairMeteredExecutor::Tenant::getStats() const {
+  TenantStats stats;
+  stats.name = name_;
+  stats.weight = weight_;
+  stats.backlog = state_.load(std::memory_order_relaxed) & kBacklogMask;
+  stats.dispatched = dispatched_.load(std::memory_order_relaxed);
+  stats.waitTime =
+      std::chrono::nanoseconds(waitTimeNs_.load(std::memory_order_relaxed));
+  return stats;
+}
+
+bool WeightedFairMeteredExecutor::Tenant::keepAliveAcquire() noexcept {
+  return Executor::keepAliveAcquire(&parent_);
+}
+
+void WeightedFairMeteredExecutor::Tenant::keepAliveRelease() noexcept {
+  Executor::keepAliveRelease(&parent_);
+}
+
+void WeightedFairMeteredExecutor::addToken(Tenant& tenant) {
+  ring_.enqueue(&tenant);
+
+  bool shouldScheduleWorker = false;
+  uint64_t oldState = state_.load(std::memory_order_relaxed);
+  uint64_t newState;
+  do {
+    newState = oldState + kTokensInc;
+    shouldScheduleWorker = (newState >> kInQueueShift) < options_.maxInQueue;
+    if (shouldScheduleWorker) {
+      newState += kInQueueInc;
+    }
+  } while (!state_.compare_exchange_weak(
+      oldState,
+      newState,
+      std::memory_order_seq_cst,
+      std::memory_order_relaxed));
+
+  if (shouldScheduleWorker) {
+    scheduleWorker();
+  }
+}
+
+void WeightedFairMeteredExecutor::worker() {
+  bool shouldRescheduleWorker = false;
+  uint64_t oldState = state_.load(std::memory_order_relaxed);
+  uint64_t newState;
+  do {
+    DCHECK_GT(oldState & kTokensMask, 0);
+    // More tokens than workers in queue, re-schedule the worker without
+    // changing the in-queue count.
+    shouldRescheduleWorker =
+        (oldState & kTokensMask) > (oldState >> kInQueueShift);
+    newState = oldState - kTokensInc;
+    if (!shouldRescheduleWorker) {
+      newState -= kInQueueInc;
+    }
+  } while (!state_.compare_exchange_weak(
+      oldState,
+      newState,
+      std::memory_order_seq_cst,
+      std::memory_order_relaxed));
+
+  if (shouldRescheduleWorker) {
+    scheduleWorker();
+  }
+
+  Tenant* tenant = nullptr;
+  CHECK(ring_.try_dequeue(tenant));
+  tenant->dispatch();
+}
+
+void WeightedFairMeteredExecutor::scheduleWorker() {
+  folly::RequestContextScopeGuard rctxGuard{nullptr};
+  kaInner_->add([self = getKeepAliveToken(this)] { self->worker(); });
+}
+
+} // namespace folly
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <folly/DefaultKeepAliveExecutor.h>
+#include <folly/concurrency/UnboundedQueue.h>
+#include <folly/io/async/Request.h>
+
+namespace folly {
+
+// Like MeteredExecutor, attaches queues to an already existing executor, with
+// a limit on the number of their tasks simultaneously present in the wrapped
+// executor's queue. Unlike MeteredExecutor, there are many queues, one per
+// tenant, which share that limit in proportion to their weights, so that a
+// tenant with a large backlog cannot delay the tasks of the others by more
+// than a round.
+//
+// Scheduling is weighted round robin, interleaved: a backlogged tenant of
+// weight w has min(w, backlog) tokens in a shared FIFO ring. Dispatching a
+// task pops a token, runs one task of its tenant, and puts the token back at
+// the end of the ring while the tenant has enough backlog for it. Every
+// operation is constant time, and both the tenant queues and the ring are
+// lock-free UMPMCQueues; adding a tenant takes a lock.
+//
+// auto fair = std::make_unique<WeightedFairMeteredExecutor>(
+//     getKeepAliveToken(cpuExecutor));
+// auto& tenantA = fair->addTenant("a", 3);
+// auto& tenantB = fair->addTenant("b");
+// tenantA.add(...); // Gets 3/4 of the slots while both are backlogged.
+// tenantB.add(...);
+class WeightedFairMeteredExecutor : public DefaultKeepAliveExecutor {
+ public:
+  struct Options {
+    Options() {}
+    // Maximum number of tasks allowed in the wrapped executor's queue at any
+    // given time. This must be >= 1 and < 2^31.
+    uint32_t maxInQueue = 1;
+  };
+
+  struct TenantStats {
+    std::string name;
+    uint32_t weight{0};
+    // Tasks added and not dispatched to the wrapped executor yet.
+    size_t backlog{0};
+    // Tasks dispatched to the wrapped executor.
+    uint64_t dispatched{0};
+    // Total time dispatched tasks waited in the tenant's queue.
+    std::chrono::nanoseconds waitTime{0};
+  };
+
+  class Tenant : public Executor {
+   public:
+    void add(Func func) override;
+
+    const std::string& name() const { return name_; }
+    uint32_t weight() const { return weight_; }
+    TenantStats getStats() const;
+
+   protected:
+    bool keepAliveAcquire() noexcept override;
+    void keepAliveRelease() noexcept override;
+
+   private:
+    friend class WeightedFairMeteredExecutor;
+
+    struct Task {
+      Func func;
+      std::shared_ptr<RequestContext> rctx;
+      std::chrono::steady_clock::time_point enqueueTime;
+    };
+
+    Tenant(WeightedFairMeteredExecutor& parent, std::string name, uint32_t w)
+        : parent_(parent), name_(std::move(name)), weight_(w) {}
+
+    // Called with one of the tenant's tokens.
+    void dispatch();
+
+    WeightedFairMeteredExecutor& parent_;
+    const std::string name_;
+    const uint32_t weight_;
+
+    // [<tokens> 32 bits][<backlog> 32 bits]
+    static constexpr uint64_t kBacklogInc = 1;
+    static constexpr uint64_t kBacklogMask = (uint64_t{1} << 32) - 1;
+    static constexpr uint64_t kTokensShift = 32;
+    static constexpr uint64_t kTokensInc = uint64_t{1} << kTokensShift;
+    alignas(folly::cacheline_align_v) std::atomic<uint64_t> state_{0};
+    std::atomic<uint64_t> dispatched_{0};
+    std::atomic<uint64_t> waitTimeNs_{0};
+    UMPMCQueue<Task, /* MayBlock */ false, /* LgSegmentSize */ 5> queue_;
+  };
+
+  using KeepAlive = Executor::KeepAlive<>;
+  // owning constructor
+  explicit WeightedFairMeteredExecutor(
+      std::unique_ptr<Executor> exe, Options options = Options());
+  // non-owning constructor
+  explicit WeightedFairMeteredExecutor(
+      KeepAlive keepAlive, Options options = Options());
+  ~WeightedFairMeteredExecutor() override;
+
+  // Adds a tenant, which lives as long as this executor. weight must be >= 1.
+  Tenant& addTenant(std::string name, uint32_t weight = 1);
+
+  // Adds the task to the "default" tenant, of weight 1, which every
+  // executor has.
+  void add(Func func) override;
+
+  std::vector<TenantStats> getTenantStats() const;
+
+ private:
+  void addToken(Tenant& tenant);
+  void worker();
+  void scheduleWorker();
+
+  const Options options_;
+  std::unique_ptr<Executor> ownedExecutor_;
+  const KeepAlive kaInner_;
+
+  // [<workers in queue> 32 bits][<tokens in ring> 32 bits]
+  static constexpr uint64_t kTokensInc = 1;
+  static constexpr uint64_t kTokensMask = (uint64_t{1} << 32) - 1;
+  static constexpr uint64_t kInQueueShift = 32;
+  static constexpr uint64_t kInQueueInc = uint64_t{1} << kInQueueShift;
+  alignas(folly::cacheline_align_v) std::atomic<uint64_t> state_{0};
+  UMPMCQueue<Tenant*, /* MayBlock */ false> ring_;
+
+  mutable std::mutex tenantsMutex_;
+  std::vector<std::unique_ptr<Tenant>> tenants_;
+  Tenant* defaultTenant_;
+};
+
+} // namespace folly
@@ -17,13 +17,17 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <exception>
 #include <stdexcept>
+#include <type_traits>
 
 #include <glog/logging.h>
 
 #include <folly/CPortability.h>
 #include <folly/Optional.h>
+#include <folly/container/span.h>
+#include <folly/synchronization/WaitOptions.h>
 
 namespace folly {
 
@@ -41,6 +45,23 @@ struct BlockingQueueAddResult {
   bool reusedThread;
 };
 
+namespace detail {
+
+// Posts n to a LifoSem-like semaphore. Returns whether a waiting thread was
+// woken, or false if the semaphore's post(n) does not say (LifoSem).
+template <class Semaphore>
+bool blockingQueuePostBatch(Semaphore& sem, size_t n) {
+  auto count = static_cast<uint32_t>(n);
+  if constexpr (std::is_void_v<decltype(sem.post(count))>) {
+    sem.post(count);
+    return false;
+  } else {
+    return sem.post(count);
+  }
+}
+
+} // namespace detail
+
 template <class T>
 class BlockingQueue {
  public:
@@ -55,10 +76,36 @@ class BlockingQueue {
       T&& item, int8_t /* priority */) {
     return add(std::move(item));
   }
+  // Adds all of items (moving from them) at the default priority. Queues
+  // override this to publish the batch and wake consumers in one step.
+  // reusedThread is only true if existing threads can work on all of them.
+  virtual BlockingQueueAddResult addBatch(span<T> items) {
+    bool reused = true;
+    for (auto& item : items) {
+      reused = add(std::move(item)).reusedThread && reused;
+    }
+    return reused;
+  }
   virtual uint8_t getNumPriorities() { return 1; }
   virtual T take() = 0;
   virtual folly::Optional<T> try_take_for(std::chrono::milliseconds time) = 0;
+  // Like try_take_for(), and adds the time it spent spinning and blocked
+  // waiting for an item to stats. Queues that do not measure it account
+  // the whole wait as blocked.
+  virtual folly::Optional<T> try_take_for_with_stats(
+      std::chrono::milliseconds time, WaitStats& stats) {
+    auto start = std::chrono::steady_clock::now();
+    auto item = try_take_for(time);
+    stats.park += std::chrono::steady_clock::now() - start;
+    return item;
+  }
   virtual size_t size() = 0;
+
+  // How take() and try_take_for() wait for an item: the semaphore-based
+  // queues in folly/executors/task_queue spin for up to spin_max() before
+  // they block. Other queues ignore it. Must be set before the queue is
+  // used.
+  virtual void setWaitOptions(const WaitOptions& /* opt */) {}
 };
 
 } // namespace folly
@@ -49,7 +49,7 @@ class LifoSemMPMCQueue : public BlockingQueue<T> {
   }
 
   T take() override {
-    sem_.wait();
+    sem_.wait(waitOptions_);
     T item;
     while (!queue_.readIfNotEmpty(item)) {
     }
@@ -57,7 +57,24 @@ class LifoSemMPMCQueue : public BlockingQueue<T> {
   }
 
   folly::Optional<T> try_take_for(std::chrono::milliseconds time) override {
-    if (!sem_.try_wait_for(time)) {
+    return tryTakeFor(time, nullptr);
+  }
+
+  folly::Optional<T> try_take_for_with_stats(
+      std::chrono::milliseconds time, WaitStats& stats) override {
+    return tryTakeFor(time, &stats);
+  }
+
+  size_t capacity() { return queue_.capacity(); }
+
+  size_t size() override { return sem_.valueGuess(); }
+
+  void setWaitOptions(const WaitOptions& opt) override { waitOptions_ = opt; }
+
+ private:
+  folly::Optional<T> tryTakeFor(
+      std::chrono::milliseconds time, WaitStats* stats) {
+    if (!sem_.try_wait_for(time, waitOptions_, stats)) {
       return folly::none;
     }
     T item;
@@ -66,12 +83,8 @@ class LifoSemMPMCQueue : public BlockingQueue<T> {
     return item;
   }
 
-  size_t capacity() { return queue_.capacity(); }
-
-  size_t size() override { return sem_.valueGuess(); }
-
- private:
   Semaphore sem_;
+  WaitOptions waitOptions_;
   folly::MPMCQueue<T> queue_;
 };
 
@@ -87,7 +87,7 @@ class PriorityLifoSemMPMCQueue : public BlockingQueue<T> {
   }
 
   T take() override {
-    sem_.wait();
+    sem_.wait(waitOptions_);
     T item;
     while (true) {
       if (nonBlockingTake(item)) {
@@ -97,15 +97,12 @@ class PriorityLifoSemMPMCQueue : public BlockingQueue<T> {
   }
 
   folly::Optional<T> try_take_for(std::chrono::milliseconds time) override {
-    if (!sem_.try_wait_for(time)) {
-      return folly::none;
-    }
-    T item;
-    while (true) {
-      if (nonBlockingTake(item)) {
-        return item;
-      }
-    }
+    return tryTakeFor(time, nullptr);
+  }
+
+  folly::Optional<T> try_take_for_with_stats(
+      std::chrono::milliseconds time, WaitStats& stats) override {
+    return tryTakeFor(time, &stats);
   }
 
   bool nonBlockingTake(T& item) {
@@ -119,8 +116,24 @@ class PriorityLifoSemMPMCQueue : public BlockingQueue<T> {
 
   size_t size() override { return sem_.valueGuess(); }
 
+  void setWaitOptions(const WaitOptions& opt) override { waitOptions_ = opt; }
+
  private:
+  folly::Optional<T> tryTakeFor(
+      std::chrono::milliseconds time, WaitStats* stats) {
+    if (!sem_.try_wait_for(time, waitOptions_, stats)) {
+      return folly::none;
+    }
+    T item;
+    while (true) {
+      if (nonBlockingTake(item)) {
+        return item;
+      }
+    }
+  }
+
   Semaphore sem_;
+  WaitOptions waitOptions_;
   std::vector<folly::MPMCQueue<T>> queues_;
 };
 
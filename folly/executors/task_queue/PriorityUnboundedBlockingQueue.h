@@ -47,8 +47,17 @@ class PriorityUnboundedBlockingQueue : public BlockingQueue<T> {
     return sem_.post();
   }
 
+  BlockingQueueAddResult addBatch(span<T> items) override {
+    auto& queue =
+        queue_.at_priority(translatePriority(folly::Executor::MID_PRI));
+    for (auto& item : items) {
+      queue.enqueue(std::move(item));
+    }
+    return detail::blockingQueuePostBatch(sem_, items.size());
+  }
+
   T take() override {
-    sem_.wait();
+    sem_.wait(waitOptions_);
     return dequeue();
   }
 
@@ -60,15 +69,27 @@ class PriorityUnboundedBlockingQueue : public BlockingQueue<T> {
   }
 
   folly::Optional<T> try_take_for(std::chrono::milliseconds time) override {
-    if (!sem_.try_wait_for(time)) {
-      return none;
-    }
-    return dequeue();
+    return tryTakeFor(time, nullptr);
+  }
+
+  folly::Optional<T> try_take_for_with_stats(
+      std::chrono::milliseconds time, WaitStats& stats) override {
+    return tryTakeFor(time, &stats);
   }
 
   size_t size() override { return sem_.valueGuess(); }
 
+  void setWaitOptions(const WaitOptions& opt) override { waitOptions_ = opt; }
+
  private:
+  folly::Optional<T> tryTakeFor(
+      std::chrono::milliseconds time, WaitStats* stats) {
+    if (!sem_.try_wait_for(time, waitOptions_, stats)) {
+      return none;
+    }
+    return dequeue();
+  }
+
   size_t translatePriority(int8_t const priority) {
     size_t const priorities = queue_.priorities();
     assert(priorities <= 255);
@@ -86,6 +107,7 @@ class PriorityUnboundedBlockingQueue : public BlockingQueue<T> {
   }
 
   Semaphore sem_;
+  WaitOptions waitOptions_;
   PriorityUMPMCQueueSet<T, /* MayBlock = */ true> queue_;
 };
 
@@ -91,21 +91,34 @@ class StripedPriorityUnboundedBlockingQueue : public BlockingQueue<T> {
 
   T take() override {
     const auto stripeIdx = getStripeIdx();
-    auto foundStripeIdx = sem_.wait(stripeIdx);
+    auto foundStripeIdx = sem_.wait(stripeIdx, waitOptions_);
     return dequeue(foundStripeIdx);
   }
 
   folly::Optional<T> try_take_for(std::chrono::milliseconds time) override {
+    return tryTakeFor(time, nullptr);
+  }
+
+  folly::Optional<T> try_take_for_with_stats(
+      std::chrono::milliseconds time, WaitStats& stats) override {
+    return tryTakeFor(time, &stats);
+  }
+
+  size_t size() override { return sem_.valueGuess(); }
+
+  void setWaitOptions(const WaitOptions& opt) override { waitOptions_ = opt; }
+
+ private:
+  folly::Optional<T> tryTakeFor(
+      std::chrono::milliseconds time, WaitStats* stats) {
     const auto stripeIdx = getStripeIdx();
-    if (auto foundStripeIdx = sem_.try_wait_for(stripeIdx, time)) {
+    if (auto foundStripeIdx =
+            sem_.try_wait_for(stripeIdx, time, waitOptions_, stats)) {
       return dequeue(*foundStripeIdx);
     }
     return none;
   }
 
-  size_t size() override { return sem_.valueGuess(); }
-
- private:
   size_t translatePriority(int8_t const priority) {
     int8_t const hi = (numPriorities_ + 1) / 2 - 1;
     int8_t const lo = hi - (numPriorities_ - 1);
@@ -126,6 +139,7 @@ class StripedPriorityUnboundedBlockingQueue : public BlockingQueue<T> {
 
   const size_t numPriorities_;
   StripedThrottledLifoSem<Queue> sem_;
+  WaitOptions waitOptions_;
 };
 
 } // namespace folly
@@ -34,22 +34,42 @@ class UnboundedBlockingQueue : public BlockingQueue<T> {
     return sem_.post();
   }
 
+  BlockingQueueAddResult addBatch(span<T> items) override {
+    for (auto& item : items) {
+      queue_.enqueue(std::move(item));
+    }
+    return detail::blockingQueuePostBatch(sem_, items.size());
+  }
+
   T take() override {
-    sem_.wait();
+    sem_.wait(waitOptions_);
     return queue_.dequeue();
   }
 
   folly::Optional<T> try_take_for(std::chrono::milliseconds time) override {
-    if (!sem_.try_wait_for(time)) {
-      return folly::none;
-    }
-    return queue_.dequeue();
+    return tryTakeFor(time, nullptr);
+  }
+
+  folly::Optional<T> try_take_for_with_stats(
+      std::chrono::milliseconds time, WaitStats& stats) override {
+    return tryTakeFor(time, &stats);
   }
 
   size_t size() override { return sem_.valueGuess(); }
 
+  void setWaitOptions(const WaitOptions& opt) override { waitOptions_ = opt; }
+
  private:
+  folly::Optional<T> tryTakeFor(
+      std::chrono::milliseconds time, WaitStats* stats) {
+    if (!sem_.try_wait_for(time, waitOptions_, stats)) {
+      return folly::none;
+    }
+    return queue_.dequeue();
+  }
+
   Semaphore sem_;
+  WaitOptions waitOptions_;
   UMPMCQueue<T, false, 6> queue_;
 };
 
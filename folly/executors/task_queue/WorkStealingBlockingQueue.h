@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/Executor.h>
+#include <folly/Likely.h>
+#include <folly/ThreadLocal.h>
+#include <folly/concurrency/UnboundedQueue.h>
+#include <folly/executors/task_queue/BlockingQueue.h>
+#include <folly/lang/Align.h>
+#include <folly/synchronization/ThrottledLifoSem.h>
+
+namespace folly {
+
+namespace detail {
+
+/**
+ * Chase-Lev work-stealing deque of T*, in the formulation of Le et al.,
+ * "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP '13),
+ * with seq_cst operations in place of the standalone fences.
+ *
+ * Only the owner may push() and pop(), at the bottom; any thread may
+ * steal() from the top. The buffer grows when full; retired buffers are
+ * kept until destruction, since a thief may still be reading one.
+ */
+template <typename T>
+class WorkStealingDeque {
+  struct Buffer {
+    explicit Buffer(int64_t cap)
+        : capacity(cap), slots(new std::atomic<T*>[size_t(cap)]) {}
+
+    std::atomic<T*>& at(int64_t i) { return slots[size_t(i & (capacity - 1))]; }
+
+    const int64_t capacity;
+    const std::unique_ptr<std::atomic<T*>[]> slots;
+  };
+
+ public:
+  WorkStealingDeque() : buffer_(new Buffer(kInitialCapacity)) {
+    retired_.emplace_back(buffer_.load(std::memory_order_relaxed));
+  }
+
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  ~WorkStealingDeque() {
+    while (auto p = pop()) {
+      delete p;
+    }
+  }
+
+  void push(T* item) {
+    auto b = bottom_.load(std::memory_order_relaxed);
+    auto t = top_.load(std::memory_order_acquire);
+    auto buf = buffer_.load(std::memory_order_relaxed);
+    if (FOLLY_UNLIKELY(b - t > buf->capacity - 1)) {
+      buf = grow(buf, t, b);
+    }
+    buf->at(b).store(item, std::memory_order_relaxed);
+    bottom_.store(b + 1, std::memory_order_release);
+  }
+
+  T* pop() {
+    auto b = bottom_.load(std::memory_order_relaxed) - 1;
+    auto buf = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_seq_cst);
+    auto t = top_.load(std::memory_order_seq_cst);
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T* item = buf->at(b).load(std::memory_order_relaxed);
+    if (t == b) {
+      // Last item: race thieves for it.
+      if (!top_.compare_exchange_strong(
+              t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // Returns nullptr if the deque looked empty or another thread won the race
+  // for the top item.
+  T* steal() {
+    auto t = top_.load(std::memory_order_seq_cst);
+    auto b = bottom_.load(std::memory_order_seq_cst);
+    if (t >= b) {
+      return nullptr;
+    }
+    auto buf = buffer_.load(std::memory_order_acquire);
+    T* item = buf->at(t).load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return item;
+  }
+
+  bool emptyGuess() const {
+    return top_.load(std::memory_order_acquire) >=
+        bottom_.load(std::memory_order_acquire);
+  }
+
+ private:
+  static constexpr int64_t kInitialCapacity = 64;
+
+  Buffer* grow(Buffer* buf, int64_t t, int64_t b) {
+    auto bigger = new Buffer(buf->capacity * 2);
+    for (auto i = t; i < b; ++i) {
+      bigger->at(i).store(
+          buf->at(i).load(std::memory_order_relaxed),
+          std::memory_order_relaxed);
+    }
+    retired_.emplace_back(bigger);
+    buffer_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  alignas(hardware_destructive_interference_size) std::atomic<int64_t> top_{0};
+  alignas(hardware_destructive_interference_size)
+      std::atomic<int64_t> bottom_{0};
+  std::atomic<Buffer*> buffer_;
+  // Owned by the owner thread; holds the current buffer too.
+  std::vector<std::unique_ptr<Buffer>> retired_;
+};
+
+} // namespace detail
+
+/**
+ * A BlockingQueue that gives each consuming thread its own deque, for
+ * thread pools running many small tasks that schedule more tasks.
+ *
+ * - add() from a thread that takes from this queue (a worker) pushes onto
+ *   that thread's deque, with no shared cache line touched besides the
+ *   semaphore. The worker later pops it LIFO, while its data is still hot.
+ * - add() from any other thread goes to a shared injector queue.
+ * - A worker looks at its own deque first, then the injector, then steals
+ *   FIFO from the other workers' deques. Every kInjectorInterval tasks it
+ *   checks the injector first, so a worker that keeps feeding itself
+ *   cannot starve external submissions.
+ *
+ * Ordering is therefore neither FIFO nor LIFO. Only one priority is
+ * supported, except that items added with a priority below MID_PRI are
+ * taken last: only once every deque and the injector look empty. This is
+ * what makes CPUThreadPoolExecutor::join() run the tasks that workers
+ * queued locally, since its stop requests are added at LO_PRI from an
+ * external thread, and would otherwise overtake them through the injector.
+ *
+ * Workers register on their first take(), up to maxWorkers of them; later
+ * workers share the injector only. A worker's deque outlives the thread:
+ * when the thread exits, tasks left in it are stolen by the others and the
+ * next thread to register takes it over.
+ */
+template <class T, class Semaphore = folly::ThrottledLifoSem>
+class WorkStealingBlockingQueue : public BlockingQueue<T> {
+  struct Worker {
+    detail::WorkStealingDeque<T> deque;
+    std::atomic<bool> owned{false};
+    uint32_t ticks{0};
+  };
+  struct alignas(hardware_destructive_interference_size) PaddedWorker
+      : Worker {};
+
+ public:
+  static constexpr uint32_t kInjectorInterval = 61;
+
+  explicit WorkStealingBlockingQueue(
+      size_t maxWorkers,
+      const typename Semaphore::Options& semaphoreOptions = {})
+      : sem_(semaphoreOptions),
+        maxWorkers_(maxWorkers),
+        workers_(new PaddedWorker[maxWorkers]) {}
+
+  BlockingQueueAddResult add(T&& item) override {
+    if (auto self = local_.get(); self && self != &overflow_) {
+      self->deque.push(new T(std::move(item)));
+    } else {
+      injector_.enqueue(std::move(item));
+    }
+    return sem_.post();
+  }
+
+  BlockingQueueAddResult addWithPriority(T&& item, int8_t priority) override {
+    if (priority < Executor::MID_PRI) {
+      backlog_.enqueue(std::move(item));
+      return sem_.post();
+    }
+    return add(std::move(item));
+  }
+
+  BlockingQueueAddResult addBatch(span<T> items) override {
+    if (auto self = local_.get(); self && self != &overflow_) {
+      for (auto& item : items) {
+        self->deque.push(new T(std::move(item)));
+      }
+    } else {
+      for (auto& item : items) {
+        injector_.enqueue(std::move(item));
+      }
+    }
+    return detail::blockingQueuePostBatch(sem_, items.size());
+  }
+
+  T take() override {
+    sem_.wait(waitOptions_);
+    return dequeue();
+  }
+
+  folly::Optional<T> try_take_for(std::chrono::milliseconds time) override {
+    return tryTakeFor(time, nullptr);
+  }
+
+  folly::Optional<T> try_take_for_with_stats(
+      std::chrono::milliseconds time, WaitStats& stats) override {
+    return tryTakeFor(time, &stats);
+  }
+
+  size_t size() override { return sem_.valueGuess(); }
+
+  void setWaitOptions(const WaitOptions& opt) override { waitOptions_ = opt; }
+
+ private:
+  folly::Optional<T> tryTakeFor(
+      std::chrono::milliseconds time, WaitStats* stats) {
+    if (!sem_.try_wait_for(time, waitOptions_, stats)) {
+      return folly::none;
+    }
+    return dequeue();
+  }
+
+  // Must follow a successful semaphore wait, which guarantees that a task
+  // is in one of the queues or about to be, so this only spins on races.
+  T dequeue() {
+    auto self = localWorker();
+    for (uint32_t attempt = 0;; ++attempt) {
+      if (self && (++self->ticks % kInjectorInterval != 0 || attempt > 0)) {
+        if (auto p = self->deque.pop()) {
+          return unwrap(p);
+        }
+      }
+      if (auto item = injector_.try_dequeue()) {
+        return std::move(*item);
+      }
+      if (auto p = steal(self)) {
+        return unwrap(p);
+      }
+      if (allDequesEmpty()) {
+        if (auto item = backlog_.try_dequeue()) {
+          return std::move(*item);
+        }
+      }
+      if (attempt > 0) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  T* steal(Worker* self) {
+    auto n = numWorkers_.load(std::memory_order_acquire);
+    auto start =
+        self ? size_t(static_cast<PaddedWorker*>(self) - workers_.get()) : 0;
+    for (size_t i = 0; i < n; ++i) {
+      auto& victim = workers_[(start + 1 + i) % n];
+      if (&victim != self && !victim.deque.emptyGuess()) {
+        if (auto p = victim.deque.steal()) {
+          return p;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  // Unlike a failed steal(), which may have lost a race, this does not miss
+  // a task that is left in a deque, including that of an exited thread.
+  bool allDequesEmpty() const {
+    auto n = numWorkers_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < n; ++i) {
+      if (!workers_[i].deque.emptyGuess()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static T unwrap(T* p) {
+    std::unique_ptr<T> owner{p};
+    return std::move(*p);
+  }
+
+  Worker* localWorker() {
+    if (auto self = local_.get(); FOLLY_LIKELY(self != nullptr)) {
+      return self == &overflow_ ? nullptr : self;
+    }
+    // Reuse a deque whose thread exited before growing the set.
+    auto n = numWorkers_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < maxWorkers_; ++i) {
+      auto& worker = workers_[i];
+      bool expected = false;
+      if (worker.owned.compare_exchange_strong(
+              expected, true, std::memory_order_acquire)) {
+        while (n <= i &&
+               !numWorkers_.compare_exchange_weak(
+                   n, i + 1, std::memory_order_release)) {
+        }
+        local_.reset(&worker, [](Worker* w, TLPDestructionMode) {
+          w->owned.store(false, std::memory_order_release);
+        });
+        return &worker;
+      }
+    }
+    // Remember that there was no room, so the scan is not repeated.
+    local_.reset(&overflow_, [](Worker*, TLPDestructionMode) {});
+    return nullptr;
+  }
+
+  Semaphore sem_;
+  WaitOptions waitOptions_;
+  UMPMCQueue<T, false, 6> injector_;
+  // Items added below MID_PRI.
+  UMPMCQueue<T, false, 6> backlog_;
+  const size_t maxWorkers_;
+  const std::unique_ptr<PaddedWorker[]> workers_;
+  std::atomic<size_t> numWorkers_{0};
+  // Marks threads that found no free deque.
+  Worker overflow_;
+  // Destroyed before workers_, releasing every thread's slot.
+  ThreadLocalPtr<Worker> local_;
+};
+
+} // namespace folly
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/task_queue/WorkStealingBlockingQueue.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include <folly/Benchmark.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/init/Init.h>
+#include <folly/synchronization/Latch.h>
+#include <folly/system/HardwareConcurrency.h>
+
+DEFINE_int32(threads, 0, "pool size; 0 means one thread per CPU");
+DEFINE_int32(fan_out_depth, 14, "depth of the binary task tree in fan_out");
+
+// Compares CPUThreadPoolExecutor's queues on two workloads:
+//  - fan_out: every task spawns two children from a pool thread, the case
+//    work stealing targets;
+//  - external: one outside thread submits all tasks, which all go through
+//    the injector.
+
+namespace {
+
+using MakeQueue = std::unique_ptr<
+    folly::BlockingQueue<folly::CPUThreadPoolExecutor::CPUTask>> (*)();
+
+size_t numThreads() {
+  return FLAGS_threads > 0 ? size_t(FLAGS_threads)
+                           : folly::available_concurrency();
+}
+
+void fanOut(size_t iters, MakeQueue makeQueue) {
+  folly::BenchmarkSuspender braces;
+  folly::CPUThreadPoolExecutor ex(numThreads(), makeQueue());
+  const int depth = FLAGS_fan_out_depth;
+  for (size_t iter = 0; iter < iters; ++iter) {
+    folly::Latch done(int64_t(1) << depth);
+    std::function<void(int)> spawn = [&](int d) {
+      if (d == depth) {
+        done.count_down();
+        return;
+      }
+      ex.add([&, d] { spawn(d + 1); });
+      ex.add([&, d] { spawn(d + 1); });
+    };
+    braces.dismissing([&] {
+      ex.add([&] { spawn(0); });
+      done.wait();
+    });
+  }
+}
+
+void external(size_t iters, MakeQueue makeQueue) {
+  folly::BenchmarkSuspender braces;
+  folly::CPUThreadPoolExecutor ex(numThreads(), makeQueue());
+  constexpr int kTasks = 1 << 14;
+  std::atomic<int> sink{0};
+  for (size_t iter = 0; iter < iters; ++iter) {
+    folly::Latch done(kTasks);
+    braces.dismissing([&] {
+      for (int i = 0; i < kTasks; ++i) {
+        ex.add([&] {
+          sink.fetch_add(1, std::memory_order_relaxed);
+          done.count_down();
+        });
+      }
+      done.wait();
+    });
+  }
+}
+
+std::unique_ptr<folly::BlockingQueue<folly::CPUThreadPoolExecutor::CPUTask>>
+makeWorkStealing() {
+  return folly::CPUThreadPoolExecutor::makeWorkStealingQueue();
+}
+
+std::unique_ptr<folly::BlockingQueue<folly::CPUThreadPoolExecutor::CPUTask>>
+makeThrottledLifoSem() {
+  return folly::CPUThreadPoolExecutor::makeThrottledLifoSemQueue();
+}
+
+} // namespace
+
+BENCHMARK(fan_out_lifo_sem, iters) {
+  fanOut(iters, &folly::CPUThreadPoolExecutor::makeLifoSemQueue);
+}
+BENCHMARK_RELATIVE(fan_out_throttled_lifo_sem, iters) {
+  fanOut(iters, &makeThrottledLifoSem);
+}
+BENCHMARK_RELATIVE(fan_out_work_stealing, iters) {
+  fanOut(iters, &makeWorkStealing);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(external_lifo_sem, iters) {
+  external(iters, &folly::CPUThreadPoolExecutor::makeLifoSemQueue);
+}
+BENCHMARK_RELATIVE(external_throttled_lifo_sem, iters) {
+  external(iters, &makeThrottledLifoSem);
+}
+BENCHMARK_RELATIVE(external_work_stealing, iters) {
+  external(iters, &makeWorkStealing);
+}
+
+int main(int argc, char** argv) {
+  folly::Init init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/task_queue/WorkStealingBlockingQueue.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/portability/GTest.h>
+#include <folly/synchronization/Baton.h>
+#include <folly/synchronization/Latch.h>
+
+using namespace folly;
+
+TEST(WorkStealingDeque, ownerIsLifoThiefIsFifo) {
+  detail::WorkStealingDeque<int> d;
+  EXPECT_EQ(nullptr, d.pop());
+  EXPECT_EQ(nullptr, d.steal());
+  // Enough to force the buffer to grow a few times.
+  for (int i = 0; i < 1000; ++i) {
+    d.push(new int(i));
+  }
+  std::unique_ptr<int> first{d.steal()};
+  EXPECT_EQ(0, *first);
+  std::unique_ptr<int> last{d.pop()};
+  EXPECT_EQ(999, *last);
+  for (int i = 998; i > 0; --i) {
+    std::unique_ptr<int> p{d.pop()};
+    ASSERT_EQ(i, *p);
+  }
+  EXPECT_EQ(nullptr, d.pop());
+  EXPECT_TRUE(d.emptyGuess());
+  // Left-over items are freed by the destructor.
+  d.push(new int(1));
+}
+
+TEST(WorkStealingDeque, concurrentStealsTakeEachItemOnce) {
+  constexpr int kItems = 200000;
+  constexpr int kThieves = 3;
+  detail::WorkStealingDeque<int> d;
+  std::atomic<bool> done{false};
+  std::vector<std::atomic<int>> seen(kItems);
+
+  std::vector<std::thread> thieves;
+  for (int i = 0; i < kThieves; ++i) {
+    thieves.emplace_back([&] {
+      while (!done.load() || !d.emptyGuess()) {
+        if (auto p = d.steal()) {
+          ++seen[*p];
+          delete p;
+        }
+      }
+    });
+  }
+  for (int i = 0; i < kItems; ++i) {
+    d.push(new int(i));
+    if (i % 3 == 0) {
+      if (auto p = d.pop()) {
+        ++seen[*p];
+        delete p;
+      }
+    }
+  }
+  done = true;
+  for (auto& t : thieves) {
+    t.join();
+  }
+  for (int i = 0; i < kItems; ++i) {
+    ASSERT_EQ(1, seen[i].load()) << i;
+  }
+}
+
+TEST(WorkStealingBlockingQueue, externalAddsUseInjector) {
+  WorkStealingBlockingQueue<int> q(4);
+  EXPECT_EQ(0, q.size());
+  q.add(1);
+  q.add(2);
+  EXPECT_EQ(2, q.size());
+  EXPECT_EQ(1, q.take());
+  EXPECT_EQ(2, *q.try_take_for(std::chrono::milliseconds(0)));
+  EXPECT_FALSE(q.try_take_for(std::chrono::milliseconds(1)).has_value());
+}
+
+TEST(WorkStealingBlockingQueue, workerAddsAreLocalAndLifo) {
+  WorkStealingBlockingQueue<int> q(4);
+  q.add(0);
+  std::thread worker([&] {
+    // The first take registers this thread as a worker.
+    EXPECT_EQ(0, q.take());
+    for (int i = 1; i <= 3; ++i) {
+      q.add(int(i));
+    }
+    EXPECT_EQ(3, q.take());
+    EXPECT_EQ(2, q.take());
+    EXPECT_EQ(1, q.take());
+  });
+  worker.join();
+  EXPECT_EQ(0, q.size());
+}
+
+TEST(WorkStealingBlockingQueue, idleWorkersSteal) {
+  WorkStealingBlockingQueue<int> q(4);
+  Baton<> filled;
+  Baton<> stolen;
+  q.add(0);
+  std::thread owner([&] {
+    EXPECT_EQ(0, q.take());
+    for (int i = 1; i <= 3; ++i) {
+      q.add(int(i));
+    }
+    filled.post();
+    stolen.wait();
+  });
+  filled.wait();
+  std::thread thief([&] {
+    // The owner is parked, so these can only come from its deque, oldest
+    // first.
+    EXPECT_EQ(1, q.take());
+    EXPECT_EQ(2, q.take());
+    EXPECT_EQ(3, q.take());
+    stolen.post();
+  });
+  thief.join();
+  owner.join();
+}
+
+TEST(WorkStealingBlockingQueue, orphanedTasksAreNotLost) {
+  WorkStealingBlockingQueue<int> q(1);
+  q.add(0);
+  std::thread([&] {
+    EXPECT_EQ(0, q.take());
+    q.add(1);
+    q.add(2);
+  }).join();
+  // The exited worker's deque is reused by the next thread to register.
+  std::thread([&] {
+    EXPECT_EQ(2, q.take());
+    q.add(3);
+    EXPECT_EQ(3, q.take());
+    EXPECT_EQ(1, q.take());
+  }).join();
+}
+
+TEST(WorkStealingBlockingQueue, moreThreadsThanDeques) {
+  WorkStealingBlockingQueue<int> q(1);
+  constexpr int kThreads = 4;
+  constexpr int kPerThread = 1000;
+  std::atomic<int> sum{0};
+  for (int i = 0; i < kThreads; ++i) {
+    q.add(0);
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&] {
+      sum += q.take();
+      for (int i = 1; i <= kPerThread; ++i) {
+        q.add(int(i));
+        sum += q.take();
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(kThreads * kPerThread * (kPerThread + 1) / 2, sum.load());
+  EXPECT_EQ(0, q.size());
+}
+
+TEST(WorkStealingBlockingQueue, cpuThreadPoolExecutorRecursiveFanOut) {
+  CPUThreadPoolExecutor ex(4, CPUThreadPoolExecutor::makeWorkStealingQueue());
+  constexpr int kDepth = 12;
+  std::atomic<int> leaves{0};
+  Latch done(1 << kDepth);
+  std::function<void(int)> spawn = [&](int depth) {
+    if (depth == kDepth) {
+      ++leaves;
+      done.count_down();
+      return;
+    }
+    ex.add([&, depth] { spawn(depth + 1); });
+    ex.add([&, depth] { spawn(depth + 1); });
+  };
+  ex.add([&] { spawn(0); });
+  done.wait();
+  EXPECT_EQ(1 << kDepth, leaves.load());
+  ex.join();
+  EXPECT_EQ(0, ex.getPendingTaskCount());
+}
+
+TEST(WorkStealingBlockingQueue, cpuThreadPoolExecutorResize) {
+  CPUThreadPoolExecutor ex(4, CPUThreadPoolExecutor::makeWorkStealingQueue(2));
+  std::atomic<int> count{0};
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < 100; ++i) {
+      ex.add([&] {
+        ex.add([&] { ++count; });
+        ++count;
+      });
+    }
+    ex.setNumThreads(round % 2 ? 4 : 1);
+  }
+  ex.join();
+  EXPECT_EQ(2000, count.load());
+}
+
+TEST(WorkStealingBlockingQueue, lowPriorityItemsAreTakenLast) {
+  WorkStealingBlockingQueue<int> q(2);
+  q.addWithPriority(-1, Executor::LO_PRI);
+  q.add(0);
+  std::thread([&] {
+    EXPECT_EQ(0, q.take());
+    q.add(1);
+    q.addWithPriority(-2, Executor::LO_PRI);
+    q.add(2);
+    EXPECT_EQ(2, q.take());
+  }).join();
+  // Left in the exited thread's deque, ahead of the backlog.
+  std::thread([&] {
+    EXPECT_EQ(1, q.take());
+    EXPECT_EQ(-1, q.take());
+    EXPECT_EQ(-2, q.take());
+  }).join();
+}
+
+TEST(WorkStealingBlockingQueue, cpuThreadPoolExecutorJoinRunsLocalTasks) {
+  constexpr int kThreads = 4;
+  // More than kInjectorInterval per worker, so that each of them looks at
+  // the injector, where join() adds its stop requests, while its own deque
+  // is still full.
+  constexpr int kChildren = 500;
+  CPUThreadPoolExecutor ex(
+      kThreads, CPUThreadPoolExecutor::makeWorkStealingQueue(kThreads));
+  std::atomic<int> count{0};
+  Latch queued(kThreads);
+  Latch release(1);
+  for (int i = 0; i < kThreads; ++i) {
+    ex.add([&] {
+      for (int j = 0; j < kChildren; ++j) {
+        ex.add([&] { ++count; });
+      }
+      queued.count_down();
+      release.wait();
+    });
+  }
+  queued.wait();
+  std::thread joiner([&] { ex.join(); });
+  // Every worker is blocked, so the stop requests show up in the count.
+  while (ex.getPendingTaskCount() < kThreads * kChildren + kThreads) {
+    std::this_thread::yield();
+  }
+  release.count_down();
+  joiner.join();
+  EXPECT_EQ(kThreads * kChildren, count.load());
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/AdaptiveThreadPoolSizer.h>
+
+#include <chrono>
+#include <stdexcept>
+
+#include <folly/portability/GTest.h>
+
+using namespace std::chrono;
+using folly::AdaptiveThreadPoolSizer;
+
+namespace {
+
+// 5ms target, 99th percentile, 100ms interval.
+AdaptiveThreadPoolSizer::Options defaultOptions() {
+  return AdaptiveThreadPoolSizer::Options()
+      .setTargetWait(milliseconds(5))
+      .setPercentile(0.99)
+      .setInterval(milliseconds(100))
+      .setMaxCpuUtilization(0.9);
+}
+
+// Records 100 waits, `slow` of them of `slowWait` and the rest of 0.
+void record(
+    AdaptiveThreadPoolSizer& sizer,
+    int slow,
+    nanoseconds slowWait,
+    steady_clock::time_point now) {
+  for (int i = 0; i < 100; ++i) {
+    sizer.recordWait(i < slow ? slowWait : nanoseconds(0), now);
+  }
+}
+
+} // namespace
+
+TEST(AdaptiveThreadPoolSizerTest, intervals) {
+  AdaptiveThreadPoolSizer sizer(defaultOptions());
+  auto now = steady_clock::now();
+  EXPECT_FALSE(sizer.recordWait(milliseconds(1), now));
+  EXPECT_FALSE(sizer.intervalExpired(now + milliseconds(50)));
+  // Only the first caller past the end of the interval gets true.
+  EXPECT_TRUE(sizer.recordWait(milliseconds(1), now + milliseconds(110)));
+  EXPECT_FALSE(sizer.recordWait(milliseconds(1), now + milliseconds(110)));
+  EXPECT_FALSE(sizer.intervalExpired(now + milliseconds(200)));
+  EXPECT_TRUE(sizer.intervalExpired(now + milliseconds(220)));
+}
+
+TEST(AdaptiveThreadPoolSizerTest, growsWhenPercentileOverTarget) {
+  AdaptiveThreadPoolSizer sizer(defaultOptions());
+  auto now = steady_clock::now();
+  // 1% over the target is still within the 99th percentile, so the pool
+  // does not grow (and even shrinks, with 99% under half the target).
+  record(sizer, 1, milliseconds(10), now);
+  EXPECT_EQ(3, sizer.update(4, 1, 16, 0.5, 0));
+  record(sizer, 2, milliseconds(10), now);
+  EXPECT_EQ(5, sizer.update(4, 1, 16, 0.5, 0));
+  record(sizer, 2, milliseconds(10), now);
+  EXPECT_EQ(16, sizer.update(16, 1, 16, 0.5, 0));
+}
+
+TEST(AdaptiveThreadPoolSizerTest, standingQueueGrowsFaster) {
+  AdaptiveThreadPoolSizer sizer(defaultOptions());
+  record(sizer, 100, milliseconds(10), steady_clock::now());
+  EXPECT_EQ(10, sizer.update(8, 1, 16, 0.5, 0));
+  record(sizer, 100, milliseconds(10), steady_clock::now());
+  EXPECT_EQ(16, sizer.update(14, 1, 16, 0.5, 0));
+}
+
+TEST(AdaptiveThreadPoolSizerTest, noGrowthWhenCpuSaturated) {
+  AdaptiveThreadPoolSizer sizer(defaultOptions());
+  record(sizer, 50, milliseconds(10), steady_clock::now());
+  EXPECT_EQ(8, sizer.update(8, 1, 16, 0.95, 0));
+}
+
+TEST(AdaptiveThreadPoolSizerTest, shrinksWithHeadroom) {
+  AdaptiveThreadPoolSizer sizer(defaultOptions());
+  auto now = steady_clock::now();
+  record(sizer, 0, {}, now);
+  EXPECT_EQ(3, sizer.update(4, 1, 16, 0.5, 0));
+  // Between half the target and the target: keep the size.
+  record(sizer, 50, milliseconds(3), now);
+  EXPECT_EQ(4, sizer.update(4, 1, 16, 0.5, 0));
+  // Never below the minimum, nor below one thread.
+  record(sizer, 0, {}, now);
+  EXPECT_EQ(4, sizer.update(4, 4, 16, 0.5, 0));
+  record(sizer, 0, {}, now);
+  EXPECT_EQ(1, sizer.update(1, 0, 16, 0.5, 0));
+}
+
+TEST(AdaptiveThreadPoolSizerTest, emptyIntervals) {
+  AdaptiveThreadPoolSizer sizer(defaultOptions());
+  // Nothing dequeued while tasks wait: every thread is busy.
+  EXPECT_EQ(10, sizer.update(8, 1, 16, 0.5, 3));
+  // Nothing to do at all.
+  EXPECT_EQ(7, sizer.update(8, 1, 16, 0, 0));
+}
+
+TEST(AdaptiveThreadPoolSizerTest, clampsToBounds) {
+  AdaptiveThreadPoolSizer sizer(defaultOptions());
+  record(sizer, 50, milliseconds(3), steady_clock::now());
+  EXPECT_EQ(8, sizer.update(20, 1, 8, 0.5, 0));
+  record(sizer, 50, milliseconds(3), steady_clock::now());
+  EXPECT_EQ(2, sizer.update(0, 2, 8, 0.5, 0));
+  EXPECT_EQ(0, sizer.update(4, 0, 0, 0.5, 0));
+}
+
+TEST(AdaptiveThreadPoolSizerTest, invalidOptions) {
+  EXPECT_THROW(
+      AdaptiveThreadPoolSizer(defaultOptions().setTargetWait(milliseconds(0))),
+      std::invalid_argument);
+  EXPECT_THROW(
+      AdaptiveThreadPoolSizer(defaultOptions().setInterval(milliseconds(0))),
+      std::invalid_argument);
+  EXPECT_THROW(
+      AdaptiveThreadPoolSizer(defaultOptions().setPercentile(1)),
+      std::invalid_argument);
+}
@@ -32,6 +32,14 @@ using namespace folly;
 // number of cores.
 static constexpr size_t kNumThreads = 19;
 
+std::unique_ptr<EDFThreadPoolExecutor> makeStripedEDF() {
+  return std::make_unique<EDFThreadPoolExecutor>(
+      kNumThreads,
+      std::make_shared<NamedThreadFactory>("EDFThreadPool"),
+      EDFThreadPoolExecutor::makeDefaultSemaphore(),
+      EDFThreadPoolExecutor::Options().setNumQueueStripes(0));
+}
+
 void throughput(uint32_t n, std::unique_ptr<ThreadPoolExecutor> ex) {
   while (n--) {
     ex->add([]() {});
@@ -43,6 +51,7 @@ BENCHMARK_NAMED_PARAM(
     throughput, CPUEx, std::make_unique<CPUThreadPoolExecutor>(kNumThreads))
 BENCHMARK_RELATIVE_NAMED_PARAM(
     throughput, EDFEx, std::make_unique<EDFThreadPoolExecutor>(kNumThreads))
+BENCHMARK_RELATIVE_NAMED_PARAM(throughput, EDFExStriped, makeStripedEDF())
 
 void saturated(
     uint32_t n, std::unique_ptr<ThreadPoolExecutor> ex, size_t numTasks) {
@@ -191,6 +200,7 @@ BENCHMARK_NAMED_PARAM(
     multiThreaded, CPUEx, std::make_unique<CPUThreadPoolExecutor>(kNumThreads))
 BENCHMARK_RELATIVE_NAMED_PARAM(
     multiThreaded, EDFEx, std::make_unique<EDFThreadPoolExecutor>(kNumThreads))
+BENCHMARK_RELATIVE_NAMED_PARAM(multiThreaded, EDFExStriped, makeStripedEDF())
 
 int main(int argc, char* argv[]) {
   folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
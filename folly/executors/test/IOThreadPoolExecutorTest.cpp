@@ -15,7 +15,15 @@
  */
 
 #include <folly/executors/IOThreadPoolExecutor.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <folly/concurrency/CacheLocality.h>
 #include <folly/executors/test/IOThreadPoolExecutorBaseTestLib.h>
+#include <folly/portability/Sched.h>
 
 namespace folly {
 namespace test {
@@ -48,6 +56,140 @@ TEST(IOThreadPoolExecutor, MaxReadAtOnce) {
   }
 }
 
+#ifdef __linux__
+namespace {
+
+// Returns the CPUs the calling thread may run on.
+std::vector<size_t> currentAffinity() {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  PCHECK(sched_getaffinity(0, sizeof(set), &set) == 0);
+  std::vector<size_t> cpus;
+  for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set)) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// Returns the CPUs the thread of evb may run on.
+std::vector<size_t> getAffinity(EventBase& evb) {
+  std::vector<size_t> cpus;
+  evb.runInEventBaseThreadAndWait([&] { cpus = currentAffinity(); });
+  return cpus;
+}
+
+// Returns the CPUs the threads of the pool may be pinned to, which may be
+// fewer than the machine's, e.g. in a restricted cpuset.
+std::vector<size_t> allowedCpus() {
+  auto cpus = currentAffinity();
+  auto numCpus = CacheLocality::system().numCpus;
+  cpus.erase(
+      std::remove_if(
+          cpus.begin(), cpus.end(), [&](auto cpu) { return cpu >= numCpus; }),
+      cpus.end());
+  return cpus;
+}
+
+IOThreadPoolExecutor makeExecutor(
+    size_t numThreads, IOThreadPoolExecutor::Options::ThreadAffinity affinity) {
+  return IOThreadPoolExecutor{
+      numThreads,
+      std::make_shared<NamedThreadFactory>("IOThreadPool"),
+      EventBaseManager::get(),
+      IOThreadPoolExecutor::Options{}.setThreadAffinity(affinity)};
+}
+
+} // namespace
+
+TEST(IOThreadPoolExecutor, ThreadAffinityCpu) {
+  using Locality = IOThreadPoolExecutor::Locality;
+  const auto allowed = allowedCpus();
+  ASSERT_FALSE(allowed.empty());
+  auto executor = makeExecutor(
+      2 * allowed.size(), IOThreadPoolExecutor::Options::ThreadAffinity::Cpu);
+
+  // Every CPU gets two threads.
+  std::map<size_t, size_t> threadsByCpu;
+  for (auto& evb : executor.getAllEventBases()) {
+    auto cpus = getAffinity(*evb);
+    ASSERT_EQ(1, cpus.size());
+    ++threadsByCpu[cpus[0]];
+  }
+  EXPECT_EQ(allowed.size(), threadsByCpu.size());
+  for (auto cpu : allowed) {
+    EXPECT_EQ(2, threadsByCpu[cpu]);
+  }
+
+  // A CPU hint picks one of the threads pinned to that CPU, alternately.
+  for (auto cpu : allowed) {
+    auto* evb1 = executor.getEventBase(Locality::cpu(cpu));
+    auto* evb2 = executor.getEventBase(Locality::cpu(cpu));
+    EXPECT_NE(evb1, evb2);
+    EXPECT_EQ(std::vector<size_t>{cpu}, getAffinity(*evb1));
+    EXPECT_EQ(std::vector<size_t>{cpu}, getAffinity(*evb2));
+  }
+
+  // Unknown CPUs and nodes fall back to round-robin.
+  EXPECT_NE(nullptr, executor.getEventBase(Locality::cpu(1 << 20)));
+  EXPECT_NE(nullptr, executor.getEventBase(Locality::numaNode(1 << 20)));
+  EXPECT_NE(nullptr, executor.getEventBase(Locality::numaNode(0)));
+}
+
+TEST(IOThreadPoolExecutor, ThreadAffinityCpuGrow) {
+  const auto allowed = allowedCpus();
+  auto executor = makeExecutor(
+      (allowed.size() + 1) / 2,
+      IOThreadPoolExecutor::Options::ThreadAffinity::Cpu);
+  executor.getAllEventBases();
+  executor.setNumThreads(allowed.size());
+
+  // The threads started later take the CPUs the first ones left.
+  std::set<size_t> used;
+  for (auto& evb : executor.getAllEventBases()) {
+    auto cpus = getAffinity(*evb);
+    ASSERT_EQ(1, cpus.size());
+    EXPECT_TRUE(used.insert(cpus[0]).second) << "CPU " << cpus[0];
+  }
+  EXPECT_EQ(std::set<size_t>(allowed.begin(), allowed.end()), used);
+}
+
+TEST(IOThreadPoolExecutor, ThreadAffinityLastLevelCache) {
+  using Locality = IOThreadPoolExecutor::Locality;
+  const auto& locality = CacheLocality::system();
+  const auto allowed = allowedCpus();
+  std::set<size_t> caches;
+  for (auto cpu : allowed) {
+    caches.insert(locality.equivClassesByCpu[cpu].back());
+  }
+  auto executor = makeExecutor(
+      caches.size(),
+      IOThreadPoolExecutor::Options::ThreadAffinity::LastLevelCache);
+
+  // A CPU hint picks the thread pinned to the CPU's cache, which has one.
+  for (auto cpu : allowed) {
+    auto cpus = getAffinity(*executor.getEventBase(Locality::cpu(cpu)));
+    EXPECT_NE(cpus.end(), std::find(cpus.begin(), cpus.end(), cpu));
+    for (auto other : cpus) {
+      EXPECT_NE(
+          allowed.end(), std::find(allowed.begin(), allowed.end(), other));
+      EXPECT_EQ(
+          locality.equivClassesByCpu[cpu].back(),
+          locality.equivClassesByCpu[other].back());
+    }
+  }
+}
+
+TEST(IOThreadPoolExecutor, ThreadAffinityNone) {
+  auto executor =
+      makeExecutor(2, IOThreadPoolExecutor::Options::ThreadAffinity::None);
+  auto* evb1 = executor.getEventBase(IOThreadPoolExecutor::Locality::cpu(0));
+  auto* evb2 = executor.getEventBase(IOThreadPoolExecutor::Locality::cpu(0));
+  EXPECT_NE(evb1, evb2);
+}
+#endif
+
 INSTANTIATE_TYPED_TEST_SUITE_P(
     IOThreadPoolExecutorTest,
     IOThreadPoolExecutorBaseTest,
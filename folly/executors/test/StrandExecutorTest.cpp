@@ -122,7 +122,7 @@ TEST(StrandExecutor, ThreadSafetyTest) {
 
 TEST(StrandExecutor, RequestContextPropagation) {
   auto exec = StrandExecutor::create();
-  // Use a number larger than maxItemsToProcessSynchronously so we exercise
+  // Use a number larger than the default maxBatchSize so we exercise
   // worker reschedules.
   constexpr size_t kNumTasks = 128;
 
@@ -150,3 +150,74 @@ TEST(StrandExecutor, RequestContextPropagation) {
 
   EXPECT_EQ(numTasksRan, kNumTasks);
 }
+
+namespace {
+// Runs tasks on a ManualExecutor, recording the priority of each.
+class RecordingExecutor : public Executor {
+ public:
+  void add(Func f) override { addWithPriority(std::move(f), MID_PRI); }
+
+  void addWithPriority(Func f, int8_t priority) override {
+    priorities.push_back(priority);
+    ex.add(std::move(f));
+  }
+
+  uint8_t getNumPriorities() const override { return 3; }
+
+  ManualExecutor ex;
+  std::vector<int8_t> priorities;
+};
+} // namespace
+
+TEST(StrandExecutor, MaxBatchSize) {
+  RecordingExecutor parent;
+  StrandContext::Options options;
+  options.maxBatchSize = 10;
+  auto exec = StrandExecutor::create(
+      StrandContext::create(options), getKeepAliveToken(parent));
+
+  int numRan = 0;
+  for (int i = 0; i < 100; ++i) {
+    exec->add([&] { ++numRan; });
+  }
+  parent.ex.drain();
+  EXPECT_EQ(100, numRan);
+  EXPECT_EQ(10, parent.priorities.size());
+}
+
+TEST(StrandExecutor, MaxBatchTime) {
+  RecordingExecutor parent;
+  StrandContext::Options options;
+  options.maxBatchSize = 1000;
+  options.maxBatchTime = 2ms;
+  auto exec = StrandExecutor::create(
+      StrandContext::create(options), getKeepAliveToken(parent));
+
+  for (int i = 0; i < 20; ++i) {
+    exec->add([] { burnTime(1ms); });
+  }
+  parent.ex.drain();
+  // At most two tasks fit in each batch, but a slow machine may run fewer.
+  EXPECT_GE(parent.priorities.size(), 10);
+  EXPECT_LE(parent.priorities.size(), 20);
+}
+
+TEST(StrandExecutor, BatchPriority) {
+  RecordingExecutor parent;
+  auto exec = StrandExecutor::create(getKeepAliveToken(parent));
+
+  std::vector<int> order;
+  // Functions of equal or higher priority join the batch, while a lower
+  // priority one gets scheduled at its own priority.
+  exec->addWithPriority([&] { order.push_back(0); }, Executor::HI_PRI);
+  exec->addWithPriority([&] { order.push_back(1); }, Executor::HI_PRI);
+  exec->addWithPriority([&] { order.push_back(2); }, Executor::LO_PRI);
+  exec->add([&] { order.push_back(3); });
+  exec->addWithPriority([&] { order.push_back(4); }, Executor::LO_PRI);
+  parent.ex.drain();
+
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), order);
+  EXPECT_EQ(
+      (std::vector<int8_t>{Executor::HI_PRI, Executor::LO_PRI}),
+      parent.priorities);
+}
@@ -14,14 +14,17 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include <boost/thread.hpp>
 #include <folly/CPortability.h>
 #include <folly/DefaultKeepAliveExecutor.h>
 #include <folly/Exception.h>
+#include <folly/Random.h>
 #include <folly/container/F14Map.h>
 #include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/executors/EDFThreadPoolExecutor.h>
@@ -98,11 +101,28 @@ FOLLY_KEEP std::unique_ptr<QueueObserverFactory> make_queue_observer_factory(
 
 } // namespace folly
 
+// Runs the typed tests on EDFThreadPoolExecutor's striped task queue too.
+class StripedQueueEDFThreadPoolExecutor : public EDFThreadPoolExecutor {
+ public:
+  explicit StripedQueueEDFThreadPoolExecutor(
+      size_t numThreads,
+      std::shared_ptr<ThreadFactory> threadFactory =
+          std::make_shared<NamedThreadFactory>("EDFThreadPool"))
+      : EDFThreadPoolExecutor(
+            numThreads,
+            std::move(threadFactory),
+            makeDefaultSemaphore(),
+            Options().setNumQueueStripes(4)) {}
+};
+
 template <typename T>
 class ThreadPoolExecutorTypedTest : public ::testing::Test {};
 
-using ValueTypes = ::testing::
-    Types<CPUThreadPoolExecutor, IOThreadPoolExecutor, EDFThreadPoolExecutor>;
+using ValueTypes = ::testing::Types<
+    CPUThreadPoolExecutor,
+    IOThreadPoolExecutor,
+    EDFThreadPoolExecutor,
+    StripedQueueEDFThreadPoolExecutor>;
 
 TYPED_TEST_SUITE(ThreadPoolExecutorTypedTest, ValueTypes);
 
@@ -279,10 +299,164 @@ TEST(ThreadPoolExecutorTest, EDFPoolStats) {
   poolStats<EDFThreadPoolExecutor>();
 }
 
+TEST(ThreadPoolExecutorTest, EDFDeadlineOrder) {
+  EDFThreadPoolExecutor ex(1);
+  EXPECT_EQ(1, ex.getNumQueueStripes());
+  Baton<> started;
+  Baton<> release;
+  ex.add(
+      [&] {
+        started.post();
+        release.wait();
+      },
+      EDFThreadPoolExecutor::kEarliestDeadline);
+  started.wait();
+
+  // Few distinct deadlines, so that there are many ties.
+  std::vector<std::pair<uint64_t, int>> order;
+  for (int i = 0; i < 1000; ++i) {
+    uint64_t deadline = folly::Random::rand32(10);
+    ex.add(
+        [&order, deadline, i] { order.emplace_back(deadline, i); }, deadline);
+  }
+  release.post();
+  ex.join();
+  ASSERT_EQ(1000, order.size());
+  EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+}
+
+TEST(ThreadPoolExecutorTest, EDFStripedQueue) {
+  EDFThreadPoolExecutor ex(
+      4,
+      std::make_shared<NamedThreadFactory>("EDFThreadPool"),
+      EDFThreadPoolExecutor::makeDefaultSemaphore(),
+      EDFThreadPoolExecutor::Options().setNumQueueStripes(8));
+  EXPECT_EQ(8, ex.getNumQueueStripes());
+
+  constexpr int kSubmitters = 4;
+  constexpr int kTasksPerSubmitter = 10000;
+  std::vector<std::atomic<int>> runs(kSubmitters * kTasksPerSubmitter);
+  std::vector<std::thread> submitters;
+  for (int s = 0; s < kSubmitters; ++s) {
+    submitters.emplace_back([&, s] {
+      for (int i = 0; i < kTasksPerSubmitter; i += 2) {
+        auto* r = &runs[s * kTasksPerSubmitter + i];
+        uint64_t deadline = folly::Random::rand64();
+        if (i % 20 == 0) {
+          // Multi-function tasks are shared by the threads running them.
+          std::vector<Func> fs;
+          fs.emplace_back([r] { ++r[0]; });
+          fs.emplace_back([r] { ++r[1]; });
+          ex.add(std::move(fs), deadline);
+        } else {
+          ex.add([r] { ++r[0]; }, deadline);
+          ex.add([r] { ++r[1]; }, deadline);
+        }
+      }
+    });
+  }
+  for (auto& t : submitters) {
+    t.join();
+  }
+  ex.join();
+  for (auto& r : runs) {
+    ASSERT_EQ(1, r.load());
+  }
+}
+
+TEST(ThreadPoolExecutorTest, EDFStripedQueuePerCache) {
+  EDFThreadPoolExecutor ex(
+      2,
+      std::make_shared<NamedThreadFactory>("EDFThreadPool"),
+      EDFThreadPoolExecutor::makeDefaultSemaphore(),
+      EDFThreadPoolExecutor::Options().setNumQueueStripes(0));
+  EXPECT_GE(ex.getNumQueueStripes(), 1);
+  std::atomic<int> count{0};
+  for (int i = 0; i < 100; ++i) {
+    ex.add([&] { ++count; }, i);
+  }
+  ex.join();
+  EXPECT_EQ(100, count.load());
+}
+
 TEST(ThreadPoolExecutorTest, IOPoolStats) {
   poolStats<IOThreadPoolExecutor>();
 }
 
+static void runTaskAndWait(Executor& ex) {
+  folly::Baton<> done;
+  ex.add([&] { done.post(); });
+  done.wait();
+}
+
+template <class TPE>
+static void idleWaitStats(TPE& tpe, bool spins) {
+  runTaskAndWait(tpe);
+  auto stats = tpe.getPoolStats();
+  auto spinTime = stats.idleSpinTime;
+  auto parkTime = stats.idleParkTime;
+  // The thread spins for the whole window, then blocks until the task.
+  /* sleep override */ std::this_thread::sleep_for(milliseconds(50));
+  runTaskAndWait(tpe);
+  // The IO threads publish their stats before the next loop.
+  runTaskAndWait(tpe);
+  stats = tpe.getPoolStats();
+  if (spins) {
+    EXPECT_GE(stats.idleSpinTime - spinTime, milliseconds(5));
+    EXPECT_LT(stats.idleSpinTime - spinTime, milliseconds(50));
+    EXPECT_GE(stats.idleParkTime - parkTime, milliseconds(20));
+  } else {
+    EXPECT_EQ(nanoseconds(0), stats.idleSpinTime);
+    EXPECT_EQ(nanoseconds(0), stats.idleParkTime);
+  }
+}
+
+TEST(ThreadPoolExecutorTest, CPUPoolIdleWaitStats) {
+  CPUThreadPoolExecutor noSpin(1);
+  idleWaitStats(noSpin, false);
+  CPUThreadPoolExecutor spin(
+      1,
+      CPUThreadPoolExecutor::Options().setWaitOptions(
+          WaitOptions().spin_max(milliseconds(5))));
+  idleWaitStats(spin, true);
+  CPUThreadPoolExecutor throttledSpin(
+      1,
+      CPUThreadPoolExecutor::makeThrottledLifoSemQueue(),
+      std::make_shared<NamedThreadFactory>("CPUThreadPool"),
+      CPUThreadPoolExecutor::Options().setWaitOptions(
+          WaitOptions().spin_max(milliseconds(5))));
+  idleWaitStats(throttledSpin, true);
+}
+
+TEST(ThreadPoolExecutorTest, CPUPoolSpinsUnderSteadyLoad) {
+  CPUThreadPoolExecutor tpe(
+      1,
+      CPUThreadPoolExecutor::Options().setWaitOptions(
+          WaitOptions().spin_max(milliseconds(200))));
+  runTaskAndWait(tpe);
+  auto before = tpe.getPoolStats();
+  // Each task comes well within the spin window of the wait for it.
+  for (int i = 0; i < 20; ++i) {
+    /* sleep override */ std::this_thread::sleep_for(milliseconds(1));
+    runTaskAndWait(tpe);
+  }
+  auto after = tpe.getPoolStats();
+  EXPECT_GE(after.idleSpinTime - before.idleSpinTime, milliseconds(10));
+  EXPECT_EQ(before.idleParkTime, after.idleParkTime);
+}
+
+TEST(ThreadPoolExecutorTest, IOPoolIdleWaitStats) {
+  IOThreadPoolExecutor noSpin(1);
+  idleWaitStats(noSpin, false);
+  IOThreadPoolExecutor spin(
+      1,
+      std::make_shared<NamedThreadFactory>("IOThreadPool"),
+      EventBaseManager::get(),
+      IOThreadPoolExecutor::Options().setWaitOptions(
+          WaitOptions().spin_max(milliseconds(5))));
+  idleWaitStats(spin, true);
+}
+
 template <class TPE>
 static void taskStats() {
   TPE tpe(1);
@@ -369,6 +543,148 @@ TYPED_TEST(ThreadPoolExecutorTypedTest, TaskObserver) {
   }
 }
 
+#ifdef __linux__
+TYPED_TEST(ThreadPoolExecutorTypedTest, TaskCpuTime) {
+  struct CpuTimeObserver : ThreadPoolExecutor::TaskObserver {
+    void taskDequeued(
+        const ThreadPoolExecutor::DequeuedTaskInfo& info) noexcept override {
+      EXPECT_EQ(expectedContext, info.context);
+    }
+
+    void taskProcessed(
+        const ThreadPoolExecutor::ProcessedTaskInfo& info) noexcept override {
+      EXPECT_EQ(nullptr, info.context);
+      cpuTimes.wlock()->push_back(info.cpuTime);
+    }
+
+    const RequestContext* expectedContext = nullptr;
+    Synchronized<std::vector<std::chrono::nanoseconds>> cpuTimes;
+  };
+
+  TypeParam ex{1};
+  auto observer = std::make_unique<CpuTimeObserver>();
+  auto* observerPtr = observer.get();
+  ex.addTaskObserver(std::move(observer));
+  auto runAndGetCpuTime = [&](Func func) {
+    Baton<> done;
+    ex.add([&] {
+      func();
+      done.post();
+    });
+    done.wait();
+    // The observer runs after the task.
+    while (observerPtr->cpuTimes.rlock()->empty()) {
+      std::this_thread::yield();
+    }
+    return observerPtr->cpuTimes.wlock()->back();
+  };
+
+  // Not measured by default.
+  EXPECT_EQ(0ns, runAndGetCpuTime([] { burnThreadCpu(20ms); }));
+  observerPtr->cpuTimes.wlock()->clear();
+
+  ex.enableTaskCpuTime();
+  EXPECT_GE(runAndGetCpuTime([] { burnThreadCpu(20ms); }), 20ms);
+  observerPtr->cpuTimes.wlock()->clear();
+  EXPECT_LT(runAndGetCpuTime(burnMs(20)), 10ms);
+  observerPtr->cpuTimes.wlock()->clear();
+
+  RequestContextScopeGuard guard;
+  observerPtr->expectedContext = RequestContext::get();
+  runAndGetCpuTime([] {});
+  ex.join();
+}
+#endif
+
+template <class TPE>
+static void testAddBatch(TPE& ex) {
+  struct CountingTaskObserver : ThreadPoolExecutor::TaskObserver {
+    void taskEnqueued(const ThreadPoolExecutor::TaskInfo&) noexcept override {
+      ++enqueued;
+    }
+    void taskDequeued(
+        const ThreadPoolExecutor::DequeuedTaskInfo&) noexcept override {}
+    void taskProcessed(
+        const ThreadPoolExecutor::ProcessedTaskInfo&) noexcept override {}
+
+    std::atomic<size_t> enqueued{0};
+  };
+  auto observer = std::make_unique<CountingTaskObserver>();
+  auto* observerPtr = observer.get();
+  ex.addTaskObserver(std::move(observer));
+
+  static constexpr size_t kNumTasks = 1000;
+  std::atomic<size_t> sum{0};
+  std::vector<Func> funcs;
+  for (size_t i = 0; i < kNumTasks; ++i) {
+    funcs.emplace_back([&sum, i] { sum += i; });
+  }
+  ex.addBatch(funcs);
+  for (auto& func : funcs) {
+    EXPECT_FALSE(func);
+  }
+  ex.addBatch({});
+  ex.join();
+  EXPECT_EQ(kNumTasks * (kNumTasks - 1) / 2, sum.load());
+  if constexpr (std::is_base_of_v<EDFThreadPoolExecutor, TPE>) {
+    // EDF enqueues the batch as a single multi-function task.
+    EXPECT_EQ(1, observerPtr->enqueued.load());
+  } else {
+    EXPECT_EQ(kNumTasks, observerPtr->enqueued.load());
+  }
+}
+
+TYPED_TEST(ThreadPoolExecutorTypedTest, AddBatch) {
+  TypeParam ex{4};
+  testAddBatch(ex);
+}
+
+TEST(ThreadPoolExecutorTest, AddBatchQueues) {
+  {
+    CPUThreadPoolExecutor ex(4, CPUThreadPoolExecutor::makeLifoSemQueue());
+    testAddBatch(ex);
+  }
+  {
+    CPUThreadPoolExecutor ex(
+        4, CPUThreadPoolExecutor::makeThrottledLifoSemPriorityQueue(3));
+    testAddBatch(ex);
+  }
+  {
+    CPUThreadPoolExecutor ex(
+        4, CPUThreadPoolExecutor::makeWorkStealingQueue(4));
+    testAddBatch(ex);
+  }
+  {
+    CPUThreadPoolExecutor ex(
+        4, std::make_unique<LifoSemMPMCQueue<CPUThreadPoolExecutor::CPUTask>>(
+               1 << 12));
+    testAddBatch(ex);
+  }
+}
+
+TEST(ThreadPoolExecutorTest, AddBatchFromPoolThreads) {
+  CPUThreadPoolExecutor cpu(4, CPUThreadPoolExecutor::makeWorkStealingQueue());
+  IOThreadPoolExecutor io(4);
+  std::atomic<int> count{0};
+  folly::Latch done(2 * 100 * 10);
+  for (Executor* ex : std::initializer_list<Executor*>{&cpu, &io}) {
+    for (int i = 0; i < 10; ++i) {
+      ex->add([&, ex] {
+        std::vector<Func> funcs;
+        for (int j = 0; j < 100; ++j) {
+          funcs.emplace_back([&] {
+            ++count;
+            done.count_down();
+          });
+        }
+        ex->addBatch(funcs);
+      });
+    }
+  }
+  done.wait();
+  EXPECT_EQ(2 * 100 * 10, count.load());
+}
+
 TEST(ThreadPoolExecutorTest, GetUsedCpuTime) {
 #ifdef __linux__
   CPUThreadPoolExecutor e(4);
@@ -1046,6 +1362,45 @@ TEST(ThreadPoolExecutorTest, DynamicThreadAddRemoveRace) {
   EXPECT_EQ(count, 10000);
 }
 
+TEST(ThreadPoolExecutorTest, CPUAdaptiveSizing) {
+  CPUThreadPoolExecutor e(std::make_pair(8, 1));
+  // Threads above the cap must retire without waiting for the death timeout.
+  e.setThreadDeathTimeout(60s);
+  e.enableAdaptiveSizing(AdaptiveThreadPoolSizer::Options()
+                             .setTargetWait(1ms)
+                             .setInterval(10ms)
+                             .setMaxCpuUtilization(1));
+
+  // A burst of blocking tasks builds a queue, which grows the pool.
+  constexpr int kBurst = 200;
+  folly::Latch done(kBurst);
+  std::atomic<size_t> peak{0};
+  for (int i = 0; i < kBurst; ++i) {
+    e.add([&] {
+      /* sleep override */ std::this_thread::sleep_for(2ms);
+      auto active = e.numActiveThreads();
+      auto prev = peak.load();
+      while (active > prev && !peak.compare_exchange_weak(prev, active)) {
+      }
+      done.count_down();
+    });
+  }
+  done.wait();
+  EXPECT_GT(peak.load(), 1);
+  EXPECT_LE(peak.load(), 8);
+
+  // A trickle of tasks that never wait shrinks it back.
+  auto deadline = steady_clock::now() + 10s;
+  while (e.numActiveThreads() > 1 && steady_clock::now() < deadline) {
+    Baton<> b;
+    e.add([&] { b.post(); });
+    b.wait();
+    /* sleep override */ std::this_thread::sleep_for(5ms);
+  }
+  EXPECT_EQ(1, e.numActiveThreads());
+  e.join();
+}
+
 TEST(ThreadPoolExecutorTest, AddPerf) {
   CPUThreadPoolExecutor e(
       kIsSanitizeThread ? 25 : 1000,
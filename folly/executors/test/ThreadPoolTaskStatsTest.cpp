@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/ThreadPoolTaskStats.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <thread>
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/EDFThreadPoolExecutor.h>
+#include <folly/executors/IOThreadPoolExecutor.h>
+#include <folly/portability/GTest.h>
+#include <folly/portability/Time.h>
+
+using namespace folly;
+using namespace std::chrono;
+
+namespace {
+
+const std::array<double, 1> kQuantiles{{.5}};
+
+void burnCpu(milliseconds ms) {
+  auto now = [] {
+    timespec tp{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &tp);
+    return nanoseconds(tp.tv_nsec) + seconds(tp.tv_sec);
+  };
+  auto expires = now() + ms;
+  while (now() < expires) {
+  }
+}
+
+} // namespace
+
+template <typename T>
+class ThreadPoolTaskStatsTest : public ::testing::Test {};
+
+using ValueTypes = ::testing::
+    Types<CPUThreadPoolExecutor, IOThreadPoolExecutor, EDFThreadPoolExecutor>;
+
+TYPED_TEST_SUITE(ThreadPoolTaskStatsTest, ValueTypes);
+
+TYPED_TEST(ThreadPoolTaskStatsTest, Tags) {
+  TypeParam ex{2};
+  auto stats = ThreadPoolTaskStats::attach(ex);
+
+  auto addTagged = [&](const char* tag, int n, auto func) {
+    RequestContextScopeGuard guard;
+    ThreadPoolTaskStats::setRequestTag(tag);
+    for (int i = 0; i < n; ++i) {
+      ex.add(func);
+    }
+  };
+  addTagged("spin", 3, [] { burnCpu(10ms); });
+  addTagged("sleep", 2, [] {
+    /* sleep override */ std::this_thread::sleep_for(10ms);
+  });
+  ex.add([] {});
+  ex.join();
+
+  auto all = stats->getEstimates(kQuantiles);
+  EXPECT_EQ(6, all.waitTime.count);
+  EXPECT_EQ(6, all.runTime.count);
+  EXPECT_EQ(6, all.cpuTime.count);
+
+  auto tags = stats->getTagEstimates(kQuantiles);
+  ASSERT_EQ(2, tags.size());
+  std::sort(tags.begin(), tags.end(), [](auto& a, auto& b) {
+    return a.first < b.first;
+  });
+  auto& [sleepTag, sleep] = tags[0];
+  auto& [spinTag, spin] = tags[1];
+  EXPECT_EQ("sleep", sleepTag);
+  EXPECT_EQ(2, sleep.runTime.count);
+  EXPECT_GE(sleep.runTime.quantiles[0].second, nanoseconds(10ms).count());
+  EXPECT_LT(sleep.cpuTime.quantiles[0].second, nanoseconds(5ms).count());
+  EXPECT_EQ("spin", spinTag);
+  EXPECT_EQ(3, spin.cpuTime.count);
+  EXPECT_GE(spin.cpuTime.quantiles[0].second, nanoseconds(10ms).count());
+}
+
+TEST(ThreadPoolTaskStatsTest, RequestTag) {
+  RequestContextScopeGuard guard;
+  auto& context = *RequestContext::get();
+  EXPECT_EQ(nullptr, ThreadPoolTaskStats::getRequestTag(context));
+  ThreadPoolTaskStats::setRequestTag("a");
+  ThreadPoolTaskStats::setRequestTag("b");
+  auto tag = ThreadPoolTaskStats::getRequestTag(context);
+  ASSERT_NE(nullptr, tag);
+  EXPECT_EQ("b", *tag);
+}
+
+TEST(ThreadPoolTaskStatsTest, ExpiredTasks) {
+  CPUThreadPoolExecutor ex{1};
+  auto stats = ThreadPoolTaskStats::attach(ex);
+  ex.add([] { /* sleep override */ std::this_thread::sleep_for(20ms); });
+  ex.add([] {}, 1ms);
+  ex.join();
+  auto all = stats->getEstimates(kQuantiles);
+  EXPECT_EQ(2, all.waitTime.count);
+  EXPECT_EQ(1, all.runTime.count);
+}
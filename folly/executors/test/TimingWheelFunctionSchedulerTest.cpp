@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/TimingWheelFunctionScheduler.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/portability/GTest.h>
+#include <folly/synchronization/Baton.h>
+#include <folly/system/ThreadName.h>
+
+using namespace folly;
+using namespace std::chrono;
+
+namespace {
+
+void delay(milliseconds ms) {
+  /* sleep override */ std::this_thread::sleep_for(ms);
+}
+
+} // namespace
+
+TEST(TimingWheelFunctionScheduler, StartAndShutdown) {
+  TimingWheelFunctionScheduler fs;
+  EXPECT_TRUE(fs.start());
+  EXPECT_FALSE(fs.start());
+  EXPECT_TRUE(fs.shutdown());
+  EXPECT_FALSE(fs.shutdown());
+  // start again
+  EXPECT_TRUE(fs.start());
+  EXPECT_TRUE(fs.shutdown());
+}
+
+TEST(TimingWheelFunctionScheduler, InvalidArguments) {
+  TimingWheelFunctionScheduler fs;
+  EXPECT_THROW(fs.addFunction([] {}, 0ms), std::invalid_argument);
+  EXPECT_THROW(fs.addFunction([] {}, 1ms, -1ms), std::invalid_argument);
+  EXPECT_THROW(fs.addFunctionOnce(nullptr), std::invalid_argument);
+  EXPECT_THROW(
+      TimingWheelFunctionScheduler(
+          TimingWheelFunctionScheduler::Options().setTick(0us)),
+      std::invalid_argument);
+}
+
+TEST(TimingWheelFunctionScheduler, Periodic) {
+  std::atomic<int> total{0};
+  TimingWheelFunctionScheduler fs;
+  fs.addFunction([&] { ++total; }, 20ms);
+  EXPECT_EQ(0, total);
+  fs.start();
+  delay(10ms);
+  EXPECT_EQ(1, total);
+  delay(200ms);
+  fs.shutdown();
+  EXPECT_GE(total, 9);
+  EXPECT_LE(total, 12);
+}
+
+TEST(TimingWheelFunctionScheduler, Once) {
+  std::atomic<int> total{0};
+  TimingWheelFunctionScheduler fs;
+  fs.start();
+  fs.addFunctionOnce([&] { ++total; }, 20ms);
+  delay(10ms);
+  EXPECT_EQ(0, total);
+  EXPECT_EQ(1, fs.numFunctions());
+  delay(30ms);
+  EXPECT_EQ(1, total);
+  EXPECT_EQ(0, fs.numFunctions());
+}
+
+TEST(TimingWheelFunctionScheduler, Cancel) {
+  std::atomic<int> a{0};
+  std::atomic<int> b{0};
+  TimingWheelFunctionScheduler fs;
+  auto idA = fs.addFunction([&] { ++a; }, 10ms);
+  fs.addFunction([&] { ++b; }, 10ms);
+  fs.start();
+  delay(25ms);
+  EXPECT_TRUE(fs.cancelFunction(idA));
+  EXPECT_FALSE(fs.cancelFunction(idA));
+  int ranA = a;
+  EXPECT_GE(ranA, 2);
+  delay(50ms);
+  EXPECT_EQ(ranA, a);
+  EXPECT_GE(b, ranA + 4);
+  fs.cancelAllFunctions();
+  EXPECT_EQ(0, fs.numFunctions());
+  int ranB = b;
+  delay(30ms);
+  EXPECT_EQ(ranB, b);
+}
+
+// Delays that span every level of the wheel but the last, with a 10us tick.
+TEST(TimingWheelFunctionScheduler, Cascade) {
+  TimingWheelFunctionScheduler fs(
+      TimingWheelFunctionScheduler::Options().setTick(10us));
+  const std::vector<microseconds> delays{1ms, 2560us, 30ms, 700ms};
+  std::vector<steady_clock::time_point> ranAt(delays.size());
+  std::atomic<size_t> remaining{delays.size()};
+  Baton<> done;
+  fs.start();
+  auto start = steady_clock::now();
+  for (size_t i = 0; i < delays.size(); ++i) {
+    fs.addFunctionOnce(
+        [&, i] {
+          ranAt[i] = steady_clock::now();
+          if (--remaining == 0) {
+            done.post();
+          }
+        },
+        delays[i]);
+  }
+  ASSERT_TRUE(done.try_wait_for(5s));
+  for (size_t i = 0; i < delays.size(); ++i) {
+    EXPECT_GE(ranAt[i] - start, delays[i]) << i;
+    EXPECT_LT(ranAt[i] - start, delays[i] + 20ms) << i;
+  }
+}
+
+// Functions added at arbitrary points within a tick, while the thread keeps
+// running within the tick, never run before their delay.
+TEST(TimingWheelFunctionScheduler, NeverEarly) {
+  constexpr size_t kNumFunctions = 200;
+  TimingWheelFunctionScheduler fs;
+  std::vector<steady_clock::time_point> addedAt(kNumFunctions);
+  std::vector<steady_clock::time_point> ranAt(kNumFunctions);
+  std::vector<milliseconds> delays(kNumFunctions);
+  std::atomic<size_t> remaining{kNumFunctions};
+  Baton<> done;
+  fs.start();
+  for (size_t i = 0; i < kNumFunctions; ++i) {
+    delays[i] = milliseconds(i % 3);
+    addedAt[i] = steady_clock::now();
+    fs.addFunctionOnce(
+        [&, i] {
+          ranAt[i] = steady_clock::now();
+          if (--remaining == 0) {
+            done.post();
+          }
+        },
+        delays[i]);
+    /* sleep override */ std::this_thread::sleep_for(microseconds(i % 7 * 50));
+  }
+  ASSERT_TRUE(done.try_wait_for(5s));
+  for (size_t i = 0; i < kNumFunctions; ++i) {
+    EXPECT_GE(ranAt[i] - addedAt[i], delays[i]) << i;
+  }
+}
+
+TEST(TimingWheelFunctionScheduler, ManyFunctions) {
+  constexpr int kNumFunctions = 100000;
+  std::atomic<int> total{0};
+  TimingWheelFunctionScheduler fs(
+      TimingWheelFunctionScheduler::Options().setStartJitter(true));
+  std::vector<TimingWheelFunctionScheduler::FunctionId> ids;
+  for (int i = 0; i < kNumFunctions; ++i) {
+    ids.push_back(fs.addFunction([&] { ++total; }, 100ms));
+  }
+  fs.start();
+  // With the start jitter, each function first runs within one interval.
+  delay(150ms);
+  EXPECT_GE(total, kNumFunctions);
+  EXPECT_LT(total, 2 * kNumFunctions);
+  for (auto id : ids) {
+    EXPECT_TRUE(fs.cancelFunction(id));
+  }
+  EXPECT_EQ(0, fs.numFunctions());
+}
+
+TEST(TimingWheelFunctionScheduler, StartJitter) {
+  constexpr int kNumFunctions = 1000;
+  std::mutex mutex;
+  std::vector<steady_clock::time_point> firstRuns;
+  TimingWheelFunctionScheduler fs(
+      TimingWheelFunctionScheduler::Options().setStartJitter(true));
+  for (int i = 0; i < kNumFunctions; ++i) {
+    fs.addFunction(
+        [&, ran = false]() mutable {
+          if (!std::exchange(ran, true)) {
+            std::lock_guard g(mutex);
+            firstRuns.push_back(steady_clock::now());
+          }
+        },
+        100ms);
+  }
+  fs.start();
+  delay(150ms);
+  fs.shutdown();
+  ASSERT_EQ(kNumFunctions, firstRuns.size());
+  std::sort(firstRuns.begin(), firstRuns.end());
+  // The first runs are spread over the interval rather than all on start.
+  EXPECT_GT(firstRuns.back() - firstRuns.front(), 50ms);
+  auto first = firstRuns.front();
+  auto onFirstTick =
+      std::count_if(firstRuns.begin(), firstRuns.end(), [&](auto t) {
+        return t - first < 1ms;
+      });
+  EXPECT_LT(onFirstTick, kNumFunctions / 10);
+}
+
+TEST(TimingWheelFunctionScheduler, Executor) {
+  CPUThreadPoolExecutor ex(2);
+  std::atomic<int> running{0};
+  std::atomic<int> maxRunning{0};
+  std::atomic<int> total{0};
+  std::atomic<bool> onPool{true};
+  {
+    TimingWheelFunctionScheduler fs(
+        TimingWheelFunctionScheduler::Options(), getKeepAliveToken(ex));
+    fs.addFunction(
+        [&] {
+          int r = ++running;
+          maxRunning = std::max<int>(maxRunning, r);
+          onPool = onPool && getCurrentThreadName() != "FuncSched";
+          // Longer than the interval: the runs that are due meanwhile are
+          // skipped, rather than run concurrently.
+          delay(25ms);
+          --running;
+          ++total;
+        },
+        10ms);
+    fs.start();
+    delay(200ms);
+  }
+  // The scheduler holds a keep-alive of the executor until destroyed.
+  ex.join();
+  EXPECT_TRUE(onPool);
+  EXPECT_EQ(1, maxRunning);
+  EXPECT_GE(total, 4);
+  EXPECT_LE(total, 8);
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/WeightedFairMeteredExecutor.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <folly/executors/ManualExecutor.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(WeightedFairMeteredExecutorTest, WeightedShare) {
+  ManualExecutor manual;
+  WeightedFairMeteredExecutor fair(getKeepAliveToken(manual));
+  auto& a = fair.addTenant("a", 3);
+  auto& b = fair.addTenant("b");
+
+  std::string order;
+  for (int i = 0; i < 400; ++i) {
+    a.add([&] { order += 'a'; });
+  }
+  for (int i = 0; i < 100; ++i) {
+    b.add([&] { order += 'b'; });
+  }
+  for (int i = 0; i < 200; ++i) {
+    EXPECT_EQ(1, manual.step());
+  }
+  EXPECT_EQ("aaab", order.substr(0, 4));
+  EXPECT_EQ(150, std::count(order.begin(), order.end(), 'a'));
+
+  // Once b is done, a gets all the slots.
+  manual.drain();
+  EXPECT_EQ(500, order.size());
+  EXPECT_EQ(300, std::count(order.begin(), order.begin() + 400, 'a'));
+  EXPECT_EQ(std::string(100, 'a'), order.substr(400));
+}
+
+TEST(WeightedFairMeteredExecutorTest, NoisyTenant) {
+  ManualExecutor manual;
+  WeightedFairMeteredExecutor fair(getKeepAliveToken(manual));
+  auto& noisy = fair.addTenant("noisy", 4);
+  auto& quiet = fair.addTenant("quiet");
+
+  int noisyRan = 0;
+  bool quietRan = false;
+  for (int i = 0; i < 1000; ++i) {
+    noisy.add([&] { ++noisyRan; });
+  }
+  manual.step();
+  quiet.add([&] { quietRan = true; });
+  // The quiet tenant waits at most a round of the noisy one's tokens.
+  while (!quietRan) {
+    ASSERT_EQ(1, manual.step());
+  }
+  EXPECT_LE(noisyRan, 5);
+
+  auto stats = fair.getTenantStats();
+  ASSERT_EQ(3, stats.size());
+  EXPECT_EQ("default", stats[0].name);
+  EXPECT_EQ("noisy", stats[1].name);
+  EXPECT_EQ(4, stats[1].weight);
+  EXPECT_EQ(noisyRan, stats[1].dispatched);
+  EXPECT_EQ(1000 - noisyRan, stats[1].backlog);
+  EXPECT_EQ("quiet", stats[2].name);
+  EXPECT_EQ(1, stats[2].dispatched);
+  EXPECT_EQ(0, stats[2].backlog);
+  manual.drain();
+}
+
+TEST(WeightedFairMeteredExecutorTest, MaxInQueue) {
+  // maxInQueue bounds the workers waiting on the wrapped executor, not the
+  // tasks running at once, so count what is queued on it.
+  struct CountingExecutor : ManualExecutor {
+    void add(Func f) override {
+      ++queued;
+      ManualExecutor::add([this, f = std::move(f)]() mutable {
+        --queued;
+        f();
+      });
+    }
+    size_t queued{0};
+  };
+
+  constexpr int kTenants = 4;
+  constexpr int kTasksPerTenant = 100;
+  CountingExecutor parent;
+  WeightedFairMeteredExecutor::Options options;
+  options.maxInQueue = 2;
+  WeightedFairMeteredExecutor fair(getKeepAliveToken(parent), options);
+
+  int ran = 0;
+  std::vector<Executor::KeepAlive<>> tenants;
+  for (int i = 0; i < kTenants; ++i) {
+    tenants.push_back(
+        getKeepAliveToken(fair.addTenant(std::to_string(i), i + 1)));
+  }
+  for (int j = 0; j < kTasksPerTenant; ++j) {
+    for (auto& tenant : tenants) {
+      tenant->add([&] { ++ran; });
+    }
+  }
+  EXPECT_EQ(2, parent.queued);
+  while (parent.step()) {
+    EXPECT_LE(parent.queued, 2);
+  }
+  EXPECT_EQ(kTenants * kTasksPerTenant, ran);
+  tenants.clear();
+
+  for (auto& stats : fair.getTenantStats()) {
+    EXPECT_EQ(0, stats.backlog);
+    EXPECT_EQ(stats.name == "default" ? 0 : kTasksPerTenant, stats.dispatched);
+  }
+}
+
+TEST(WeightedFairMeteredExecutorTest, DefaultTenant) {
+  ManualExecutor manual;
+  WeightedFairMeteredExecutor fair(getKeepAliveToken(manual));
+  bool ran = false;
+  fair.add([&] { ran = true; });
+  EXPECT_EQ(1, fair.getTenantStats()[0].backlog);
+  manual.drain();
+  EXPECT_TRUE(ran);
+  EXPECT_EQ(1, fair.getTenantStats()[0].dispatched);
+}
+
+TEST(WeightedFairMeteredExecutorTest, RequestContext) {
+  ManualExecutor manual;
+  WeightedFairMeteredExecutor fair(getKeepAliveToken(manual));
+  auto& tenant = fair.addTenant("a");
+  std::shared_ptr<RequestContext> context;
+  std::shared_ptr<RequestContext> seen;
+  {
+    RequestContextScopeGuard guard;
+    context = RequestContext::saveContext();
+    tenant.add([&] { seen = RequestContext::saveContext(); });
+  }
+  manual.drain();
+  EXPECT_EQ(context, seen);
+}
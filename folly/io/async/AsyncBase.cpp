@@ -157,6 +157,40 @@ int AsyncBase::submit(Range<Op**> ops) {
   return rc;
 }
 
+void AsyncBase::submitChain(Range<Op**> ops) {
+  if (!supportsChain()) {
+    throw std::invalid_argument("AsyncBase: chains are not supported");
+  }
+  for (auto& op : ops) {
+    CHECK_EQ(op->state(), Op::State::INITIALIZED);
+    op->start();
+  }
+  initializeContext(); // on demand
+
+  auto unstart = [&] {
+    for (auto& op : ops) {
+      op->unstart();
+    }
+    decrementPending(ops.size());
+  };
+
+  // Unlike submit(), a chain is not submitted partially.
+  auto p = pending_.fetch_add(ops.size(), std::memory_order_acq_rel);
+  if (p + ops.size() > capacity_) {
+    unstart();
+    throw std::range_error("AsyncBase: too many pending requests");
+  }
+
+  int rc = submitChainRange(ops);
+
+  if (rc < 0) {
+    unstart();
+    throwSystemErrorExplicit(-rc, "AsyncBase: chain submit failed");
+  }
+  submitted_ += rc;
+  DCHECK_EQ(size_t(rc), ops.size());
+}
+
 Range<AsyncBase::Op**> AsyncBase::wait(size_t minRequests) {
   CHECK(isInit());
   CHECK_EQ(pollFd_, -1) << "wait() only allowed on non-pollable object";
@@ -19,6 +19,7 @@
 #include <sys/types.h>
 
 #include <atomic>
+#include <cerrno>
 #include <cstdint>
 #include <deque>
 #include <functional>
@@ -86,6 +87,13 @@ class AsyncBaseOp {
     pwrite(fd, buf, size, start);
   }
 
+  /**
+   * Initiate a request to flush the file's data and metadata (fsync), or
+   * only what is needed to read the data back (fdatasync).
+   */
+  virtual void fsync(int fd) = 0;
+  virtual void fdatasync(int fd) = 0;
+
   // we support only these subclasses
   virtual AsyncIOOp* getAsyncIOOp() = 0;
   virtual IoUringOp* getIoUringOp() = 0;
@@ -244,6 +252,22 @@ class AsyncBase {
    */
   int submit(Range<Op**> ops);
 
+  /**
+   * Whether submitChain() is supported.
+   */
+  virtual bool supportsChain() const { return false; }
+
+  /**
+   * Submit a range of ops to be executed one after the other, each one only
+   * once the previous one completed successfully, without a round trip to
+   * user space in between. If an op fails, or reads or writes fewer bytes
+   * than requested, the ops after it complete with -ECANCELED. Either all
+   * the ops are submitted or, with an exception, none.
+   *
+   * Throws std::invalid_argument if !supportsChain().
+   */
+  void submitChain(Range<Op**> ops);
+
  protected:
   virtual int drainPollFd() = 0;
   void complete(Op* op, ssize_t result) { op->complete(result); }
@@ -255,6 +279,9 @@ class AsyncBase {
   void decrementPending(size_t num = 1);
   virtual int submitOne(AsyncBase::Op* op) = 0;
   virtual int submitRange(Range<AsyncBase::Op**> ops) = 0;
+  virtual int submitChainRange(Range<AsyncBase::Op**> /*ops*/) {
+    return -EOPNOTSUPP;
+  }
 
   enum class WaitType { COMPLETE, CANCEL };
   virtual Range<AsyncBase::Op**> doWait(
@@ -126,6 +126,16 @@ void AsyncIOOp::pwritev(int fd, const iovec* iov, int iovcnt, off_t start) {
   io_prep_pwritev(&iocb_, fd, iov, iovcnt, start);
 }
 
+void AsyncIOOp::fsync(int fd) {
+  init();
+  io_prep_fsync(&iocb_, fd);
+}
+
+void AsyncIOOp::fdatasync(int fd) {
+  init();
+  io_prep_fdsync(&iocb_, fd);
+}
+
 void AsyncIOOp::toStream(std::ostream& os) const {
   os << "{" << state_ << ", ";
 
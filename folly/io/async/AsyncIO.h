@@ -46,6 +46,9 @@ class AsyncIOOp : public AsyncBaseOp {
   void pwrite(int fd, const void* buf, size_t size, off_t start) override;
   void pwritev(int fd, const iovec* iov, int iovcnt, off_t start) override;
 
+  void fsync(int fd) override;
+  void fdatasync(int fd) override;
+
   void reset(NotificationCallback cb = NotificationCallback()) override;
 
   AsyncIOOp* getAsyncIOOp() override { return this; }
@@ -21,8 +21,11 @@
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/IoUringEventBaseLocal.h>
 #include <folly/io/async/IoUringProvidedBufferRing.h>
+#include <folly/io/async/IoUringRegisteredBufferArena.h>
 #include <folly/memory/Malloc.h>
+#include <folly/portability/Fcntl.h>
 #include <folly/portability/SysUio.h>
+#include <folly/portability/Unistd.h>
 
 #if FOLLY_HAS_LIBURING
 
@@ -113,6 +116,15 @@ AsyncIoUringSocket::AsyncIoUringSocket(
   state_ = State::Established;
 }
 
+AsyncIoUringSocket::AsyncIoUringSocket(
+    EventBase* evb, DirectDescriptor fd, Options&& options)
+    : AsyncIoUringSocket(evb, std::move(options)) {
+  directFd_ = fd.index;
+  usedFd_ = fd.index;
+  mbFixedFileFlags_ = IOSQE_FIXED_FILE;
+  state_ = State::Established;
+}
+
 std::string AsyncIoUringSocket::toString(AsyncIoUringSocket::State s) {
   switch (s) {
     case State::None:
@@ -524,7 +536,8 @@ bool AsyncIoUringSocket::good() const {
 bool AsyncIoUringSocket::hangup() const {
   if (fd_ == NetworkSocket()) {
     // sanity check, no one should ask for hangup if we are not connected.
-    assert(false);
+    // A direct descriptor cannot be polled from here.
+    assert(directFd_ >= 0);
     return false;
   }
   struct pollfd fds[1];
@@ -747,8 +760,8 @@ void AsyncIoUringSocket::ReadSqe::processSubmit(
   processOldEventBaseRead();
 
   // read does not use registered fd, as it can be long lived and leak socket
-  // files
-  int fd = parent_->fd_.toFd();
+  // files, unless there is no other
+  int fd = parent_->directFd_ >= 0 ? parent_->directFd_ : parent_->fd_.toFd();
 
   if (!readCallback_) {
     VLOG(2) << "readProcessSubmit with no callback?";
@@ -808,6 +821,9 @@ void AsyncIoUringSocket::ReadSqe::processSubmit(
     VLOG(5) << "readProcessSubmit " << this << " reg=" << fd
             << " cb=" << readCallback_ << " size=" << maxSize_;
   }
+  if (parent_->directFd_ >= 0) {
+    sqe->flags |= IOSQE_FIXED_FILE;
+  }
 }
 
 void AsyncIoUringSocket::ReadSqe::sendReadBuf(
@@ -910,6 +926,57 @@ AsyncIoUringSocket::WriteSqe::WriteSqe(
   setEventBase(parent->evb_);
 }
 
+AsyncIoUringSocket::WriteSqe::WriteSqe(
+    AsyncIoUringSocket* parent,
+    WriteCallback* callback,
+    int fd,
+    off_t offset,
+    size_t length,
+    const int (&pipe)[2],
+    WriteFlags flags)
+    : IoSqeBase(IoSqeBase::Type::Write),
+      parent_(parent),
+      callback_(callback),
+      flags_(flags),
+      totalLength_(length),
+      fileFd_(fd),
+      fileOffset_(offset),
+      fileRemaining_(length),
+      pipe_{pipe[0], pipe[1]} {
+  memset(&msg_, 0, sizeof(msg_));
+  // Splices of up to the pipe's capacity, which is worth growing from the
+  // default 64KB.
+  ::fcntl(pipe_[1], F_SETPIPE_SZ, 1 << 20);
+  auto pipeSize = ::fcntl(pipe_[1], F_GETPIPE_SZ);
+  pipeSize_ = pipeSize > 0 ? size_t(pipeSize) : 65536;
+  setEventBase(parent->evb_);
+}
+
+AsyncIoUringSocket::WriteSqe::~WriteSqe() {
+  VLOG(5) << "~WriteSqe() " << this;
+  for (auto pipeFd : pipe_) {
+    if (pipeFd >= 0) {
+      ::close(pipeFd);
+    }
+  }
+}
+
+bool AsyncIoUringSocket::WriteSqe::advanceFile(size_t res) {
+  if (inPipe_ == 0) {
+    // from the file to the pipe
+    fileOffset_ += res;
+    fileRemaining_ -= res;
+    inPipe_ = res;
+  } else {
+    // from the pipe to the socket
+    inPipe_ -= res;
+    totalLength_ -= res;
+    fileWritten_ += res;
+    parent_->bytesWritten_ += res;
+  }
+  return totalLength_ > 0;
+}
+
 int AsyncIoUringSocket::WriteSqe::sendMsgFlags() const {
   int msg_flags = MSG_NOSIGNAL;
   if (isSet(flags_, WriteFlags::CORK)) {
@@ -925,13 +992,55 @@ int AsyncIoUringSocket::WriteSqe::sendMsgFlags() const {
   return msg_flags;
 }
 
+int AsyncIoUringSocket::WriteSqe::fixedBufferIndex() const {
+  auto* arena = parent_->backend_->registeredBufferArena();
+  if (!arena || msg_.msg_iovlen != 1 ||
+      !IoUringBackend::kernelSupportsSendZC()) {
+    return -1;
+  }
+  return arena->bufferIndex(msg_.msg_iov->iov_base, msg_.msg_iov->iov_len);
+}
+
 void AsyncIoUringSocket::WriteSqe::processSubmit(
     struct io_uring_sqe* sqe) noexcept {
   VLOG(5) << "write sqe submit " << this << " iovs=" << msg_.msg_iovlen
           << " length=" << totalLength_ << " ptr=" << msg_.msg_iov
           << " zc=" << zerocopy_ << " fd = " << parent_->usedFd_
           << " flags=" << parent_->mbFixedFileFlags_;
-  if (zerocopy_) {
+  if (isFile()) {
+    if (inPipe_ == 0) {
+      ::io_uring_prep_splice(
+          sqe,
+          fileFd_,
+          fileOffset_,
+          pipe_[1],
+          -1,
+          std::min(fileRemaining_, pipeSize_),
+          SPLICE_F_MOVE);
+    } else {
+      unsigned int spliceFlags = SPLICE_F_MOVE;
+      if (fileRemaining_ > 0 || isSet(flags_, WriteFlags::CORK)) {
+        spliceFlags |= SPLICE_F_MORE;
+      }
+      ::io_uring_prep_splice(
+          sqe, pipe_[0], -1, parent_->usedFd_, -1, inPipe_, spliceFlags);
+      // IOSQE_FIXED_FILE applies to the output of a splice.
+      sqe->flags |= parent_->mbFixedFileFlags_;
+    }
+    return;
+  }
+  if (int bufIndex = fixedBufferIndex(); bufIndex >= 0) {
+    // The pages were pinned when registered, not for every send as for
+    // sendmsg_zc. buf_ is kept, out of the arena, until the notification.
+    ::io_uring_prep_send_zc_fixed(
+        sqe,
+        parent_->usedFd_,
+        msg_.msg_iov->iov_base,
+        msg_.msg_iov->iov_len,
+        sendMsgFlags() | MSG_WAITALL,
+        0,
+        bufIndex);
+  } else if (zerocopy_) {
     ::io_uring_prep_sendmsg_zc(
         sqe, parent_->usedFd_, &msg_, sendMsgFlags() | MSG_WAITALL);
   } else {
@@ -1014,6 +1123,11 @@ struct CancelSqe : IoSqeBase {
 } // namespace
 
 void AsyncIoUringSocket::asyncDetachFd(AsyncDetachFdCallback* callback) {
+  if (directFd_ >= 0) {
+    callback->fdDetachFail(AsyncSocketException(
+        AsyncSocketException::NOT_SUPPORTED, "no fd for a direct descriptor"));
+    return;
+  }
   auto state = new DetachFdState(this, callback, takeFd());
 
   if (writeSqeActive_) {
@@ -1103,6 +1217,10 @@ bool AsyncIoUringSocket::isDetachable() const {
     VLOG(3) << "not detachable: closing";
     return false;
   }
+  if (directFd_ >= 0) {
+    VLOG(3) << "not detachable: direct descriptor";
+    return false;
+  }
   if (state_ == State::FastOpen) {
     VLOG(3) << "not detachable: fastopen";
     return false;
@@ -1350,8 +1468,24 @@ std::pair<
 AsyncIoUringSocket::WriteSqe::detachEventBase() {
   auto [promise, future] =
       makePromiseContract<std::vector<std::pair<int, uint32_t>>>();
-  auto newSqe =
-      new WriteSqe(parent_, callback_, std::move(buf_), flags_, zerocopy_);
+  WriteSqe* newSqe;
+  if (isFile()) {
+    newSqe = new WriteSqe(
+        parent_,
+        callback_,
+        fileFd_,
+        fileOffset_,
+        fileRemaining_,
+        pipe_,
+        flags_);
+    // the pipe, and the data in it, now belong to newSqe
+    pipe_[0] = pipe_[1] = -1;
+    newSqe->inPipe_ = inPipe_;
+    newSqe->fileWritten_ = fileWritten_;
+  } else {
+    newSqe =
+        new WriteSqe(parent_, callback_, std::move(buf_), flags_, zerocopy_);
+  }
 
   // make sure to keep the state of where we are in the write
   newSqe->totalLength_ = totalLength_;
@@ -1429,6 +1563,21 @@ void AsyncIoUringSocket::WriteSqe::callback(const io_uring_cqe* cqe) noexcept {
 
   DestructorGuard dg(parent_);
 
+  if (isFile()) {
+    if (res > 0) {
+      if (advanceFile(res)) {
+        prepareForReuse();
+        parent_->doReSubmitWrite();
+        return;
+      }
+      // already accounted for
+      res = 0;
+    } else if (res == 0 && totalLength_ > 0) {
+      VLOG(2) << "file shorter than the range to send";
+      res = -ENODATA;
+    }
+  }
+
   if (res > 0 && (size_t)res < totalLength_) {
     // todo clean out the iobuf
     size_t toRemove = res;
@@ -1480,9 +1629,18 @@ void AsyncIoUringSocket::WriteSqe::callback(const io_uring_cqe* cqe) noexcept {
         callback_->writeSuccess();
       } else if (res < 0) {
         VLOG(2) << "write error! " << res;
-        callback_->writeErr(
-            0,
-            AsyncSocketException(AsyncSocketException::UNKNOWN, "write error"));
+        if (isFile() && res == -ENODATA) {
+          callback_->writeErr(
+              fileWritten_,
+              AsyncSocketException(
+                  AsyncSocketException::INTERNAL_ERROR,
+                  "the file to send is shorter than the range"));
+        } else {
+          callback_->writeErr(
+              isFile() ? fileWritten_ : 0,
+              AsyncSocketException(
+                  AsyncSocketException::UNKNOWN, "write error"));
+        }
       }
     }
     if (parent_) {
@@ -1573,6 +1731,40 @@ void AsyncIoUringSocket::writeChain(
   }
 }
 
+void AsyncIoUringSocket::sendFile(
+    WriteCallback* callback,
+    int fd,
+    off_t offset,
+    size_t length,
+    WriteFlags flags) {
+  if (state_ == State::FastOpen ||
+      ((state_ == State::Closed || state_ == State::Error) && !connecting())) {
+    // fast open sends its data with the connect
+    return AsyncTransport::sendFile(callback, fd, offset, length, flags);
+  }
+  int pipeFds[2];
+  if (::pipe2(pipeFds, O_CLOEXEC) != 0) {
+    if (callback) {
+      callback->writeErr(
+          0,
+          AsyncSocketException(
+              AsyncSocketException::INTERNAL_ERROR,
+              "pipe2() failed",
+              errno));
+    }
+    return;
+  }
+  if (!callback) {
+    callback = &sNullWriteCallback;
+  }
+  auto w = new WriteSqe(this, callback, fd, offset, length, pipeFds, flags);
+  VLOG(5) << "AsyncIoUringSocket::sendFile(" << this
+          << " ) state=" << stateAsString() << " size=" << length
+          << " cb=" << callback << " fd=" << fd_;
+  writeSqeQueue_.push_back(*w);
+  processWriteQueue();
+}
+
 namespace {
 
 class UnregisterFdSqe : public IoSqeBase {
@@ -1609,6 +1801,25 @@ class UnregisterFdSqe : public IoSqeBase {
   IoUringFdRegistrationRecord* fd;
 };
 
+class ShutdownDirectFdSqe : public IoSqeBase {
+ public:
+  explicit ShutdownDirectFdSqe(int idx) : idx_(idx) {}
+
+  void processSubmit(struct io_uring_sqe* sqe) noexcept override {
+    ::io_uring_prep_shutdown(sqe, idx_, SHUT_RDWR);
+    sqe->flags |= IOSQE_FIXED_FILE;
+  }
+
+  void callback(const io_uring_cqe*) noexcept override { delete this; }
+
+  void callbackCancelled(const io_uring_cqe*) noexcept override {
+    delete this;
+  }
+
+ private:
+  int idx_;
+};
+
 } // namespace
 
 void AsyncIoUringSocket::unregisterFd() {
@@ -1628,6 +1839,7 @@ NetworkSocket AsyncIoUringSocket::takeFd() {
   auto ret = std::exchange(fd_, {});
   unregisterFd();
   usedFd_ = -1;
+  directFd_ = -1;
   return ret;
 }
 
@@ -1654,6 +1866,8 @@ void AsyncIoUringSocket::setZeroCopyEnableFunc(
 void AsyncIoUringSocket::closeProcessSubmit(struct io_uring_sqe* sqe) {
   if (fd_.toFd() >= 0) {
     ::io_uring_prep_close(sqe, fd_.toFd());
+  } else if (directFd_ >= 0) {
+    ::io_uring_prep_close_direct(sqe, directFd_);
   } else {
     // already closed -> nop
     ::io_uring_prep_nop(sqe);
@@ -1711,6 +1925,11 @@ void AsyncIoUringSocket::closeNow() {
     // we submit and then release for 2 reasons:
     // 1: we dont want to accidentally clear the closeSqe_ without submitting
     // 2: we dont want to resubmit, which could close a random fd
+    if (directFd_ >= 0) {
+      // as with registered fds, requests still holding the socket would keep
+      // it open after the close
+      backend_->submitSoon(*new ShutdownDirectFdSqe(directFd_));
+    }
     backend_->submitSoon(*closeSqe_);
     closeSqe_.release();
   }
@@ -80,6 +80,18 @@ class AsyncIoUringSocket : public AsyncSocketTransport {
   explicit AsyncIoUringSocket(
       EventBase* evb, NetworkSocket ns, Options&& options = Options{});
 
+  // A slot of the backend's registered file table, such as a connection
+  // accepted by an AsyncServerSocket with setIoUringAcceptDirect().
+  struct DirectDescriptor {
+    int index;
+  };
+
+  // Takes ownership of a direct descriptor of evb's IoUringBackend. The socket
+  // has no file descriptor then: it cannot be detached, and the addresses and
+  // socket options are not available.
+  AsyncIoUringSocket(
+      EventBase* evb, DirectDescriptor fd, Options&& options = Options{});
+
   static bool supports(EventBase* backend);
   static bool supportsZcRx(EventBase* backend);
 
@@ -136,12 +148,25 @@ class AsyncIoUringSocket : public AsyncSocketTransport {
   void writev(
       WriteCallback*, const iovec*, size_t, WriteFlags = WriteFlags::NONE)
       override;
+  // A buffer allocated from the backend's registeredBufferArena(), and not
+  // chained, is sent zero copy as a fixed buffer, where the kernel supports
+  // IORING_OP_SEND_ZC, whatever Options::zeroCopyEnable says. It goes back
+  // to the arena once the kernel is done with it.
   void writeChain(
       WriteCallback* callback,
       std::unique_ptr<IOBuf>&& buf,
       WriteFlags flags) override;
   bool canZC(std::unique_ptr<IOBuf> const& buf) const;
 
+  // Splices the range through a pipe, from the file and then to the socket,
+  // so that the data is never copied to user space.
+  void sendFile(
+      WriteCallback* callback,
+      int fd,
+      off_t offset,
+      size_t length,
+      WriteFlags flags = WriteFlags::NONE) override;
+
   // AsyncTransport
   void close() override;
   void closeNow() override;
@@ -392,12 +417,28 @@ class AsyncIoUringSocket : public AsyncSocketTransport {
         std::unique_ptr<IOBuf>&& buf,
         WriteFlags flags,
         bool zc);
-    ~WriteSqe() override { VLOG(5) << "~WriteSqe() " << this; }
+    // Sends [offset, offset + length) of the file, through the pipe, whose
+    // ends it takes ownership of.
+    WriteSqe(
+        AsyncIoUringSocket* parent,
+        WriteCallback* callback,
+        int fd,
+        off_t offset,
+        size_t length,
+        const int (&pipe)[2],
+        WriteFlags flags);
+    ~WriteSqe() override;
 
     void processSubmit(struct io_uring_sqe* sqe) noexcept override;
     void callback(const io_uring_cqe* cqe) noexcept override;
     void callbackCancelled(const io_uring_cqe* cqe) noexcept override;
     int sendMsgFlags() const;
+    // The index of the registered buffer holding what is left to send, or
+    // -1 if it is not all within one.
+    int fixedBufferIndex() const;
+    bool isFile() const { return fileFd_ >= 0; }
+    // Accounts for a splice of res bytes, returns whether any are left.
+    bool advanceFile(size_t res);
     std::pair<
         folly::SemiFuture<std::vector<std::pair<int, uint32_t>>>,
         WriteSqe*>
@@ -413,6 +454,16 @@ class AsyncIoUringSocket : public AsyncSocketTransport {
     size_t totalLength_;
     struct msghdr msg_;
 
+    // sendFile(): totalLength_ is fileRemaining_ + inPipe_
+    int fileFd_{-1};
+    off_t fileOffset_{0};
+    size_t fileRemaining_{0};
+    int pipe_[2]{-1, -1};
+    size_t pipeSize_{0};
+    size_t inPipe_{0};
+    // from the pipe to the socket, for writeErr()
+    size_t fileWritten_{0};
+
     bool zerocopy_{false};
     int refs_ = 1;
     folly::Function<bool(int, uint32_t)> detachedSignal_;
@@ -489,6 +540,8 @@ class AsyncIoUringSocket : public AsyncSocketTransport {
   IoUringFdRegistrationRecord* fdRegistered_ = nullptr;
   int usedFd_ = -1;
   unsigned int mbFixedFileFlags_ = 0;
+  // direct descriptor owned by this socket, which then has no fd_
+  int directFd_ = -1;
   std::unique_ptr<CloseSqe> closeSqe_{new CloseSqe(this)};
 
   State state_ = State::None;
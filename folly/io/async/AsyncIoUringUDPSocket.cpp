@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/AsyncIoUringUDPSocket.h>
+
+#include <cstring>
+
+#include <folly/String.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/Unistd.h>
+#include <folly/io/async/EventBaseBackendBase.h>
+#include <folly/io/async/IoUringBackend.h>
+#include <folly/io/async/IoUringEventBaseLocal.h>
+#include <folly/io/async/IoUringProvidedBufferRing.h>
+
+#if FOLLY_HAS_LIBURING
+
+namespace folly {
+
+namespace {
+
+IoUringBackend* tryGetBackend(EventBase* evb) {
+  auto* b = IoUringEventBaseLocal::try_get(evb);
+  if (!b) {
+    b = dynamic_cast<IoUringBackend*>(evb->getBackend());
+  }
+  return b;
+}
+
+IoUringBackend* getBackend(EventBase* evb) {
+  auto* b = tryGetBackend(evb);
+  if (!b) {
+    throw std::runtime_error("need to take a IoUringBackend event base");
+  }
+  return b;
+}
+
+} // namespace
+
+// A multishot recvmsg into the provided buffer ring. It lives until its
+// last completion, after release() if that is still to come.
+class AsyncIoUringUDPSocket::RecvSqe : public IoSqeBase {
+ public:
+  RecvSqe(
+      AsyncIoUringUDPSocket* parent,
+      IoUringBackend* backend,
+      IoUringProvidedBufferRing* bp)
+      : IoSqeBase(IoSqeBase::Type::Read),
+        parent_(parent),
+        backend_(backend),
+        bp_(bp),
+        fd_(parent->getNetworkSocket()) {
+    std::memset(&msg_, 0, sizeof(msg_));
+    msg_.msg_namelen = sizeof(sockaddr_storage);
+    msg_.msg_controllen = ReadCallback::OnDataAvailableParams::kCmsgSpace;
+    setEventBase(parent->getEventBase());
+  }
+
+  void processSubmit(struct io_uring_sqe* sqe) noexcept override {
+    ::io_uring_prep_recvmsg_multishot(sqe, fd_.toFd(), &msg_, MSG_TRUNC);
+    sqe->buf_group = bp_->gid();
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+  }
+
+  void callback(const io_uring_cqe* cqe) noexcept override {
+    auto buf = takeBuffer(cqe);
+    bool more = cqe->flags & IORING_CQE_F_MORE;
+    inCallback_ = true;
+    if (cqe->res == -ENOBUFS) {
+      bp_->enobuf();
+    } else if (cqe->res < 0) {
+      if (!more) {
+        parent_->onRecvError(cqe->res);
+      }
+    } else if (buf) {
+      deliver(std::move(buf));
+    }
+    inCallback_ = false;
+    if (!parent_) {
+      // released by the callbacks, and cancelled if still in flight
+      if (!more) {
+        delete this;
+      }
+      return;
+    }
+    if (!more) {
+      // The kernel ended the multishot recvmsg, out of buffers or when the
+      // completion queue overflowed. Give the callbacks a loop iteration to
+      // return some buffers in the first case.
+      if (cqe->res == -ENOBUFS) {
+        backend_->submitNextLoop(*this);
+      } else {
+        backend_->submitSoon(*this);
+      }
+    }
+  }
+
+  void callbackCancelled(const io_uring_cqe* cqe) noexcept override {
+    takeBuffer(cqe);
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+      delete this;
+    }
+  }
+
+  void release() noexcept {
+    parent_ = nullptr;
+    if (inFlight()) {
+      backend_->cancel(this);
+    } else if (!inCallback_) {
+      delete this;
+    }
+  }
+
+ private:
+  std::unique_ptr<IOBuf> takeBuffer(const io_uring_cqe* cqe) noexcept {
+    if (!(cqe->flags & IORING_CQE_F_BUFFER)) {
+      return nullptr;
+    }
+    uint16_t bufId = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    return bp_->getIoBuf(
+        bufId, cqe->res, (cqe->flags & IORING_CQE_F_BUF_MORE) != 0);
+  }
+
+  void deliver(std::unique_ptr<IOBuf> buf) noexcept {
+    EventRecvmsgMultishotCallback::ParsedRecvMsgMultishot p;
+    if (!EventRecvmsgMultishotCallback::parseRecvmsgMultishot(
+            buf->coalesce(), msg_, p)) {
+      return;
+    }
+    BatchReadCallback::Datagram datagram;
+    datagram.peer.setFromSockaddr(
+        reinterpret_cast<const sockaddr*>(p.name.data()), p.name.size());
+    datagram.truncated =
+        (p.flags & MSG_TRUNC) || p.realPayloadLength > p.payload.size();
+    struct msghdr control;
+    std::memset(&control, 0, sizeof(control));
+    control.msg_control = const_cast<uint8_t*>(p.control.data());
+    control.msg_controllen = p.control.size();
+    AsyncUDPSocket::fromMsg(datagram.params, control);
+    buf->trimStart(p.payload.data() - buf->data());
+    buf->trimEnd(buf->length() - p.payload.size());
+    datagram.data = std::move(buf);
+    parent_->onDatagram(std::move(datagram));
+  }
+
+  AsyncIoUringUDPSocket* parent_;
+  IoUringBackend* backend_;
+  IoUringProvidedBufferRing* bp_;
+  NetworkSocket fd_;
+  struct msghdr msg_;
+  bool inCallback_{false};
+};
+
+AsyncIoUringUDPSocket::SendFd::~SendFd() {
+  ::close(fd);
+}
+
+AsyncIoUringUDPSocket::SendSqe::SendSqe(
+    AsyncIoUringUDPSocket* parent,
+    std::shared_ptr<SendFd> fd,
+    const struct msghdr& message,
+    int flags)
+    : IoSqeBase(IoSqeBase::Type::Write),
+      parent_(parent),
+      fd_(std::move(fd)),
+      flags_(flags) {
+  for (size_t i = 0; i < message.msg_iovlen; ++i) {
+    length_ += message.msg_iov[i].iov_len;
+  }
+  buf_.reset(new uint8_t[message.msg_controllen + length_]);
+  std::memset(&msg_, 0, sizeof(msg_));
+  if (message.msg_name) {
+    std::memcpy(&addr_, message.msg_name, message.msg_namelen);
+    msg_.msg_name = &addr_;
+    msg_.msg_namelen = message.msg_namelen;
+  }
+  if (message.msg_controllen) {
+    std::memcpy(buf_.get(), message.msg_control, message.msg_controllen);
+    msg_.msg_control = buf_.get();
+    msg_.msg_controllen = message.msg_controllen;
+  }
+  auto* data = buf_.get() + message.msg_controllen;
+  iov_.iov_base = data;
+  iov_.iov_len = length_;
+  for (size_t i = 0; i < message.msg_iovlen; ++i) {
+    std::memcpy(
+        data, message.msg_iov[i].iov_base, message.msg_iov[i].iov_len);
+    data += message.msg_iov[i].iov_len;
+  }
+  msg_.msg_iov = &iov_;
+  msg_.msg_iovlen = 1;
+  setEventBase(parent->getEventBase());
+}
+
+void AsyncIoUringUDPSocket::SendSqe::processSubmit(
+    struct io_uring_sqe* sqe) noexcept {
+  ::io_uring_prep_sendmsg(sqe, fd_->fd, &msg_, flags_);
+}
+
+void AsyncIoUringUDPSocket::SendSqe::callback(
+    const io_uring_cqe* cqe) noexcept {
+  if (parent_) {
+    parent_->sendDone(cqe->res);
+  }
+  delete this;
+}
+
+void AsyncIoUringUDPSocket::SendSqe::callbackCancelled(
+    const io_uring_cqe* cqe) noexcept {
+  callback(cqe);
+}
+
+bool AsyncIoUringUDPSocket::supports(EventBase* evb) {
+  return tryGetBackend(evb) != nullptr;
+}
+
+AsyncIoUringUDPSocket::AsyncIoUringUDPSocket(EventBase* evb, Options options)
+    : AsyncUDPSocket(evb),
+      options_(std::move(options)),
+      backend_(getBackend(evb)) {}
+
+AsyncIoUringUDPSocket::~AsyncIoUringUDPSocket() {
+  // ~AsyncUDPSocket() would only run the base class close().
+  if (isBound()) {
+    close();
+  } else {
+    releaseRecv();
+    detachSends();
+  }
+}
+
+void AsyncIoUringUDPSocket::resumeRead(ReadCallback* cob) {
+  CHECK(!isReading()) << "Another read callback already installed";
+  CHECK(isBound()) << "UDP server socket not yet bind to an address";
+  if (!backend_->hasBufferProvider() ||
+      !IoUringBackend::kernelSupportsRecvmsgMultishot() ||
+      CHECK_NOTNULL(cob)->shouldOnlyNotify()) {
+    AsyncUDPSocket::resumeRead(cob);
+    return;
+  }
+  uringReadCallback_ = cob;
+  batchReadCallback_ = dynamic_cast<BatchReadCallback*>(cob);
+  submitRecv();
+}
+
+void AsyncIoUringUDPSocket::pauseRead() {
+  if (!uringReadCallback_) {
+    AsyncUDPSocket::pauseRead();
+    return;
+  }
+  uringReadCallback_ = nullptr;
+  batchReadCallback_ = nullptr;
+  releaseRecv();
+  pendingReads_.clear();
+  cancelLoopCallback();
+}
+
+void AsyncIoUringUDPSocket::close() {
+  auto* cob = std::exchange(uringReadCallback_, nullptr);
+  batchReadCallback_ = nullptr;
+  releaseRecv();
+  pendingReads_.clear();
+  cancelLoopCallback();
+  // The queued sends keep their duplicate of the fd open.
+  detachSends();
+  sendFd_.reset();
+  sendError_ = 0;
+  AsyncUDPSocket::close();
+  if (cob) {
+    cob->onReadClosed();
+  }
+}
+
+void AsyncIoUringUDPSocket::detachEventBase() {
+  CHECK(!recvSqe_ && sends_.empty())
+      << "AsyncIoUringUDPSocket has io_uring operations in flight";
+  cancelLoopCallback();
+  AsyncUDPSocket::detachEventBase();
+  backend_ = nullptr;
+}
+
+void AsyncIoUringUDPSocket::attachEventBase(EventBase* evb) {
+  backend_ = getBackend(evb);
+  AsyncUDPSocket::attachEventBase(evb);
+}
+
+ssize_t AsyncIoUringUDPSocket::sendmsg(
+    NetworkSocket socket, const struct msghdr* message, int flags) {
+  if (takeSendError()) {
+    return -1;
+  }
+  return queueSend(socket.toFd(), *message, flags);
+}
+
+int AsyncIoUringUDPSocket::sendmmsg(
+    NetworkSocket socket,
+    struct mmsghdr* msgvec,
+    unsigned int vlen,
+    int flags) {
+  // Like sendmmsg(), fails only if the first message cannot be sent.
+  if (vlen > 0 && takeSendError()) {
+    return -1;
+  }
+  unsigned int i = 0;
+  for (; i < vlen; ++i) {
+    auto ret = queueSend(socket.toFd(), msgvec[i].msg_hdr, flags);
+    if (ret < 0) {
+      break;
+    }
+    msgvec[i].msg_len = static_cast<unsigned int>(ret);
+  }
+  return (i == 0 && vlen > 0) ? -1 : static_cast<int>(i);
+}
+
+bool AsyncIoUringUDPSocket::takeSendError() noexcept {
+  if (!sendError_) {
+    return false;
+  }
+  errno = std::exchange(sendError_, 0);
+  return true;
+}
+
+ssize_t AsyncIoUringUDPSocket::queueSend(
+    int fd, const struct msghdr& message, int flags) {
+  if (flags & MSG_ZEROCOPY) {
+    errno = EOPNOTSUPP;
+    return -1;
+  }
+  if (sendsInFlight_ >= options_.maxSendsInFlight) {
+    errno = EAGAIN;
+    return -1;
+  }
+  if (!sendFd_ || sendFd_->socketFd != fd) {
+    int dupFd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (dupFd < 0) {
+      return -1;
+    }
+    sendFd_ = std::make_shared<SendFd>(fd, dupFd);
+  }
+  auto* sqe = new SendSqe(this, sendFd_, message, flags);
+  sends_.push_back(*sqe);
+  ++sendsInFlight_;
+  backend_->submitSoon(*sqe);
+  return static_cast<ssize_t>(sqe->length_);
+}
+
+void AsyncIoUringUDPSocket::sendDone(int res) noexcept {
+  --sendsInFlight_;
+  if (res < 0) {
+    ++sendErrors_;
+    VLOG(4) << "AsyncIoUringUDPSocket send failed: " << errnoStr(-res);
+    if (!sendError_) {
+      sendError_ = -res;
+    }
+  }
+}
+
+void AsyncIoUringUDPSocket::detachSends() noexcept {
+  for (auto& sqe : sends_) {
+    sqe.parent_ = nullptr;
+  }
+  sends_.clear();
+  sendsInFlight_ = 0;
+}
+
+void AsyncIoUringUDPSocket::submitRecv() noexcept {
+  recvSqe_ = new RecvSqe(this, backend_, backend_->bufferProvider());
+  backend_->submitSoon(*recvSqe_);
+}
+
+void AsyncIoUringUDPSocket::releaseRecv() noexcept {
+  if (recvSqe_) {
+    std::exchange(recvSqe_, nullptr)->release();
+  }
+}
+
+void AsyncIoUringUDPSocket::onDatagram(
+    BatchReadCallback::Datagram&& datagram) noexcept {
+  if (batchReadCallback_) {
+    pendingReads_.push_back(std::move(datagram));
+    if (!isLoopCallbackScheduled()) {
+      getEventBase()->runInLoop(this);
+    }
+    return;
+  }
+  void* buf = nullptr;
+  size_t len = 0;
+  uringReadCallback_->getReadBuffer(&buf, &len);
+  if (!buf || len == 0) {
+    return;
+  }
+  size_t copied = std::min(len, datagram.data->length());
+  std::memcpy(buf, datagram.data->data(), copied);
+  // The datagram may as well give its buffer back before the callback.
+  bool truncated = datagram.truncated || copied < datagram.data->length();
+  datagram.data.reset();
+  uringReadCallback_->onDataAvailable(
+      datagram.peer, copied, truncated, datagram.params);
+}
+
+void AsyncIoUringUDPSocket::onRecvError(int res) noexcept {
+  auto* cob = std::exchange(uringReadCallback_, nullptr);
+  batchReadCallback_ = nullptr;
+  releaseRecv();
+  pendingReads_.clear();
+  cancelLoopCallback();
+  cob->onReadError(AsyncSocketException(
+      AsyncSocketException::INTERNAL_ERROR,
+      "AsyncIoUringUDPSocket: recvmsg failed",
+      -res));
+}
+
+void AsyncIoUringUDPSocket::runLoopCallback() noexcept {
+  if (!batchReadCallback_ || pendingReads_.empty()) {
+    return;
+  }
+  auto datagrams = std::move(pendingReads_);
+  pendingReads_.clear();
+  batchReadCallback_->onDataAvailableBatch(datagrams);
+}
+
+} // namespace folly
+
+#endif
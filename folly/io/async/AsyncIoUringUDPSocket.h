@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <boost/intrusive/list.hpp>
+#include <folly/SocketAddress.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/AsyncUDPSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/IoUringBase.h>
+#include <folly/io/async/Liburing.h>
+
+#if FOLLY_HAS_LIBURING
+
+namespace folly {
+
+class IoUringBackend;
+class IoUringProvidedBufferRing;
+
+/**
+ * A UDP socket doing its I/O through the io_uring of the IoUringBackend
+ * running its EventBase, instead of with a syscall per batch of datagrams.
+ *
+ * Writes: every message AsyncUDPSocket would pass to sendmsg()/sendmmsg(),
+ * GSO and other control messages included, is copied into a sendmsg SQE
+ * that is submitted with the other SQEs of the loop iteration. The write
+ * methods return what they would have for a successful syscall, or -1 with
+ * errno EAGAIN once Options::maxSendsInFlight sends are pending. A send that
+ * fails once submitted fails the next write instead, with its errno, the way
+ * the kernel reports asynchronous errors of UDP sockets; getSendErrors()
+ * counts them all. The sends use a duplicate of the socket's fd, so those
+ * still queued on close() go out. Zero copy sends are not supported: the data
+ * is copied anyway.
+ *
+ * Reads: a multishot recvmsg, with buffers picked by the kernel from the
+ * backend's provided buffer ring, so there is no resubmission per datagram.
+ * The buffers must fit the largest datagram, or GRO batch with setGRO(),
+ * plus the recvmsg header. A BatchReadCallback gets IOBufs pointing into
+ * the provided buffers, without a copy, once per loop iteration, with all
+ * the datagrams from the completions reaped in it. Any other ReadCallback
+ * gets a copy through getReadBuffer()/onDataAvailable(). Without a buffer
+ * ring, a kernel with multishot recvmsg, or for callbacks that only want
+ * to be notified, reads are AsyncUDPSocket's.
+ */
+class AsyncIoUringUDPSocket : public AsyncUDPSocket,
+                              private EventBase::LoopCallback {
+ public:
+  struct Options {
+    Options() {}
+    // Sends submitted and not completed yet, beyond which writes fail with
+    // EAGAIN, as they would on a full socket send buffer.
+    size_t maxSendsInFlight{4096};
+  };
+
+  class BatchReadCallback : public ReadCallback {
+   public:
+    struct Datagram {
+      SocketAddress peer;
+      std::unique_ptr<IOBuf> data;
+      bool truncated{false};
+      OnDataAvailableParams params;
+    };
+
+    /**
+     * Invoked with the datagrams received since the last call. The data
+     * holds on to provided buffers, which should be released promptly to
+     * not starve the ring. The vector may be moved from.
+     */
+    virtual void onDataAvailableBatch(
+        std::vector<Datagram>& datagrams) noexcept = 0;
+
+    // Unused, datagrams are delivered by onDataAvailableBatch().
+    void getReadBuffer(void** buf, size_t* len) noexcept override {
+      *buf = nullptr;
+      *len = 0;
+    }
+    void onDataAvailable(
+        const SocketAddress&,
+        size_t,
+        bool,
+        OnDataAvailableParams) noexcept override {}
+  };
+
+  static bool supports(EventBase* evb);
+
+  // Throws if evb is not running on an IoUringBackend.
+  explicit AsyncIoUringUDPSocket(EventBase* evb, Options options = Options());
+  ~AsyncIoUringUDPSocket() override;
+
+  void resumeRead(ReadCallback* cob) override;
+  void pauseRead() override;
+  void close() override;
+
+  bool isReading() const override {
+    return uringReadCallback_ || AsyncUDPSocket::isReading();
+  }
+
+  // Only possible with no reads or sends in flight.
+  void detachEventBase() override;
+  void attachEventBase(EventBase* evb) override;
+
+  // Whether reads use the multishot recvmsg.
+  bool usingIoUringRecv() const { return recvSqe_ != nullptr; }
+  size_t getSendsInFlight() const { return sendsInFlight_; }
+  uint64_t getSendErrors() const { return sendErrors_; }
+
+ protected:
+  ssize_t sendmsg(
+      NetworkSocket socket, const struct msghdr* message, int flags) override;
+
+  int sendmmsg(
+      NetworkSocket socket,
+      struct mmsghdr* msgvec,
+      unsigned int vlen,
+      int flags) override;
+
+ private:
+  class RecvSqe;
+
+  // A duplicate of the socket's fd, closed with the last send using it.
+  struct SendFd {
+    SendFd(int socketFd, int fd) : socketFd(socketFd), fd(fd) {}
+    ~SendFd();
+
+    // The fd this duplicates.
+    const int socketFd;
+    const int fd;
+  };
+
+  struct send_sqe_tag;
+  using send_sqe_hook = boost::intrusive::list_base_hook<
+      boost::intrusive::tag<send_sqe_tag>,
+      boost::intrusive::link_mode<boost::intrusive::auto_unlink>>;
+  struct SendSqe final : IoSqeBase, send_sqe_hook {
+    SendSqe(
+        AsyncIoUringUDPSocket* parent,
+        std::shared_ptr<SendFd> fd,
+        const struct msghdr& message,
+        int flags);
+
+    void processSubmit(struct io_uring_sqe* sqe) noexcept override;
+    void callback(const io_uring_cqe* cqe) noexcept override;
+    void callbackCancelled(const io_uring_cqe* cqe) noexcept override;
+
+    AsyncIoUringUDPSocket* parent_;
+    std::shared_ptr<SendFd> fd_;
+    int flags_;
+    size_t length_{0};
+    sockaddr_storage addr_;
+    // Control messages, then the data.
+    std::unique_ptr<uint8_t[]> buf_;
+    struct iovec iov_;
+    struct msghdr msg_;
+  };
+  using SendSqeList = boost::intrusive::list<
+      SendSqe,
+      boost::intrusive::base_hook<send_sqe_hook>,
+      boost::intrusive::constant_time_size<false>>;
+
+  // Fails with the error of a completed send, if any, and sets errno.
+  bool takeSendError() noexcept;
+  ssize_t queueSend(int fd, const struct msghdr& message, int flags);
+  void sendDone(int res) noexcept;
+  void detachSends() noexcept;
+
+  void submitRecv() noexcept;
+  void releaseRecv() noexcept;
+  void onDatagram(BatchReadCallback::Datagram&& datagram) noexcept;
+  void onRecvError(int res) noexcept;
+
+  // EventBase::LoopCallback, flushes pendingReads_.
+  void runLoopCallback() noexcept override;
+
+  const Options options_;
+  IoUringBackend* backend_;
+
+  SendSqeList sends_;
+  std::shared_ptr<SendFd> sendFd_;
+  size_t sendsInFlight_{0};
+  uint64_t sendErrors_{0};
+  // The errno of the first failed send not reported by a write yet.
+  int sendError_{0};
+
+  // Set instead of AsyncUDPSocket::readCallback_ when reads use io_uring.
+  ReadCallback* uringReadCallback_{nullptr};
+  BatchReadCallback* batchReadCallback_{nullptr};
+  RecvSqe* recvSqe_{nullptr};
+  std::vector<BatchReadCallback::Datagram> pendingReads_;
+};
+
+} // namespace folly
+
+#endif
@@ -932,6 +932,13 @@ class AsyncSSLSocket : public AsyncSocket {
       uint32_t* partialWritten,
       WriteRequestTag writeTag) override;
 
+  // Only if security negotiation is deferred: once encrypted, the records
+  // are built in user space, so the file has to be read.
+  bool canSendFile(WriteFlags flags) const override {
+    return sslState_ == SSLStateEnum::STATE_UNENCRYPTED &&
+        AsyncSocket::canSendFile(flags);
+  }
+
   ssize_t performWriteIovec(
       const iovec* vec,
       uint32_t count,
@@ -32,11 +32,23 @@
 #include <folly/String.h>
 #include <folly/detail/SocketFastOpen.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/Liburing.h>
 #include <folly/io/async/NotificationQueue.h>
 #include <folly/portability/Fcntl.h>
 #include <folly/portability/Sockets.h>
 #include <folly/portability/Unistd.h>
 
+#if FOLLY_HAS_LIBURING
+#include <folly/io/async/IoUringBackend.h> // @manual
+#include <folly/io/async/IoUringEventBaseLocal.h> // @manual
+#endif
+
+#if FOLLY_HAS_LIBURING && defined(IORING_ACCEPT_MULTISHOT)
+#define FOLLY_SERVER_SOCKET_IO_URING_ACCEPT 1
+#else
+#define FOLLY_SERVER_SOCKET_IO_URING_ACCEPT 0
+#endif
+
 namespace folly {
 
 #ifndef TCP_SAVE_SYN
@@ -58,6 +70,225 @@ static constexpr bool kSupportReflectTos = kIsLinuxActual;
 
 AsyncServerSocket::AcceptCallback::~AcceptCallback() = default;
 
+#if FOLLY_SERVER_SOCKET_IO_URING_ACCEPT
+namespace {
+
+IoUringBackend* getIoUringAcceptBackend(EventBase* evb) {
+  if (!evb || !IoUringBackend::kernelSupportsMultishotAccept()) {
+    return nullptr;
+  }
+  auto* backend = dynamic_cast<IoUringBackend*>(evb->getBackend());
+  if (!backend) {
+    backend = IoUringEventBaseLocal::try_get(evb);
+  }
+  return backend;
+}
+
+} // namespace
+
+/*
+ * A multishot IORING_OP_ACCEPT on one of the listening sockets, which
+ * completes once per connection until it fails or is cancelled.
+ *
+ * It outlives release() until the kernel is done with it, and closes the
+ * connections accepted in the meantime.
+ */
+class AsyncServerSocket::IoUringAcceptSqe : public IoSqeBase {
+ public:
+  IoUringAcceptSqe(
+      AsyncServerSocket* parent,
+      IoUringBackend* backend,
+      NetworkSocket fd,
+      sa_family_t addressFamily,
+      bool direct)
+      : parent_(parent),
+        backend_(backend),
+        fd_(fd),
+        addressFamily_(addressFamily),
+        direct_(direct) {
+    setEventBase(parent->eventBase_);
+  }
+
+  void processSubmit(struct io_uring_sqe* sqe) noexcept override {
+#ifdef IORING_FILE_INDEX_ALLOC
+    if (direct_) {
+      // blocking, as AsyncIoUringSocket keeps its sockets
+      ::io_uring_prep_multishot_accept_direct(
+          sqe, fd_.toFd(), nullptr, nullptr, 0);
+      return;
+    }
+#endif
+    // The completions would all share an address buffer, so the address of
+    // each connection is read with getpeername() instead.
+    ::io_uring_prep_accept(sqe, fd_.toFd(), nullptr, nullptr, SOCK_NONBLOCK);
+    sqe->ioprio |= IORING_ACCEPT_MULTISHOT;
+  }
+
+  void callback(const io_uring_cqe* cqe) noexcept override {
+    bool more = cqe->flags & IORING_CQE_F_MORE;
+    if (!more && parent_ &&
+        (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP)) {
+      if (direct_) {
+        LOG(WARNING) << "io_uring direct accept failed on " << fd_
+                     << ", accepting file descriptors: "
+                     << errnoStr(-cqe->res);
+        direct_ = false;
+        backend_->submitSoon(*this);
+        return;
+      }
+      // The kernel does not take a multishot accept on this socket after
+      // all; accept with readiness events instead.
+      LOG(WARNING) << "io_uring accept failed on " << fd_
+                   << ", falling back to accept4(): " << errnoStr(-cqe->res);
+      parent_->fallBackFromIoUringAccept(this);
+      delete this;
+      return;
+    }
+    {
+      DestructorGuard dg(parent_);
+      inCallback_ = true;
+      if (direct_) {
+        parent_->handleIoUringAcceptDirect(this, cqe->res, addressFamily_);
+      } else {
+        parent_->handleIoUringAccept(cqe->res, addressFamily_);
+      }
+      inCallback_ = false;
+    }
+    if (!parent_) {
+      // released by the callback, and cancelled if still in flight
+      if (!more) {
+        delete this;
+      }
+      return;
+    }
+    if (!more) {
+      // The kernel ended the multishot accept, on an error or when the
+      // completion queue overflowed.
+      switch (-cqe->res) {
+        case EBADF:
+        case ENOTSOCK:
+          LOG(ERROR) << "io_uring accept failed on " << fd_
+                     << ", no longer accepting: " << errnoStr(-cqe->res);
+          break;
+        default:
+          backend_->submitSoon(*this);
+      }
+    }
+  }
+
+  void callbackCancelled(const io_uring_cqe* cqe) noexcept override {
+    if (cqe->res >= 0) {
+      closeAccepted(cqe->res);
+    }
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+      delete this;
+    }
+  }
+
+  // Closes the connection of a successful completion.
+  void closeAccepted(int res) noexcept {
+    if (direct_) {
+      backend_->closeDirectFd(res);
+    } else {
+      closeNoInt(NetworkSocket::fromFd(res));
+    }
+  }
+
+  bool direct() const { return direct_; }
+
+  void release() {
+    parent_ = nullptr;
+    if (inFlight()) {
+      backend_->cancel(this);
+    } else if (!inCallback_) {
+      delete this;
+    }
+  }
+
+ private:
+  AsyncServerSocket* parent_;
+  IoUringBackend* backend_;
+  NetworkSocket fd_;
+  sa_family_t addressFamily_;
+  bool direct_;
+  bool inCallback_{false};
+};
+#else
+class AsyncServerSocket::IoUringAcceptSqe {
+ public:
+  void closeAccepted(int) noexcept {}
+  bool direct() const { return false; }
+  void release() {}
+};
+#endif
+
+bool AsyncServerSocket::ServerEventHandler::registerAccept() {
+#if FOLLY_SERVER_SOCKET_IO_URING_ACCEPT
+  if (parent_->ioUringAccept_) {
+    if (ioUringAccept_) {
+      return true;
+    }
+    if (auto* backend = getIoUringAcceptBackend(parent_->eventBase_)) {
+      bool direct = parent_->ioUringAcceptDirect_ &&
+          backend->hasDirectAcceptFds() && parent_->allCallbacksLocal();
+      ioUringAccept_ = new IoUringAcceptSqe(
+          parent_, backend, socket_, addressFamily_, direct);
+      backend->submitSoon(*ioUringAccept_);
+      return true;
+    }
+  }
+#endif
+  return registerHandler(EventHandler::READ | EventHandler::PERSIST);
+}
+
+void AsyncServerSocket::ServerEventHandler::unregisterAccept() {
+  if (ioUringAccept_) {
+    std::exchange(ioUringAccept_, nullptr)->release();
+  }
+  unregisterHandler();
+}
+
+void AsyncServerSocket::fallBackFromIoUringAccept(IoUringAcceptSqe* sqe) {
+  for (auto& handler : sockets_) {
+    if (handler.ioUringAccept_ == sqe) {
+      handler.ioUringAccept_ = nullptr;
+      if (!handler.registerHandler(
+              EventHandler::READ | EventHandler::PERSIST)) {
+        LOG(ERROR) << "failed to register for accept events on "
+                   << handler.socket_;
+      }
+      return;
+    }
+  }
+}
+
+bool AsyncServerSocket::usingIoUringAccept() const {
+  for (const auto& handler : sockets_) {
+    if (handler.ioUringAccept_) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool AsyncServerSocket::usingIoUringAcceptDirect() const {
+  for (const auto& handler : sockets_) {
+    if (handler.ioUringAccept_ && handler.ioUringAccept_->direct()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool AsyncServerSocket::allCallbacksLocal() const {
+  for (const auto& info : callbacks_) {
+    if (info.eventBase && info.eventBase != eventBase_) {
+      return false;
+    }
+  }
+  return true;
+}
+
 const uint32_t AsyncServerSocket::kDefaultMaxAcceptAtOnce;
 const uint32_t AsyncServerSocket::kDefaultCallbackAcceptAtOnce;
 const uint32_t AsyncServerSocket::kDefaultMaxMessagesInQueue;
@@ -196,7 +427,7 @@ int AsyncServerSocket::stopAccepting(int shutdownFlags) {
   // second because it hasn't been closed yet.
   for (; !sockets_.empty(); sockets_.pop_back()) {
     auto& handler = sockets_.back();
-    handler.unregisterHandler();
+    handler.unregisterAccept();
     if (const auto shutdownSocketSet = wShutdownSocketSet_.lock()) {
       shutdownSocketSet->close(handler.socket_);
     } else if (shutdownFlags >= 0) {
@@ -705,6 +936,19 @@ void AsyncServerSocket::addAcceptCallback(
       it->second.consumer = acceptor;
     }
   }
+  if (eventBase != eventBase_ && usingIoUringAcceptDirect()) {
+    // Direct descriptors are only valid in the primary EventBase, so accept
+    // file descriptors from now on.
+    for (auto& handler : sockets_) {
+      if (handler.ioUringAccept_) {
+        handler.unregisterAccept();
+        if (!handler.registerAccept()) {
+          LOG(ERROR) << "failed to register for accept events on "
+                     << handler.socket_;
+        }
+      }
+    }
+  }
   if (localCallbackIndex_ < 0 && callbacks_.back().eventBase == eventBase_) {
     localCallbackIndex_ = static_cast<int>(callbacks_.size() - 1);
   }
@@ -785,7 +1029,7 @@ void AsyncServerSocket::removeAcceptCallback(
   // was removed, unregister for events until a callback is added.
   if (accepting_ && callbacks_.empty()) {
     for (auto& handler : sockets_) {
-      handler.unregisterHandler();
+      handler.unregisterAccept();
     }
   }
 }
@@ -803,7 +1047,7 @@ void AsyncServerSocket::startAccepting() {
   }
 
   for (auto& handler : sockets_) {
-    if (!handler.registerHandler(EventHandler::READ | EventHandler::PERSIST)) {
+    if (!handler.registerAccept()) {
       throw std::runtime_error("failed to register for accept events");
     }
   }
@@ -815,7 +1059,7 @@ void AsyncServerSocket::pauseAccepting() {
   }
   accepting_ = false;
   for (auto& handler : sockets_) {
-    handler.unregisterHandler();
+    handler.unregisterAccept();
   }
 
   // If we were in the accept backoff state, disable the backoff timeout
@@ -1040,128 +1284,194 @@ void AsyncServerSocket::handlerReady(
     auto clientSocket = netops::accept(fd, saddr, &addrLen);
 #endif
 
+    auto acceptErrno = errno;
+
     address.setFromSockaddr(saddr, addrLen);
 
-    if (clientSocket != NetworkSocket() && connectionEventCallback_) {
-      connectionEventCallback_->onConnectionAccepted(clientSocket, address);
-    }
-
-    // Connection accepted, get the SYN packet from the client if
-    // TOS reflect is enabled
-    if (kSupportReflectTos && clientSocket != NetworkSocket() && tosReflect_) {
-      std::array<uint32_t, 64> buffer;
-      socklen_t len = sizeof(buffer);
-      int ret = netops::getsockopt(
-          clientSocket, IPPROTO_TCP, TCP_SAVED_SYN, &buffer, &len);
-
-      if (ret == 0) {
-        uint32_t tosWord = folly::Endian::big(buffer[0]);
-        if (addressFamily == AF_INET6) {
-          tosWord = (tosWord & 0x0FC00000) >> 20;
-          // Set the TOS on the return socket only if it is non-zero
-          if (tosWord) {
-            ret = netops::setsockopt(
-                clientSocket,
-                IPPROTO_IPV6,
-                IPV6_TCLASS,
-                &tosWord,
-                sizeof(tosWord));
-          }
-        } else if (addressFamily == AF_INET) {
-          tosWord = (tosWord & 0x00FC0000) >> 16;
-          if (tosWord) {
-            ret = netops::setsockopt(
-                clientSocket, IPPROTO_IP, IP_TOS, &tosWord, sizeof(tosWord));
-          }
-        }
+    if (!processAcceptedSocket(
+            clientSocket, std::move(address), addressFamily, acceptErrno)) {
+      return;
+    }
+  }
+}
 
-        if (ret != 0) {
-          LOG(ERROR) << "Unable to set TOS for accepted socket "
-                     << clientSocket;
-        }
-      } else {
-        LOG(ERROR) << "Unable to get SYN packet for accepted socket "
-                   << clientSocket;
-      }
+void AsyncServerSocket::handleIoUringAccept(
+    int res, sa_family_t addressFamily) noexcept {
+  if (callbacks_.empty()) {
+    // completed before accepting stopped
+    if (res >= 0) {
+      closeNoInt(NetworkSocket::fromFd(res));
     }
+    return;
+  }
+  DestructorGuard dg(this);
 
-    std::chrono::time_point<std::chrono::steady_clock> nowMs =
-        std::chrono::steady_clock::now();
-    auto timeSinceLastAccept = std::max<int64_t>(
-        0,
-        nowMs.time_since_epoch().count() -
-            lastAccepTimestamp_.time_since_epoch().count());
-    lastAccepTimestamp_ = nowMs;
-    if (acceptRate_ < 1) {
-      acceptRate_ *= 1 + acceptRateAdjustSpeed_ * timeSinceLastAccept;
-      if (acceptRate_ >= 1) {
-        acceptRate_ = 1;
-      } else if (rand() > acceptRate_ * RAND_MAX) {
-        ++numDroppedConnections_;
-        if (clientSocket != NetworkSocket()) {
-          closeNoInt(clientSocket);
-          if (connectionEventCallback_) {
-            connectionEventCallback_->onConnectionDropped(
-                clientSocket,
-                address,
-                fmt::format(
-                    "Server is rate limiting new connections. Current accept rate is {}",
-                    acceptRate_));
-          }
-        }
-        continue;
-      }
+  NetworkSocket clientSocket;
+  SocketAddress address;
+  if (res >= 0) {
+    clientSocket = NetworkSocket::fromFd(res);
+    sockaddr_storage addrStorage = {};
+    socklen_t addrLen = sizeof(addrStorage);
+    auto saddr = reinterpret_cast<sockaddr*>(&addrStorage);
+    if (netops::getpeername(clientSocket, saddr, &addrLen) == 0) {
+      address.setFromSockaddr(saddr, addrLen);
     }
+  }
+  processAcceptedSocket(
+      clientSocket, std::move(address), addressFamily, res < 0 ? -res : 0);
+}
 
-    if (clientSocket == NetworkSocket()) {
-      if (errno == EAGAIN) {
-        // No more sockets to accept right now.
-        // Check for this code first, since it's the most common.
-        return;
-      } else if (errno == EMFILE || errno == ENFILE) {
-        // We're out of file descriptors.  Perhaps we're accepting connections
-        // too quickly. Pause accepting briefly to back off and give the server
-        // a chance to recover.
-        LOG(ERROR) << "accept failed: out of file descriptors; entering accept "
-                      "back-off state";
-        enterBackoff();
-
-        // Dispatch the error message
-        dispatchError("accept() failed", errno);
-      } else {
-        dispatchError("accept() failed", errno);
+void AsyncServerSocket::handleIoUringAcceptDirect(
+    IoUringAcceptSqe* sqe, int res, sa_family_t addressFamily) noexcept {
+  if (res < 0) {
+    handleIoUringAccept(res, addressFamily);
+    return;
+  }
+  if (callbacks_.empty() || rateLimitAccept()) {
+    // completed before accepting stopped, or dropped
+    sqe->closeAccepted(res);
+    return;
+  }
+
+  CallbackInfo* info = nextCallback();
+  DCHECK(!info->eventBase || info->eventBase == eventBase_);
+  if (!info->callback->connectionAcceptedDirect(
+          res, {std::chrono::steady_clock::now()})) {
+    LOG(ERROR) << "accept callback does not take direct descriptors, "
+               << "closing the connection";
+    sqe->closeAccepted(res);
+  }
+}
+
+bool AsyncServerSocket::rateLimitAccept() {
+  std::chrono::time_point<std::chrono::steady_clock> nowMs =
+      std::chrono::steady_clock::now();
+  auto timeSinceLastAccept = std::max<int64_t>(
+      0,
+      nowMs.time_since_epoch().count() -
+          lastAccepTimestamp_.time_since_epoch().count());
+  lastAccepTimestamp_ = nowMs;
+  if (acceptRate_ < 1) {
+    acceptRate_ *= 1 + acceptRateAdjustSpeed_ * timeSinceLastAccept;
+    if (acceptRate_ >= 1) {
+      acceptRate_ = 1;
+    } else if (rand() > acceptRate_ * RAND_MAX) {
+      ++numDroppedConnections_;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool AsyncServerSocket::processAcceptedSocket(
+    NetworkSocket clientSocket,
+    SocketAddress&& address,
+    sa_family_t addressFamily,
+    int err) noexcept {
+  if (clientSocket != NetworkSocket() && connectionEventCallback_) {
+    connectionEventCallback_->onConnectionAccepted(clientSocket, address);
+  }
+
+  // Connection accepted, get the SYN packet from the client if
+  // TOS reflect is enabled
+  if (kSupportReflectTos && clientSocket != NetworkSocket() && tosReflect_) {
+    std::array<uint32_t, 64> buffer;
+    socklen_t len = sizeof(buffer);
+    int ret = netops::getsockopt(
+        clientSocket, IPPROTO_TCP, TCP_SAVED_SYN, &buffer, &len);
+
+    if (ret == 0) {
+      uint32_t tosWord = folly::Endian::big(buffer[0]);
+      if (addressFamily == AF_INET6) {
+        tosWord = (tosWord & 0x0FC00000) >> 20;
+        // Set the TOS on the return socket only if it is non-zero
+        if (tosWord) {
+          ret = netops::setsockopt(
+              clientSocket,
+              IPPROTO_IPV6,
+              IPV6_TCLASS,
+              &tosWord,
+              sizeof(tosWord));
+        }
+      } else if (addressFamily == AF_INET) {
+        tosWord = (tosWord & 0x00FC0000) >> 16;
+        if (tosWord) {
+          ret = netops::setsockopt(
+              clientSocket, IPPROTO_IP, IP_TOS, &tosWord, sizeof(tosWord));
+        }
       }
-      if (connectionEventCallback_) {
-        connectionEventCallback_->onConnectionAcceptError(errno);
+
+      if (ret != 0) {
+        LOG(ERROR) << "Unable to set TOS for accepted socket "
+                   << clientSocket;
       }
-      return;
+    } else {
+      LOG(ERROR) << "Unable to get SYN packet for accepted socket "
+                 << clientSocket;
     }
+  }
 
-#if !FOLLY_HAVE_ACCEPT4
-    // Explicitly set the new connection to non-blocking mode
-    if (netops::set_socket_non_blocking(clientSocket) != 0) {
+  if (rateLimitAccept()) {
+    if (clientSocket != NetworkSocket()) {
       closeNoInt(clientSocket);
-      std::string errorMsg =
-          "Failed to set accepted socket to non-blocking mode.";
-      dispatchError(errorMsg.c_str(), errno);
       if (connectionEventCallback_) {
         connectionEventCallback_->onConnectionDropped(
             clientSocket,
             address,
-            fmt::format("{} errno ({})", std::move(errorMsg), errno));
+            fmt::format(
+                "Server is rate limiting new connections. Current accept rate is {}",
+                acceptRate_));
       }
-      return;
     }
-#endif
-
-    // Inform the callback about the new connection
-    dispatchSocket(clientSocket, std::move(address));
+    return true;
+  }
+
+  if (clientSocket == NetworkSocket()) {
+    if (err == EAGAIN) {
+      // No more sockets to accept right now.
+      // Check for this code first, since it's the most common.
+      return false;
+    } else if (err == EMFILE || err == ENFILE) {
+      // We're out of file descriptors.  Perhaps we're accepting connections
+      // too quickly. Pause accepting briefly to back off and give the server
+      // a chance to recover.
+      LOG(ERROR) << "accept failed: out of file descriptors; entering accept "
+                    "back-off state";
+      enterBackoff();
+
+      // Dispatch the error message
+      dispatchError("accept() failed", err);
+    } else {
+      dispatchError("accept() failed", err);
+    }
+    if (connectionEventCallback_) {
+      connectionEventCallback_->onConnectionAcceptError(err);
+    }
+    return false;
+  }
 
-    // If we aren't accepting any more, break out of the loop
-    if (!accepting_ || callbacks_.empty()) {
-      break;
+#if !FOLLY_HAVE_ACCEPT4
+  // Explicitly set the new connection to non-blocking mode
+  if (netops::set_socket_non_blocking(clientSocket) != 0) {
+    closeNoInt(clientSocket);
+    std::string errorMsg =
+        "Failed to set accepted socket to non-blocking mode.";
+    dispatchError(errorMsg.c_str(), errno);
+    if (connectionEventCallback_) {
+      connectionEventCallback_->onConnectionDropped(
+          clientSocket,
+          address,
+          fmt::format("{} errno ({})", std::move(errorMsg), errno));
     }
+    return false;
   }
+#endif
+
+  // Inform the callback about the new connection
+  dispatchSocket(clientSocket, std::move(address));
+
+  // If we aren't accepting any more, stop
+  return accepting_ && !callbacks_.empty();
 }
 
 void AsyncServerSocket::dispatchSocket(
@@ -1310,7 +1620,7 @@ void AsyncServerSocket::enterBackoff() {
   // Go ahead and disable accepts for now.  We leave accepting_ set to true,
   // since that tracks the desired state requested by the user.
   for (auto& handler : sockets_) {
-    handler.unregisterHandler();
+    handler.unregisterAccept();
   }
   if (connectionEventCallback_) {
     connectionEventCallback_->onBackoffStarted();
@@ -1336,7 +1646,7 @@ void AsyncServerSocket::backoffTimeoutExpired() {
 
   // Register the handler.
   for (auto& handler : sockets_) {
-    if (!handler.registerHandler(EventHandler::READ | EventHandler::PERSIST)) {
+    if (!handler.registerAccept()) {
       // We're hosed.  We could just re-schedule backoffTimeout_ to
       // re-try again after a little bit.  However, we don't want to
       // loop retrying forever if we can't re-enable accepts.  Just
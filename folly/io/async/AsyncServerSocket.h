@@ -23,6 +23,7 @@
 #include <exception>
 #include <functional>
 #include <memory>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -180,6 +181,26 @@ class AsyncServerSocket : public DelayedDestruction, public AsyncSocketBase {
         const SocketAddress& clientAddr,
         AcceptInfo info) noexcept = 0;
 
+    /**
+     * connectionAcceptedDirect() is called instead of connectionAccepted()
+     * for a connection accepted into an io_uring direct descriptor (see
+     * setIoUringAcceptDirect()), in the server socket's EventBase.
+     *
+     * @param index  The direct descriptor of the connection, in the fixed
+     *               file table of the EventBase's IoUringBackend, for example
+     *               to construct an AsyncIoUringSocket on that EventBase.  The
+     *               AcceptCallback assumes ownership of it.  The client
+     *               address is not available.
+     * @param info   As for connectionAccepted().
+     * @return       false if the AcceptCallback does not take direct
+     *               descriptors, in which case the server socket closes the
+     *               connection.
+     */
+    virtual bool connectionAcceptedDirect(
+        int /* index */, AcceptInfo /* info */) noexcept {
+      return false;
+    }
+
     /**
      * acceptError() is called if an error occurs while accepting.
      *
@@ -816,6 +837,53 @@ class AsyncServerSocket : public DelayedDestruction, public AsyncSocketBase {
     tfoMaxQueueSize_ = maxTFOQueueSize;
   }
 
+  /**
+   * Accept with a multishot IORING_OP_ACCEPT when the primary EventBase runs
+   * on an IoUringBackend (or has an IoUringEventBaseLocal) and the kernel
+   * supports it: every connection then completes a single request, instead
+   * of taking a readiness event and an accept4() call. Otherwise, or if
+   * disabled, the socket accepts with accept4().
+   *
+   * The setting applies the next time the socket starts accepting.
+   */
+  void setIoUringAccept(bool enable) { ioUringAccept_ = enable; }
+
+  /**
+   * Get whether or not io_uring accept is enabled.
+   */
+  bool getIoUringAccept() const { return ioUringAccept_; }
+
+  /**
+   * Whether the socket is currently accepting with io_uring.
+   */
+  bool usingIoUringAccept() const;
+
+  /**
+   * With io_uring accept, accept into direct descriptors of the IoUringBackend
+   * instead of file descriptors, and pass them to
+   * AcceptCallback::connectionAcceptedDirect(). Requests on a direct
+   * descriptor skip the file table lookup, and it takes no fd.
+   *
+   * The backend must reserve slots for them with
+   * IoUringBackend::Options::setDirectAcceptFds(), and every accept callback
+   * must run in the primary EventBase, as the descriptors are only valid in
+   * its ring; otherwise connections are accepted as file descriptors. The
+   * ConnectionEventCallback and TOS reflection do not see these connections.
+   *
+   * The setting applies the next time the socket starts accepting.
+   */
+  void setIoUringAcceptDirect(bool enable) { ioUringAcceptDirect_ = enable; }
+
+  /**
+   * Get whether or not accepting into direct descriptors is enabled.
+   */
+  bool getIoUringAcceptDirect() const { return ioUringAcceptDirect_; }
+
+  /**
+   * Whether the socket is currently accepting into direct descriptors.
+   */
+  bool usingIoUringAcceptDirect() const;
+
   /**
    * Do not attempt the transparent TLS handshake
    */
@@ -943,9 +1011,26 @@ class AsyncServerSocket : public DelayedDestruction, public AsyncSocketBase {
   };
 
   class BackoffTimeout;
+  class IoUringAcceptSqe;
 
   virtual void handlerReady(
       uint16_t events, NetworkSocket fd, sa_family_t family) noexcept;
+  void handleIoUringAccept(int res, sa_family_t family) noexcept;
+  void handleIoUringAcceptDirect(
+      IoUringAcceptSqe* sqe, int res, sa_family_t family) noexcept;
+  // Accepts with readiness events on the socket of a failed io_uring accept.
+  void fallBackFromIoUringAccept(IoUringAcceptSqe* sqe);
+  // Whether every accept callback runs in the primary EventBase.
+  bool allCallbacksLocal() const;
+  // Returns whether to drop the connection just accepted, to keep to the
+  // accept rate.
+  bool rateLimitAccept();
+  // Returns whether to keep accepting on this readiness event.
+  bool processAcceptedSocket(
+      NetworkSocket clientSocket,
+      SocketAddress&& address,
+      sa_family_t addressFamily,
+      int err) noexcept;
 
   NetworkSocket createSocket(int family);
   void setupSocket(NetworkSocket fd, int family);
@@ -993,19 +1078,24 @@ class AsyncServerSocket : public DelayedDestruction, public AsyncSocketBase {
           parent_(parent),
           addressFamily_(addressFamily) {}
 
-    ServerEventHandler(const ServerEventHandler& other)
+    // Move-only: the multishot accept request has a single owner, which
+    // releases it in unregisterAccept().
+    ServerEventHandler(ServerEventHandler&& other) noexcept
         : EventHandler(other.eventBase_, other.socket_),
           eventBase_(other.eventBase_),
           socket_(other.socket_),
           parent_(other.parent_),
-          addressFamily_(other.addressFamily_) {}
+          addressFamily_(other.addressFamily_),
+          ioUringAccept_(std::exchange(other.ioUringAccept_, nullptr)) {}
 
-    ServerEventHandler& operator=(const ServerEventHandler& other) {
+    ServerEventHandler& operator=(ServerEventHandler&& other) noexcept {
       if (this != &other) {
+        unregisterAccept();
         eventBase_ = other.eventBase_;
         socket_ = other.socket_;
         parent_ = other.parent_;
         addressFamily_ = other.addressFamily_;
+        ioUringAccept_ = std::exchange(other.ioUringAccept_, nullptr);
 
         detachEventBase();
         attachEventBase(other.eventBase_);
@@ -1014,15 +1104,23 @@ class AsyncServerSocket : public DelayedDestruction, public AsyncSocketBase {
       return *this;
     }
 
+    ServerEventHandler(const ServerEventHandler&) = delete;
+    ServerEventHandler& operator=(const ServerEventHandler&) = delete;
+
     // Inherited from EventHandler
     void handlerReady(uint16_t events) noexcept override {
       parent_->handlerReady(events, socket_, addressFamily_);
     }
 
+    // Start and stop accepting, with io_uring or readiness events.
+    bool registerAccept();
+    void unregisterAccept();
+
     EventBase* eventBase_;
     NetworkSocket socket_;
     AsyncServerSocket* parent_;
     sa_family_t addressFamily_;
+    IoUringAcceptSqe* ioUringAccept_{nullptr};
   };
 
   EventBase* eventBase_;
@@ -1049,6 +1147,8 @@ class AsyncServerSocket : public DelayedDestruction, public AsyncSocketBase {
   bool closeOnExec_;
   bool tfo_{false};
   bool noTransparentTls_{false};
+  bool ioUringAccept_{false};
+  bool ioUringAcceptDirect_{false};
   uint32_t tfoMaxQueueSize_{0};
   std::weak_ptr<ShutdownSocketSet> wShutdownSocketSet_;
   ConnectionEventCallback* connectionEventCallback_{nullptr};
@@ -25,6 +25,7 @@
 #include <boost/preprocessor/control/if.hpp>
 
 #include <folly/Exception.h>
+#include <folly/FileUtil.h>
 #include <folly/Portability.h>
 #include <folly/SocketAddress.h>
 #include <folly/String.h>
@@ -42,7 +43,9 @@
 #if defined(__linux__)
 #include <linux/if_packet.h>
 #include <linux/sockios.h>
+#include <signal.h>
 #include <sys/ioctl.h>
+#include <sys/sendfile.h>
 #endif
 
 using ZeroCopyMemStore = folly::AsyncReader::ReadCallback::ZeroCopyMemStore;
@@ -220,6 +223,28 @@ cmsgToScmTimestamping(const cmsghdr& cmsg) {
 }
 
 #endif // FOLLY_HAVE_SO_TIMESTAMPING
+
+#if defined(__linux__)
+// sendfile(2) has no MSG_NOSIGNAL: block SIGPIPE around it, and discard the
+// one it raises when the peer is gone, unless the thread blocked SIGPIPE
+// itself.
+ssize_t sendFileNoSigPipe(int outFd, int inFd, off_t* offset, size_t count) {
+  sigset_t sigPipe;
+  sigset_t oldMask;
+  sigemptyset(&sigPipe);
+  sigaddset(&sigPipe, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &sigPipe, &oldMask);
+  auto n = ::sendfile(outFd, inFd, offset, count);
+  if (n < 0 && errno == EPIPE && !sigismember(&oldMask, SIGPIPE)) {
+    auto errnoCopy = errno;
+    struct timespec noWait = {};
+    sigtimedwait(&sigPipe, nullptr, &noWait);
+    errno = errnoCopy;
+  }
+  pthread_sigmask(SIG_SETMASK, &oldMask, nullptr);
+  return n;
+}
+#endif
 } // namespace
 
 // TODO: It might help performance to provide a version of BytesWriteRequest
@@ -349,7 +374,7 @@ class AsyncSocket::BytesWriteRequest : public AsyncSocket::WriteRequest {
 
     // Increment the totalBytesWritten_ count by bytesWritten_;
     assert(bytesWritten_ >= 0);
-    totalBytesWritten_ += uint32_t(bytesWritten_);
+    totalBytesWritten_ += size_t(bytesWritten_);
   }
 
  private:
@@ -402,6 +427,142 @@ class AsyncSocket::BytesWriteRequest : public AsyncSocket::WriteRequest {
   struct iovec writeOps_[]; ///< write operation(s) list
 };
 
+/* The WriteRequest of sendFile(). It moves the range of the file to the
+ * socket with sendfile(2), or, when the data has to go through user space,
+ * reads it a chunk at a time and writes each chunk with performWrite(),
+ * reading the next one once the previous one is written.
+ */
+class AsyncSocket::FileWriteRequest : public AsyncSocket::WriteRequest {
+ public:
+  FileWriteRequest(
+      AsyncSocket* socket,
+      WriteCallback* callback,
+      int fd,
+      off_t offset,
+      size_t length,
+      WriteFlags flags,
+      bool buffered)
+      : AsyncSocket::WriteRequest(socket, callback),
+        fd_(fd),
+        offset_(offset),
+        remaining_(length),
+        // The chunk is reused, it cannot be sent with zero copy.
+        flags_(unSet(flags, WriteFlags::WRITE_MSG_ZEROCOPY)),
+        buffered_(buffered) {}
+
+  void destroy() override { delete this; }
+
+  WriteResult performWrite() override {
+    if (buffered_) {
+      return performBufferedWrite();
+    }
+#if defined(__linux__)
+    // Bounded like a single write(2).
+    constexpr size_t kMaxChunk = size_t(1) << 30;
+    auto n = sendFileNoSigPipe(
+        socket_->fd_.toFd(), fd_, &offset_, std::min(remaining_, kMaxChunk));
+    if (n < 0) {
+      if (errno == EAGAIN) {
+        return WriteResult(0);
+      }
+      return WriteResult(
+          WRITE_ERROR,
+          std::make_unique<AsyncSocketException>(
+              AsyncSocketException::INTERNAL_ERROR,
+              socket_->withAddr("sendfile() failed"),
+              errno));
+    }
+    if (n == 0 && remaining_ > 0) {
+      return shorterThanRange();
+    }
+    socket_->rawBytesWritten_ += n;
+    remaining_ -= size_t(n);
+    bytesWritten(size_t(n));
+    return WriteResult(n);
+#else
+    return WriteResult(
+        WRITE_ERROR,
+        std::make_unique<AsyncSocketException>(
+            AsyncSocketException::NOT_SUPPORTED, "sendfile() not supported"));
+#endif
+  }
+
+  bool isComplete() override { return remaining_ == 0; }
+
+  // performWrite() already accounts for the progress.
+  void consume() override {}
+
+ private:
+  // private destructor, to ensure callers use destroy()
+  ~FileWriteRequest() override = default;
+
+  WriteResult performBufferedWrite() {
+    if (!chunk_ || chunk_->empty()) {
+      auto size = std::min(remaining_, kSendFileChunkSize);
+      if (!chunk_) {
+        chunk_ = IOBuf::create(size);
+      }
+      chunk_->clear();
+      auto n = preadFull(fd_, chunk_->writableData(), size, offset_);
+      if (n < 0) {
+        return WriteResult(
+            WRITE_ERROR,
+            std::make_unique<AsyncSocketException>(
+                AsyncSocketException::INTERNAL_ERROR,
+                socket_->withAddr("failed to read the file to send"),
+                errno));
+      }
+      if (size_t(n) < size) {
+        return shorterThanRange();
+      }
+      chunk_->append(size);
+      offset_ += off_t(size);
+    }
+
+    // The flags, EOR and timestamps included, are for the end of the range.
+    bool lastChunk = remaining_ == chunk_->length();
+    WriteFlags writeFlags = lastChunk ? flags_ : WriteFlags::CORK;
+    if (getNext() != nullptr) {
+      writeFlags |= WriteFlags::CORK;
+    }
+    iovec vec;
+    vec.iov_base = chunk_->writableData();
+    vec.iov_len = chunk_->length();
+    uint32_t countWritten = 0;
+    uint32_t partialWritten = 0;
+    auto writeResult = socket_->performWrite(
+        &vec,
+        1,
+        writeFlags,
+        &countWritten,
+        &partialWritten,
+        WriteRequestTag{WriteRequestTag::EmptyDummy{}});
+    if (writeResult.writeReturn > 0) {
+      // performWrite() counts the bytes written to the socket.
+      auto n = size_t(writeResult.writeReturn);
+      chunk_->trimStart(n);
+      remaining_ -= n;
+      totalBytesWritten_ += n;
+    }
+    return writeResult;
+  }
+
+  WriteResult shorterThanRange() {
+    return WriteResult(
+        WRITE_ERROR,
+        std::make_unique<AsyncSocketException>(
+            AsyncSocketException::INTERNAL_ERROR,
+            socket_->withAddr("the file to send is shorter than the range")));
+  }
+
+  const int fd_;
+  off_t offset_; ///< offset of the next byte to read or send
+  size_t remaining_; ///< bytes left to send
+  const WriteFlags flags_;
+  const bool buffered_;
+  std::unique_ptr<IOBuf> chunk_; ///< read and not written yet, if buffered_
+};
+
 int AsyncSocket::SendMsgParamsCallback::getDefaultFlags(
     folly::WriteFlags flags, bool zeroCopyEnabled) noexcept {
   int msg_flags = MSG_DONTWAIT;
@@ -1993,6 +2154,60 @@ void AsyncSocket::writeImpl(
   }
 }
 
+void AsyncSocket::sendFile(
+    WriteCallback* callback,
+    int fd,
+    off_t offset,
+    size_t length,
+    WriteFlags flags) {
+  if (state_ == StateEnum::FAST_OPEN) {
+    // See writeImpl(): the data goes with the connect.
+    return AsyncTransport::sendFile(callback, fd, offset, length, flags);
+  }
+  VLOG(6) << "AsyncSocket::sendFile() this=" << this << ", fd=" << fd_
+          << ", callback=" << callback << ", length=" << length
+          << ", state=" << state_;
+  DestructorGuard dg(this);
+  eventBase_->dcheckIsInEventBaseThread();
+
+  if (shutdownFlags_ & (SHUT_WRITE | SHUT_WRITE_PENDING)) {
+    // See writeImpl().
+    return invalidState(callback);
+  }
+  if (state_ != StateEnum::ESTABLISHED && !connecting()) {
+    return invalidState(callback);
+  }
+
+  totalAppBytesScheduledForWrite_ += length;
+  bool idle = writeReqHead_ == nullptr;
+  auto req = new FileWriteRequest(
+      this, callback, fd, offset, length, flags, !canSendFile(flags));
+  if (writeReqTail_ == nullptr) {
+    writeReqHead_ = writeReqTail_ = req;
+  } else {
+    writeReqTail_->append(req);
+    writeReqTail_ = req;
+  }
+
+  if (idle && !connecting()) {
+    // Like a write to an idle socket, start right away; handleWrite()
+    // registers for write events if the request does not complete.
+    handleWrite();
+  } else if (bufferCallback_) {
+    bufferCallback_->onEgressBuffered();
+  }
+}
+
+bool AsyncSocket::canSendFile(WriteFlags flags) const {
+#if defined(__linux__)
+  return unSet(flags, WriteFlags::CORK) == WriteFlags::NONE &&
+      lifecycleObservers_.empty();
+#else
+  (void)flags;
+  return false;
+#endif
+}
+
 void AsyncSocket::writeRequest(WriteRequest* req) {
   if (writeReqTail_ == nullptr) {
     assert(writeReqHead_ == nullptr);
@@ -4217,7 +4432,7 @@ void AsyncSocket::failWrite(const char* fn, const AsyncSocketException& ex) {
     WriteRequest* req = writeReqHead_;
     writeReqHead_ = req->getNext();
     WriteCallback* callback = req->getCallback();
-    uint32_t bytesWritten = req->getTotalBytesWritten();
+    size_t bytesWritten = req->getTotalBytesWritten();
     req->destroy();
     if (callback) {
       callback->writeErr(bytesWritten, ex);
@@ -863,6 +863,20 @@ class AsyncSocket : public AsyncSocketTransport {
       std::unique_ptr<folly::IOBuf>&& buf,
       WriteFlags flags = WriteFlags::NONE) override;
 
+  /**
+   * On Linux, moves the data from the file to the socket with sendfile(2),
+   * without copying it to user space. sendfile(2) cannot take flags: CORK
+   * only applies within the range, and the writes that need other flags or
+   * have prewrite observers read the file a chunk at a time instead, each
+   * chunk once the previous one is written.
+   */
+  void sendFile(
+      WriteCallback* callback,
+      int fd,
+      off_t offset,
+      size_t length,
+      WriteFlags flags = WriteFlags::NONE) override;
+
   class WriteRequest;
   virtual void writeRequest(WriteRequest* req);
   void writeRequestReady() { handleWrite(); }
@@ -1317,7 +1331,7 @@ class AsyncSocket : public AsyncSocketTransport {
       return callbackWithState_;
     }
 
-    uint32_t getTotalBytesWritten() const { return totalBytesWritten_; }
+    size_t getTotalBytesWritten() const { return totalBytesWritten_; }
 
     void append(WriteRequest* next) {
       assert(next_ == nullptr);
@@ -1329,7 +1343,7 @@ class AsyncSocket : public AsyncSocketTransport {
     }
 
     void bytesWritten(size_t count) {
-      totalBytesWritten_ += uint32_t(count);
+      totalBytesWritten_ += count;
       socket_->appBytesWritten_ += count;
     }
 
@@ -1341,7 +1355,7 @@ class AsyncSocket : public AsyncSocketTransport {
     WriteRequest* next_{nullptr}; ///< pointer to next WriteRequest
     WriteCallbackWithState callbackWithState_; ///< completion callback
     ReleaseIOBufCallback* releaseIOBufCallback_; ///< release IOBuf callback
-    uint32_t totalBytesWritten_{0}; ///< total bytes written
+    size_t totalBytesWritten_{0}; ///< total bytes written
   };
 
  public:
@@ -1625,6 +1639,7 @@ class AsyncSocket : public AsyncSocketTransport {
   };
 
   class BytesWriteRequest;
+  class FileWriteRequest;
 
   class WriteTimeout : public AsyncTimeout {
    public:
@@ -1756,6 +1771,13 @@ class AsyncSocket : public AsyncSocketTransport {
       size_t totalBytes,
       WriteFlags flags = WriteFlags::NONE);
 
+  /**
+   * Whether sendFile() can use sendfile(2) for a write with these flags.
+   * Otherwise it reads the file a chunk at a time, and writes the chunks
+   * with performWrite().
+   */
+  virtual bool canSendFile(WriteFlags flags) const;
+
   /**
    * Attempt to write to the socket.
    *
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/AsyncTransport.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#include <folly/FileUtil.h>
+#include <folly/io/async/AsyncSocketException.h>
+
+namespace folly {
+
+namespace {
+
+// Reads the range a chunk at a time, and writes each chunk once the previous
+// one has been written, so that only one chunk is held in memory.
+class FileChunkWriter : public AsyncWriter::WriteCallback {
+ public:
+  FileChunkWriter(
+      AsyncTransport* transport,
+      AsyncWriter::WriteCallback* callback,
+      int fd,
+      off_t offset,
+      size_t length,
+      WriteFlags flags,
+      size_t chunkSize)
+      : transport_(transport),
+        callback_(callback),
+        fd_(fd),
+        offset_(offset),
+        remaining_(length),
+        flags_(flags),
+        chunkSize_(chunkSize) {}
+
+  // Writes until a chunk is left in flight, or the range has been written.
+  void writeChunks() {
+    while (remaining_ > 0) {
+      auto size = std::min(remaining_, chunkSize_);
+      auto buf = IOBuf::create(size);
+      auto n = preadFull(fd_, buf->writableData(), size, offset_);
+      if (n < 0 || size_t(n) != size) {
+        auto errnoCopy = n < 0 ? errno : 0;
+        fail(
+            0,
+            AsyncSocketException(
+                AsyncSocketException::INTERNAL_ERROR,
+                n < 0 ? "failed to read the file to send"
+                      : "the file to send is shorter than the range",
+                errnoCopy));
+        delete this;
+        return;
+      }
+      buf->append(size);
+      offset_ += size;
+      remaining_ -= size;
+      chunk_ = size;
+
+      state_ = State::Writing;
+      transport_->writeChain(
+          this,
+          std::move(buf),
+          remaining_ > 0 ? flags_ | WriteFlags::CORK : flags_);
+      if (state_ == State::Writing) {
+        state_ = State::Waiting;
+        return;
+      }
+      if (state_ == State::Failed) {
+        delete this;
+        return;
+      }
+    }
+    if (callback_) {
+      callback_->writeSuccess();
+    }
+    delete this;
+  }
+
+  void writeSuccess() noexcept override {
+    written_ += chunk_;
+    if (state_ == State::Writing) {
+      state_ = State::Written;
+      return;
+    }
+    writeChunks();
+  }
+
+  void writeErr(size_t bytesWritten, const AsyncSocketException& ex) noexcept
+      override {
+    fail(bytesWritten, ex);
+    if (state_ == State::Writing) {
+      state_ = State::Failed;
+      return;
+    }
+    delete this;
+  }
+
+ private:
+  enum class State {
+    Waiting,
+    // Within writeChain(), which may complete the write before returning.
+    Writing,
+    Written,
+    Failed,
+  };
+
+  void fail(size_t bytesWritten, const AsyncSocketException& ex) {
+    if (callback_) {
+      callback_->writeErr(written_ + bytesWritten, ex);
+    }
+  }
+
+  AsyncTransport* const transport_;
+  AsyncWriter::WriteCallback* const callback_;
+  const int fd_;
+  off_t offset_;
+  size_t remaining_;
+  const WriteFlags flags_;
+  const size_t chunkSize_;
+  size_t chunk_{0};
+  size_t written_{0};
+  State state_{State::Waiting};
+};
+
+} // namespace
+
+void AsyncTransport::sendFile(
+    WriteCallback* callback,
+    int fd,
+    off_t offset,
+    size_t length,
+    WriteFlags flags) {
+  (new FileChunkWriter(
+       this, callback, fd, offset, length, flags, kSendFileChunkSize))
+      ->writeChunks();
+}
+
+} // namespace folly
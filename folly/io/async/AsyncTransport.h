@@ -514,6 +514,28 @@ class AsyncTransport
    */
   virtual void shutdownWriteNow() = 0;
 
+  /**
+   * Write length bytes of the file fd, starting at offset.
+   *
+   * This is a write like writeChain(): it is ordered with the other writes,
+   * and exactly one of writeSuccess() or writeErr() will be invoked on a
+   * non-null callback. fd must remain open until then; its file offset is
+   * not changed.
+   *
+   * Transports that can move the data from the file to the socket in the
+   * kernel (AsyncSocket with sendfile(2), AsyncIoUringSocket with splice)
+   * override this. The default implementation reads the range a chunk at a
+   * time, and writes each chunk with writeChain() once the previous one has
+   * been written; writes issued before the callback runs may then go out
+   * ahead of the rest of the range.
+   */
+  virtual void sendFile(
+      WriteCallback* callback,
+      int fd,
+      off_t offset,
+      size_t length,
+      WriteFlags flags = WriteFlags::NONE);
+
   /**
    * Determine if transport is open and ready to read or write.
    *
@@ -899,6 +921,10 @@ class AsyncTransport
  protected:
   ~AsyncTransport() override = default;
 
+  // How much of the file sendFile() reads into memory at a time, when it
+  // cannot move the data in the kernel.
+  static constexpr size_t kSendFileChunkSize = 64 * 1024;
+
  private:
   template <class T>
   friend class DecoratedAsyncTransportWrapper;
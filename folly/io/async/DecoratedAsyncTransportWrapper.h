@@ -150,6 +150,15 @@ class DecoratedAsyncTransportWrapper : public folly::AsyncTransport {
 
   void shutdownWriteNow() override { transport_->shutdownWriteNow(); }
 
+  void sendFile(
+      folly::AsyncTransport::WriteCallback* callback,
+      int fd,
+      off_t offset,
+      size_t length,
+      folly::WriteFlags flags = folly::WriteFlags::NONE) override {
+    transport_->sendFile(callback, fd, offset, length, flags);
+  }
+
   std::string getApplicationProtocol() const noexcept override {
     return transport_->getApplicationProtocol();
   }
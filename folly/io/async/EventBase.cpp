@@ -430,6 +430,21 @@ void EventBase::setMaxReadAtOnce(uint32_t maxAtOnce) {
   queue_->setMaxReadAtOnce(maxAtOnce);
 }
 
+void EventBase::setWaitOptions(const WaitOptions& opt) {
+  dcheckIsInEventBaseThread();
+  idleSpinMax_ = opt.spin_max();
+}
+
+std::chrono::nanoseconds EventBase::getIdleSpinTime() const {
+  dcheckIsInEventBaseThread();
+  return idleSpinTime_;
+}
+
+std::chrono::nanoseconds EventBase::getIdleParkTime() const {
+  dcheckIsInEventBaseThread();
+  return idleParkTime_;
+}
+
 bool EventBase::isInEventBaseThread() const {
   auto tid = loopTid_.load(std::memory_order_relaxed);
   return tid == static_cast<pid_t>(getOSThreadID()) ||
@@ -628,7 +643,9 @@ EventBase::LoopStatus EventBase::loopMain(int flags, LoopOptions options) {
     // nobody can add loop callbacks from within this thread if
     // we don't have to handle anything to start with...
     if (blocking && loopCallbacks_.empty()) {
-      res = evb_->eb_event_base_loop(EVLOOP_ONCE);
+      res = idleSpinMax_ > std::chrono::nanoseconds::zero()
+          ? spinThenWaitForEvents()
+          : evb_->eb_event_base_loop(EVLOOP_ONCE);
     } else {
       res = evb_->eb_event_base_loop(EVLOOP_ONCE | EVLOOP_NONBLOCK);
     }
@@ -815,7 +832,43 @@ void EventBase::loopForever() {
   }
 }
 
+int EventBase::spinThenWaitForEvents() {
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + idleSpinMax_;
+  idleWaitStart_ = start;
+  idleWaitSpinning_ = true;
+  do {
+    int res = evb_->eb_event_base_loop(EVLOOP_ONCE | EVLOOP_NONBLOCK);
+    // Handling an event ends the idle wait, see bumpHandlingTime().
+    if (res != 0 || idleWaitStart_ == std::chrono::steady_clock::time_point{} ||
+        !loopCallbacks_.empty() || stop_.load(std::memory_order_relaxed)) {
+      endIdleWait();
+      return res;
+    }
+  } while (std::chrono::steady_clock::now() < deadline);
+  endIdleWait();
+
+  idleWaitStart_ = std::chrono::steady_clock::now();
+  idleWaitSpinning_ = false;
+  int res = evb_->eb_event_base_loop(EVLOOP_ONCE);
+  endIdleWait();
+  return res;
+}
+
+void EventBase::endIdleWait() {
+  if (idleWaitStart_ == std::chrono::steady_clock::time_point{}) {
+    return;
+  }
+  auto waited = std::chrono::steady_clock::now() - idleWaitStart_;
+  (idleWaitSpinning_ ? idleSpinTime_ : idleParkTime_) += waited;
+  idleWaitStart_ = {};
+}
+
 void EventBase::bumpHandlingTime() {
+  if (FOLLY_UNLIKELY(
+          idleWaitStart_ != std::chrono::steady_clock::time_point{})) {
+    endIdleWait();
+  }
   if (!enableTimeMeasurement_) {
     return;
   }
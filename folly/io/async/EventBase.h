@@ -54,6 +54,7 @@
 #include <folly/io/async/TimeoutManager.h>
 #include <folly/portability/Event.h>
 #include <folly/synchronization/CallOnce.h>
+#include <folly/synchronization/WaitOptions.h>
 
 namespace folly {
 class EventBaseBackendBase;
@@ -805,6 +806,23 @@ class EventBase
   uint32_t getMaxReadAtOnce() const;
   void setMaxReadAtOnce(uint32_t maxAtOnce);
 
+  /**
+   * Sets how long a blocking loop polls for events before it blocks waiting
+   * for them: opt.spin_max(), which is zero by default. Spinning burns CPU
+   * while the loop is idle in exchange for a lower wake-up latency.
+   *
+   * Must be called from the EventBase thread.
+   */
+  void setWaitOptions(const WaitOptions& opt);
+
+  /**
+   * Total time the loop spent idle, polling for events and blocked waiting
+   * for them respectively, while a spin window was set. Must be called from
+   * the EventBase thread.
+   */
+  std::chrono::nanoseconds getIdleSpinTime() const;
+  std::chrono::nanoseconds getIdleParkTime() const;
+
   /**
    * Verify that current thread is the EventBase thread.
    *
@@ -1028,6 +1046,11 @@ class EventBase
    */
   bool nothingHandledYet() const noexcept;
 
+  // Polls for events for up to idleSpinMax_, then blocks.
+  int spinThenWaitForEvents();
+  // Accounts the idle wait in progress, if any, as spinning or parked.
+  void endIdleWait();
+
   using LoopCallbackList = LoopCallback::List;
 
   bool isSuccess(LoopStatus status);
@@ -1122,6 +1145,14 @@ class EventBase
   std::size_t latestLoopCnt_;
   std::chrono::steady_clock::time_point startWork_;
 
+  // Spin window before blocking for events, and the idle time accounting.
+  std::chrono::nanoseconds idleSpinMax_{0};
+  std::chrono::nanoseconds idleSpinTime_{0};
+  std::chrono::nanoseconds idleParkTime_{0};
+  // Start of the idle wait in progress, if any.
+  std::chrono::steady_clock::time_point idleWaitStart_;
+  bool idleWaitSpinning_{false};
+
   // Observer to export counters
   std::shared_ptr<EventBaseObserver> observer_;
   uint32_t observerSampleCount_;
@@ -166,6 +166,18 @@ void IoUringOp::pwrite(
   io_uring_sqe_set_data(&sqe_.sqe, this);
 }
 
+void IoUringOp::fsync(int fd) {
+  init();
+  io_uring_prep_fsync(&sqe_.sqe, fd, 0);
+  io_uring_sqe_set_data(&sqe_.sqe, this);
+}
+
+void IoUringOp::fdatasync(int fd) {
+  init();
+  io_uring_prep_fsync(&sqe_.sqe, fd, IORING_FSYNC_DATASYNC);
+  io_uring_sqe_set_data(&sqe_.sqe, this);
+}
+
 void IoUringOp::toStream(std::ostream& os) const {
   os << "{" << state_ << ", [" << getSqeSize() << "], ";
 
@@ -327,6 +339,32 @@ int IoUring::submitRange(Range<AsyncBase::Op**> ops) {
   return total ? total : -1;
 }
 
+int IoUring::submitChainRange(Range<AsyncBase::Op**> ops) {
+  for (auto* op : ops) {
+    IoUringOp* iop = op->getIoUringOp();
+    if (!iop || iop->getOptions() != getOptions()) {
+      return -EINVAL;
+    }
+  }
+
+  std::unique_lock lk(submitMutex_);
+  // A link does not carry over to the next submit, so the whole chain must
+  // fit in the SQ ring.
+  if (::io_uring_sq_space_left(&ioRing_) < ops.size()) {
+    return -EINVAL;
+  }
+  for (size_t i = 0; i < ops.size(); i++) {
+    IoUringOp* iop = ops[i]->getIoUringOp();
+    auto* sqe = io_uring_get_sqe(&ioRing_);
+    ::memcpy(sqe, &iop->getSqe(), iop->getSqeSize());
+    if (i + 1 < ops.size()) {
+      sqe->flags |= IOSQE_IO_LINK;
+    }
+  }
+
+  return io_uring_submit(&ioRing_);
+}
+
 Range<AsyncBase::Op**> IoUring::doWait(
     WaitType type,
     size_t minRequests,
@@ -74,6 +74,9 @@ class IoUringOp : public AsyncBaseOp {
   void pwrite(int fd, const void* buf, size_t size, off_t start, int buf_index)
       override;
 
+  void fsync(int fd) override;
+  void fdatasync(int fd) override;
+
   void reset(NotificationCallback cb = NotificationCallback()) override;
 
   AsyncIOOp* getAsyncIOOp() override { return nullptr; }
@@ -149,6 +152,13 @@ class IoUring : public AsyncBase {
 
   static bool isAvailable();
 
+  /**
+   * Chains are linked with IOSQE_IO_LINK, and all their SQEs go in with a
+   * single submit, so they must fit in the SQ ring: maxSubmit entries,
+   * rounded up to a power of 2.
+   */
+  bool supportsChain() const override { return true; }
+
   const IoUringOp::Options& getOptions() const { return options_; }
 
   int register_buffers(const struct iovec* iovecs, unsigned int nr_iovecs);
@@ -161,6 +171,7 @@ class IoUring : public AsyncBase {
   int drainPollFd() override;
   int submitOne(AsyncBase::Op* op) override;
   int submitRange(Range<AsyncBase::Op**> ops) override;
+  int submitChainRange(Range<AsyncBase::Op**> ops) override;
 
  private:
   Range<AsyncBase::Op**> doWait(
@@ -56,6 +56,7 @@ extern "C" FOLLY_ATTR_WEAK void eb_poll_loop_post_hook(
 
 #if FOLLY_IO_URING_UP_TO_DATE
 #include <folly/io/async/IoUringProvidedBufferRing.h>
+#include <folly/io/async/IoUringRegisteredBufferArena.h>
 #endif
 
 namespace folly {
@@ -376,9 +377,13 @@ IoUringBackend::SocketPair::~SocketPair() {
   }
 }
 
-IoUringBackend::FdRegistry::FdRegistry(struct io_uring& ioRing, size_t n)
-    : ioRing_(ioRing), files_(n, -1), inUse_(n), records_(n) {
-  if (n > std::numeric_limits<int>::max()) {
+IoUringBackend::FdRegistry::FdRegistry(
+    struct io_uring& ioRing, size_t n, size_t direct)
+    : ioRing_(ioRing),
+      files_(n + direct, -1),
+      inUse_(n + direct),
+      records_(n) {
+  if (n + direct > std::numeric_limits<int>::max()) {
     throw std::runtime_error("too many registered files");
   }
 }
@@ -393,6 +398,21 @@ int IoUringBackend::FdRegistry::init() {
         records_[i].idx_ = i;
         free_.push_front(records_[i]);
       }
+#ifdef IORING_FILE_INDEX_ALLOC
+      if (inUse_ > records_.size()) {
+        // the kernel allocates direct descriptors past the registered fds
+        int rangeRet = ::io_uring_register_file_alloc_range(
+            &ioRing_, records_.size(), inUse_ - records_.size());
+        if (rangeRet) {
+          LOG(ERROR) << "io_uring_register_file_alloc_range("
+                     << records_.size() << ", " << inUse_ - records_.size()
+                     << ") failed: " << folly::errnoStr(-rangeRet) << " "
+                     << this;
+        } else {
+          directAlloc_ = true;
+        }
+      }
+#endif
     } else {
       LOG(ERROR) << "io_uring_register_files(" << inUse_ << ") "
                  << "failed errno = " << errno << ":\""
@@ -447,6 +467,15 @@ bool IoUringBackend::FdRegistry::free(IoUringFdRegistrationRecord* record) {
   return false;
 }
 
+void IoUringBackend::closeDirectFd(int idx) noexcept {
+  int fd = -1;
+  int ret = ::io_uring_register_files_update(&ioRing_, idx, &fd, 1);
+  if (ret != 1) {
+    LOG(ERROR) << "closing direct descriptor " << idx
+               << " failed: " << folly::errnoStr(-ret);
+  }
+}
+
 FOLLY_ALWAYS_INLINE struct io_uring_sqe* IoUringBackend::getUntrackedSqe() {
   struct io_uring_sqe* ret = ::io_uring_get_sqe(&ioRing_);
   // if running with SQ poll enabled
@@ -525,7 +554,7 @@ void IoUringBackend::processSignalReadIoSqe(
 IoUringBackend::IoUringBackend(Options options)
     : options_(options),
       numEntries_(options.capacity),
-      fdRegistry_(ioRing_, options.registeredFds) {
+      fdRegistry_(ioRing_, options.registeredFds, options.directAcceptFds) {
   // create the timer fd
   timerFd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
   if (timerFd_ < 0) {
@@ -1093,7 +1122,7 @@ void IoUringBackend::dCheckSubmitTid() {
 void IoUringBackend::initSubmissionLinked() {
   // we need to call the init before adding the timer fd
   // so we avoid a deadlock - waiting for the queue to be drained
-  if (options_.registeredFds > 0) {
+  if (options_.registeredFds > 0 || options_.directAcceptFds > 0) {
     // now init the file registry
     // if this fails, we still continue since we
     // can run without registered fds
@@ -1126,6 +1155,27 @@ void IoUringBackend::initSubmissionLinked() {
     }
   }
 
+  if (options_.registeredBuffersCount) {
+    try {
+      IoUringRegisteredBufferArena::Options options = {
+          .bufferCount =
+              static_cast<uint32_t>(options_.registeredBuffersCount),
+          .bufferSize =
+              static_cast<uint32_t>(options_.registeredBuffersEachSize),
+          .useHugePages = options_.useHugePages,
+      };
+      registeredBufferArena_ =
+          IoUringRegisteredBufferArena::create(this->ioRingPtr(), options);
+    } catch (const IoUringRegisteredBufferArena::LibUringCallError& ex) {
+      LOG(ERROR) << folly::to<std::string>(
+          "failed to register buffers, buffer count: ",
+          options_.registeredBuffersCount,
+          ", buffer size: ",
+          options_.registeredBuffersEachSize);
+      throw NotAvailable(ex.what());
+    }
+  }
+
   if (options_.zeroCopyRx) {
     IoUringZeroCopyBufferPool::Params params = {
         .ring = this->ioRingPtr(),
@@ -2047,7 +2097,10 @@ static bool doKernelSupportsSendZC() {
     return false;
   }
 
-  io_uring_prep_sendmsg_zc(sqe, -1, nullptr, 0);
+  // Recent kernels copy the msghdr in before looking up the fd, so it has
+  // to be valid to get to EBADF.
+  struct msghdr msg = {};
+  io_uring_prep_sendmsg_zc(sqe, -1, &msg, 0);
   ret = ::io_uring_submit(&ring);
   if (ret != 1) {
     return false;
@@ -2070,6 +2123,74 @@ static bool doKernelSupportsSendZC() {
 #endif
 }
 
+static bool doKernelSupportsMultishotAccept() {
+#ifdef IORING_ACCEPT_MULTISHOT
+  struct io_uring ring;
+
+  int ret = io_uring_queue_init(4, &ring, 0);
+  if (ret) {
+    LOG(ERROR) << "doKernelSupportsMultishotAccept: Unexpectedly "
+               << "io_uring_queue_init failed";
+    return false;
+  }
+  SCOPE_EXIT {
+    io_uring_queue_exit(&ring);
+  };
+
+  // Kernels before multishot accept look up the fd before the flags, so
+  // the probe needs a real listening socket, with a connection to accept.
+  int listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  int clientFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  SCOPE_EXIT {
+    for (int fd : {listenFd, clientFd}) {
+      if (fd >= 0) {
+        fileops::close(fd);
+      }
+    }
+  };
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addrLen = sizeof(addr);
+  auto* saddr = reinterpret_cast<struct sockaddr*>(&addr);
+  if (listenFd < 0 || clientFd < 0 || ::bind(listenFd, saddr, addrLen) ||
+      ::listen(listenFd, 1) || ::getsockname(listenFd, saddr, &addrLen) ||
+      ::connect(clientFd, saddr, addrLen)) {
+    LOG(ERROR) << "doKernelSupportsMultishotAccept: unable to set up a "
+               << "loopback connection: " << folly::errnoStr(errno);
+    return false;
+  }
+
+  auto* sqe = ::io_uring_get_sqe(&ring);
+  if (!sqe) {
+    LOG(ERROR) << "doKernelSupportsMultishotAccept: no sqe?";
+    return false;
+  }
+
+  ::io_uring_prep_accept(sqe, listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+  sqe->ioprio |= IORING_ACCEPT_MULTISHOT;
+  ret = ::io_uring_submit(&ring);
+  if (ret != 1) {
+    return false;
+  }
+
+  struct io_uring_cqe* cqe = nullptr;
+  ret = ::io_uring_wait_cqe(&ring, &cqe);
+  if (ret) {
+    return false;
+  }
+
+  // Kernels without multishot accept fail it with EINVAL.
+  if (cqe->res >= 0) {
+    fileops::close(cqe->res);
+  }
+  return cqe->res >= 0 && (cqe->flags & IORING_CQE_F_MORE);
+#else
+  // fallthrough
+  return false;
+#endif
+}
+
 } // namespace
 
 bool IoUringBackend::kernelSupportsRecvmsgMultishot() {
@@ -2087,6 +2208,11 @@ bool IoUringBackend::kernelSupportsSendZC() {
   return ret;
 }
 
+bool IoUringBackend::kernelSupportsMultishotAccept() {
+  static bool const ret = doKernelSupportsMultishotAccept();
+  return ret;
+}
+
 } // namespace folly
 
 #endif
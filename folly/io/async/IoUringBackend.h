@@ -41,6 +41,7 @@
 #include <folly/io/async/EventBaseBackendBase.h>
 #include <folly/io/async/IoUringBase.h>
 #include <folly/io/async/IoUringProvidedBufferRing.h>
+#include <folly/io/async/IoUringRegisteredBufferArena.h>
 #include <folly/io/async/IoUringZeroCopyBufferPool.h>
 #include <folly/io/async/Liburing.h>
 #include <folly/portability/Asm.h>
@@ -115,6 +116,14 @@ class IoUringBackend : public EventBaseBackendBase {
       return *this;
     }
 
+    // Reserves v slots of the registered file table, after the registered
+    // fds, for the kernel to allocate direct descriptors in (see
+    // AsyncServerSocket::setIoUringAcceptDirect()).
+    Options& setDirectAcceptFds(size_t v) {
+      directAcceptFds = v;
+      return *this;
+    }
+
     Options& setFlags(uint32_t v) {
       flags = v;
 
@@ -171,6 +180,13 @@ class IoUringBackend : public EventBaseBackendBase {
       return *this;
     }
 
+    // Buffers registered with the ring, see registeredBufferArena().
+    Options& setRegisteredBuffers(size_t eachSize, size_t count) {
+      registeredBuffersCount = count;
+      registeredBuffersEachSize = eachSize;
+      return *this;
+    }
+
     constexpr bool isPow2(uint64_t n) noexcept {
       return n > 0 && !((n - 1) & n);
     }
@@ -285,10 +301,13 @@ class IoUringBackend : public EventBaseBackendBase {
     size_t maxSubmit{128};
     size_t maxGet{256};
     size_t registeredFds{0};
+    size_t directAcceptFds{0};
     size_t sqGroupNumThreads{1};
     size_t initialProvidedBuffersCount{0};
     size_t initialProvidedBuffersEachSize{0};
     size_t providedBufRings{1};
+    size_t registeredBuffersCount{0};
+    size_t registeredBuffersEachSize{0};
 
     uint32_t flags{0};
 
@@ -369,6 +388,7 @@ class IoUringBackend : public EventBaseBackendBase {
   static bool kernelSupportsRecvmsgMultishot();
   static bool kernelSupportsDeferTaskrun();
   static bool kernelSupportsSendZC();
+  static bool kernelSupportsMultishotAccept();
 
   IoUringFdRegistrationRecord* registerFd(int fd) noexcept {
     return fdRegistry_.alloc(fd);
@@ -378,6 +398,14 @@ class IoUringBackend : public EventBaseBackendBase {
     return fdRegistry_.free(rec);
   }
 
+  // Whether the kernel allocates direct descriptors for this backend, in the
+  // slots reserved with Options::setDirectAcceptFds().
+  bool hasDirectAcceptFds() const { return fdRegistry_.directAlloc_; }
+
+  // Closes a direct descriptor right away. Requests queued but not submitted
+  // yet with this index would then fail, or use another file.
+  void closeDirectFd(int idx) noexcept;
+
   // CQ poll mode loop callback
   using CQPollLoopCallback = folly::Function<void()>;
 
@@ -480,6 +508,12 @@ class IoUringBackend : public EventBaseBackendBase {
   bool hasBufferProvider() { return bufferProviders_.size() > 0; }
   uint16_t nextBufferProviderGid() { return bufferProviderGidNext_++; }
   IoUringZeroCopyBufferPool* zcBufferPool() { return zcBufferPool_.get(); }
+  // Allocator of IOBufs that io_uring writes can use as fixed buffers, if
+  // Options::setRegisteredBuffers() was set. With Options::setDeferTaskRun()
+  // the buffers are only registered once the loop first runs.
+  IoUringRegisteredBufferArena* registeredBufferArena() {
+    return registeredBufferArena_.get();
+  }
 
  protected:
   enum class WaitForEventsMode { WAIT, DONT_WAIT };
@@ -592,7 +626,9 @@ class IoUringBackend : public EventBaseBackendBase {
 
   struct FdRegistry {
     FdRegistry() = delete;
-    FdRegistry(struct io_uring& ioRing, size_t n);
+    // n slots for registerFd(), followed by direct slots for the kernel to
+    // allocate from.
+    FdRegistry(struct io_uring& ioRing, size_t n, size_t direct);
 
     IoUringFdRegistrationRecord* alloc(int fd) noexcept;
     bool free(IoUringFdRegistrationRecord* record);
@@ -601,6 +637,7 @@ class IoUringBackend : public EventBaseBackendBase {
     size_t update();
 
     bool err_{false};
+    bool directAlloc_{false};
     struct io_uring& ioRing_;
     std::vector<int> files_;
     size_t inUse_;
@@ -1236,6 +1273,7 @@ class IoUringBackend : public EventBaseBackendBase {
   std::vector<IoUringProvidedBufferRing::UniquePtr> bufferProviders_;
   uint64_t bufferProviderIdx_{0};
   IoUringZeroCopyBufferPool::UniquePtr zcBufferPool_;
+  IoUringRegisteredBufferArena::UniquePtr registeredBufferArena_;
 
   // loop related
   bool loopBreak_{false};
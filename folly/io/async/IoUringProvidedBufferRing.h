@@ -114,7 +114,11 @@ class IoUringProvidedBufferRing {
   }
 
   struct io_uring_buf* ringBuf(int idx) const noexcept {
-    return &ringPtr_->bufs[idx & ringMask_];
+    // Not &ringPtr_->bufs[]: before Linux 6.5, the uapi headers declare bufs
+    // after an empty struct, which takes a byte in C++, so the entries would
+    // start 8 bytes past where the kernel reads them.
+    return reinterpret_cast<struct io_uring_buf*>(ringPtr_) +
+        (idx & ringMask_);
   }
 
   struct BufferState {
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/IoUringRegisteredBufferArena.h>
+
+#include <mutex>
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <folly/lang/Align.h>
+#include <folly/portability/SysMman.h>
+#include <folly/portability/SysUio.h>
+
+#if FOLLY_HAS_LIBURING
+
+namespace {
+constexpr size_t kHugePageSizeBytes = 1024 * 1024 * 2;
+constexpr size_t kPageSizeBytes = 4096;
+// IORING_MAX_REG_BUFFERS
+constexpr uint32_t kMaxBufferCount = 1U << 14;
+} // namespace
+
+namespace folly {
+
+IoUringRegisteredBufferArena::UniquePtr IoUringRegisteredBufferArena::create(
+    io_uring* ioRingPtr, Options options) {
+  return IoUringRegisteredBufferArena::UniquePtr(
+      new IoUringRegisteredBufferArena(ioRingPtr, options));
+}
+
+IoUringRegisteredBufferArena::IoUringRegisteredBufferArena(
+    io_uring* ioRingPtr, Options options)
+    : ioRingPtr_(ioRingPtr),
+      sizePerBuffer_(
+          folly::align_ceil(
+              std::max<size_t>(options.bufferSize, 1), kPageSizeBytes)),
+      bufferCount_(options.bufferCount) {
+  if (bufferCount_ > kMaxBufferCount) {
+    throw std::runtime_error(
+        folly::to<std::string>(
+            "bufferCount cannot be larger than ", kMaxBufferCount));
+  }
+  if (bufferCount_ == 0) {
+    throw std::runtime_error("bufferCount cannot be 0");
+  }
+
+  mapMemory(options.useHugePages);
+  try {
+    registerBuffers();
+  } catch (...) {
+    ::munmap(bufferBuffer_, allSize_);
+    throw;
+  }
+
+  // Hand out the lowest addresses first.
+  freeList_.reserve(bufferCount_);
+  for (uint32_t i = bufferCount_; i > 0; --i) {
+    freeList_.push_back(i - 1);
+  }
+}
+
+void IoUringRegisteredBufferArena::mapMemory(bool useHugePages) {
+  bufferSize_ = sizePerBuffer_ * bufferCount_;
+  allSize_ = folly::align_ceil(
+      bufferSize_, useHugePages ? kHugePageSizeBytes : kPageSizeBytes);
+
+  void* mem = ::mmap(
+      nullptr,
+      allSize_,
+      PROT_READ | PROT_WRITE,
+      MAP_ANONYMOUS | MAP_PRIVATE,
+      -1,
+      0);
+
+  if (mem == MAP_FAILED) {
+    auto errnoCopy = errno;
+    throw std::runtime_error(
+        folly::to<std::string>(
+            "unable to allocate registered buffers of size ",
+            allSize_,
+            ": ",
+            folly::errnoStr(errnoCopy)));
+  }
+  bufferBuffer_ = static_cast<char*>(mem);
+
+  if (useHugePages) {
+    int ret = ::madvise(mem, allSize_, MADV_HUGEPAGE);
+    PLOG_IF(ERROR, ret) << "cannot enable huge pages";
+  } else {
+    ::madvise(mem, allSize_, MADV_NOHUGEPAGE);
+  }
+}
+
+void IoUringRegisteredBufferArena::registerBuffers() {
+  // One iovec per buffer, so the buffer index of a request is the index of
+  // the IOBuf's buffer in the arena.
+  std::vector<struct iovec> iovs(bufferCount_);
+  for (uint32_t i = 0; i < bufferCount_; i++) {
+    iovs[i].iov_base = getData(i);
+    iovs[i].iov_len = sizePerBuffer_;
+  }
+
+  int ret = ::io_uring_register_buffers(ioRingPtr_, iovs.data(), iovs.size());
+  if (ret) {
+    LOG(ERROR) << folly::to<std::string>(
+        "unable to register buffers ",
+        -ret,
+        ": ",
+        folly::errnoStr(-ret),
+        ", buffer count: ",
+        bufferCount_,
+        ", size per buf: ",
+        sizePerBuffer_);
+    throw LibUringCallError("unable to register buffers");
+  }
+}
+
+std::unique_ptr<IOBuf> IoUringRegisteredBufferArena::allocate() noexcept {
+  uint32_t i;
+  {
+    std::unique_lock lock{mutex_};
+    if (freeList_.empty() || wantsShutdown_) {
+      return nullptr;
+    }
+    i = freeList_.back();
+    freeList_.pop_back();
+    ++outstanding_;
+  }
+
+  auto free_fn = [](void* buf, void* userData) {
+    static_cast<IoUringRegisteredBufferArena*>(userData)->returnBuffer(buf);
+  };
+  return IOBuf::takeOwnership(
+      static_cast<void*>(getData(i)), sizePerBuffer_, 0, free_fn, this);
+}
+
+uint32_t IoUringRegisteredBufferArena::available() const noexcept {
+  std::unique_lock lock{mutex_};
+  return static_cast<uint32_t>(freeList_.size());
+}
+
+void IoUringRegisteredBufferArena::returnBuffer(void* buf) noexcept {
+  auto i = static_cast<uint32_t>(
+      (static_cast<char*>(buf) - bufferBuffer_) / sizePerBuffer_);
+  DCHECK_LT(i, bufferCount_);
+
+  std::unique_lock lock{mutex_};
+  auto refs = --outstanding_;
+  if (FOLLY_UNLIKELY(wantsShutdown_)) {
+    lock.unlock();
+    delayedDestroy(refs);
+    return;
+  }
+  freeList_.push_back(i);
+}
+
+void IoUringRegisteredBufferArena::destroy() noexcept {
+  std::unique_lock lock{mutex_};
+  // Requests still in flight keep their own reference to the registration.
+  ::io_uring_unregister_buffers(ioRingPtr_);
+  wantsShutdown_ = true;
+  auto refs = outstanding_;
+  lock.unlock();
+  delayedDestroy(refs);
+}
+
+void IoUringRegisteredBufferArena::delayedDestroy(uint32_t refs) noexcept {
+  if (refs == 0) {
+    ::munmap(bufferBuffer_, allSize_);
+    delete this;
+  }
+}
+
+} // namespace folly
+
+#endif
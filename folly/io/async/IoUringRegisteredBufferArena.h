@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/Liburing.h>
+#include <folly/synchronization/DistributedMutex.h>
+
+#if FOLLY_HAS_LIBURING
+
+FOLLY_PUSH_WARNING
+FOLLY_CLANG_DISABLE_WARNING("-Wnested-anon-types")
+FOLLY_CLANG_DISABLE_WARNING("-Wzero-length-array")
+#include <liburing.h> // @manual
+FOLLY_POP_WARNING
+
+namespace folly {
+
+/**
+ * Fixed size buffers, registered with an io_uring through
+ * io_uring_register_buffers(), and handed out as IOBufs.
+ *
+ * The kernel pins the registered memory once, so a request naming one of
+ * these buffers by its index (IORING_OP_WRITE_FIXED, or IORING_OP_SEND_ZC
+ * with IORING_RECVSEND_FIXED_BUF) does not have to pin and map the pages of
+ * the data itself, as it does for arbitrary user memory.
+ *
+ * Buffers go back to the arena when the last IOBuf referring to them is
+ * freed, from any thread. The memory stays mapped until then, even after
+ * destroy().
+ */
+class IoUringRegisteredBufferArena {
+ public:
+  class LibUringCallError : public std::runtime_error {
+   public:
+    using std::runtime_error::runtime_error;
+  };
+
+  struct Deleter {
+    void operator()(IoUringRegisteredBufferArena* arena) {
+      if (arena) {
+        arena->destroy();
+      }
+    }
+  };
+
+  using UniquePtr = std::unique_ptr<IoUringRegisteredBufferArena, Deleter>;
+
+  struct Options {
+    uint32_t bufferCount{0};
+    // Rounded up to a multiple of the page size.
+    uint32_t bufferSize{0};
+    bool useHugePages{false};
+  };
+
+  static UniquePtr create(io_uring* ioRingPtr, Options options);
+
+  void destroy() noexcept;
+
+  // An empty IOBuf with sizePerBuffer() bytes of tailroom, or nullptr if all
+  // the buffers are in use.
+  std::unique_ptr<IOBuf> allocate() noexcept;
+
+  // The index of the registered buffer holding [data, data + length), or -1
+  // if the range is not within a single buffer of this arena.
+  int bufferIndex(const void* data, size_t length) const noexcept {
+    auto addr = reinterpret_cast<uintptr_t>(data);
+    auto base = reinterpret_cast<uintptr_t>(bufferBuffer_);
+    if (addr < base || addr - base >= bufferSize_) {
+      return -1;
+    }
+    auto idx = (addr - base) / sizePerBuffer_;
+    if (addr - base + length > (idx + 1) * sizePerBuffer_) {
+      return -1;
+    }
+    return static_cast<int>(idx);
+  }
+
+  uint32_t count() const noexcept { return bufferCount_; }
+  size_t sizePerBuffer() const noexcept { return sizePerBuffer_; }
+  // Buffers not handed out.
+  uint32_t available() const noexcept;
+
+ private:
+  explicit IoUringRegisteredBufferArena(io_uring* ioRingPtr, Options options);
+  ~IoUringRegisteredBufferArena() = default;
+
+  IoUringRegisteredBufferArena(IoUringRegisteredBufferArena&&) = delete;
+  IoUringRegisteredBufferArena(IoUringRegisteredBufferArena const&) = delete;
+  IoUringRegisteredBufferArena& operator=(IoUringRegisteredBufferArena&&) =
+      delete;
+  IoUringRegisteredBufferArena& operator=(
+      IoUringRegisteredBufferArena const&) = delete;
+
+  void mapMemory(bool useHugePages);
+  void registerBuffers();
+
+  void returnBuffer(void* buf) noexcept;
+  void delayedDestroy(uint32_t refs) noexcept;
+
+  char* getData(uint32_t i) const noexcept {
+    return bufferBuffer_ + static_cast<size_t>(i) * sizePerBuffer_;
+  }
+
+  io_uring* ioRingPtr_;
+  char* bufferBuffer_{nullptr};
+  size_t sizePerBuffer_{0};
+  size_t bufferSize_{0};
+  size_t allSize_{0};
+  uint32_t bufferCount_{0};
+
+  mutable folly::DistributedMutex mutex_;
+  std::vector<uint32_t> freeList_;
+  uint32_t outstanding_{0};
+  bool wantsShutdown_{false};
+};
+
+} // namespace folly
+
+#endif
@@ -41,9 +41,29 @@ static constexpr auto has_io_uring_rt = +[] { return false; };
 using io_uring_type = void;
 #endif
 
+// The result for an op whose submit threw; called from a catch block.
+static int submitErrorCode() noexcept {
+  try {
+    throw;
+  } catch (const std::system_error& ex) {
+    return -ex.code().value();
+  } catch (const std::bad_alloc&) {
+    return -ENOMEM;
+  } catch (...) {
+    return -EIO;
+  }
+}
+
 template <typename AsyncIOType>
 void SimpleAsyncIO::init() {
-  asyncIO_ = std::make_unique<AsyncIOType>(maxRequests_, AsyncBase::POLLABLE);
+  if constexpr (std::is_same_v<AsyncIOType, io_uring_type>) {
+    // An SQ ring as large as the queue, so that any chain can be linked.
+    asyncIO_ = std::make_unique<AsyncIOType>(
+        maxRequests_, AsyncBase::POLLABLE, maxRequests_);
+  } else {
+    asyncIO_ =
+        std::make_unique<AsyncIOType>(maxRequests_, AsyncBase::POLLABLE);
+  }
   opsFreeList_.withWLock([this](auto& freeList) {
     for (size_t i = 0; i < maxRequests_; ++i) {
       freeList.push(std::make_unique<typename AsyncIOType::Op>());
@@ -131,6 +151,22 @@ std::unique_ptr<AsyncBaseOp> SimpleAsyncIO::getOp() {
   return rc;
 }
 
+std::vector<std::unique_ptr<AsyncBaseOp>> SimpleAsyncIO::getOps(size_t n) {
+  std::vector<std::unique_ptr<AsyncBaseOp>> rc;
+  opsFreeList_.withWLock(
+      [this, n, &rc](std::queue<std::unique_ptr<AsyncBaseOp>>& freeList) {
+        if (freeList.size() >= n && !terminating_) {
+          rc.reserve(n);
+          for (size_t i = 0; i < n; ++i) {
+            rc.push_back(std::move(freeList.front()));
+            freeList.pop();
+            rc.back()->reset();
+          }
+        }
+      });
+  return rc;
+}
+
 void SimpleAsyncIO::putOp(std::unique_ptr<AsyncBaseOp>&& op) {
   opsFreeList_.withWLock(
       [this, op{std::move(op)}](
@@ -142,6 +178,19 @@ void SimpleAsyncIO::putOp(std::unique_ptr<AsyncBaseOp>&& op) {
       });
 }
 
+void SimpleAsyncIO::putOps(std::vector<std::unique_ptr<AsyncBaseOp>>&& ops) {
+  opsFreeList_.withWLock(
+      [this, ops{std::move(ops)}](
+          std::queue<std::unique_ptr<AsyncBaseOp>>& freeList) mutable {
+        for (auto& op : ops) {
+          freeList.push(std::move(op));
+        }
+        if (terminating_ && freeList.size() == maxRequests_) {
+          drainedBaton_.post();
+        }
+      });
+}
+
 void SimpleAsyncIO::submitOp(
     Function<void(AsyncBaseOp*)> preparer, SimpleAsyncIOCompletor completor) {
   std::unique_ptr<AsyncBaseOp> opHolder = getOp();
@@ -200,6 +249,139 @@ void SimpleAsyncIO::pwrite(
       std::move(completor));
 }
 
+SimpleAsyncIO::Chain& SimpleAsyncIO::Chain::pread(
+    int fd, void* buf, size_t size, off_t start) {
+  steps_.push_back({Step::Type::READ, fd, buf, size, start});
+  return *this;
+}
+
+SimpleAsyncIO::Chain& SimpleAsyncIO::Chain::pwrite(
+    int fd, const void* buf, size_t size, off_t start) {
+  steps_.push_back(
+      {Step::Type::WRITE, fd, const_cast<void*>(buf), size, start});
+  return *this;
+}
+
+SimpleAsyncIO::Chain& SimpleAsyncIO::Chain::fsync(int fd) {
+  steps_.push_back({Step::Type::FSYNC, fd, nullptr, 0, 0});
+  return *this;
+}
+
+SimpleAsyncIO::Chain& SimpleAsyncIO::Chain::fdatasync(int fd) {
+  steps_.push_back({Step::Type::FDATASYNC, fd, nullptr, 0, 0});
+  return *this;
+}
+
+void SimpleAsyncIO::Chain::Step::prepare(AsyncBaseOp* op) const {
+  switch (type) {
+    case Type::READ:
+      op->pread(fd, buf, size, start);
+      break;
+    case Type::WRITE:
+      op->pwrite(fd, buf, size, start);
+      break;
+    case Type::FSYNC:
+      op->fsync(fd);
+      break;
+    case Type::FDATASYNC:
+      op->fdatasync(fd);
+      break;
+  }
+}
+
+struct SimpleAsyncIO::ChainState {
+  Chain chain;
+  SimpleAsyncIOChainCompletor completor;
+  std::vector<std::unique_ptr<AsyncBaseOp>> ops;
+  std::vector<int> results;
+  // Whether the kernel links the ops, rather than submitChain() submitting
+  // each one from the completion of the previous one.
+  bool linked{false};
+  size_t completed{0};
+};
+
+void SimpleAsyncIO::submitChain(
+    Chain chain, SimpleAsyncIOChainCompletor completor) {
+  size_t n = chain.size();
+  if (n == 0) {
+    completionExecutor_->add(
+        [completor{std::move(completor)}]() mutable { completor({}); });
+    return;
+  }
+  auto ops = getOps(n);
+  if (ops.empty()) {
+    completor(std::vector<int>(n, -EBUSY));
+    return;
+  }
+
+  // Deleted by onChainOpCompleted(), with the last op.
+  auto* state = new ChainState{
+      std::move(chain),
+      std::move(completor),
+      std::move(ops),
+      std::vector<int>(n, -ECANCELED)};
+  state->linked = asyncIO_->supportsChain();
+  std::vector<AsyncBaseOp*> rawOps;
+  rawOps.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    auto* op = state->ops[i].get();
+    state->chain.steps_[i].prepare(op);
+    op->setNotificationCallback([this, state, i](AsyncBaseOp* op_) {
+      onChainOpCompleted(state, i, op_->result());
+    });
+    rawOps.push_back(op);
+  }
+
+  try {
+    if (state->linked) {
+      asyncIO_->submitChain(range(rawOps));
+    } else {
+      asyncIO_->submit(rawOps[0]);
+    }
+  } catch (...) {
+    // As if the first IO had failed, e.g. aio rejects a bad fd on submit.
+    state->results[0] = submitErrorCode();
+    finishChain(state);
+  }
+}
+
+void SimpleAsyncIO::onChainOpCompleted(
+    ChainState* state, size_t i, int rc) noexcept {
+  state->results[i] = rc;
+  size_t n = state->ops.size();
+  if (state->linked) {
+    // The kernel completes every op, with -ECANCELED after a broken link.
+    if (++state->completed < n) {
+      return;
+    }
+  } else if (
+      i + 1 < n && rc >= 0 && size_t(rc) == state->chain.steps_[i].size) {
+    try {
+      asyncIO_->submit(state->ops[i + 1].get());
+      return;
+    } catch (...) {
+      state->results[i + 1] = submitErrorCode();
+    }
+  }
+  finishChain(state);
+}
+
+void SimpleAsyncIO::finishChain(ChainState* state) noexcept {
+  // Same as in submitOp(): once the ops are back, this instance may be
+  // gone, and so may the op whose callback this is.
+  auto completionExecutor = completionExecutor_;
+  auto results = std::move(state->results);
+  auto completor = std::move(state->completor);
+  auto ops = std::move(state->ops);
+  delete state;
+  putOps(std::move(ops));
+
+  completionExecutor->add(
+      [results{std::move(results)}, completor{std::move(completor)}]() mutable {
+        completor(std::move(results));
+      });
+}
+
 #if FOLLY_HAS_COROUTINES
 folly::coro::Task<int> SimpleAsyncIO::co_pwrite(
     int fd, const void* buf, size_t size, off_t start) {
@@ -224,6 +406,18 @@ folly::coro::Task<int> SimpleAsyncIO::co_pread(
   co_await done;
   co_return result;
 }
+
+folly::coro::Task<std::vector<int>> SimpleAsyncIO::co_submitChain(
+    Chain chain) {
+  folly::coro::Baton done;
+  std::vector<int> result;
+  submitChain(std::move(chain), [&done, &result](std::vector<int> rcs) {
+    result = std::move(rcs);
+    done.post();
+  });
+  co_await done;
+  co_return result;
+}
 #endif // FOLLY_HAS_COROUTINES
 
 } // namespace folly
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <queue>
+#include <vector>
 
 #include <folly/Synchronized.h>
 #include <folly/coro/Task.h>
@@ -166,6 +167,52 @@ class SimpleAsyncIO : public EventHandler {
       off_t offset,
       SimpleAsyncIOCompletor completor);
 
+  /**
+   * A sequence of IOs for submitChain(), e.g. a write and the fdatasync that
+   * makes it durable, or the read and the write of a copy.
+   */
+  class Chain {
+   public:
+    Chain& pread(int fd, void* buf, size_t size, off_t start);
+    Chain& pwrite(int fd, const void* buf, size_t size, off_t start);
+    Chain& fsync(int fd);
+    Chain& fdatasync(int fd);
+
+    size_t size() const { return steps_.size(); }
+
+   private:
+    friend class SimpleAsyncIO;
+
+    struct Step {
+      enum class Type { READ, WRITE, FSYNC, FDATASYNC };
+      Type type;
+      int fd;
+      void* buf;
+      // bytes the IO must transfer for the chain to go on
+      size_t size;
+      off_t start;
+
+      void prepare(AsyncBaseOp* op) const;
+    };
+    std::vector<Step> steps_;
+  };
+
+  using SimpleAsyncIOChainCompletor = Function<void(std::vector<int> rcs)>;
+
+  /**
+   * Initiate the IOs of the chain, each one once the previous one completed
+   * in full. With io_uring, they are linked in the kernel and there is no
+   * round trip to user space in between; aio does not support that, each IO
+   * is submitted when the previous one completes.
+   *
+   * Completion is indicated by a single asynchronous call to the completor,
+   * with the result of each IO. If one fails, or transfers fewer bytes than
+   * requested, those after it are not executed and get -ECANCELED. If fewer
+   * than chain.size() requests are available (see setMaxRequests(size_t) in
+   * Config), all get -EBUSY.
+   */
+  void submitChain(Chain chain, SimpleAsyncIOChainCompletor completor);
+
 #if FOLLY_HAS_COROUTINES
   /**
    * Coroutine version of pread().
@@ -188,11 +235,22 @@ class SimpleAsyncIO : public EventHandler {
    */
   folly::coro::Task<int> co_pwrite(
       int fd, const void* buf, size_t size, off_t start);
+  /**
+   * Coroutine version of submitChain().
+   */
+  folly::coro::Task<std::vector<int>> co_submitChain(Chain chain);
 #endif
 
  private:
+  struct ChainState;
+
   std::unique_ptr<AsyncBaseOp> getOp();
+  std::vector<std::unique_ptr<AsyncBaseOp>> getOps(size_t n);
   void putOp(std::unique_ptr<AsyncBaseOp>&&);
+  void putOps(std::vector<std::unique_ptr<AsyncBaseOp>>&& ops);
+
+  void onChainOpCompleted(ChainState* state, size_t i, int rc) noexcept;
+  void finishChain(ChainState* state) noexcept;
 
   void submitOp(
       Function<void(AsyncBaseOp*)> preparer, SimpleAsyncIOCompletor completor);
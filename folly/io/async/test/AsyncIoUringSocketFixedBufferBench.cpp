@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/resource.h>
+
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/AsyncIoUringSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/IoUringBackend.h>
+#include <folly/net/NetOps.h>
+#include <folly/portability/GFlags.h>
+
+DEFINE_uint32(chunk, 64 * 1024, "bytes per write");
+DEFINE_uint32(inflight, 64, "writes in flight at once");
+
+using namespace folly;
+
+namespace {
+
+enum class Mode {
+  // sendmsg of a malloc'ed buffer
+  Copy,
+  // sendmsg_zc of a malloc'ed buffer, pinning its pages on every send
+  ZeroCopy,
+  // send_zc of a buffer from the backend's registered buffer arena
+  Fixed,
+};
+
+class CountingWriteCallback : public AsyncWriter::WriteCallback {
+ public:
+  void writeSuccess() noexcept override { --inFlight; }
+
+  void writeErr(size_t, const AsyncSocketException& ex) noexcept override {
+    LOG(FATAL) << "write failed: " << ex;
+  }
+
+  size_t inFlight{0};
+};
+
+uint64_t cpuMicros() {
+  struct rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  auto micros = [](const struct timeval& tv) {
+    return uint64_t(tv.tv_sec) * 1000000 + tv.tv_usec;
+  };
+  return micros(usage.ru_utime) + micros(usage.ru_stime);
+}
+
+// Writes iters chunks to a loopback TCP connection, drained by a blocking
+// reader thread, and reports the CPU time of the process, which includes
+// the reader's and the kernel's, per GB written.
+void runWrites(UserCounters& counters, size_t iters, Mode mode) {
+  std::unique_ptr<EventBase> evb;
+  AsyncIoUringSocket::UniquePtr socket;
+  IoUringRegisteredBufferArena* arena = nullptr;
+  std::unique_ptr<IOBuf> chunk;
+  NetworkSocket client;
+  std::thread reader;
+  CountingWriteCallback callback;
+  BENCHMARK_SUSPEND {
+    // The socket only writes, but it needs buffers to read with.
+    auto options =
+        IoUringBackend::Options{}.setInitialProvidedBuffers(1024, 16);
+    if (mode == Mode::Fixed) {
+      options.setRegisteredBuffers(FLAGS_chunk, FLAGS_inflight);
+    }
+    evb = std::make_unique<EventBase>(EventBase::Options{}.setBackendFactory(
+        [options]() -> std::unique_ptr<EventBaseBackendBase> {
+          return std::make_unique<IoUringBackend>(options);
+        }));
+    arena = dynamic_cast<IoUringBackend*>(evb->getBackend())
+                ->registeredBufferArena();
+
+    auto listener = netops::socket(AF_INET, SOCK_STREAM, 0);
+    SocketAddress address("127.0.0.1", 0);
+    sockaddr_storage addr;
+    auto len = address.getAddress(&addr);
+    CHECK_EQ(
+        0, netops::bind(listener, reinterpret_cast<sockaddr*>(&addr), len));
+    CHECK_EQ(0, netops::listen(listener, 1));
+    address.setFromLocalAddress(listener);
+    len = address.getAddress(&addr);
+    client = netops::socket(AF_INET, SOCK_STREAM, 0);
+    CHECK_EQ(
+        0, netops::connect(client, reinterpret_cast<sockaddr*>(&addr), len));
+    auto server = netops::accept(listener, nullptr, nullptr);
+    netops::close(listener);
+
+    AsyncIoUringSocket::Options socketOptions;
+    if (mode == Mode::ZeroCopy) {
+      socketOptions.zeroCopyEnable = [](auto&&) { return true; };
+    }
+    socket.reset(
+        new AsyncIoUringSocket(evb.get(), server, std::move(socketOptions)));
+
+    chunk = IOBuf::create(FLAGS_chunk);
+    memset(chunk->writableData(), 'x', FLAGS_chunk);
+    chunk->append(FLAGS_chunk);
+
+    reader = std::thread([client] {
+      std::vector<char> buf(1 << 20);
+      while (netops::recv(client, buf.data(), buf.size(), 0) > 0) {
+      }
+    });
+  }
+
+  auto start = cpuMicros();
+  for (size_t i = 0; i < iters; ++i) {
+    while (callback.inFlight >= FLAGS_inflight) {
+      evb->loopOnce();
+    }
+    std::unique_ptr<IOBuf> buf;
+    if (mode == Mode::Fixed) {
+      // Buffers come back when their send is notified, not when the write
+      // callback runs.
+      while (!(buf = arena->allocate())) {
+        evb->loopOnce();
+      }
+      buf->append(FLAGS_chunk);
+    } else {
+      buf = chunk->clone();
+    }
+    ++callback.inFlight;
+    socket->writeChain(&callback, std::move(buf), WriteFlags::NONE);
+  }
+  while (callback.inFlight > 0) {
+    evb->loopOnce();
+  }
+  auto cpu = cpuMicros() - start;
+
+  BENCHMARK_SUSPEND {
+    double gb = double(iters) * FLAGS_chunk / (1 << 30);
+    counters["cpu_ms_per_gb"] = UserMetric(cpu / 1000.0 / gb);
+
+    socket.reset();
+    // The socket is closed from the loop, the reader may not see it yet.
+    netops::shutdown(client, SHUT_RDWR);
+    reader.join();
+    netops::close(client);
+    chunk.reset();
+    evb.reset();
+  }
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(Copy, counters, iters) {
+  runWrites(counters, iters, Mode::Copy);
+}
+
+BENCHMARK_COUNTERS(ZeroCopy, counters, iters) {
+  runWrites(counters, iters, Mode::ZeroCopy);
+}
+
+BENCHMARK_COUNTERS(FixedBuffers, counters, iters) {
+  runWrites(counters, iters, Mode::Fixed);
+}
+
+int main(int argc, char** argv) {
+  folly::Init init(&argc, &argv, true);
+  if (!IoUringBackend::isAvailable() ||
+      !IoUringBackend::kernelSupportsSendZC()) {
+    LOG(ERROR) << "io_uring zero copy send not supported";
+    return 0;
+  }
+  runBenchmarks();
+  return 0;
+}
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <map>
@@ -31,11 +32,13 @@
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/IoUringBackend.h>
 #include <folly/io/async/IoUringEvent.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
 #include <folly/io/async/test/AsyncSocketTest.h>
 #include <folly/io/async/test/AsyncSocketTest2.h>
 #include <folly/portability/GTest.h>
 #include <folly/system/Shell.h>
 #include <folly/test/SocketAddressTestHelper.h>
+#include <folly/testing/TestUtil.h>
 
 namespace folly {
 
@@ -222,6 +225,7 @@ struct TestParams {
   bool supportBufferMovable = true;
   bool sendzc = false;
   bool registerFd = true;
+  bool ioUringAccept = false;
   std::string testName() const {
     return folly::to<std::string>(
         ioUringServer ? "ioUringServer" : "oldServer",
@@ -233,6 +237,7 @@ struct TestParams {
         sendzc ? "_zerocopy" : "",
         "_",
         registerFd ? "" : "_noRegisterFd",
+        ioUringAccept ? "_ioUringAccept" : "",
         "iouringBackend");
   }
 };
@@ -300,6 +305,7 @@ class AsyncIoUringSocketTest
 
     serverSocket = AsyncServerSocket::newSocket(base.get());
     serverSocket->setTFOEnabled(true, 1);
+    serverSocket->setIoUringAccept(GetParam().ioUringAccept);
     serverSocket->bind(0);
     serverSocket->listen(1024);
     serverSocket->addAcceptCallback(this, nullptr);
@@ -894,6 +900,42 @@ TEST_P(AsyncIoUringSocketTestAll, SendTimeout) {
   EXPECT_EQ(AsyncSocketException::TIMED_OUT, ex.error().second.getType());
 }
 
+TEST_P(AsyncIoUringSocketTestAll, SendFile) {
+  MAYBE_SKIP();
+  auto [e, s, cb] = makeConnected();
+  // Larger than a pipe, so the range is spliced a part at a time.
+  std::string data = randomString(4000000);
+  test::TemporaryFile file;
+  ASSERT_EQ(
+      ssize_t(data.size()), writeFull(file.fd(), data.data(), data.size()));
+
+  constexpr off_t kOffset = 3;
+  size_t length = data.size() - 10;
+  FutureWriteCallback wcb;
+  s->write(&nullWriteCallback, "head", 4);
+  s->sendFile(&wcb, file.fd(), kOffset, length);
+  s->write(&nullWriteCallback, "tail", 4);
+  std::string expected = "head" + data.substr(kOffset, length) + "tail";
+  auto res = cb->waitFor(expected.size()).via(base.get()).getVia(base.get());
+  EXPECT_TRUE(expected == res) << expected.size() << " vs " << res.size();
+  auto& [promise, future] = wcb.promiseContract;
+  EXPECT_TRUE(std::move(future).via(base.get()).getVia(base.get()).hasValue());
+}
+
+TEST_P(AsyncIoUringSocketTestAll, SendFileShorterThanRange) {
+  MAYBE_SKIP();
+  auto [e, s, cb] = makeConnected();
+  test::TemporaryFile file;
+  ASSERT_EQ(5, writeFull(file.fd(), "hello", 5));
+
+  FutureWriteCallback wcb;
+  s->sendFile(&wcb, file.fd(), 2, 10);
+  auto& [promise, future] = wcb.promiseContract;
+  auto res = std::move(future).via(base.get()).getVia(base.get());
+  ASSERT_TRUE(res.hasError());
+  EXPECT_EQ(3, res.error().first);
+}
+
 auto mkAllTestParams() {
   std::vector<TestParams> t;
 
@@ -913,6 +955,9 @@ auto mkAllTestParams() {
       add_flip_case(&TestParams::sendzc);
     }
     add_flip_case(&TestParams::supportBufferMovable);
+    if (IoUringBackend::kernelSupportsMultishotAccept()) {
+      add_flip_case(&TestParams::ioUringAccept);
+    }
     t.push_back(all);
   };
 
@@ -1043,4 +1088,290 @@ TEST(AsyncIoUringSocketTest, RemoveNonBlockFlag) {
   EXPECT_EQ(newFlags & O_NONBLOCK, 0);
 }
 
+TEST(AsyncIoUringSocketTest, RegisteredBufferWrite) {
+  constexpr size_t kBuffers = 4;
+  constexpr size_t kBufferBytes = 4096;
+  Promise<NetworkSocket> fdPromise;
+  test::TestAcceptCallback acceptCallback;
+  acceptCallback.setConnectionAcceptedFn(
+      [&fdPromise](NetworkSocket fd, const folly::SocketAddress& /*addr*/) {
+        fdPromise.setValue(fd);
+      });
+
+  auto options = IoUringBackend::Options{}
+                     .setRegisteredBuffers(kBufferBytes, kBuffers)
+                     .setInitialProvidedBuffers(1024, 16)
+                     .setDeferTaskRun(true);
+  EventBase evb{EventBase::Options{}.setBackendFactory(
+      [&options]() -> std::unique_ptr<EventBaseBackendBase> {
+        return std::make_unique<IoUringBackend>(options);
+      })};
+  auto* backend = dynamic_cast<IoUringBackend*>(evb.getBackend());
+  backend->loopPoll(); // init delayed bits, which register the buffers
+  auto* arena = backend->registeredBufferArena();
+  ASSERT_NE(nullptr, arena);
+  EXPECT_EQ(kBuffers, arena->count());
+  EXPECT_EQ(kBufferBytes, arena->sizePerBuffer());
+
+  auto serverSocket = AsyncServerSocket::newSocket(&evb);
+  serverSocket->bind(folly::SocketAddress("127.0.0.1", 0));
+  serverSocket->listen(1024);
+  folly::SocketAddress serverAddress;
+  serverSocket->getAddress(&serverAddress);
+  serverSocket->addAcceptCallback(&acceptCallback, &evb);
+  serverSocket->startAccepting();
+
+  // A blocking client, to read back what was written.
+  auto client = netops::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_storage addr;
+  auto addrLen = serverAddress.getAddress(&addr);
+  ASSERT_EQ(
+      0, netops::connect(client, reinterpret_cast<sockaddr*>(&addr), addrLen));
+  auto fd = fdPromise.getFuture().within(kTimeout).via(&evb).getVia(&evb);
+  AsyncIoUringSocket::UniquePtr socket(
+      new AsyncIoUringSocket(AsyncSocket::newSocket(&evb, fd)));
+
+  std::vector<std::unique_ptr<IOBuf>> bufs;
+  for (size_t i = 0; i < kBuffers; ++i) {
+    bufs.push_back(arena->allocate());
+    ASSERT_NE(nullptr, bufs.back());
+    EXPECT_EQ(kBufferBytes, bufs.back()->tailroom());
+  }
+  EXPECT_EQ(nullptr, arena->allocate());
+  EXPECT_EQ(0, arena->available());
+
+  std::string expected;
+  std::vector<FutureWriteCallback> callbacks(kBuffers);
+  for (size_t i = 0; i < kBuffers; ++i) {
+    auto& buf = bufs[i];
+    char c = static_cast<char>('a' + i);
+    memset(buf->writableTail(), c, kBufferBytes);
+    buf->append(kBufferBytes);
+    expected.append(kBufferBytes, c);
+    socket->writeChain(&callbacks[i], std::move(buf), WriteFlags::NONE);
+  }
+  for (auto& callback : callbacks) {
+    auto res = std::move(callback.promiseContract.future)
+                   .within(kTimeout)
+                   .via(&evb)
+                   .getVia(&evb);
+    EXPECT_TRUE(res.hasValue());
+  }
+  // The buffers go back to the arena once the kernel is done with them.
+  while (arena->available() < kBuffers) {
+    evb.loopOnce();
+  }
+
+  std::string received(expected.size(), '\0');
+  EXPECT_EQ(
+      received.size(),
+      readFull(client.toFd(), received.data(), received.size()));
+  EXPECT_EQ(expected, received);
+
+  socket.reset();
+  netops::close(client);
+  serverSocket->removeAcceptCallback(&acceptCallback, &evb);
+  evb.loopOnce(EVLOOP_NONBLOCK);
+}
+
+TEST(AsyncIoUringSocketTest, MultishotAccept) {
+  if (!IoUringBackend::kernelSupportsMultishotAccept()) {
+    GTEST_SKIP() << "multishot accept not supported";
+  }
+  constexpr int kConnections = 64;
+  std::vector<SocketAddress> accepted;
+  test::TestAcceptCallback acceptCallback;
+  acceptCallback.setConnectionAcceptedFn(
+      [&](NetworkSocket fd, const folly::SocketAddress& addr) {
+        int flags = fcntl(fd.toFd(), F_GETFL, 0);
+        EXPECT_EQ(flags & O_NONBLOCK, O_NONBLOCK);
+        accepted.push_back(addr);
+        netops::close(fd);
+      });
+
+  EventBase evb{EventBase::Options{}.setBackendFactory(
+      []() -> std::unique_ptr<EventBaseBackendBase> {
+        return std::make_unique<IoUringBackend>(
+            IoUringBackend::Options{}.setDeferTaskRun(true));
+      })};
+
+  auto serverSocket = AsyncServerSocket::newSocket(&evb);
+  serverSocket->setIoUringAccept(true);
+  serverSocket->bind(0);
+  serverSocket->listen(1024);
+  SocketAddress serverAddress;
+  serverSocket->getAddress(&serverAddress);
+  serverSocket->addAcceptCallback(&acceptCallback, nullptr);
+  serverSocket->startAccepting();
+  EXPECT_TRUE(serverSocket->usingIoUringAccept());
+
+  std::vector<AsyncSocket::UniquePtr> clients;
+  for (int i = 0; i < kConnections; ++i) {
+    clients.emplace_back(AsyncSocket::newSocket(&evb));
+    clients.back()->connect(nullptr, serverAddress);
+  }
+  evb.loopOnce();
+  while (accepted.size() < kConnections) {
+    evb.loopOnce();
+  }
+  // The peer addresses are those of the clients.
+  std::vector<SocketAddress> clientAddresses;
+  for (auto& client : clients) {
+    SocketAddress address;
+    client->getLocalAddress(&address);
+    clientAddresses.push_back(address);
+  }
+  std::sort(clientAddresses.begin(), clientAddresses.end());
+  std::sort(accepted.begin(), accepted.end());
+  EXPECT_EQ(clientAddresses, accepted);
+
+  // Stop accepting, and start again.
+  serverSocket->pauseAccepting();
+  EXPECT_FALSE(serverSocket->usingIoUringAccept());
+  serverSocket->startAccepting();
+  EXPECT_TRUE(serverSocket->usingIoUringAccept());
+  clients.emplace_back(AsyncSocket::newSocket(&evb));
+  clients.back()->connect(nullptr, serverAddress);
+  while (accepted.size() < kConnections + 1) {
+    evb.loopOnce();
+  }
+
+  serverSocket->removeAcceptCallback(&acceptCallback, nullptr);
+  evb.loopOnce(EVLOOP_NONBLOCK);
+}
+
+TEST(AsyncIoUringSocketTest, MultishotAcceptFallback) {
+  if (!IoUringBackend::kernelSupportsMultishotAccept()) {
+    GTEST_SKIP() << "multishot accept not supported";
+  }
+  int accepted = 0;
+  test::TestAcceptCallback acceptCallback;
+  acceptCallback.setConnectionAcceptedFn(
+      [&](NetworkSocket fd, const folly::SocketAddress&) {
+        ++accepted;
+        netops::close(fd);
+      });
+  acceptCallback.setAcceptErrorFn(
+      [](const std::exception& ex) { ADD_FAILURE() << ex.what(); });
+
+  EventBase evb{EventBase::Options{}.setBackendFactory(
+      []() -> std::unique_ptr<EventBaseBackendBase> {
+        return std::make_unique<IoUringBackend>(IoUringBackend::Options{});
+      })};
+
+  // The accept fails with EINVAL on a socket that is not listening yet, as
+  // it does on kernels without multishot accept.
+  auto serverSocket = AsyncServerSocket::newSocket(&evb);
+  serverSocket->setIoUringAccept(true);
+  serverSocket->bind(0);
+  SocketAddress serverAddress;
+  serverSocket->getAddress(&serverAddress);
+  serverSocket->addAcceptCallback(&acceptCallback, nullptr);
+  serverSocket->startAccepting();
+  EXPECT_TRUE(serverSocket->usingIoUringAccept());
+  while (serverSocket->usingIoUringAccept()) {
+    evb.loopOnce();
+  }
+
+  // Still accepting, with accept4().
+  serverSocket->listen(16);
+  auto client = AsyncSocket::newSocket(&evb);
+  client->connect(nullptr, serverAddress);
+  while (accepted == 0) {
+    evb.loopOnce();
+  }
+
+  serverSocket->removeAcceptCallback(&acceptCallback, nullptr);
+  evb.loopOnce(EVLOOP_NONBLOCK);
+}
+
+TEST(AsyncIoUringSocketTest, MultishotAcceptDirect) {
+  if (!IoUringBackend::kernelSupportsMultishotAccept()) {
+    GTEST_SKIP() << "multishot accept not supported";
+  }
+  EventBase evb{EventBase::Options{}.setBackendFactory(
+      []() -> std::unique_ptr<EventBaseBackendBase> {
+        return std::make_unique<IoUringBackend>(
+            IoUringBackend::Options{}
+                .setUseRegisteredFds(16)
+                .setDirectAcceptFds(8)
+                .setInitialProvidedBuffers(1024, 128)
+                .setDeferTaskRun(true));
+      })};
+  auto* backend = dynamic_cast<IoUringBackend*>(evb.getBackend());
+  backend->loopPoll(); // init delayed bits as this is the only thread
+  if (!backend->hasDirectAcceptFds()) {
+    GTEST_SKIP() << "direct descriptors not supported";
+  }
+
+  struct DirectAcceptCallback : AsyncServerSocket::AcceptCallback {
+    void connectionAccepted(
+        NetworkSocket fd, const SocketAddress&, AcceptInfo) noexcept override {
+      ADD_FAILURE() << "accepted a file descriptor";
+      netops::close(fd);
+    }
+
+    bool connectionAcceptedDirect(int index, AcceptInfo) noexcept override {
+      echoes.push_back(std::make_unique<EchoTransport>(
+          AsyncSocketTransport::UniquePtr(new AsyncIoUringSocket(
+              evb, AsyncIoUringSocket::DirectDescriptor{index})),
+          true));
+      echoes.back()->start();
+      return true;
+    }
+
+    EventBase* evb;
+    std::vector<std::unique_ptr<EchoTransport>> echoes;
+  } acceptCallback;
+  acceptCallback.evb = &evb;
+
+  auto serverSocket = AsyncServerSocket::newSocket(&evb);
+  serverSocket->setIoUringAccept(true);
+  serverSocket->setIoUringAcceptDirect(true);
+  serverSocket->bind(0);
+  serverSocket->listen(1024);
+  SocketAddress serverAddress;
+  serverSocket->getAddress(&serverAddress);
+  serverSocket->addAcceptCallback(&acceptCallback, nullptr);
+  serverSocket->startAccepting();
+  EXPECT_TRUE(serverSocket->usingIoUringAcceptDirect());
+
+  // More connections than direct descriptors, so the slots of closed
+  // connections must be reused.
+  for (int round = 0; round < 3; ++round) {
+    std::vector<AsyncSocket::UniquePtr> clients;
+    std::vector<CollectCallback> collectors(6);
+    std::vector<SemiFuture<std::string>> replies;
+    for (auto& collector : collectors) {
+      clients.emplace_back(AsyncSocket::newSocket(&evb));
+      clients.back()->connect(nullptr, serverAddress);
+      clients.back()->setReadCB(&collector);
+      clients.back()->write(&nullWriteCallback, "hello", 5);
+      replies.push_back(collector.waitFor(5));
+    }
+    for (auto& reply : replies) {
+      EXPECT_EQ("hello", std::move(reply).via(&evb).getVia(&evb));
+    }
+    clients.clear();
+    for (auto& echo : acceptCallback.echoes) {
+      while (echo->transport->good()) {
+        evb.loopOnce();
+      }
+    }
+    acceptCallback.echoes.clear();
+    evb.loopOnce(EVLOOP_NONBLOCK);
+  }
+
+  // Direct descriptors are only valid on this EventBase.
+  ScopedEventBaseThread remote;
+  test::TestAcceptCallback remoteCallback;
+  serverSocket->addAcceptCallback(&remoteCallback, remote.getEventBase());
+  EXPECT_FALSE(serverSocket->usingIoUringAcceptDirect());
+  EXPECT_TRUE(serverSocket->usingIoUringAccept());
+
+  serverSocket->removeAcceptCallback(&remoteCallback, remote.getEventBase());
+  serverSocket->removeAcceptCallback(&acceptCallback, nullptr);
+  evb.loopOnce(EVLOOP_NONBLOCK);
+}
+
 } // namespace folly
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/AsyncIoUringUDPSocket.h>
+
+#include <string>
+#include <vector>
+
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/IoUringBackend.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+std::unique_ptr<EventBase> makeEventBase(size_t providedBuffers = 256) {
+  auto options = IoUringBackend::Options{};
+  if (providedBuffers) {
+    options.setInitialProvidedBuffers(2048, providedBuffers);
+  }
+  return std::make_unique<EventBase>(EventBase::Options{}.setBackendFactory(
+      [options]() -> std::unique_ptr<EventBaseBackendBase> {
+        return std::make_unique<IoUringBackend>(options);
+      }));
+}
+
+class BatchReadCallback : public AsyncIoUringUDPSocket::BatchReadCallback {
+ public:
+  void onDataAvailableBatch(
+      std::vector<Datagram>& datagrams) noexcept override {
+    ++batches;
+    for (auto& datagram : datagrams) {
+      peers.push_back(datagram.peer);
+      data.push_back(datagram.data->moveToFbString().toStdString());
+    }
+  }
+
+  void onReadError(const AsyncSocketException& ex) noexcept override {
+    FAIL() << ex.what();
+  }
+
+  void onReadClosed() noexcept override { closed = true; }
+
+  size_t batches{0};
+  std::vector<SocketAddress> peers;
+  std::vector<std::string> data;
+  bool closed{false};
+};
+
+class CopyReadCallback : public AsyncUDPSocket::ReadCallback {
+ public:
+  explicit CopyReadCallback(size_t size) : buf(size) {}
+
+  void getReadBuffer(void** b, size_t* len) noexcept override {
+    *b = buf.data();
+    *len = buf.size();
+  }
+
+  void onDataAvailable(
+      const SocketAddress& peer,
+      size_t len,
+      bool isTruncated,
+      OnDataAvailableParams) noexcept override {
+    peers.push_back(peer);
+    data.emplace_back(buf.data(), len);
+    truncated.push_back(isTruncated);
+  }
+
+  void onReadError(const AsyncSocketException& ex) noexcept override {
+    FAIL() << ex.what();
+  }
+
+  void onReadClosed() noexcept override {}
+
+  std::vector<char> buf;
+  std::vector<SocketAddress> peers;
+  std::vector<std::string> data;
+  std::vector<bool> truncated;
+};
+
+class AsyncIoUringUDPSocketTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (!IoUringBackend::isAvailable()) {
+      GTEST_SKIP() << "io_uring not available";
+    }
+    evb = makeEventBase();
+    server = std::make_unique<AsyncIoUringUDPSocket>(evb.get());
+    server->bind(SocketAddress("127.0.0.1", 0));
+    client = std::make_unique<AsyncIoUringUDPSocket>(evb.get());
+    client->bind(SocketAddress("127.0.0.1", 0));
+  }
+
+  void TearDown() override {
+    client.reset();
+    server.reset();
+    evb.reset();
+  }
+
+  template <class F>
+  void loopUntil(F&& f) {
+    while (!f()) {
+      evb->loopOnce();
+    }
+  }
+
+  std::unique_ptr<EventBase> evb;
+  std::unique_ptr<AsyncIoUringUDPSocket> server;
+  std::unique_ptr<AsyncIoUringUDPSocket> client;
+};
+
+} // namespace
+
+TEST_F(AsyncIoUringUDPSocketTest, BatchRead) {
+  BatchReadCallback callback;
+  server->resumeRead(&callback);
+  EXPECT_TRUE(server->isReading());
+  EXPECT_EQ(
+      IoUringBackend::kernelSupportsRecvmsgMultishot(),
+      server->usingIoUringRecv());
+
+  constexpr int kDatagrams = 100;
+  for (int i = 0; i < kDatagrams; ++i) {
+    auto payload = std::to_string(i);
+    EXPECT_EQ(
+        payload.size(),
+        client->write(server->address(), IOBuf::copyBuffer(payload)));
+  }
+  EXPECT_EQ(kDatagrams, client->getSendsInFlight());
+  loopUntil([&] { return callback.data.size() == kDatagrams; });
+
+  for (int i = 0; i < kDatagrams; ++i) {
+    EXPECT_EQ(std::to_string(i), callback.data[i]);
+    EXPECT_EQ(client->address(), callback.peers[i]);
+  }
+  if (server->usingIoUringRecv()) {
+    // All the completions of a loop iteration come in one batch.
+    EXPECT_LT(callback.batches, kDatagrams);
+  }
+  EXPECT_EQ(0, client->getSendsInFlight());
+  EXPECT_EQ(0, client->getSendErrors());
+
+  server->close();
+  EXPECT_TRUE(callback.closed);
+  EXPECT_FALSE(server->isReading());
+}
+
+TEST_F(AsyncIoUringUDPSocketTest, BatchReadRunsOutOfBuffers) {
+  // More datagrams than buffers: the multishot recvmsg ends with ENOBUFS
+  // and is submitted again once the callback gave the buffers back.
+  auto smallEvb = makeEventBase(8);
+  AsyncIoUringUDPSocket reader(smallEvb.get());
+  reader.bind(SocketAddress("127.0.0.1", 0));
+  AsyncIoUringUDPSocket writer(smallEvb.get());
+  writer.bind(SocketAddress("127.0.0.1", 0));
+  BatchReadCallback callback;
+  reader.resumeRead(&callback);
+
+  constexpr int kDatagrams = 100;
+  for (int i = 0; i < kDatagrams; ++i) {
+    auto payload = std::to_string(i);
+    EXPECT_EQ(
+        payload.size(),
+        writer.write(reader.address(), IOBuf::copyBuffer(payload)));
+  }
+  while (callback.data.size() < kDatagrams) {
+    smallEvb->loopOnce();
+  }
+  for (int i = 0; i < kDatagrams; ++i) {
+    EXPECT_EQ(std::to_string(i), callback.data[i]);
+  }
+  EXPECT_EQ(0, writer.getSendErrors());
+  reader.close();
+}
+
+TEST_F(AsyncIoUringUDPSocketTest, CopyRead) {
+  CopyReadCallback callback(8);
+  server->resumeRead(&callback);
+
+  std::unique_ptr<IOBuf> bufs[] = {
+      IOBuf::copyBuffer("short"), IOBuf::copyBuffer("much too long")};
+  SocketAddress addrs[] = {server->address()};
+  EXPECT_EQ(2, client->writem(range(addrs), bufs, 2));
+  loopUntil([&] { return callback.data.size() == 2; });
+
+  EXPECT_EQ("short", callback.data[0]);
+  EXPECT_FALSE(callback.truncated[0]);
+  EXPECT_EQ("much too", callback.data[1]);
+  EXPECT_TRUE(callback.truncated[1]);
+  EXPECT_EQ(client->address(), callback.peers[1]);
+
+  server->pauseRead();
+  EXPECT_FALSE(server->isReading());
+  EXPECT_FALSE(server->usingIoUringRecv());
+}
+
+TEST_F(AsyncIoUringUDPSocketTest, GSO) {
+  if (client->getGSO() < 0) {
+    GTEST_SKIP() << "GSO not supported";
+  }
+  BatchReadCallback callback;
+  server->resumeRead(&callback);
+
+  constexpr size_t kSegment = 100;
+  constexpr size_t kSegments = 10;
+  std::string payload(kSegment * kSegments, 'x');
+  for (size_t i = 0; i < kSegments; ++i) {
+    payload[i * kSegment] = static_cast<char>('0' + i);
+  }
+  EXPECT_EQ(
+      payload.size(),
+      client->writeGSO(
+          server->address(),
+          IOBuf::copyBuffer(payload),
+          AsyncUDPSocket::WriteOptions(kSegment, false)));
+  loopUntil([&] { return callback.data.size() == kSegments; });
+
+  for (size_t i = 0; i < kSegments; ++i) {
+    EXPECT_EQ(payload.substr(i * kSegment, kSegment), callback.data[i]);
+  }
+  EXPECT_EQ(0, client->getSendErrors());
+}
+
+TEST_F(AsyncIoUringUDPSocketTest, MaxSendsInFlight) {
+  AsyncIoUringUDPSocket::Options options;
+  options.maxSendsInFlight = 2;
+  AsyncIoUringUDPSocket limited(evb.get(), options);
+  limited.bind(SocketAddress("127.0.0.1", 0));
+  BatchReadCallback callback;
+  server->resumeRead(&callback);
+
+  auto buf = IOBuf::copyBuffer("x");
+  EXPECT_EQ(1, limited.write(server->address(), buf));
+  EXPECT_EQ(1, limited.write(server->address(), buf));
+  EXPECT_EQ(-1, limited.write(server->address(), buf));
+  EXPECT_EQ(EAGAIN, errno);
+
+  loopUntil([&] { return limited.getSendsInFlight() == 0; });
+  EXPECT_EQ(1, limited.write(server->address(), buf));
+  loopUntil([&] { return callback.data.size() == 3; });
+}
+
+TEST_F(AsyncIoUringUDPSocketTest, NoProvidedBuffers) {
+  // Reads fall back to AsyncUDPSocket's, writes still use io_uring.
+  auto otherEvb = makeEventBase(0);
+  AsyncIoUringUDPSocket other(otherEvb.get());
+  other.bind(SocketAddress("127.0.0.1", 0));
+  CopyReadCallback callback(64);
+  other.resumeRead(&callback);
+  EXPECT_TRUE(other.isReading());
+  EXPECT_FALSE(other.usingIoUringRecv());
+
+  EXPECT_EQ(5, client->write(other.address(), IOBuf::copyBuffer("hello")));
+  loopUntil([&] { return client->getSendsInFlight() == 0; });
+  while (callback.data.empty()) {
+    otherEvb->loopOnce();
+  }
+  EXPECT_EQ("hello", callback.data[0]);
+  other.close();
+}
+
+TEST_F(AsyncIoUringUDPSocketTest, CloseWithQueuedSends) {
+  // Only the sends are under test.
+  AsyncUDPSocket reader(evb.get());
+  reader.bind(SocketAddress("127.0.0.1", 0));
+  CopyReadCallback callback(64);
+  reader.resumeRead(&callback);
+
+  constexpr int kDatagrams = 10;
+  auto clientAddress = client->address();
+  for (int i = 0; i < kDatagrams; ++i) {
+    EXPECT_EQ(1, client->write(reader.address(), IOBuf::copyBuffer("x")));
+  }
+  client->close();
+  // Likely to reuse the fd number of the closed socket.
+  AsyncIoUringUDPSocket other(evb.get());
+  other.bind(SocketAddress("127.0.0.1", 0));
+
+  loopUntil([&] { return callback.data.size() == kDatagrams; });
+  for (const auto& peer : callback.peers) {
+    EXPECT_EQ(clientAddress, peer);
+  }
+}
+
+TEST_F(AsyncIoUringUDPSocketTest, SendErrorFailsNextWrite) {
+  // Nothing listens on the port of a closed socket, so the kernel refuses
+  // the datagrams sent to it after the first.
+  auto closedAddress = server->address();
+  server->close();
+  client->connect(closedAddress);
+
+  auto buf = IOBuf::copyBuffer("x");
+  ssize_t ret = 0;
+  for (int i = 0; i < 10 && ret >= 0; ++i) {
+    ret = client->write(closedAddress, buf);
+    loopUntil([&] { return client->getSendsInFlight() == 0; });
+  }
+  EXPECT_EQ(-1, ret);
+  EXPECT_EQ(ECONNREFUSED, errno);
+  EXPECT_EQ(1, client->getSendErrors());
+  // Reported once.
+  EXPECT_EQ(1, client->write(closedAddress, buf));
+}
@@ -24,6 +24,7 @@
 #include <set>
 #include <thread>
 
+#include <folly/FileUtil.h>
 #include <folly/SocketAddress.h>
 #include <folly/String.h>
 #include <folly/io/Cursor.h>
@@ -1170,6 +1171,76 @@ TEST(AsyncSSLSocketTest, SSLGetEKMFailsOnTLS10) {
   EXPECT_EQ(nullptr, ekm);
 }
 
+/**
+ * Once encrypted, sendFile() cannot use sendfile(2): the file is read a
+ * chunk at a time and each chunk is written as TLS records.
+ */
+TEST(AsyncSSLSocketTest, SendFile) {
+  // Collects what the server reads.
+  struct StringReadCallback : AsyncTransport::ReadCallback {
+    void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
+      *bufReturn = buf;
+      *lenReturn = sizeof(buf);
+    }
+    void readDataAvailable(size_t len) noexcept override {
+      data.append(buf, len);
+    }
+    void readEOF() noexcept override { done = true; }
+    void readErr(const AsyncSocketException& ex) noexcept override {
+      ADD_FAILURE() << ex.what();
+      done = true;
+    }
+    char buf[4096];
+    std::string data;
+    bool done{false};
+  };
+
+  EventBase eventBase;
+  auto clientCtx = std::make_shared<SSLContext>();
+  auto serverCtx = std::make_shared<SSLContext>();
+  NetworkSocket fds[2];
+  getfds(fds);
+  getctx(clientCtx, serverCtx);
+  // Shared, as WriteCallbackBase closes it on error.
+  std::shared_ptr<AsyncSSLSocket> clientSock =
+      AsyncSSLSocket::newSocket(clientCtx, &eventBase, fds[0], false);
+  AsyncSSLSocket::UniquePtr serverSock(
+      new AsyncSSLSocket(serverCtx, &eventBase, fds[1], true));
+  serverSock->sslAccept(nullptr, std::chrono::milliseconds::zero());
+  clientSock->sslConn(nullptr, std::chrono::milliseconds::zero());
+  eventBase.loop();
+  ASSERT_TRUE(clientSock->good());
+
+  // Several chunks, the last one partial.
+  constexpr size_t kFileLength = 3 * 1024 * 1024 + 100;
+  std::string fileData(kFileLength, '\0');
+  for (size_t i = 0; i < kFileLength; ++i) {
+    fileData[i] = char('a' + i % 26);
+  }
+  test::TemporaryFile file;
+  ASSERT_EQ(
+      ssize_t(kFileLength),
+      writeFull(file.fd(), fileData.data(), fileData.size()));
+
+  constexpr off_t kOffset = 5;
+  constexpr size_t kLength = kFileLength - 10;
+  StringReadCallback readCallback;
+  serverSock->setReadCB(&readCallback);
+  test::WriteCallbackBase writeCallback;
+  writeCallback.setSocket(clientSock);
+  clientSock->sendFile(&writeCallback, file.fd(), kOffset, kLength);
+  while (readCallback.data.size() < kLength && !readCallback.done) {
+    eventBase.loopOnce();
+  }
+
+  EXPECT_EQ(STATE_SUCCEEDED, writeCallback.state);
+  EXPECT_EQ(kLength, clientSock->getAppBytesWritten());
+  // More went out than the file: the records carry their own overhead.
+  EXPECT_GT(clientSock->getRawBytesWritten(), kLength);
+  EXPECT_TRUE(readCallback.data == fileData.substr(kOffset, kLength));
+  serverSock->setReadCB(nullptr);
+}
+
 /**
  * Verify that server is able to get client cert by getPeerCert() API.
  */
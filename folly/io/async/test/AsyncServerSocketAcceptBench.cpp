@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/FileUtil.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/IoUringBackend.h>
+#include <folly/net/NetOps.h>
+#include <folly/portability/GFlags.h>
+
+DEFINE_uint32(batch, 256, "connections in flight at once");
+
+using namespace folly;
+
+namespace {
+
+class CountingAcceptCallback : public AsyncServerSocket::AcceptCallback {
+ public:
+  void connectionAccepted(
+      NetworkSocket fd, const SocketAddress&, AcceptInfo) noexcept override {
+    closeNoInt(fd);
+    ++accepted;
+  }
+
+  size_t accepted{0};
+};
+
+// Accepts iters connections, made by the same thread in batches: with epoll
+// readiness events and accept4() on the default EventBase, or with a
+// multishot IORING_OP_ACCEPT on an IoUringBackend one.
+void runAccept(size_t iters, bool ioUringAccept) {
+  std::unique_ptr<EventBase> evb;
+  AsyncServerSocket::UniquePtr serverSocket;
+  CountingAcceptCallback callback;
+  SocketAddress address;
+  BENCHMARK_SUSPEND {
+    if (ioUringAccept) {
+      evb = std::make_unique<EventBase>(EventBase::Options{}.setBackendFactory(
+          []() -> std::unique_ptr<EventBaseBackendBase> {
+            return std::make_unique<IoUringBackend>(IoUringBackend::Options{});
+          }));
+    } else {
+      evb = std::make_unique<EventBase>();
+    }
+    serverSocket.reset(new AsyncServerSocket(evb.get()));
+    serverSocket->setIoUringAccept(ioUringAccept);
+    serverSocket->bind(SocketAddress("127.0.0.1", 0));
+    serverSocket->listen(4096);
+    serverSocket->addAcceptCallback(&callback, nullptr);
+    serverSocket->startAccepting();
+    CHECK_EQ(ioUringAccept, serverSocket->usingIoUringAccept());
+    address = serverSocket->getAddress();
+  }
+
+  std::vector<NetworkSocket> clients;
+  while (callback.accepted < iters) {
+    size_t batch = std::min<size_t>(FLAGS_batch, iters - callback.accepted);
+    auto target = callback.accepted + batch;
+    for (size_t i = 0; i < batch; ++i) {
+      auto fd = netops::socket(AF_INET, SOCK_STREAM, 0);
+      netops::set_socket_non_blocking(fd);
+      sockaddr_storage addr;
+      auto len = address.getAddress(&addr);
+      netops::connect(fd, reinterpret_cast<sockaddr*>(&addr), len);
+      clients.push_back(fd);
+    }
+    while (callback.accepted < target) {
+      evb->loopOnce();
+    }
+    for (auto fd : clients) {
+      netops::close(fd);
+    }
+    clients.clear();
+  }
+
+  BENCHMARK_SUSPEND {
+    serverSocket->removeAcceptCallback(&callback, nullptr);
+    serverSocket.reset();
+    evb.reset();
+  }
+}
+
+} // namespace
+
+BENCHMARK(EpollAccept, iters) {
+  runAccept(iters, false);
+}
+
+BENCHMARK_RELATIVE(IoUringMultishotAccept, iters) {
+  runAccept(iters, true);
+}
+
+int main(int argc, char** argv) {
+  folly::Init init(&argc, &argv, true);
+  if (!IoUringBackend::isAvailable() ||
+      !IoUringBackend::kernelSupportsMultishotAccept()) {
+    LOG(ERROR) << "io_uring multishot accept not supported";
+    return 0;
+  }
+  runBenchmarks();
+  return 0;
+}
@@ -25,6 +25,7 @@
 #include <thread>
 
 #include <folly/ExceptionWrapper.h>
+#include <folly/FileUtil.h>
 #include <folly/Random.h>
 #include <folly/SocketAddress.h>
 #include <folly/io/IOBuf.h>
@@ -2150,6 +2151,89 @@ TEST(AsyncSocketTest, WriteIOBufCorked) {
   ASSERT_FALSE(socket->isClosedByPeer());
 }
 
+namespace {
+void testSendFile(WriteFlags flags) {
+  TestServer server;
+
+  // Large enough for partial writes.
+  constexpr size_t kFileLength = 8 * 1024 * 1024;
+  std::string fileData(kFileLength, '\0');
+  for (size_t i = 0; i < kFileLength; ++i) {
+    fileData[i] = char('a' + i % 26);
+  }
+  test::TemporaryFile file;
+  ASSERT_EQ(
+      ssize_t(kFileLength),
+      writeFull(file.fd(), fileData.data(), fileData.size()));
+
+  // Queue the writes while connecting.
+  EventBase evb;
+  std::shared_ptr<AsyncSocket> socket = AsyncSocket::newSocket(&evb);
+  ConnCallback ccb;
+  socket->connect(&ccb, server.getAddress(), 30);
+
+  std::string head = "head";
+  std::string tail = "tail";
+  constexpr off_t kOffset = 3;
+  constexpr size_t kLength = kFileLength - 10;
+  WriteCallback wcb1;
+  socket->write(&wcb1, head.data(), head.size());
+  WriteCallback wcb2;
+  socket->sendFile(&wcb2, file.fd(), kOffset, kLength, flags);
+  WriteCallback wcb3;
+  socket->write(&wcb3, tail.data(), tail.size());
+  socket->shutdownWrite();
+
+  std::shared_ptr<AsyncSocket> acceptedSocket = server.acceptAsync(&evb);
+  ReadCallback rcb;
+  acceptedSocket->setReadCB(&rcb);
+  evb.loop();
+
+  ASSERT_EQ(ccb.state, STATE_SUCCEEDED);
+  ASSERT_EQ(wcb1.state, STATE_SUCCEEDED);
+  ASSERT_EQ(wcb2.state, STATE_SUCCEEDED);
+  ASSERT_EQ(wcb3.state, STATE_SUCCEEDED);
+  ASSERT_EQ(rcb.state, STATE_SUCCEEDED);
+  std::string received;
+  for (const auto& buf : rcb.buffers) {
+    received.append(buf.buffer, buf.length);
+  }
+  EXPECT_TRUE(received == head + fileData.substr(kOffset, kLength) + tail);
+  EXPECT_EQ(head.size() + kLength + tail.size(), socket->getAppBytesWritten());
+
+  acceptedSocket->close();
+  socket->close();
+}
+} // namespace
+
+TEST(AsyncSocketTest, SendFile) {
+  testSendFile(WriteFlags::NONE);
+}
+
+// sendfile(2) cannot take EOR, so the file is read a chunk at a time.
+TEST(AsyncSocketTest, SendFileBuffered) {
+  testSendFile(WriteFlags::EOR);
+}
+
+TEST(AsyncSocketTest, SendFileShorterThanRange) {
+  TestServer server;
+
+  EventBase evb;
+  std::shared_ptr<AsyncSocket> socket =
+      AsyncSocket::newSocket(&evb, server.getAddress(), 30);
+  evb.loop(); // loop until the socket is connected
+  auto acceptedSocket = server.acceptAsync(&evb);
+
+  test::TemporaryFile file;
+  ASSERT_EQ(5, writeFull(file.fd(), "hello", 5));
+  WriteCallback wcb;
+  socket->sendFile(&wcb, file.fd(), 2, 10);
+  evb.loop();
+
+  ASSERT_EQ(wcb.state, STATE_FAILED);
+  EXPECT_EQ(3, wcb.bytesWritten);
+}
+
 /**
  * Test performing a zero-length write
  */
@@ -16,9 +16,14 @@
 
 #include <folly/io/async/AsyncTransport.h>
 
+#include <string>
+#include <vector>
+
+#include <folly/FileUtil.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/test/MockAsyncTransport.h>
 #include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
 
 using namespace testing;
 
@@ -44,4 +49,117 @@ TEST(AsyncTransportTest, getSocketFromWrappedTransport) {
   ASSERT_EQ(transportAddr, sock);
 }
 
+namespace {
+
+// The default sendFile() reads 64KB at a time.
+constexpr size_t kChunkSize = 64 * 1024;
+
+std::string fileData(size_t length) {
+  std::string data(length, '\0');
+  for (size_t i = 0; i < length; ++i) {
+    data[i] = char('a' + i % 26);
+  }
+  return data;
+}
+
+struct WriteChainCall {
+  AsyncTransport::WriteCallback* callback;
+  std::string data;
+  WriteFlags flags;
+};
+
+} // namespace
+
+TEST(AsyncTransportTest, sendFileWritesChunksInTurn) {
+  auto data = fileData(2 * kChunkSize + 100);
+  test::TemporaryFile file;
+  ASSERT_EQ(
+      ssize_t(data.size()), writeFull(file.fd(), data.data(), data.size()));
+
+  test::MockAsyncTransport transport;
+  std::vector<WriteChainCall> calls;
+  EXPECT_CALL(transport, writeChain(_, _, _))
+      .WillRepeatedly([&](auto* callback, auto buf, auto flags) {
+        calls.push_back({callback, buf->toString(), flags});
+      });
+  test::MockWriteCallback wcb;
+
+  constexpr off_t kOffset = 10;
+  auto length = data.size() - kOffset;
+  transport.sendFile(&wcb, file.fd(), kOffset, length, WriteFlags::EOR);
+  // The next chunk is only read once the previous one is written.
+  ASSERT_EQ(1, calls.size());
+  calls.back().callback->writeSuccess();
+  ASSERT_EQ(2, calls.size());
+  calls.back().callback->writeSuccess();
+  ASSERT_EQ(3, calls.size());
+  EXPECT_CALL(wcb, writeSuccess_());
+  calls.back().callback->writeSuccess();
+
+  std::string written;
+  for (const auto& call : calls) {
+    written += call.data;
+  }
+  EXPECT_EQ(data.substr(kOffset), written);
+  EXPECT_EQ(kChunkSize, calls[0].data.size());
+  EXPECT_EQ(WriteFlags::EOR | WriteFlags::CORK, calls[0].flags);
+  EXPECT_EQ(WriteFlags::EOR | WriteFlags::CORK, calls[1].flags);
+  EXPECT_EQ(WriteFlags::EOR, calls[2].flags);
+}
+
+TEST(AsyncTransportTest, sendFileWrittenInline) {
+  auto data = fileData(3 * kChunkSize);
+  test::TemporaryFile file;
+  ASSERT_EQ(
+      ssize_t(data.size()), writeFull(file.fd(), data.data(), data.size()));
+
+  test::MockAsyncTransport transport;
+  std::string written;
+  EXPECT_CALL(transport, writeChain(_, _, _))
+      .Times(3)
+      .WillRepeatedly([&](auto* callback, auto buf, auto) {
+        written += buf->toString();
+        callback->writeSuccess();
+      });
+  test::MockWriteCallback wcb;
+  EXPECT_CALL(wcb, writeSuccess_());
+  transport.sendFile(&wcb, file.fd(), 0, data.size());
+  EXPECT_EQ(data, written);
+}
+
+TEST(AsyncTransportTest, sendFileShorterThanRange) {
+  auto data = fileData(kChunkSize + 100);
+  test::TemporaryFile file;
+  ASSERT_EQ(
+      ssize_t(data.size()), writeFull(file.fd(), data.data(), data.size()));
+
+  test::MockAsyncTransport transport;
+  EXPECT_CALL(transport, writeChain(_, _, _))
+      .WillOnce([&](auto* callback, auto, auto) { callback->writeSuccess(); });
+  test::MockWriteCallback wcb;
+  EXPECT_CALL(wcb, writeErr_(kChunkSize, _));
+  transport.sendFile(&wcb, file.fd(), 0, 2 * kChunkSize);
+}
+
+TEST(AsyncTransportTest, sendFileWriteErr) {
+  auto data = fileData(2 * kChunkSize);
+  test::TemporaryFile file;
+  ASSERT_EQ(
+      ssize_t(data.size()), writeFull(file.fd(), data.data(), data.size()));
+
+  test::MockAsyncTransport transport;
+  std::vector<AsyncTransport::WriteCallback*> callbacks;
+  EXPECT_CALL(transport, writeChain(_, _, _))
+      .Times(2)
+      .WillRepeatedly(
+          [&](auto* callback, auto, auto) { callbacks.push_back(callback); });
+  test::MockWriteCallback wcb;
+  transport.sendFile(&wcb, file.fd(), 0, data.size());
+  callbacks.back()->writeSuccess();
+  ASSERT_EQ(2, callbacks.size());
+  EXPECT_CALL(wcb, writeErr_(kChunkSize + 10, _));
+  callbacks.back()->writeErr(
+      10, AsyncSocketException(AsyncSocketException::NOT_OPEN, "closed"));
+}
+
 } // namespace folly
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/IoUringRegisteredBufferArena.h>
+
+#include <gtest/gtest.h>
+
+#if FOLLY_HAS_LIBURING
+
+using namespace ::testing;
+using namespace ::std;
+using namespace ::folly;
+
+struct IoUringRegisteredBufferArenaTest : testing::Test {
+  void SetUp() override {
+    if (io_uring_queue_init(64, &ring, 0)) {
+      GTEST_SKIP() << "io_uring not available";
+    }
+  }
+
+  void TearDown() override {
+    if (ring.ring_fd > 0) {
+      io_uring_queue_exit(&ring);
+    }
+  }
+
+  io_uring ring{};
+};
+
+TEST_F(IoUringRegisteredBufferArenaTest, Create) {
+  IoUringRegisteredBufferArena::Options options = {
+      .bufferCount = 16,
+      .bufferSize = 5000,
+  };
+  auto arena = IoUringRegisteredBufferArena::create(&ring, options);
+  EXPECT_EQ(arena->count(), 16);
+  EXPECT_EQ(arena->available(), 16);
+  // rounded up to pages
+  EXPECT_EQ(arena->sizePerBuffer(), 8192);
+}
+
+TEST_F(IoUringRegisteredBufferArenaTest, AllocateAndReturn) {
+  IoUringRegisteredBufferArena::Options options = {
+      .bufferCount = 2,
+      .bufferSize = 4096,
+  };
+  auto arena = IoUringRegisteredBufferArena::create(&ring, options);
+  auto a = arena->allocate();
+  auto b = arena->allocate();
+  ASSERT_TRUE(a);
+  ASSERT_TRUE(b);
+  EXPECT_EQ(arena->allocate(), nullptr);
+  EXPECT_EQ(arena->available(), 0);
+
+  EXPECT_EQ(a->length(), 0);
+  EXPECT_EQ(a->tailroom(), 4096);
+  EXPECT_EQ(arena->bufferIndex(a->data(), 4096), 0);
+  EXPECT_EQ(arena->bufferIndex(b->data(), 4096), 1);
+  EXPECT_EQ(arena->bufferIndex(b->data() + 100, 100), 1);
+  // straddling two buffers, or outside of the arena
+  EXPECT_EQ(arena->bufferIndex(a->data() + 100, 4096), -1);
+  EXPECT_EQ(arena->bufferIndex(b->data() + 4096, 1), -1);
+  int onStack;
+  EXPECT_EQ(arena->bufferIndex(&onStack, sizeof(onStack)), -1);
+
+  // clones share the buffer, which is returned with the last of them
+  auto clone = b->clone();
+  b.reset();
+  EXPECT_EQ(arena->available(), 0);
+  clone.reset();
+  EXPECT_EQ(arena->available(), 1);
+  a.reset();
+  EXPECT_EQ(arena->available(), 2);
+}
+
+TEST_F(IoUringRegisteredBufferArenaTest, OutlivedByBuffers) {
+  IoUringRegisteredBufferArena::Options options = {
+      .bufferCount = 4,
+      .bufferSize = 4096,
+  };
+  auto arena = IoUringRegisteredBufferArena::create(&ring, options);
+  auto buf = arena->allocate();
+  ASSERT_TRUE(buf);
+  arena.reset();
+  // still mapped
+  memset(buf->writableTail(), 'x', buf->tailroom());
+  buf->append(buf->tailroom());
+  buf.reset();
+}
+
+#endif
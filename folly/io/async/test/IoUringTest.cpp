@@ -124,6 +124,88 @@ TEST(IoUringTest, RegisteredBuffers) {
   CHECK_EQ(::memcmp(regFdReadBuf.get(), regFdWriteBuf.get(), kBufSize), 0);
 }
 
+TEST(IoUringTest, Chain) {
+  constexpr size_t kBufSize = 4096;
+  std::unique_ptr<IoUring> ioUring;
+  try {
+    ioUring = std::make_unique<BatchIoUring>();
+  } catch (const std::runtime_error&) {
+  }
+  SKIP_IF(!ioUring) << "IOUring not available";
+  EXPECT_TRUE(ioUring->supportsChain());
+
+  auto tempFile = folly::test::TempFileUtil::getTempFile(kDefaultFileSize);
+  int fd = ::open(tempFile.path().c_str(), O_RDWR);
+  SKIP_IF(fd == -1) << "Tempfile can't be opened: " << folly::errnoStr(errno);
+  SCOPE_EXIT {
+    fileops::close(fd);
+  };
+
+  std::string writeBuf(kBufSize, 'x');
+  std::string readBuf(kBufSize, '\0');
+  std::vector<folly::AsyncBaseOp*> completed;
+  auto callback = [&](folly::AsyncBaseOp* op) { completed.push_back(op); };
+
+  // write, make it durable, read it back
+  IoUring::Op writeOp(callback), syncOp(callback), readOp(callback);
+  writeOp.pwrite(fd, writeBuf.data(), kBufSize, 0);
+  syncOp.fdatasync(fd);
+  readOp.pread(fd, readBuf.data(), kBufSize, 0);
+  std::vector<folly::AsyncBaseOp*> chain = {&writeOp, &syncOp, &readOp};
+  ioUring->submitChain(folly::range(chain));
+  while (completed.size() < chain.size()) {
+    ioUring->wait(1);
+  }
+  EXPECT_EQ(chain, completed);
+  EXPECT_EQ(kBufSize, writeOp.result());
+  EXPECT_EQ(0, syncOp.result());
+  EXPECT_EQ(kBufSize, readOp.result());
+  EXPECT_EQ(writeBuf, readBuf);
+
+  // a short read breaks the chain
+  completed.clear();
+  readOp.reset(callback);
+  writeOp.reset(callback);
+  readOp.pread(fd, readBuf.data(), kBufSize, kDefaultFileSize - 1);
+  writeOp.pwrite(fd, readBuf.data(), kBufSize, 0);
+  chain = {&readOp, &writeOp};
+  ioUring->submitChain(folly::range(chain));
+  while (completed.size() < chain.size()) {
+    ioUring->wait(1);
+  }
+  EXPECT_EQ(1, readOp.result());
+  EXPECT_EQ(-ECANCELED, writeOp.result());
+}
+
+TEST(IoUringTest, ChainTooLong) {
+  // an SQ ring of 2 entries
+  std::unique_ptr<IoUring> ioUring;
+  try {
+    ioUring = std::make_unique<IoUring>(16, folly::AsyncBase::NOT_POLLABLE, 2);
+  } catch (const std::runtime_error&) {
+  }
+  SKIP_IF(!ioUring) << "IOUring not available";
+
+  auto tempFile = folly::test::TempFileUtil::getTempFile(kDefaultFileSize);
+  int fd = ::open(tempFile.path().c_str(), O_RDWR);
+  SKIP_IF(fd == -1) << "Tempfile can't be opened: " << folly::errnoStr(errno);
+  SCOPE_EXIT {
+    fileops::close(fd);
+  };
+
+  IoUring::Op ops[3];
+  std::vector<folly::AsyncBaseOp*> chain;
+  for (auto& op : ops) {
+    op.fsync(fd);
+    chain.push_back(&op);
+  }
+  EXPECT_THROW(ioUring->submitChain(folly::range(chain)), std::system_error);
+  EXPECT_EQ(0, ioUring->pending());
+  for (auto& op : ops) {
+    EXPECT_EQ(folly::AsyncBaseOp::State::INITIALIZED, op.state());
+  }
+}
+
 } // namespace async_base_test_lib_detail
 } // namespace test
 } // namespace folly
@@ -18,11 +18,13 @@
 
 #include <bitset>
 
+#include <folly/Conv.h>
 #include <folly/File.h>
 #include <folly/Random.h>
 #include <folly/coro/BlockingWait.h>
 #include <folly/coro/Collect.h>
 #include <folly/io/IOBuf.h>
+#include <folly/portability/Fcntl.h>
 #include <folly/portability/GTest.h>
 #include <folly/synchronization/Baton.h>
 
@@ -160,6 +162,85 @@ TEST_P(SimpleAsyncIOTest, DestroyWithPendingIO) {
   ASSERT_EQ(completed, numWrites);
 }
 
+TEST_P(SimpleAsyncIOTest, Chain) {
+  auto tmpfile = File::temporary();
+  int fd = tmpfile.fd();
+  SimpleAsyncIO aio(config_);
+  const std::string data("Parlor Tricks");
+  std::array<char, 128> buffer;
+
+  Baton done;
+  std::vector<int> results;
+  aio.submitChain(
+      SimpleAsyncIO::Chain()
+          .pwrite(fd, data.data(), data.size(), 0)
+          .fdatasync(fd)
+          .pread(fd, buffer.data(), data.size(), 0),
+      [&](std::vector<int> rcs) {
+        results = std::move(rcs);
+        done.post();
+      });
+  ASSERT_TRUE(done.try_wait_for(std::chrono::seconds(10)));
+  EXPECT_EQ(results, std::vector<int>({int(data.size()), 0, int(data.size())}));
+  EXPECT_EQ(memcmp(buffer.data(), data.data(), data.size()), 0);
+
+  // A short read stops the chain.
+  done.reset();
+  aio.submitChain(
+      SimpleAsyncIO::Chain()
+          .pread(fd, buffer.data(), buffer.size(), 0)
+          .pwrite(fd, buffer.data(), buffer.size(), 0),
+      [&](std::vector<int> rcs) {
+        results = std::move(rcs);
+        done.post();
+      });
+  ASSERT_TRUE(done.try_wait_for(std::chrono::seconds(10)));
+  EXPECT_EQ(results, std::vector<int>({int(data.size()), -ECANCELED}));
+}
+
+TEST_P(SimpleAsyncIOTest, ChainBusy) {
+  auto tmpfile = File::temporary();
+  int fd = tmpfile.fd();
+  SimpleAsyncIO aio(config_.setMaxRequests(2));
+
+  std::vector<int> results;
+  aio.submitChain(
+      SimpleAsyncIO::Chain().fsync(fd).fsync(fd).fsync(fd),
+      [&](std::vector<int> rcs) { results = std::move(rcs); });
+  EXPECT_EQ(results, std::vector<int>(3, -EBUSY));
+
+  // The requests are still free for a chain that fits.
+  Baton done;
+  aio.submitChain(
+      SimpleAsyncIO::Chain().fsync(fd).fsync(fd), [&](std::vector<int> rcs) {
+        results = std::move(rcs);
+        done.post();
+      });
+  ASSERT_TRUE(done.try_wait_for(std::chrono::seconds(10)));
+  EXPECT_EQ(results, std::vector<int>({0, 0}));
+}
+
+TEST_P(SimpleAsyncIOTest, ChainError) {
+  auto tmpfile = File::temporary();
+  File readOnly(to<std::string>("/proc/self/fd/", tmpfile.fd()), O_RDONLY);
+  SimpleAsyncIO aio(config_);
+  const std::string data("Vienna Teng");
+
+  // A failed IO stops the chain, as a short one does.
+  Baton done;
+  std::vector<int> results;
+  aio.submitChain(
+      SimpleAsyncIO::Chain()
+          .pwrite(readOnly.fd(), data.data(), data.size(), 0)
+          .fsync(tmpfile.fd()),
+      [&](std::vector<int> rcs) {
+        results = std::move(rcs);
+        done.post();
+      });
+  ASSERT_TRUE(done.try_wait_for(std::chrono::seconds(10)));
+  EXPECT_EQ(results, std::vector<int>({-EBADF, -ECANCELED}));
+}
+
 #if FOLLY_HAS_COROUTINES
 static folly::coro::Task<folly::Unit> doCoAsyncWrites(
     SimpleAsyncIO& aio, int fd, std::string const& data, int copies) {
@@ -207,6 +288,26 @@ TEST_P(SimpleAsyncIOTest, CoroutineReadWrite) {
   folly::coro::blockingWait(doCoAsyncWrites(aio, fd, testStr, 10));
   folly::coro::blockingWait(doCoAsyncReads(aio, fd, testStr, 10));
 }
+
+TEST_P(SimpleAsyncIOTest, CoroutineChainCopy) {
+  auto src = File::temporary();
+  auto dst = File::temporary();
+  SimpleAsyncIO aio(config_);
+  const std::string data = makeRandomBinaryString(4096);
+  ASSERT_EQ(data.size(), ::pwrite(src.fd(), data.data(), data.size(), 0));
+
+  std::string buffer(data.size(), '\0');
+  auto results = folly::coro::blockingWait(aio.co_submitChain(
+      SimpleAsyncIO::Chain()
+          .pread(src.fd(), buffer.data(), buffer.size(), 0)
+          .pwrite(dst.fd(), buffer.data(), buffer.size(), 0)
+          .fsync(dst.fd())));
+  EXPECT_EQ(results, std::vector<int>({4096, 4096, 0}));
+
+  std::string copy(data.size(), '\0');
+  ASSERT_EQ(copy.size(), ::pread(dst.fd(), copy.data(), copy.size(), 0));
+  EXPECT_EQ(data, copy);
+}
 #endif // FOLLY_HAS_COROUTINES
 
 INSTANTIATE_TEST_SUITE_P(
@@ -33,6 +33,8 @@
 #include <folly/lang/SafeAssert.h>
 #include <folly/synchronization/AtomicStruct.h>
 #include <folly/synchronization/SaturatingSemaphore.h>
+#include <folly/synchronization/WaitOptions.h>
+#include <folly/synchronization/detail/Spin.h>
 
 namespace folly {
 
@@ -492,22 +494,32 @@ struct LifoSemBase {
   /// has been shut down and this method would otherwise be blocking.
   /// Note that wait() doesn't throw during shutdown if tryWait() would
   /// return true
-  void wait() {
+  ///
+  /// opt.spin_max() is how long the waiter spins for a post before it
+  /// blocks.
+  void wait(const WaitOptions& opt = {}) {
     auto const deadline = std::chrono::steady_clock::time_point::max();
-    auto res = try_wait_until(deadline);
+    auto res = try_wait_until(deadline, opt);
     FOLLY_SAFE_DCHECK(res, "infinity time has passed");
   }
 
   bool try_wait() { return tryWait(); }
 
+  /// If stats is given, the time the wait spun and blocked is added to it.
   template <typename Rep, typename Period>
-  bool try_wait_for(const std::chrono::duration<Rep, Period>& timeout) {
-    return try_wait_until(timeout + std::chrono::steady_clock::now());
+  bool try_wait_for(
+      const std::chrono::duration<Rep, Period>& timeout,
+      const WaitOptions& opt = {},
+      WaitStats* stats = nullptr) {
+    return try_wait_until(
+        timeout + std::chrono::steady_clock::now(), opt, stats);
   }
 
   template <typename Clock, typename Duration>
   bool try_wait_until(
-      const std::chrono::time_point<Clock, Duration>& deadline) {
+      const std::chrono::time_point<Clock, Duration>& deadline,
+      const WaitOptions& opt = {},
+      WaitStats* stats = nullptr) {
     // early check isn't required for correctness, but is an important
     // perf win if we can avoid allocating and deallocating a node
     if (tryWait()) {
@@ -525,7 +537,10 @@ struct LifoSemBase {
     }
 
     if (rv == WaitResult::PUSH) {
-      if (!node->handoff().try_wait_until(deadline)) {
+      bool posted = FOLLY_UNLIKELY(stats != nullptr)
+          ? tryWaitForHandoff(*node, deadline, opt, *stats)
+          : node->handoff().try_wait_until(deadline, opt);
+      if (!posted) {
         if (tryRemoveNode(*node)) {
           return false;
         } else {
@@ -578,6 +593,29 @@ struct LifoSemBase {
       unique_ptr<LifoSemNode<Handoff, Atom>, LifoSemNodeRecycler<Handoff, Atom>>
           UniquePtr;
 
+  /// Like node.handoff().try_wait_until(deadline, opt), but spins for the
+  /// post here rather than in the handoff, to time the spinning and the
+  /// blocking separately.
+  template <typename Clock, typename Duration>
+  bool tryWaitForHandoff(
+      LifoSemNode<Handoff, Atom>& node,
+      const std::chrono::time_point<Clock, Duration>& deadline,
+      const WaitOptions& opt,
+      WaitStats& stats) {
+    auto const spinStart = std::chrono::steady_clock::now();
+    auto res = detail::spin_pause_until(
+        deadline, opt, [&] { return node.handoff().try_wait(); });
+    auto const parkStart = std::chrono::steady_clock::now();
+    stats.spin += parkStart - spinStart;
+    if (res != detail::spin_result::advance) {
+      return res == detail::spin_result::success;
+    }
+    auto parkOpt = opt;
+    bool posted = node.handoff().try_wait_until(deadline, parkOpt.spin_max({}));
+    stats.park += std::chrono::steady_clock::now() - parkStart;
+    return posted;
+  }
+
   /// Returns a node that can be passed to decrOrLink
   template <typename... Args>
   UniquePtr allocateNode(Args&&... args) {
@@ -161,27 +161,34 @@ class StripedThrottledLifoSem {
     return *res;
   }
 
+  // If stats is given, the time the wait spun and blocked is added to it.
   template <typename Rep, typename Period>
   std::optional<size_t> try_wait_for(
       size_t preferredStripeIdx,
       const std::chrono::duration<Rep, Period>& timeout,
-      const WaitOptions& opt = {}) {
+      const WaitOptions& opt = {},
+      WaitStats* stats = nullptr) {
     return try_wait_until(
-        preferredStripeIdx, timeout + std::chrono::steady_clock::now(), opt);
+        preferredStripeIdx,
+        timeout + std::chrono::steady_clock::now(),
+        opt,
+        stats);
   }
 
   template <typename Clock, typename Duration>
   std::optional<size_t> try_wait_until(
       size_t preferredStripeIdx,
       const std::chrono::time_point<Clock, Duration>& deadline,
-      const WaitOptions& opt = {}) {
+      const WaitOptions& opt = {},
+      WaitStats* stats = nullptr) {
     // First see if we can get a post from any stripe.
     if (auto res = try_wait(preferredStripeIdx)) {
       return res;
     }
 
     // No luck. Wait on the local stripe.
-    if (!stripes_[preferredStripeIdx].sem.try_wait_until(deadline, opt)) {
+    if (!stripes_[preferredStripeIdx].sem.try_wait_until(
+            deadline, opt, stats)) {
       return std::nullopt; // Timed out.
     }
     // We got a wake-up, we're entitled to a post.
@@ -103,17 +103,21 @@ class ThrottledLifoSem {
     FOLLY_SAFE_DCHECK(res, "infinity time has passed");
   }
 
+  // If stats is given, the time the wait spun and blocked is added to it.
   template <typename Rep, typename Period>
   bool try_wait_for(
       const std::chrono::duration<Rep, Period>& timeout,
-      const WaitOptions& opt = {}) {
-    return try_wait_until(timeout + std::chrono::steady_clock::now(), opt);
+      const WaitOptions& opt = {},
+      WaitStats* stats = nullptr) {
+    return try_wait_until(
+        timeout + std::chrono::steady_clock::now(), opt, stats);
   }
 
   template <typename Clock, typename Duration>
   bool try_wait_until(
       const std::chrono::time_point<Clock, Duration>& deadline,
-      const WaitOptions& opt = {}) {
+      const WaitOptions& opt = {},
+      WaitStats* stats = nullptr) {
     // Fast path, avoid incrementing num waiters if value is positive.
     if (try_wait()) {
       return true;
@@ -121,9 +125,19 @@ class ThrottledLifoSem {
 
     state_.fetch_add(kNumWaitersInc, std::memory_order_seq_cst);
 
-    switch (detail::spin_pause_until(deadline, opt, [this] {
+    std::chrono::steady_clock::time_point spinStart;
+    if (FOLLY_UNLIKELY(stats != nullptr)) {
+      spinStart = std::chrono::steady_clock::now();
+    }
+    auto res = detail::spin_pause_until(deadline, opt, [this] {
       return tryWaitImpl<DecrNumWaiters::OnSuccess>();
-    })) {
+    });
+    std::chrono::steady_clock::time_point parkStart;
+    if (FOLLY_UNLIKELY(stats != nullptr)) {
+      parkStart = std::chrono::steady_clock::now();
+      stats->spin += parkStart - spinStart;
+    }
+    switch (res) {
       case detail::spin_result::success:
         return true;
       case detail::spin_result::timeout:
@@ -132,7 +146,12 @@ class ThrottledLifoSem {
         break;
     }
 
-    return tryWaitUntilSlow(deadline);
+    if (FOLLY_LIKELY(stats == nullptr)) {
+      return tryWaitUntilSlow(deadline);
+    }
+    bool posted = tryWaitUntilSlow(deadline);
+    stats->park += std::chrono::steady_clock::now() - parkStart;
+    return posted;
   }
 
   uint32_t valueGuess() const {
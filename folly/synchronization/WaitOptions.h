@@ -72,4 +72,14 @@ class WaitOptions {
   bool logging_enabled_ = Defaults::logging_enabled;
 };
 
+/// WaitStats
+///
+/// How waits spent their time: spinning for a wake-up, for up to the
+/// spin_max() of their WaitOptions, and blocked after that. The waits that
+/// take one add to it; a wait that did not have to wait adds nothing.
+struct WaitStats {
+  std::chrono::nanoseconds spin{0};
+  std::chrono::nanoseconds park{0};
+};
+
 } // namespace folly
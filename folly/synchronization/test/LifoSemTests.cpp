@@ -48,6 +48,35 @@ TEST(LifoSem, basic) {
   sem.wait();
 }
 
+TEST(LifoSem, waitStats) {
+  using namespace std::chrono_literals;
+  LifoSem sem;
+  WaitStats stats;
+  // Spins for the whole window, then blocks until the deadline.
+  EXPECT_FALSE(sem.try_wait_for(50ms, WaitOptions().spin_max(1ms), &stats));
+  EXPECT_GE(stats.spin, 1ms);
+  EXPECT_LT(stats.spin, 50ms);
+  EXPECT_GE(stats.park, 25ms);
+
+  // Posted while spinning.
+  stats = {};
+  std::thread poster([&] {
+    /* sleep override */ std::this_thread::sleep_for(1ms);
+    sem.post();
+  });
+  EXPECT_TRUE(sem.try_wait_for(10s, WaitOptions().spin_max(10s), &stats));
+  poster.join();
+  EXPECT_GT(stats.spin, 0ns);
+  EXPECT_EQ(stats.park, 0ns);
+
+  // Does not wait.
+  stats = {};
+  sem.post();
+  EXPECT_TRUE(sem.try_wait_for(10s, WaitOptions(), &stats));
+  EXPECT_EQ(stats.spin, 0ns);
+  EXPECT_EQ(stats.park, 0ns);
+}
+
 TEST(LifoSem, multi) {
   LifoSem sem;
 
@@ -53,6 +53,37 @@ TEST(ThrottledLifoSem, Basic) {
   EXPECT_FALSE(sem.try_wait_for(std::chrono::milliseconds(1)));
 }
 
+TEST(ThrottledLifoSem, WaitStats) {
+  using namespace std::chrono_literals;
+  folly::ThrottledLifoSem sem;
+  folly::WaitStats stats;
+  // Spins for the whole window, then blocks until the deadline.
+  EXPECT_FALSE(
+      sem.try_wait_for(50ms, folly::WaitOptions{}.spin_max(1ms), &stats));
+  EXPECT_GE(stats.spin, 1ms);
+  EXPECT_LT(stats.spin, 50ms);
+  EXPECT_GE(stats.park, 25ms);
+
+  // Posted while spinning.
+  stats = {};
+  std::thread poster([&] {
+    /* sleep override */ std::this_thread::sleep_for(1ms);
+    sem.post();
+  });
+  EXPECT_TRUE(
+      sem.try_wait_for(10s, folly::WaitOptions{}.spin_max(10s), &stats));
+  poster.join();
+  EXPECT_GT(stats.spin, 0ns);
+  EXPECT_EQ(stats.park, 0ns);
+
+  // Does not wait.
+  stats = {};
+  sem.post();
+  EXPECT_TRUE(sem.try_wait_for(10s, folly::WaitOptions{}, &stats));
+  EXPECT_EQ(stats.spin, 0ns);
+  EXPECT_EQ(stats.park, 0ns);
+}
+
 TEST(ThrottledLifoSem, Timeouts) {
   constexpr auto kWakeUpInterval = std::chrono::milliseconds(200);
 
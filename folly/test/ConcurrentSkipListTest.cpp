@@ -17,8 +17,10 @@
 #include <folly/ConcurrentSkipList.h>
 
 #include <atomic>
+#include <limits>
 #include <memory>
 #include <set>
+#include <stdexcept>
 #include <system_error>
 #include <thread>
 #include <vector>
@@ -28,6 +30,7 @@
 #include <folly/Memory.h>
 #include <folly/String.h>
 #include <folly/container/Foreach.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/memory/Arena.h>
 #include <folly/portability/GFlags.h>
 #include <folly/portability/GTest.h>
@@ -497,6 +500,179 @@ TEST(ConcurrentSkipList, NonTrivialDeallocationWithSysArena) {
   TestNonTrivialDeallocation(list);
 }
 
+TEST(ConcurrentSkipList, CreateFromSorted) {
+  {
+    std::vector<ValueType> empty;
+    SkipListAccessor skipList(
+        SkipListType::createInstanceFromSorted(empty.begin(), empty.end()));
+    EXPECT_TRUE(skipList.empty());
+    EXPECT_TRUE(skipList.first() == nullptr);
+    skipList.add(1);
+    EXPECT_TRUE(skipList.contains(1));
+  }
+
+  for (int n : {1, 2, 10, 1000, 100000}) {
+    vector<ValueType> values;
+    SetType verifier;
+    for (int i = 0; i < n; ++i) {
+      // Every third value is repeated.
+      values.push_back(2 * i);
+      if (i % 3 == 0) {
+        values.push_back(2 * i);
+      }
+      verifier.insert(2 * i);
+    }
+    SkipListAccessor skipList(
+        SkipListType::createInstanceFromSorted(values.begin(), values.end()));
+    verifyEqual(skipList, verifier);
+    EXPECT_EQ(0, *skipList.first());
+    EXPECT_EQ(2 * (n - 1), *skipList.last());
+
+    // The list behaves like one built by add() from here on.
+    SkipListAccessor::Skipper skipper(skipList);
+    for (int i = 0; i < 2 * n; ++i) {
+      EXPECT_EQ(i % 2 == 0, skipper.to(i));
+    }
+    randomAdding(1000, skipList, &verifier, 2 * n);
+    randomRemoval(1000, skipList, &verifier, 2 * n);
+    for (int v = 0; v < 2 * n; ++v) {
+      skipList.remove(v);
+    }
+    EXPECT_TRUE(skipList.empty());
+  }
+}
+
+TEST(ConcurrentSkipList, CreateFromSortedStrings) {
+  using SkipListT = folly::ConcurrentSkipList<std::string>;
+  std::vector<std::string> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.push_back(makeRandomeString(5));
+  }
+  std::sort(values.begin(), values.end());
+  SkipListT::Accessor skipList(SkipListT::createInstanceFromSorted(
+      std::make_move_iterator(values.begin()),
+      std::make_move_iterator(values.end())));
+  EXPECT_TRUE(std::is_sorted(skipList.begin(), skipList.end()));
+  EXPECT_EQ(
+      std::set<std::string>(skipList.begin(), skipList.end()).size(),
+      skipList.size());
+}
+
+TEST(ConcurrentSkipList, CreateFromSortedParallel) {
+  CPUThreadPoolExecutor executor(4);
+  for (int n : {0, 3, 1000, 100000}) {
+    for (size_t chunks : {1, 4, 16}) {
+      vector<ValueType> values;
+      SetType verifier;
+      for (int i = 0; i < n; ++i) {
+        // Long runs of duplicates exercise the chunk boundary adjustment.
+        values.push_back(i / 7);
+        verifier.insert(i / 7);
+      }
+      SkipListAccessor skipList(SkipListType::createInstanceFromSorted(
+          executor, chunks, values.begin(), values.end()));
+      verifyEqual(skipList, verifier);
+      randomAdding(1000, skipList, &verifier, n / 7 + 1);
+      verifyEqual(skipList, verifier);
+    }
+  }
+}
+
+TEST(ConcurrentSkipList, CreateFromSortedWithArena) {
+  using SysArenaSkipListType = ConcurrentSkipList<
+      NonTrivialValue,
+      std::less<NonTrivialValue>,
+      SysArenaAllocator<char>>;
+  SysArena arena;
+  SysArenaAllocator<char> alloc(arena);
+  std::vector<NonTrivialValue> values;
+  for (int i = 0; i < 100; ++i) {
+    values.emplace_back(i);
+  }
+  auto list = SysArenaSkipListType::createInstanceFromSorted(
+      values.begin(), values.end(), alloc);
+  EXPECT_EQ(100, list->size());
+}
+
+// Throws from its copy constructor once copiesLeft reaches 0.
+struct ThrowOnCopyValue {
+  static std::atomic<int> instances;
+  static std::atomic<int> copiesLeft;
+
+  ThrowOnCopyValue() : ThrowOnCopyValue(0) {}
+  explicit ThrowOnCopyValue(int v) : value(v) { ++instances; }
+  ThrowOnCopyValue(const ThrowOnCopyValue& other) : value(other.value) {
+    if (copiesLeft-- == 0) {
+      throw std::runtime_error("copy");
+    }
+    ++instances;
+  }
+  ~ThrowOnCopyValue() { --instances; }
+
+  bool operator<(const ThrowOnCopyValue& rhs) const {
+    return value < rhs.value;
+  }
+
+  int value;
+};
+
+std::atomic<int> ThrowOnCopyValue::instances(0);
+std::atomic<int> ThrowOnCopyValue::copiesLeft(
+    std::numeric_limits<int>::max());
+
+TEST(ConcurrentSkipList, CreateFromSortedThrows) {
+  using SkipListT = ConcurrentSkipList<ThrowOnCopyValue>;
+  CPUThreadPoolExecutor executor(4);
+  std::vector<ThrowOnCopyValue> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.emplace_back(i);
+  }
+  for (int copies : {0, 1, 500, 999}) {
+    ThrowOnCopyValue::copiesLeft = copies;
+    EXPECT_THROW(
+        SkipListT::createInstanceFromSorted(values.begin(), values.end()),
+        std::runtime_error);
+    EXPECT_EQ(int(values.size()), ThrowOnCopyValue::instances.load());
+
+    ThrowOnCopyValue::copiesLeft = copies;
+    EXPECT_THROW(
+        SkipListT::createInstanceFromSorted(
+            executor, 4, values.begin(), values.end()),
+        std::runtime_error);
+    EXPECT_EQ(int(values.size()), ThrowOnCopyValue::instances.load());
+  }
+  ThrowOnCopyValue::copiesLeft = std::numeric_limits<int>::max();
+}
+
+TEST(ConcurrentSkipList, CreateFromSortedAddThrows) {
+  // Runs tasks on a pool, and throws from add() once addsLeft reaches 0.
+  struct ThrowingExecutor : Executor {
+    void add(Func f) override {
+      if (addsLeft-- == 0) {
+        throw std::runtime_error("add");
+      }
+      pool.add(std::move(f));
+    }
+    CPUThreadPoolExecutor pool{4};
+    int addsLeft;
+  };
+  using SkipListT = ConcurrentSkipList<ThrowOnCopyValue>;
+  std::vector<ThrowOnCopyValue> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.emplace_back(i);
+  }
+  for (int adds : {0, 1, 7}) {
+    ThrowingExecutor executor;
+    executor.addsLeft = adds;
+    EXPECT_THROW(
+        SkipListT::createInstanceFromSorted(
+            executor, 8, values.begin(), values.end()),
+        std::runtime_error);
+    // Whatever the scheduled chunks built was freed with the list.
+    EXPECT_EQ(int(values.size()), ThrowOnCopyValue::instances.load());
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {